@@ -8,6 +8,8 @@
 #include "Recording/IVRRenderFrameSource.h" 
 #include "IVR.h"
 #include "Engine/World.h" 
+#include "GameFramework/WorldSettings.h" // Para a dilatação de tempo efetiva
+#include "IVRCaptureClock.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Misc/Paths.h" 
 #include "Misc/FileHelper.h" 
@@ -16,14 +18,21 @@
 #include "Engine/Texture2D.h" 
 #include "RenderingThread.h"
 #include "Async/Async.h" // Para AsyncTask (ainda necessário para StartRecording)
+#include "Misc/ScopeLock.h"
 // [MANUAL_REF_POINT] Includes do OpenCV foram movidos para IVROpenCVBridge.
 // Incluindo o bridge para chamar as funções OpenCV nativas
 #include "IVROpenCVGlobals.h"
+#include "IVR_FeatureCache.h" // Cache de features por hash do frame
+#include "IVR_CVStageGraph.h" // Grafo de etapas de visão (etapas próprias + tempos por etapa)
 // Forward declarations de FRunnables que agora estão em IVROpenCVBridge
 // UIVRVideoEncoder usará FVideoEncoderWorker, então precisa do .h dele
 #include "FVideoEncoderWorker.h"
 // Removido: UIVRFramePool; struct FIVR_JustRTFrame; Essas estão no IVRTypes.h agora
 
+const FName UIVRCaptureComponent::RecordingSinkName(TEXT("IVR.Recording"));
+const FName UIVRCaptureComponent::RealTimeSinkName(TEXT("IVR.RealTime"));
+const FName UIVRCaptureComponent::SharedRingSinkName(TEXT("IVR.SharedMemoryRing"));
+
 UIVRCaptureComponent::UIVRCaptureComponent()
 {
     PrimaryComponentTick.bCanEverTick = true;
@@ -61,6 +70,12 @@ void UIVRCaptureComponent::BeginDestroy()
         OwnedVideoCaptureComponent = nullptr;
     }
     StopRecording(); // Força a parada de qualquer gravação ativa quando o componente é destruído.
+    if (FrameFanOut.IsValid())
+    {
+        FrameFanOut->RemoveAllSinks(); // Antes do anel: o sink de memória compartilhada escreve nele
+    }
+    ShutdownFeatureWorkerPool();
+    SharedFrameRing.Close();
     // A sessão de gravação é gerenciada pelo UIVRRecordingManager e CurrentSession é Transient.
     // Não precisa de limpeza explícita aqui para CurrentSession.
 
@@ -82,6 +97,12 @@ void UIVRCaptureComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
         CurrentFrameSource = nullptr;
         UE_LOG(LogIVR, Log, TEXT("UIVRCaptureComponent: CurrentFrameSource encerrado."));
     }
+    if (FrameFanOut.IsValid())
+    {
+        FrameFanOut->RemoveAllSinks();
+    }
+    ShutdownFeatureWorkerPool();
+    SharedFrameRing.Close();
     // Não destruímos OwnedVideoCaptureComponent aqui, pois BeginDestroy já fará isso se for de nossa propriedade.
     // Apenas garantimos que a referência seja nula.
     OwnedVideoCaptureComponent = nullptr; 
@@ -90,6 +111,13 @@ void UIVRCaptureComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 void UIVRCaptureComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
 {
     Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+    // Ancora o relógio de captura ao tempo do mundo, para que timestamps de qualquer fonte possam ser convertidos.
+    if (UWorld* World = GetWorld())
+    {
+        const AWorldSettings* WorldSettings = World->GetWorldSettings();
+        const float EffectiveDilation = World->IsPaused() ? 0.0f : (WorldSettings ? WorldSettings->GetEffectiveTimeDilation() : 1.0f);
+        FIVR_CaptureClock::Get().SyncWorldTime(World->GetTimeSeconds(), EffectiveDilation);
+    }
     if (OwnedVideoCaptureComponent && VideoSettings.FrameSourceType == EIVRFrameSourceType::RenderTarget && VideoSettings.IVR_FollowActor)
     {
         if (VideoSettings.IVR_FollowActor->IsValidLowLevel())
@@ -172,6 +200,8 @@ void UIVRCaptureComponent::StartRecording()
                 UIVRRecordingManager::Get()->SetGeneratingMasterVideo(false); // Garantir que o manager não esteja ocupado se StartRecording falhou internamente
                 return;
             }
+            StrongThis->CurrentSession->OnFrameDropBurst.AddDynamic(StrongThis, &UIVRCaptureComponent::HandleSessionFrameDropBurst);
+            StrongThis->RebuildBuiltInFrameSinks(); // bEnableRTFrames/IVR_RecordAlongsideRealTime podem ter mudado desde o BeginPlay
             
             if (StrongThis->CurrentFrameSource)
             {
@@ -301,7 +331,7 @@ void UIVRCaptureComponent::StopRecording()
 
     if (StrongThis->bIsRecording)
     {
-        if (!StrongThis->VideoSettings.bEnableRTFrames) 
+        if (StrongThis->IsRecordingSinkEnabled()) 
         {
             StrongThis->EndCurrentTake();
             UIVRRecordingManager::Get()->GenerateMasterVideoAndCleanup();
@@ -390,6 +420,7 @@ void UIVRCaptureComponent::StartNewTake()
         return;
     }
 
+    CurrentSession->OnFrameDropBurst.AddDynamic(this, &UIVRCaptureComponent::HandleSessionFrameDropBurst);
     CurrentTakeTime = 0.0f;
     CurrentTakeNumber++;
     UE_LOG(LogIVR, Log, TEXT("UIVRCaptureComponent: Take %d iniciado."), CurrentTakeNumber);
@@ -403,83 +434,432 @@ void UIVRCaptureComponent::EndCurrentTake()
         UE_LOG(LogIVR, Log, TEXT("UIVRCaptureComponent: Take %d finalizado."), CurrentTakeNumber);
     }
 }
+FIVR_BackpressureStats UIVRCaptureComponent::GetBackpressureStats() const
+{
+    return CurrentSession ? CurrentSession->GetBackpressureStats() : FIVR_BackpressureStats();
+}
+void UIVRCaptureComponent::HandleSessionFrameDropBurst(EIVRBackpressurePolicy Policy, const FIVR_BackpressureStats& Stats)
+{
+    OnFrameDropBurst.Broadcast(Policy, Stats);
+}
+FString UIVRCaptureComponent::GetSharedFrameRingName() const
+{
+    return SharedFrameRing.IsOpen() ? SharedFrameRing.GetSystemName() : FString();
+}
 void UIVRCaptureComponent::OnFrameAcquiredFromSource(FIVR_VideoFrame Frame)
 {
-    if (bIsRecording)
+    // Um único buffer para todos os consumidores: o fan-out o compartilha e cada sink roda na sua lane.
+    FIVR_FrameSinkPacket Packet;
+    Packet.Frame = MoveTemp(Frame);
+    // O contexto da câmera é lido aqui, na Game Thread, para que sinks de background não toquem no componente de cena.
+    if (OwnedVideoCaptureComponent)
     {
-        if (!VideoSettings.bEnableRTFrames) 
+        Packet.CameraTransform = OwnedVideoCaptureComponent->GetComponentTransform();
+        Packet.CameraFOV = OwnedVideoCaptureComponent->FOVAngle;
+    }
+    GetOrCreateFrameFanOut().Dispatch(MoveTemp(Packet));
+}
+FIVR_FrameFanOut& UIVRCaptureComponent::GetOrCreateFrameFanOut()
+{
+    if (!FrameFanOut.IsValid())
+    {
+        FrameFanOut = MakeUnique<FIVR_FrameFanOut>(FramePool);
+    }
+    return *FrameFanOut;
+}
+void UIVRCaptureComponent::AddFrameSink(const TSharedRef<IIVRFrameSink, ESPMode::ThreadSafe>& Sink)
+{
+    GetOrCreateFrameFanOut().AddSink(Sink);
+}
+bool UIVRCaptureComponent::RemoveFrameSink(FName SinkName)
+{
+    return FrameFanOut.IsValid() && FrameFanOut->RemoveSink(SinkName);
+}
+TArray<FIVR_FrameSinkStats> UIVRCaptureComponent::GetFrameSinkStats() const
+{
+    return FrameFanOut.IsValid() ? FrameFanOut->GetSinkStats() : TArray<FIVR_FrameSinkStats>();
+}
+FIVR_FeatureWorkerPoolStats UIVRCaptureComponent::GetFeatureWorkerPoolStats() const
+{
+    return FeatureWorkerPool.IsValid() ? FeatureWorkerPool->GetStats() : FIVR_FeatureWorkerPoolStats();
+}
+void UIVRCaptureComponent::AddFeatureStage(const TSharedRef<IVROpenCVBridge::FOCV_CVStage, ESPMode::ThreadSafe>& Stage)
+{
+    const FName StageName = Stage->GetName();
+    CustomFeatureStages.RemoveAll([StageName](const TSharedRef<IVROpenCVBridge::FOCV_CVStage, ESPMode::ThreadSafe>& Existing) { return Existing->GetName() == StageName; });
+    CustomFeatureStages.Add(Stage);
+    if (FeatureGraph.IsValid())
+    {
+        FeatureGraph->AddStage(Stage); // Frames já enviados terminam com o plano antigo
+    }
+}
+bool UIVRCaptureComponent::RemoveFeatureStage(FName StageName)
+{
+    const int32 NumRemoved = CustomFeatureStages.RemoveAll([StageName](const TSharedRef<IVROpenCVBridge::FOCV_CVStage, ESPMode::ThreadSafe>& Existing) { return Existing->GetName() == StageName; });
+    if (NumRemoved > 0 && FeatureGraph.IsValid())
+    {
+        // Sai só essa etapa (os tempos das demais são mantidos); se ela substituía uma embutida ainda pedida, a embutida volta
+        FeatureGraph->RemoveStage(StageName);
+        FeatureGraph->AddBuiltInStage(StageName, FeatureGraphStages);
+    }
+    return NumRemoved > 0;
+}
+TArray<IVROpenCVBridge::FOCV_StageTimingStats> UIVRCaptureComponent::GetFeatureStageTimings() const
+{
+    return FeatureGraph.IsValid() ? FeatureGraph->GetTimingStats() : TArray<IVROpenCVBridge::FOCV_StageTimingStats>();
+}
+void UIVRCaptureComponent::ShutdownFeatureWorkerPool()
+{
+    if (FeatureWorkerPool.IsValid())
+    {
+        FeatureWorkerPool->Shutdown();
+        FeatureWorkerPool.Reset();
+    }
+    FeatureTracker.Reset();
+    FeatureCache.Reset();
+    FeatureResultPool.Reset(); // Resultados ainda com listeners se liberam sozinhos
+    // O último frame do preview prende um buffer do pool; solto junto com o resto do caminho de tempo real
+    LastUploadedPixels.Reset();
+    LastUploadedTexture.Reset();
+    FScopeLock DiffBaseLock(&UploadDiffBase->Lock);
+    UploadDiffBase->Pixels.Reset();
+}
+bool UIVRCaptureComponent::IsRecordingSinkEnabled() const
+{
+    return !VideoSettings.bEnableRTFrames || VideoSettings.IVR_RecordAlongsideRealTime;
+}
+void UIVRCaptureComponent::RebuildBuiltInFrameSinks()
+{
+    FIVR_FrameFanOut& FanOut = GetOrCreateFrameFanOut();
+    // Os sinks internos capturam 'this': o componente sempre os remove (esperando o consumo em andamento)
+    // no EndPlay/BeginDestroy, antes de ser destruído.
+    if (IsRecordingSinkEnabled())
+    {
+        if (!FanOut.HasSink(RecordingSinkName))
         {
-            if (CurrentSession)
-            {
-                CurrentSession->AddVideoFrame(Frame); 
-            }
-            else
+            // Inline: AddVideoFrame só enfileira; a própria sessão aplica a política de backpressure.
+            FIVR_FrameSinkLaneSettings Lane;
+            Lane.Lane = EIVRFrameSinkLane::Inline;
+            FanOut.AddSink(MakeShared<FIVR_LambdaFrameSink, ESPMode::ThreadSafe>(RecordingSinkName, Lane, [this](FIVR_FrameSinkPacket& Packet)
             {
-                UE_LOG(LogIVR, Warning, TEXT("UIVRCaptureComponent: Descartando frame - nenhuma sessão de gravação disponível."));
-                if (FramePool && Frame.RawDataPtr.IsValid())
+                if (!bIsRecording)
                 {
-                    FramePool->ReleaseFrame(Frame.RawDataPtr);
+                    return false;
                 }
+                if (!CurrentSession)
+                {
+                    UE_LOG(LogIVR, Warning, TEXT("UIVRCaptureComponent: Descartando frame - nenhuma sessão de gravação disponível."));
+                    return false;
+                }
+                CurrentSession->AddVideoFrame(Packet.Frame); // A sessão devolve o buffer ao pool
+                return true;
+            }));
+        }
+    }
+    else
+    {
+        FanOut.RemoveSink(RecordingSinkName);
+    }
+
+    if (VideoSettings.bEnableRTFrames)
+    {
+        // O rastreamento depende do frame anterior: com ele ativo, um único worker mantém os frames em ordem
+        const int32 NumFeatureWorkers = VideoSettings.IVR_EnableFeatureTracking ? 1 : FMath::Clamp(VideoSettings.IVR_FeatureWorkerCount, 1, 8);
+        if (FeatureWorkerPool.IsValid() && FeatureWorkerPool->GetNumWorkers() != NumFeatureWorkers)
+        {
+            ShutdownFeatureWorkerPool();
+        }
+        if (!FeatureWorkerPool.IsValid())
+        {
+            FeatureWorkerPool = MakeShared<FIVR_FeatureWorkerPool, ESPMode::ThreadSafe>();
+            if (!FeatureWorkerPool->Start(NumFeatureWorkers, TEXT("IVRFeatureWorkers")))
+            {
+                FeatureWorkerPool.Reset();
             }
         }
-        else // Modo JustRTCapture (saída em tempo real)
+        if (!VideoSettings.IVR_EnableFeatureTracking)
         {
-            FIVR_JustRTFrame FrameOutput; 
-            FrameOutput.Width = Frame.Width;
-            FrameOutput.Height = Frame.Height;
-            FrameOutput.Timestamp = Frame.Timestamp;
-            FrameOutput.SourceFrameTint = VideoSettings.IVR_FrameTint;
-            FrameOutput.RawDataBuffer = *Frame.RawDataPtr; 
-            
-            if (FramePool && Frame.RawDataPtr.IsValid()) 
+            FeatureTracker.Reset();
+        }
+        else if (!FeatureTracker.IsValid())
+        {
+            FeatureTracker = MakeShared<IVROpenCVBridge::FOCV_FeatureTracker, ESPMode::ThreadSafe>();
+        }
+        if (!FeatureResultPool.IsValid())
+        {
+            FeatureResultPool = MakeShared<FIVR_FeatureResultPool, ESPMode::ThreadSafe>();
+        }
+        // Só fontes que repetem frames idênticos (loop de pasta, frames simulados) compensam o hash por frame;
+        // Render Target, Webcam e Video File quase nunca repetem e pagariam o hash à toa.
+        const bool bSourceRepeatsFrames = VideoSettings.FrameSourceType == EIVRFrameSourceType::Folder ||
+                                          VideoSettings.FrameSourceType == EIVRFrameSourceType::Simulated;
+        const int32 FeatureCacheSize = bSourceRepeatsFrames ? FMath::Clamp(VideoSettings.IVR_FeatureCacheSize, 0, 256) : 0;
+        if (FeatureCacheSize == 0)
+        {
+            FeatureCache.Reset();
+        }
+        else if (!FeatureCache.IsValid() || FeatureCache->GetCapacity() != FeatureCacheSize)
+        {
+            FeatureCache = MakeShared<FIVR_FeatureCache, ESPMode::ThreadSafe>(FeatureCacheSize);
+        }
+        if (!FanOut.HasSink(RealTimeSinkName))
+        {
+            // Lane inline: o sink só captura as configurações e envia o frame ao FeatureWorkerPool, que já
+            // descarta os frames velhos quando todos os workers estão ocupados.
+            FIVR_FrameSinkLaneSettings Lane;
+            Lane.Lane = EIVRFrameSinkLane::Inline;
+            FanOut.AddSink(MakeShared<FIVR_LambdaFrameSink, ESPMode::ThreadSafe>(RealTimeSinkName, Lane, [this](FIVR_FrameSinkPacket& Packet)
+            {
+                return bIsRecording && SubmitRealTimeFrame(Packet);
+            }));
+        }
+    }
+    else
+    {
+        FanOut.RemoveSink(RealTimeSinkName);
+        ShutdownFeatureWorkerPool();
+    }
+
+    if (SharedFrameRing.IsOpen())
+    {
+        if (!FanOut.HasSink(SharedRingSinkName))
+        {
+            FIVR_FrameSinkLaneSettings Lane;
+            Lane.Lane = EIVRFrameSinkLane::Worker;
+            Lane.QueueDepth = 2;
+            Lane.DropPolicy = EIVRFrameSinkDropPolicy::DropOldest;
+            FanOut.AddSink(MakeShared<FIVR_LambdaFrameSink, ESPMode::ThreadSafe>(SharedRingSinkName, Lane, [this](FIVR_FrameSinkPacket& Packet)
             {
-                FramePool->ReleaseFrame(Frame.RawDataPtr);
+                SharedFrameRing.Publish(Packet.Frame);
+                return false;
+            }));
+        }
+    }
+    else
+    {
+        FanOut.RemoveSink(SharedRingSinkName);
+    }
+}
+bool UIVRCaptureComponent::SubmitRealTimeFrame(FIVR_FrameSinkPacket& Packet)
+{
+    if (!FeatureWorkerPool.IsValid() || !Packet.Frame.RawDataPtr.IsValid())
+    {
+        return false;
+    }
+    // Tudo que o job precisa é capturado aqui, na Game Thread; o worker não toca no componente.
+    FIVR_JustRTFrame FrameOutput;
+    FrameOutput.Width = Packet.Frame.Width;
+    FrameOutput.Height = Packet.Frame.Height;
+    // JustRT entrega o tempo do mundo correspondente ao instante da captura (relógio único para todas as fontes).
+    double FrameWorldSeconds = 0.0;
+    FrameOutput.Timestamp = FIVR_CaptureClock::Get().MapToWorldSeconds(Packet.Frame.TimestampNs, FrameWorldSeconds) ? (float)FrameWorldSeconds : Packet.Frame.Timestamp;
+    FrameOutput.SourceFrameTint = VideoSettings.IVR_FrameTint;
+    FrameOutput.LiveTexture = RealTimeOutputTexture2D;
+    FrameOutput.DisplayTint = RTDisplayTint;
+
+    const bool bDebugDrawFeatures = VideoSettings.IVR_DebugDrawFeatures;
+    // Os bits de EIVRFeatureStage coincidem com os de EOCV_FeatureStage; o overlay de debug é um bit só do bridge.
+    EOCV_FeatureStage FeatureStages = (EOCV_FeatureStage)((uint32)VideoSettings.IVR_FeatureStages & (uint32)(EOCV_FeatureStage::Corners | EOCV_FeatureStage::Quads | EOCV_FeatureStage::Histograms));
+    if (bDebugDrawFeatures)
+    {
+        // Como no caminho legado (ProcessFrameAndExtractFeatures), o desenho de debug inclui os cantos mesmo fora de IVR_FeatureStages.
+        FeatureStages |= EOCV_FeatureStage::Corners | EOCV_FeatureStage::DebugOverlay;
+    }
+    FOCV_FeatureStageParams FeatureParams;
+    FeatureParams.MaxCorners = VideoSettings.IVR_GFTT_MaxCorners;
+    FeatureParams.QualityLevel = VideoSettings.IVR_GFTT_QualityLevel;
+    FeatureParams.MinDistance = VideoSettings.IVR_GFTT_MinDistance;
+    FeatureParams.HistogramSubsample = FMath::Max(1, VideoSettings.IVR_HistogramSubsample);
+    FeatureParams.PyramidLevel = VideoSettings.IVR_FeaturePyramidLevel;
+    FeatureParams.MaxDetectionWidth = VideoSettings.IVR_FeatureDetectionMaxWidth;
+    FeatureParams.bRefineCornersAtFullResolution = VideoSettings.IVR_RefineCornersAtFullResolution;
+    GatherFeatureRegions(Packet.CameraTransform, Packet.CameraFOV, Packet.Frame.Width, Packet.Frame.Height, FeatureParams.Regions);
+    FOCV_TrackerSettings TrackerSettings;
+    TrackerSettings.KeyframeInterval = FMath::Max(1, VideoSettings.IVR_TrackingKeyframeInterval);
+    TrackerSettings.MinSurvivalRatio = FMath::Clamp(VideoSettings.IVR_TrackingMinSurvivalRatio, 0.0f, 1.0f);
+    // NOVO: Grafo de etapas do componente. Criado uma vez; quando as etapas pedidas mudam, só as embutidas que
+    // mudaram entram ou saem, e os tempos acumulados (GetFeatureStageTimings) são mantidos.
+    const bool bHasCustomStages = CustomFeatureStages.Num() > 0;
+    const bool bUseGraph = FeatureStages != EOCV_FeatureStage::None || bHasCustomStages;
+    if (bUseGraph)
+    {
+        if (!FeatureGraph.IsValid())
+        {
+            FeatureGraph = MakeShared<IVROpenCVBridge::FOCV_CVStageGraph, ESPMode::ThreadSafe>();
+            FeatureGraph->AddBuiltInStages(FeatureStages);
+            for (const TSharedRef<IVROpenCVBridge::FOCV_CVStage, ESPMode::ThreadSafe>& Stage : CustomFeatureStages)
+            {
+                FeatureGraph->AddStage(Stage);
             }
-            if (RTDisplayTint != FLinearColor::White)
+            FeatureGraphStages = FeatureStages;
+        }
+        else if (FeatureGraphStages != FeatureStages)
+        {
+            for (const EOCV_FeatureStage Flag : { EOCV_FeatureStage::Corners, EOCV_FeatureStage::Quads, EOCV_FeatureStage::Histograms, EOCV_FeatureStage::DebugOverlay })
             {
-                const int32 NumPixels = FrameOutput.Width * FrameOutput.Height;
-                for (int32 i = 0; i < NumPixels; ++i)
+                const bool bWanted = EnumHasAnyFlags(FeatureStages, Flag);
+                const FName StageName = IVROpenCVBridge::FOCV_CVStageGraph::GetBuiltInStageName(Flag);
+                // Uma etapa própria com o mesmo nome continua no lugar da embutida
+                if (bWanted == EnumHasAnyFlags(FeatureGraphStages, Flag) ||
+                    CustomFeatureStages.ContainsByPredicate([StageName](const TSharedRef<IVROpenCVBridge::FOCV_CVStage, ESPMode::ThreadSafe>& Existing) { return Existing->GetName() == StageName; }))
+                {
+                    continue;
+                }
+                if (bWanted)
                 {
-                    float B_float = (float)FrameOutput.RawDataBuffer[i * 4 + 0] / 255.0f; B_float *= RTDisplayTint.B;
-                    FrameOutput.RawDataBuffer[i * 4 + 0] = FMath::Clamp((uint8)(B_float * 255.0f), (uint8)0, (uint8)255);
-                    float G_float = (float)FrameOutput.RawDataBuffer[i * 4 + 1] / 255.0f; G_float *= RTDisplayTint.G;
-                    FrameOutput.RawDataBuffer[i * 4 + 1] = FMath::Clamp((uint8)(G_float * 255.0f), (uint8)0, (uint8)255);
-                    float R_float = (float)FrameOutput.RawDataBuffer[i * 4 + 2] / 255.0f; R_float *= RTDisplayTint.R;
-                    FrameOutput.RawDataBuffer[i * 4 + 2] = FMath::Clamp((uint8)(R_float * 255.0f), (uint8)0, (uint8)255);
-                    float A_float = (float)FrameOutput.RawDataBuffer[i * 4 + 3] / 255.0f; A_float *= RTDisplayTint.A;
-                    FrameOutput.RawDataBuffer[i * 4 + 3] = FMath::Clamp((uint8)(A_float * 255.0f), (uint8)0, (uint8)255);
+                    FeatureGraph->AddBuiltInStage(StageName, FeatureStages);
+                }
+                else
+                {
+                    FeatureGraph->RemoveStage(StageName);
                 }
             }
-            FrameOutput.LiveTexture = RealTimeOutputTexture2D;
-            FrameOutput.DisplayTint = RTDisplayTint; 
-            
-            FTransform CameraTransform = FTransform::Identity;
-            float CameraFOV = 90.0f;
-            if (OwnedVideoCaptureComponent)
+            FeatureGraphStages = FeatureStages;
+        }
+    }
+    // Sem etapas pedidas o grafo fica guardado (com seus tempos), mas não roda
+    TSharedPtr<IVROpenCVBridge::FOCV_CVStageGraph, ESPMode::ThreadSafe> Graph = bUseGraph ? FeatureGraph : nullptr;
+    // O job segura sua própria referência: um Reset do componente não destrói o rastreador no meio de um frame.
+    // Etapas próprias só existem no grafo, e seu resultado não é determinístico para o cache: os dois ficam de fora.
+    TSharedPtr<IVROpenCVBridge::FOCV_FeatureTracker, ESPMode::ThreadSafe> Tracker = bHasCustomStages ? nullptr : FeatureTracker;
+    TSharedPtr<FIVR_FeatureCache, ESPMode::ThreadSafe> Cache = bHasCustomStages ? nullptr : FeatureCache;
+    TSharedPtr<FIVR_FeatureResultPool, ESPMode::ThreadSafe> ResultPool = FeatureResultPool;
+    const bool bExpandFeatures = VideoSettings.IVR_ExpandFeaturesForBlueprint;
+    const FTransform CameraTransform = Packet.CameraTransform;
+    const float CameraFOV = Packet.CameraFOV;
+    // O pool só é liberado depois do FeatureWorkerPool (EndPlay/BeginDestroy), então o ponteiro bruto é seguro nos workers.
+    UIVRFramePool* Pool = FramePool;
+    TSharedPtr<TArray<uint8>> SourceBuffer = Packet.Frame.RawDataPtr;
+    TSharedRef<FUploadDiffBase, ESPMode::ThreadSafe> DiffBaseSource = UploadDiffBase;
+    TWeakObjectPtr<UIVRCaptureComponent> WeakThis = this;
+
+    FIVR_FeatureWorkerPool::FJob Job;
+    Job.Work = [FrameOutput = MoveTemp(FrameOutput), SourceBuffer, Pool, CameraTransform, CameraFOV, FeatureStages, FeatureParams, Tracker, TrackerSettings, Cache, Graph, ResultPool, bExpandFeatures, bDebugDrawFeatures, DiffBaseSource, WeakThis]() mutable -> TUniqueFunction<void()>
+    {
+        // O buffer do pool é compartilhado com os outros sinks e só pode ser lido. Uma cópia privada (também do pool)
+        // só é feita quando os pixels serão alterados pela tintura de exibição; o desenho de debug vai só para o preview.
+        const FLinearColor DisplayTint = FrameOutput.DisplayTint;
+        const bool bTint = DisplayTint != FLinearColor::White;
+        TSharedPtr<TArray<uint8>> PixelBuffer = SourceBuffer;
+        if (bTint)
+        {
+            PixelBuffer = Pool ? Pool->AcquireFrame() : nullptr;
+            if (!PixelBuffer.IsValid() || PixelBuffer->Num() != SourceBuffer->Num())
             {
-                CameraTransform = OwnedVideoCaptureComponent->GetComponentTransform();
-                CameraFOV = OwnedVideoCaptureComponent->FOVAngle;
+                PixelBuffer = MakeShared<TArray<uint8>>();
+                PixelBuffer->SetNumUninitialized(SourceBuffer->Num());
+            }
+            const uint8* Src = SourceBuffer->GetData();
+            uint8* Dst = PixelBuffer->GetData();
+            // Cópia e tintura em uma única passada (BGRA)
+            const float ChannelTint[4] = { DisplayTint.B, DisplayTint.G, DisplayTint.R, DisplayTint.A };
+            const int32 NumBytes = FMath::Min(SourceBuffer->Num(), FrameOutput.Width * FrameOutput.Height * 4);
+            for (int32 i = 0; i < NumBytes; ++i)
+            {
+                Dst[i] = (uint8)FMath::Clamp((float)Src[i] * ChannelTint[i & 3], 0.0f, 255.0f);
+            }
+            if (Pool)
+            {
+                Pool->ReleaseFrame(SourceBuffer);
             }
-            
-            ProcessFrameAndFeaturesAsync(
-                FrameOutput,
-                CameraTransform,
-                CameraFOV,
-                VideoSettings.IVR_GFTT_MaxCorners,
-                VideoSettings.IVR_GFTT_QualityLevel,
-                VideoSettings.IVR_GFTT_MinDistance,
-                VideoSettings.IVR_DebugDrawFeatures
-             );
         }
-    }
-    else 
+        SourceBuffer.Reset();
+
+        TSharedRef<FIVR_FeatureResult, ESPMode::ThreadSafe> FeatureResult = ResultPool.IsValid() ? ResultPool->Acquire() : MakeShared<FIVR_FeatureResult, ESPMode::ThreadSafe>();
+        TArray<FOCV_OverlayPrimitive> Overlay;
+        ExtractRealTimeFeatures(*FeatureResult, PixelBuffer->GetData(), FrameOutput.Width, FrameOutput.Height, CameraTransform, CameraFOV,
+                                FeatureStages, FeatureParams, Tracker.Get(), TrackerSettings, Cache.Get(), Graph.Get(), bDebugDrawFeatures ? &Overlay : nullptr);
+        if (bExpandFeatures)
+        {
+            FeatureResult->ToBlueprint(FrameOutput.Features); // Compatibilidade: Features já preenchida para Blueprint
+        }
+        FrameOutput.FeatureResult = FeatureResult;
+        // Overlay de debug: composto em uma cópia que só vai para a textura de preview; o frame entregue fica intacto.
+        TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> PreviewPixels;
+        if (Overlay.Num() > 0 && FrameOutput.LiveTexture)
+        {
+            TSharedPtr<TArray<uint8>> PreviewBuffer = Pool ? Pool->AcquireFrame() : nullptr;
+            if (!PreviewBuffer.IsValid() || PreviewBuffer->Num() != PixelBuffer->Num())
+            {
+                PreviewBuffer = MakeShared<TArray<uint8>>();
+                PreviewBuffer->SetNumUninitialized(PixelBuffer->Num());
+            }
+            FMemory::Memcpy(PreviewBuffer->GetData(), PixelBuffer->GetData(), PixelBuffer->Num());
+            IVROpenCVBridge::DrawOverlay(PreviewBuffer->GetData(), FrameOutput.Width, FrameOutput.Height, Overlay);
+            if (Pool)
+            {
+                PreviewPixels = Pool->MakeImmutablePayload(MoveTemp(PreviewBuffer));
+            }
+            else
+            {
+                PreviewPixels = MoveTemp(PreviewBuffer);
+            }
+        }
+        // A partir daqui os pixels são imutáveis; o payload devolve o buffer ao pool quando o último listener o soltar.
+        if (Pool)
+        {
+            FrameOutput.PixelData = Pool->MakeImmutablePayload(MoveTemp(PixelBuffer));
+        }
+        else
+        {
+            FrameOutput.PixelData = MoveTemp(PixelBuffer);
+        }
+
+        // Diff por blocos contra o último payload enviado à textura, aqui no worker (os dois buffers são imutáveis).
+        // A continuação só aproveita as regiões se nenhum outro upload tiver acontecido nesse meio tempo.
+        TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> DiffBase;
+        TArray<FUpdateTextureRegion2D> DirtyRegions;
+        if (FrameOutput.LiveTexture)
+        {
+            const TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe>& UploadPixels = PreviewPixels.IsValid() ? PreviewPixels : FrameOutput.PixelData;
+            {
+                FScopeLock DiffBaseLock(&DiffBaseSource->Lock);
+                DiffBase = DiffBaseSource->Pixels;
+            }
+            if (DiffBase.IsValid() && UploadPixels.IsValid() && DiffBase->Num() == UploadPixels->Num())
+            {
+                FIVR_TileDiff::ComputeDirtyRegions(DiffBase->GetData(), UploadPixels->GetData(), FrameOutput.Width, FrameOutput.Height, DirtyRegions);
+            }
+            else
+            {
+                DiffBase.Reset();
+            }
+        }
+
+        // Continuação na Game Thread, na ordem de captura: apenas o upload da textura e o broadcast.
+        return [FrameOutput = MoveTemp(FrameOutput), PreviewPixels = MoveTemp(PreviewPixels), DiffBase = MoveTemp(DiffBase), DirtyRegions = MoveTemp(DirtyRegions), WeakThis]()
+        {
+            UIVRCaptureComponent* StrongThis = WeakThis.Get();
+            if (!StrongThis)
+            {
+                UE_LOG(LogIVR, Warning, TEXT("UIVRCaptureComponent::SubmitRealTimeFrame: Componente IVRCaptureComponent foi destruído antes que o resultado das features pudesse ser entregue."));
+                return;
+            }
+            if (StrongThis->RealTimeOutputTexture2D && FrameOutput.HasPixelData())
+            {
+                StrongThis->UpdateTextureFromRawData(StrongThis->RealTimeOutputTexture2D, PreviewPixels.IsValid() ? PreviewPixels : FrameOutput.PixelData, FrameOutput.Width, FrameOutput.Height,
+                                                     DiffBase, DiffBase.IsValid() ? &DirtyRegions : nullptr);
+            }
+            else
+            {
+                UE_LOG(LogIVR, Warning, TEXT("UIVRCaptureComponent: RealTimeOutputTexture2D ou PixelData inválido para saída RT APÓS processamento de features."));
+            }
+            if (StrongThis->OnRealTimeFrameReady.IsBound())
+            {
+                StrongThis->OnRealTimeFrameReady.Broadcast(FrameOutput);
+            }
+        };
+    };
+    Job.Discard = [SourceBuffer, Pool]()
     {
-        UE_LOG(LogIVR, Warning, TEXT("UIVRCaptureComponent: Descartando frame da fonte - não gravando ou não no modo de captura RT."));
-        if (FramePool && Frame.RawDataPtr.IsValid())
+        // Substituído por um frame mais novo ou abandonado no encerramento: o buffer volta ao pool sem processamento
+        if (Pool)
         {
-            FramePool->ReleaseFrame(Frame.RawDataPtr);
+            Pool->ReleaseFrame(SourceBuffer);
         }
-    }
+    };
+    FeatureWorkerPool->Submit(MoveTemp(Job));
+    return true;
 }
 void UIVRCaptureComponent::RefreshFrameSourceAndApplySettings()
 {
@@ -741,6 +1121,14 @@ void UIVRCaptureComponent::Internal_InitializeFrameSource()
         
         // Re-inicializa o FramePool com as dimensões reais da captura
         FramePool->Initialize(FramePoolSize, ActualFrameWidth, ActualFrameHeight, true); // true para forçar re-inicialização
+        // O anel de memória compartilhada é dimensionado pela resolução real, como o FramePool
+        GetOrCreateFrameFanOut().RemoveSink(SharedRingSinkName);
+        SharedFrameRing.Close();
+        if (VideoSettings.IVR_PublishSharedRing && !SharedFrameRing.Open(VideoSettings.IVR_SharedRingName, ActualFrameWidth, ActualFrameHeight, VideoSettings.IVR_SharedRingSlots))
+        {
+            UE_LOG(LogIVR, Warning, TEXT("UIVRCaptureComponent: Não foi possível abrir o anel de memória compartilhada '%s'. Frames não serão publicados."), *VideoSettings.IVR_SharedRingName);
+        }
+        RebuildBuiltInFrameSinks();
         // Liga o delegate para receber frames da nova fonte
         CurrentFrameSource->OnFrameAcquired.AddUObject(this, &UIVRCaptureComponent::OnFrameAcquiredFromSource);
         UE_LOG(LogIVR, Log, TEXT("UIVRCaptureComponent: Fonte de frames '%s' inicializada e delegate ligado. FramePool configurado para %dx%d."), *CurrentFrameSource->GetName(), ActualFrameWidth, ActualFrameHeight);
@@ -750,52 +1138,88 @@ void UIVRCaptureComponent::Internal_InitializeFrameSource()
         UE_LOG(LogIVR, Error, TEXT("UIVRCaptureComponent: Falha ao criar CurrentFrameSource. A gravação não funcionará corretamente."));
     }
 }
-// O restante do IVRCaptureComponent.cpp permanece o mesmo (UpdateTextureFromRawData, PrepareVideoForRecording, ExportVideoToCompatibleFormat, ProcessFrameAndFeaturesAsync, DeprojectPixelToWorld)
-void UIVRCaptureComponent::UpdateTextureFromRawData(UTexture2D* Texture, const TArray<uint8>& RawData, int32 InWidth, int32 InHeight)
+// O restante do IVRCaptureComponent.cpp permanece o mesmo (UpdateTextureFromRawData, PrepareVideoForRecording, ExportVideoToCompatibleFormat, ExtractRealTimeFeatures, DeprojectPixelToWorld)
+bool UIVRCaptureComponent::UpdateTextureFromRawData(UTexture2D* Texture, const TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe>& PixelData, int32 InWidth, int32 InHeight,
+                                                    const TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe>& DiffBase, const TArray<FUpdateTextureRegion2D>* DirtyRegions)
 {
     if (!Texture || !Texture->IsValidLowLevelFast() || !Texture->GetResource())
     {
         UE_LOG(LogIVR, Error, TEXT("UpdateTextureFromRawData: Textura ou recurso RHI inválido na entrada."));
-        return;
+        return false;
+    }
+    // UpdateTextureRegions retorna sem agendar o upload (nem o callback de limpeza) para texturas streamable:
+    // a vaga no fence e as regiões nunca seriam devolvidas.
+    if (Texture->IsStreamable())
+    {
+        UE_LOG(LogIVR, Error, TEXT("UpdateTextureFromRawData: Textura '%s' é streamable e não aceita UpdateTextureRegions."), *Texture->GetName());
+        return false;
     }
     if (Texture->GetSizeX() != InWidth || Texture->GetSizeY() != InHeight)
     {
         UE_LOG(LogIVR, Error, TEXT("UpdateTextureFromRawData: Dimensões da textura (%dx%d) não correspondem às do frame (%dx%d). Frame descartado."),
                Texture->GetSizeX(), Texture->GetSizeY(), InWidth, InHeight);
-        return; 
+        return false; 
     }
-    if (RawData.Num() != InWidth * InHeight * sizeof(FColor))
+    if (!PixelData.IsValid() || PixelData->Num() != InWidth * InHeight * sizeof(FColor))
     {
-        UE_LOG(LogIVR, Error, TEXT("UpdateTextureFromRawData: RawData size mismatch! Actual: %d, Expected: %d. Frame descartado."), RawData.Num(), InWidth * InHeight * sizeof(FColor));
-        return; 
+        UE_LOG(LogIVR, Error, TEXT("UpdateTextureFromRawData: RawData size mismatch! Actual: %d, Expected: %d. Frame descartado."), PixelData.IsValid() ? PixelData->Num() : 0, InWidth * InHeight * sizeof(FColor));
+        return false; 
     }
-    uint8* MipData = new uint8[RawData.Num()];
-    FMemory::Memcpy(MipData, RawData.GetData(), RawData.Num());
-    FUpdateTextureRegion2D Region(0, 0, 0, 0, InWidth, InHeight);
-    ENQUEUE_RENDER_COMMAND(UpdateTextureFromRawDataCommand)(
-        [Texture, Region, InWidth, MipData](FRHICommandListImmediate& RHICmdList)
+    // Diff por blocos (calculado no worker): só os retângulos alterados vão para a GPU, desde que a base do diff
+    // ainda seja o conteúdo da textura. Sem base válida (primeiro frame, textura nova, upload intermediário) o frame inteiro é enviado.
+    const bool bHasDiffBase = DirtyRegions && DiffBase.IsValid() && DiffBase == LastUploadedPixels && LastUploadedTexture.Get() == Texture;
+    const TArray<FUpdateTextureRegion2D>* UploadRegions = &DirtyRegionScratch;
+    if (bHasDiffBase)
+    {
+        if (DirtyRegions->Num() == 0)
         {
-            if (Texture && Texture->GetResource())
-            {
-                Texture->UpdateTextureRegions(
-                    0,                                   
-                    1,                                   
-                    &Region,                             
-                    InWidth * sizeof(FColor),            
-                    0,                                   
-                    MipData,                             
-                    [](uint8* InSrcData, const FUpdateTextureRegion2D* InRegions) 
-                    {
-                        delete[] InSrcData; 
-                    }
-                );
-            }
-            else
-            {
-                UE_LOG(LogIVR, Error, TEXT("UpdateTextureFromRawData: Texture ou recurso RHI tornou-se inválido na Render Thread. MipData será vazado se não for explicitamente deletado aqui."));
-                delete[] MipData; 
-            }
+            ++RealTimeUploadsUnchanged;
+            return true; // A textura já mostra exatamente este frame
+        }
+        UploadRegions = DirtyRegions;
+    }
+    else
+    {
+        DirtyRegionScratch.Reset();
+        DirtyRegionScratch.Add(FUpdateTextureRegion2D(0, 0, 0, 0, InWidth, InHeight));
+    }
+
+    // Fence simples: com dois uploads ainda pendentes na RHI, este frame não vai para a textura.
+    // O preview mostra o próximo frame em vez de acumular comandos de render sem limite.
+    if (RealTimeUploadsInFlight->GetValue() >= MaxRealTimeUploadsInFlight)
+    {
+        ++RealTimeUploadsSkipped;
+        UE_LOG(LogIVR, Verbose, TEXT("UpdateTextureFromRawData: Upload anterior ainda pendente na RHI. Frame pulado (total: %lld)."), RealTimeUploadsSkipped);
+        return false;
+    }
+    RealTimeUploadsInFlight->Increment();
+
+    // Sem staging: o payload imutável do pool é a origem do upload e fica vivo até o callback de limpeza,
+    // que roda na Render Thread depois que a RHI consumiu os dados e libera a vaga no fence.
+    // As regiões usam SrcX/SrcY iguais a DestX/DestY, então o pitch de origem é o da linha inteira.
+    const int32 NumRegions = UploadRegions->Num();
+    FUpdateTextureRegion2D* Regions = new FUpdateTextureRegion2D[NumRegions];
+    FMemory::Memcpy(Regions, UploadRegions->GetData(), NumRegions * sizeof(FUpdateTextureRegion2D));
+    TSharedRef<FThreadSafeCounter, ESPMode::ThreadSafe> InFlight = RealTimeUploadsInFlight;
+    Texture->UpdateTextureRegions(
+        0,
+        NumRegions,
+        Regions,
+        InWidth * sizeof(FColor),
+        sizeof(FColor),
+        const_cast<uint8*>(PixelData->GetData()), // Somente leitura pela RHI
+        [PixelData, InFlight](uint8* InSrcData, const FUpdateTextureRegion2D* InRegions)
+        {
+            delete[] InRegions;
+            InFlight->Decrement(); // A referência ao payload é solta junto com este callback
         });
+    LastUploadedPixels = PixelData;
+    LastUploadedTexture = Texture;
+    {
+        FScopeLock DiffBaseLock(&UploadDiffBase->Lock);
+        UploadDiffBase->Pixels = PixelData;
+    }
+    return true;
 }
 FString UIVRCaptureComponent::PrepareVideoForRecording(const FString& InSourceVideoPath, const FString& OutPreparedVideoPath, bool bOverwrite)
 {
@@ -897,73 +1321,106 @@ FString UIVRCaptureComponent::ExportVideoToCompatibleFormat(const FString& InSou
     UE_LOG(LogIVR, Log, TEXT("ExportVideoToCompatibleFormat: Vídeo transcodificado com sucesso para: %s"), *OutCompatibleVideoPath);
     return OutCompatibleVideoPath;
 }
-void UIVRCaptureComponent::ProcessFrameAndFeaturesAsync(FIVR_JustRTFrame InOutFrame, FTransform CameraTransform, float CameraFOV, int32 MaxCorners, float QualityLevel, float MinDistance, bool bDebugDrawFeatures)
-{
-    // [MANUAL_REF_POINT] A lógica de processamento OpenCV foi movida para IVROpenCVBridge::ProcessFrameAndExtractFeatures.
-    // Chame a função apropriada do IVROpenCVBridge aqui, passando os parâmetros necessários.
-    // Chame a função do bridge com os parâmetros brutos. FramePoolInstance foi removido!
-    // Criar uma instância da struct de features do IVROpenCVBridge para receber os resultados
-    FOCV_NativeJustRTFeatures TempExtractedFeatures;
-    IVROpenCVBridge::ProcessFrameAndExtractFeatures(
-            InOutFrame.RawDataBuffer.GetData(), // Passar o ponteiro bruto para os pixels
-            InOutFrame.Width,
-            InOutFrame.Height,
-            CameraTransform,
-            CameraFOV,
-            VideoSettings.IVR_GFTT_MaxCorners,
-            VideoSettings.IVR_GFTT_QualityLevel,
-            VideoSettings.IVR_GFTT_MinDistance,
-            VideoSettings.IVR_DebugDrawFeatures,
-            TempExtractedFeatures // A struct de saída
-         );
-    TWeakObjectPtr<UIVRCaptureComponent> WeakThis = this;
-    AsyncTask(ENamedThreads::GameThread, [TempExtractedFeatures,InOutFrame, CameraTransform, CameraFOV, MaxCorners, QualityLevel, MinDistance, bDebugDrawFeatures, WeakThis]() mutable
+void UIVRCaptureComponent::ExtractRealTimeFeatures(FIVR_FeatureResult& OutResult, uint8* PixelData, int32 InWidth, int32 InHeight, const FTransform& CameraTransform, float CameraFOV,
+                                                   EOCV_FeatureStage Stages, const FOCV_FeatureStageParams& Params,
+                                                   IVROpenCVBridge::FOCV_FeatureTracker* Tracker, const FOCV_TrackerSettings& TrackerSettings,
+                                                   FIVR_FeatureCache* Cache, IVROpenCVBridge::FOCV_CVStageGraph* Graph,
+                                                   TArray<FOCV_OverlayPrimitive>* OutOverlay)
+{
+    // [MANUAL_REF_POINT] A lógica de processamento OpenCV está em IVROpenCVBridge::FOCV_CVStageGraph.
+    OutResult.Reset();
+    if (Stages == EOCV_FeatureStage::None && !Graph)
     {
-        if (!WeakThis.IsValid())
-        {
-            UE_LOG(LogIVR, Warning, TEXT("UIVRCaptureComponent::ProcessFrameAndFeaturesAsync: Componente IVRCaptureComponent foi destruído antes que a tarefa assíncrona de processamento de features pudesse ser executada."));
-            return;
-        }
-        UIVRCaptureComponent* StrongThis = WeakThis.Get();
-        if (StrongThis->RealTimeOutputTexture2D && InOutFrame.RawDataBuffer.Num() > 0)
-        {
-            StrongThis->UpdateTextureFromRawData(StrongThis->RealTimeOutputTexture2D, InOutFrame.RawDataBuffer, InOutFrame.Width, InOutFrame.Height);
-        }
-        else
+        return; // Nenhum consumidor pediu features
+    }
+    // Saída nativa do bridge: um scratch por thread do pool, que mantém a capacidade dos arrays entre frames
+    static thread_local FOCV_NativeJustRTFeatures TempExtractedFeatures;
+    // Rastreamento depende do frame anterior e não pode ser reaproveitado; o overlay é só dado e entra no cache
+    const bool bUseCache = Cache && !Tracker;
+    const uint64 CacheKey = bUseCache ? FIVR_FeatureCache::MakeKey(PixelData, InWidth, InHeight, Stages, Params) : 0;
+    if (bUseCache && Cache->Find(CacheKey, TempExtractedFeatures))
+    {
+        // Frame idêntico a um recente: nada a extrair
+    }
+    else if (Tracker)
+    {
+        Tracker->ProcessFrame(PixelData, InWidth, InHeight, Stages, Params, TrackerSettings, TempExtractedFeatures);
+    }
+    else if (Graph)
+    {
+        Graph->Execute(PixelData, InWidth, InHeight, Params, TempExtractedFeatures);
+        if (bUseCache)
         {
-            UE_LOG(LogIVR, Warning, TEXT("UIVRCaptureComponent: RealTimeOutputTexture2D ou RawDataBuffer inválido para saída RT APÓS processamento de features."));
+            Cache->Add(CacheKey, TempExtractedFeatures);
         }
-        
-        // Agora copiar os resultados da struct temporária para a FIVR_JustRTFrame original
-        // Fazer a conversão de FIVROCV_InterestPoint para FIVR_JustRTPoint
-        InOutFrame.Features.JustRTInterestPoints.Empty();
-        for (const FOCV_NativeJustRTPoint& OCVPoint : TempExtractedFeatures.JustRTInterestPoints)
-        {
-            FIVR_JustRTPoint RTPoint; // Esta struct ainda é do IVRCore
-            RTPoint.Point2D = OCVPoint.Point2D;
-            RTPoint.Size2D = OCVPoint.Size2D;
-            RTPoint.Angle = OCVPoint.Angle;
-            RTPoint.IsQuad = OCVPoint.IsQuad;
-            
-            // Deprojeção para o mundo 3D - Chamada aqui na GameThread para evitar problemas com UWorld
-            StrongThis->DeprojectPixelToWorld(OCVPoint.Point2D, CameraTransform, CameraFOV, 
-                                            FIntPoint(InOutFrame.Width, InOutFrame.Height), 
-                                            RTPoint.Point3D, RTPoint.Direction);
-            
-            InOutFrame.Features.JustRTInterestPoints.Add(RTPoint);
-        }
-        InOutFrame.Features.BiggestPointIndex = TempExtractedFeatures.BiggestPointIndex;
-        InOutFrame.Features.SmallerPointIndex = TempExtractedFeatures.SmallerPointIndex;
-        InOutFrame.Features.NumOfQuads = TempExtractedFeatures.NumOfQuads;
-        InOutFrame.Features.NumOfRectangles = TempExtractedFeatures.NumOfRectangles;
-        InOutFrame.Features.HistogramRed = TempExtractedFeatures.HistogramRed;
-        InOutFrame.Features.HistogramGreen = TempExtractedFeatures.HistogramGreen;
-        InOutFrame.Features.HistogramBlue = TempExtractedFeatures.HistogramBlue;
-        if (StrongThis->OnRealTimeFrameReady.IsBound())
+    }
+    else
+    {
+        IVROpenCVBridge::ExtractFeatureStages(
+                PixelData, // Passar o ponteiro bruto para os pixels
+                InWidth,
+                InHeight,
+                Stages,
+                Params,
+                TempExtractedFeatures // A struct de saída
+             );
+        if (bUseCache)
         {
-            StrongThis->OnRealTimeFrameReady.Broadcast(InOutFrame);
+            Cache->Add(CacheKey, TempExtractedFeatures);
         }
-    });
+    }
+
+    // Pontos de interesse -> SoA float32
+    const int32 NumPoints = TempExtractedFeatures.JustRTInterestPoints.Num();
+    OutResult.SetNumPoints(NumPoints);
+    for (int32 Index = 0; Index < NumPoints; ++Index)
+    {
+        const FOCV_NativeJustRTPoint& OCVPoint = TempExtractedFeatures.JustRTInterestPoints[Index];
+        OutResult.PointX[Index] = (float)OCVPoint.Point2D.X;
+        OutResult.PointY[Index] = (float)OCVPoint.Point2D.Y;
+        OutResult.SizeX[Index] = (float)OCVPoint.Size2D.X;
+        OutResult.SizeY[Index] = (float)OCVPoint.Size2D.Y;
+        OutResult.Angle[Index] = OCVPoint.Angle;
+        OutResult.TrackId[Index] = OCVPoint.TrackId;
+        OutResult.IsQuad[Index] = OCVPoint.IsQuad ? 1 : 0;
+    }
+    // A deprojeção é matemática pura (sem UWorld), então roda aqui no worker em vez da Game Thread, em lote.
+    DeprojectPixelsToWorld(OutResult.PointX, OutResult.PointY, CameraTransform, CameraFOV, FIntPoint(InWidth, InHeight),
+                           OutResult.DirectionX, OutResult.DirectionY, OutResult.DirectionZ);
+    OutResult.CameraLocation = FVector3f(CameraTransform.GetLocation());
+    OutResult.BiggestPointIndex = TempExtractedFeatures.BiggestPointIndex;
+    OutResult.SmallerPointIndex = TempExtractedFeatures.SmallerPointIndex;
+    OutResult.NumOfQuads = TempExtractedFeatures.NumOfQuads;
+    OutResult.NumOfRectangles = TempExtractedFeatures.NumOfRectangles;
+    OutResult.bIsKeyframe = TempExtractedFeatures.bIsKeyframe;
+
+    const int32 NumCorners = TempExtractedFeatures.Corners.Num();
+    const bool bHasCornerIds = TempExtractedFeatures.CornerIds.Num() == NumCorners;
+    OutResult.SetNumCorners(NumCorners);
+    for (int32 Index = 0; Index < NumCorners; ++Index)
+    {
+        OutResult.CornerX[Index] = (float)TempExtractedFeatures.Corners[Index].X;
+        OutResult.CornerY[Index] = (float)TempExtractedFeatures.Corners[Index].Y;
+        OutResult.CornerIds[Index] = bHasCornerIds ? TempExtractedFeatures.CornerIds[Index] : INDEX_NONE;
+    }
+
+    OutResult.bHasHistograms = TempExtractedFeatures.HistogramRed.Num() == FIVR_FeatureResult::NumHistogramBins;
+    if (OutResult.bHasHistograms)
+    {
+        FIVR_FeatureResult::QuantizeHistogram(TempExtractedFeatures.HistogramRed, OutResult.HistogramRed);
+        FIVR_FeatureResult::QuantizeHistogram(TempExtractedFeatures.HistogramGreen, OutResult.HistogramGreen);
+        FIVR_FeatureResult::QuantizeHistogram(TempExtractedFeatures.HistogramBlue, OutResult.HistogramBlue);
+    }
+
+    for (const FOCV_StageTiming& Timing : TempExtractedFeatures.StageTimings)
+    {
+        OutResult.StageNames.Add(Timing.Stage);
+        OutResult.StageMilliseconds.Add(Timing.Milliseconds);
+    }
+    if (OutOverlay)
+    {
+        *OutOverlay = TempExtractedFeatures.Overlay;
+    }
 }
 void UIVRCaptureComponent::DeprojectPixelToWorld(
     const FVector2D& PixelPos,
@@ -982,4 +1439,148 @@ void UIVRCaptureComponent::DeprojectPixelToWorld(
     FVector ViewSpaceDirection = FVector(ViewX, ViewY, -1.0f).GetSafeNormal();
     OutWorldDirection = CameraTransform.GetRotation().RotateVector(ViewSpaceDirection);
     OutWorldLocation = CameraTransform.GetLocation();
-}
\ No newline at end of file
+}
+void UIVRCaptureComponent::DeprojectPixelsToWorld(
+    TArrayView<const float> PixelX,
+    TArrayView<const float> PixelY,
+    const FTransform& CameraTransform,
+    float FOVDegrees,
+    const FIntPoint& ImageResolution,
+    TArrayView<float> OutDirectionX,
+    TArrayView<float> OutDirectionY,
+    TArrayView<float> OutDirectionZ)
+{
+    const int32 NumPoints = FMath::Min(FMath::Min(PixelX.Num(), PixelY.Num()), FMath::Min3(OutDirectionX.Num(), OutDirectionY.Num(), OutDirectionZ.Num()));
+    if (NumPoints == 0)
+    {
+        return;
+    }
+    if (ImageResolution.X <= 0 || ImageResolution.Y <= 0)
+    {
+        // Resolução inválida: as saídas (alocadas sem inicializar) recebem direção nula em vez de lixo
+        FMemory::Memzero(OutDirectionX.GetData(), OutDirectionX.Num() * sizeof(float));
+        FMemory::Memzero(OutDirectionY.GetData(), OutDirectionY.Num() * sizeof(float));
+        FMemory::Memzero(OutDirectionZ.GetData(), OutDirectionZ.Num() * sizeof(float));
+        return;
+    }
+    // ViewX = ((X / W) * 2 - 1) * Tan * Aspect e ViewY = (1 - (Y / H) * 2) * Tan, reescritos como X * Escala + Deslocamento
+    const float TanHalfFOV = FMath::Tan(FMath::DegreesToRadians(FOVDegrees) * 0.5f);
+    const float AspectRatio = (float)ImageResolution.X / ImageResolution.Y;
+    const VectorRegister4Float ScaleX = VectorSetFloat1(2.0f * TanHalfFOV * AspectRatio / ImageResolution.X);
+    const VectorRegister4Float OffsetX = VectorSetFloat1(-TanHalfFOV * AspectRatio);
+    const VectorRegister4Float ScaleY = VectorSetFloat1(-2.0f * TanHalfFOV / ImageResolution.Y);
+    const VectorRegister4Float OffsetY = VectorSetFloat1(TanHalfFOV);
+    const VectorRegister4Float One = VectorSetFloat1(1.0f);
+
+    // Linhas da matriz de rotação: Mundo = ViewX * Linha0 + ViewY * Linha1 + (-1) * Linha2 (rotação preserva o comprimento,
+    // então normalizar antes ou depois dá o mesmo resultado)
+    const FMatrix Rotation = FQuatRotationMatrix(CameraTransform.GetRotation());
+    VectorRegister4Float Row[3][3];
+    for (int32 R = 0; R < 3; ++R)
+    {
+        for (int32 C = 0; C < 3; ++C)
+        {
+            Row[R][C] = VectorSetFloat1((float)Rotation.M[R][C]);
+        }
+    }
+
+    for (int32 First = 0; First < NumPoints; First += 4)
+    {
+        const int32 NumInBatch = FMath::Min(4, NumPoints - First);
+        // Lote final incompleto: completa com zeros em vez de ler além do array
+        alignas(16) float X[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        alignas(16) float Y[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        FMemory::Memcpy(X, PixelX.GetData() + First, NumInBatch * sizeof(float));
+        FMemory::Memcpy(Y, PixelY.GetData() + First, NumInBatch * sizeof(float));
+
+        const VectorRegister4Float ViewX = VectorMultiplyAdd(VectorLoadAligned(X), ScaleX, OffsetX);
+        const VectorRegister4Float ViewY = VectorMultiplyAdd(VectorLoadAligned(Y), ScaleY, OffsetY);
+        // 1 / |(ViewX, ViewY, -1)|
+        const VectorRegister4Float InvLength = VectorReciprocalSqrt(VectorMultiplyAdd(ViewX, ViewX, VectorMultiplyAdd(ViewY, ViewY, One)));
+
+        alignas(16) float World[3][4];
+        for (int32 C = 0; C < 3; ++C)
+        {
+            const VectorRegister4Float Axis = VectorSubtract(VectorMultiplyAdd(ViewX, Row[0][C], VectorMultiply(ViewY, Row[1][C])), Row[2][C]);
+            VectorStoreAligned(VectorMultiply(Axis, InvLength), World[C]);
+        }
+        FMemory::Memcpy(OutDirectionX.GetData() + First, World[0], NumInBatch * sizeof(float));
+        FMemory::Memcpy(OutDirectionY.GetData() + First, World[1], NumInBatch * sizeof(float));
+        FMemory::Memcpy(OutDirectionZ.GetData() + First, World[2], NumInBatch * sizeof(float));
+    }
+}
+bool UIVRCaptureComponent::ProjectWorldToPixel(
+    const FVector& WorldLocation,
+    const FTransform& CameraTransform,
+    float FOVDegrees,
+    const FIntPoint& ImageResolution,
+    FVector2D& OutPixelPos)
+{
+    // Base da câmera da UE (USceneCaptureComponent2D): X para frente (profundidade), Y para a direita, Z para cima;
+    // o FOV é horizontal, então o vertical sai pelo aspect ratio
+    const FVector ViewSpace = CameraTransform.GetRotation().UnrotateVector(WorldLocation - CameraTransform.GetLocation());
+    if (ViewSpace.X <= UE_KINDA_SMALL_NUMBER)
+    {
+        return false;
+    }
+    const float TanHalfFOV = FMath::Tan(FMath::DegreesToRadians(FOVDegrees) * 0.5f);
+    const float AspectRatio = (float)ImageResolution.X / ImageResolution.Y;
+    const float NDC_X = ViewSpace.Y / (ViewSpace.X * TanHalfFOV);
+    const float NDC_Y = ViewSpace.Z * AspectRatio / (ViewSpace.X * TanHalfFOV);
+    OutPixelPos.X = (NDC_X + 1.0f) * 0.5f * ImageResolution.X;
+    OutPixelPos.Y = (1.0f - (NDC_Y + 1.0f) * 0.5f) * ImageResolution.Y;
+    return true;
+}
+void UIVRCaptureComponent::GatherFeatureRegions(const FTransform& CameraTransform, float CameraFOV, int32 InWidth, int32 InHeight, TArray<FIntRect>& OutRegions) const
+{
+    OutRegions.Reset();
+    for (const FBox2D& Region : VideoSettings.IVR_FeatureRegions)
+    {
+        if (Region.Max.X > Region.Min.X && Region.Max.Y > Region.Min.Y) // bIsValid não é editável no editor
+        {
+            OutRegions.Add(FIntRect(
+                FMath::FloorToInt32(Region.Min.X * InWidth), FMath::FloorToInt32(Region.Min.Y * InHeight),
+                FMath::CeilToInt32(Region.Max.X * InWidth), FMath::CeilToInt32(Region.Max.Y * InHeight)));
+        }
+    }
+
+    const AActor* RegionActor = VideoSettings.IVR_FeatureRegionActor;
+    if (!IsValid(RegionActor))
+    {
+        return;
+    }
+    FVector Origin, Extent;
+    RegionActor->GetActorBounds(false, Origin, Extent);
+    const FIntPoint Resolution(InWidth, InHeight);
+    FBox2D Projected(ForceInit);
+    int32 NumBehind = 0;
+    for (int32 Corner = 0; Corner < 8; ++Corner)
+    {
+        const FVector Sign((Corner & 1) ? 1.0f : -1.0f, (Corner & 2) ? 1.0f : -1.0f, (Corner & 4) ? 1.0f : -1.0f);
+        FVector2D Pixel;
+        if (ProjectWorldToPixel(Origin + Extent * Sign, CameraTransform, CameraFOV, Resolution, Pixel))
+        {
+            Projected += Pixel;
+        }
+        else
+        {
+            ++NumBehind;
+        }
+    }
+    if (NumBehind == 8)
+    {
+        // Ator atrás da câmera: uma região vazia ainda conta como "há regiões", então nada é extraído dele
+        OutRegions.Add(FIntRect());
+    }
+    else if (NumBehind > 0)
+    {
+        OutRegions.Add(FIntRect(0, 0, InWidth, InHeight)); // Atravessa o plano da câmera: a projeção não é confiável
+    }
+    else
+    {
+        const int32 Padding = FMath::Max(0, VideoSettings.IVR_FeatureRegionActorPadding);
+        OutRegions.Add(FIntRect(
+            FMath::FloorToInt32(Projected.Min.X) - Padding, FMath::FloorToInt32(Projected.Min.Y) - Padding,
+            FMath::CeilToInt32(Projected.Max.X) + Padding, FMath::CeilToInt32(Projected.Max.Y) + Padding));
+    }
+}
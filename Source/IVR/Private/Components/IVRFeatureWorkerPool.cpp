@@ -0,0 +1,212 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#include "Components/IVRFeatureWorkerPool.h"
+#include "Misc/QueuedThreadPool.h"
+#include "Misc/IQueuedWork.h"
+#include "Misc/ScopeLock.h"
+#include "Async/Async.h"
+
+DEFINE_LOG_CATEGORY(LogIVRFeatureWorkerPool);
+
+/** Embrulha um FJob como IQueuedWork. Se deleta ao terminar. */
+class FIVR_FeatureWorkerPool::FQueuedJob : public IQueuedWork
+{
+public:
+    FQueuedJob(FIVR_FeatureWorkerPool* InOwner, uint64 InSequence, FJob&& InJob)
+        : Owner(InOwner)
+        , Sequence(InSequence)
+        , Job(MoveTemp(InJob))
+    {}
+
+    virtual void DoThreadedWork() override
+    {
+        const double StartSeconds = FPlatformTime::Seconds();
+        TUniqueFunction<void()> Continuation = Job.Work ? Job.Work() : TUniqueFunction<void()>();
+        Owner->OnJobFinished(Sequence, MoveTemp(Continuation), FPlatformTime::Seconds() - StartSeconds);
+        delete this;
+    }
+
+    virtual void Abandon() override
+    {
+        if (Job.Discard)
+        {
+            Job.Discard();
+        }
+        Owner->OnJobFinished(Sequence, TUniqueFunction<void()>(), 0.0);
+        delete this;
+    }
+
+private:
+    FIVR_FeatureWorkerPool* Owner; // O pool espera todos os jobs no Shutdown, antes de ser destruído
+    uint64 Sequence;
+    FJob Job;
+};
+
+FIVR_FeatureWorkerPool::FIVR_FeatureWorkerPool()
+{
+}
+
+FIVR_FeatureWorkerPool::~FIVR_FeatureWorkerPool()
+{
+    Shutdown();
+}
+
+bool FIVR_FeatureWorkerPool::Start(int32 InNumWorkers, const TCHAR* PoolName)
+{
+    if (ThreadPool)
+    {
+        Shutdown();
+    }
+    NumWorkers = FMath::Clamp(InNumWorkers, 1, 8);
+    ThreadPool = FQueuedThreadPool::Allocate();
+    // Pilha de 1 MB: goodFeaturesToTrack e findContours usam mais que o padrão de 32 KB.
+    if (!ThreadPool->Create(NumWorkers, 1024 * 1024, TPri_BelowNormal, PoolName))
+    {
+        UE_LOG(LogIVRFeatureWorkerPool, Error, TEXT("Failed to create feature worker pool '%s' with %d threads."), PoolName, NumWorkers);
+        delete ThreadPool;
+        ThreadPool = nullptr;
+        return false;
+    }
+    FScopeLock ScopeLock(&Lock);
+    bShuttingDown = false;
+    Stats = FIVR_FeatureWorkerPoolStats();
+    Stats.NumWorkers = NumWorkers;
+    TotalWorkSeconds = 0.0;
+    UE_LOG(LogIVRFeatureWorkerPool, Log, TEXT("Feature worker pool '%s' started with %d threads."), PoolName, NumWorkers);
+    return true;
+}
+
+void FIVR_FeatureWorkerPool::Shutdown()
+{
+    if (!ThreadPool)
+    {
+        return;
+    }
+    TUniquePtr<FJob> Discarded;
+    {
+        FScopeLock ScopeLock(&Lock);
+        bShuttingDown = true;
+        Discarded = MoveTemp(PendingJob);
+    }
+    if (Discarded.IsValid() && Discarded->Discard)
+    {
+        Discarded->Discard();
+    }
+    // Destroy espera os jobs em andamento e chama Abandon nos que ainda não começaram.
+    ThreadPool->Destroy();
+    delete ThreadPool;
+    ThreadPool = nullptr;
+
+    FScopeLock ScopeLock(&Lock);
+    ReadyResults.Empty();
+    JobsInFlight = 0;
+    NextSequenceToDeliver = NextSequence;
+    UE_LOG(LogIVRFeatureWorkerPool, Log, TEXT("Feature worker pool stopped. Completed: %lld, discarded: %lld, avg work: %.2f ms."),
+        Stats.JobsCompleted, Stats.JobsDiscarded, Stats.JobsCompleted > 0 ? (TotalWorkSeconds * 1000.0) / Stats.JobsCompleted : 0.0);
+}
+
+void FIVR_FeatureWorkerPool::Submit(FJob&& Job)
+{
+    TUniquePtr<FJob> Stale;
+    {
+        FScopeLock ScopeLock(&Lock);
+        if (!ThreadPool || bShuttingDown)
+        {
+            Stale = MakeUnique<FJob>(MoveTemp(Job));
+        }
+        else
+        {
+            ++Stats.JobsSubmitted;
+            if (JobsInFlight < NumWorkers)
+            {
+                LaunchLocked(MoveTemp(Job));
+            }
+            else
+            {
+                // Todos os workers ocupados: o novo frame substitui o que esperava
+                Stale = MoveTemp(PendingJob);
+                PendingJob = MakeUnique<FJob>(MoveTemp(Job));
+                if (Stale.IsValid())
+                {
+                    ++Stats.JobsDiscarded;
+                }
+            }
+        }
+    }
+    if (Stale.IsValid() && Stale->Discard)
+    {
+        Stale->Discard();
+    }
+}
+
+void FIVR_FeatureWorkerPool::LaunchLocked(FJob&& Job)
+{
+    ++JobsInFlight;
+    ThreadPool->AddQueuedWork(new FQueuedJob(this, NextSequence++, MoveTemp(Job)));
+}
+
+void FIVR_FeatureWorkerPool::OnJobFinished(uint64 Sequence, TUniqueFunction<void()>&& Continuation, double WorkSeconds)
+{
+    bool bScheduleDelivery = false;
+    {
+        FScopeLock ScopeLock(&Lock);
+        --JobsInFlight;
+        ++Stats.JobsCompleted;
+        TotalWorkSeconds += WorkSeconds;
+        // Mesmo uma continuação vazia ocupa sua sequência, para não travar a entrega dos jobs seguintes.
+        ReadyResults.Add(Sequence, MoveTemp(Continuation));
+        if (PendingJob.IsValid() && !bShuttingDown)
+        {
+            TUniquePtr<FJob> Next = MoveTemp(PendingJob);
+            LaunchLocked(MoveTemp(*Next));
+        }
+        if (!bDeliveryScheduled && !bShuttingDown)
+        {
+            bDeliveryScheduled = true;
+            bScheduleDelivery = true;
+        }
+    }
+    if (bScheduleDelivery)
+    {
+        TWeakPtr<FIVR_FeatureWorkerPool, ESPMode::ThreadSafe> WeakPool = AsShared();
+        AsyncTask(ENamedThreads::GameThread, [WeakPool]()
+        {
+            if (TSharedPtr<FIVR_FeatureWorkerPool, ESPMode::ThreadSafe> Pool = WeakPool.Pin())
+            {
+                Pool->DeliverReadyResults();
+            }
+        });
+    }
+}
+
+void FIVR_FeatureWorkerPool::DeliverReadyResults()
+{
+    check(IsInGameThread());
+    for (;;)
+    {
+        TUniqueFunction<void()> Continuation;
+        {
+            FScopeLock ScopeLock(&Lock);
+            if (!ReadyResults.RemoveAndCopyValue(NextSequenceToDeliver, Continuation))
+            {
+                bDeliveryScheduled = false;
+                return;
+            }
+            ++NextSequenceToDeliver;
+        }
+        // Fora do lock: a continuação pode disparar delegates que submetem novos jobs.
+        if (Continuation)
+        {
+            Continuation();
+        }
+    }
+}
+
+FIVR_FeatureWorkerPoolStats FIVR_FeatureWorkerPool::GetStats() const
+{
+    FScopeLock ScopeLock(&Lock);
+    FIVR_FeatureWorkerPoolStats Result = Stats;
+    Result.AverageWorkMs = Stats.JobsCompleted > 0 ? (TotalWorkSeconds * 1000.0) / Stats.JobsCompleted : 0.0;
+    return Result;
+}
@@ -0,0 +1,345 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#include "Components/IVRFrameSink.h"
+#include "IVRFramePool.h"
+#include "Async/Async.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Misc/ScopeLock.h"
+
+DEFINE_LOG_CATEGORY(LogIVRFrameSink);
+
+/**
+ * Fila e contexto de execução de um sink. Na lane Worker, no máximo uma task de background drena a fila
+ * por vez, o que mantém a ordem dos frames e deixa cada sink com um único consumidor.
+ */
+class FIVR_FrameFanOut::FLane : public TSharedFromThis<FLane, ESPMode::ThreadSafe>
+{
+public:
+    FLane(const TSharedRef<IIVRFrameSink, ESPMode::ThreadSafe>& InSink, UIVRFramePool* InFramePool)
+        : Sink(InSink)
+        , Settings(InSink->GetLaneSettings())
+        , FramePool(InFramePool)
+    {
+        Settings.QueueDepth = FMath::Max(1, Settings.QueueDepth);
+    }
+
+    void Push(FIVR_FrameSinkPacket&& Packet)
+    {
+        if (Settings.Lane == EIVRFrameSinkLane::Inline)
+        {
+            Deliver(Packet);
+            return;
+        }
+        if (Settings.DropPolicy == EIVRFrameSinkDropPolicy::LatestFrameWins)
+        {
+            PushLatest(MoveTemp(Packet));
+            return;
+        }
+
+        FIVR_FrameSinkPacket Dropped;
+        bool bScheduleDrain = false;
+        {
+            FScopeLock Lock(&QueueLock);
+            if (Pending.Num() >= Settings.QueueDepth)
+            {
+                if (Settings.DropPolicy == EIVRFrameSinkDropPolicy::DropOldest)
+                {
+                    Dropped = MoveTemp(Pending[0]);
+                    Pending.RemoveAt(0, 1, EAllowShrinking::No);
+                    Pending.Add(MoveTemp(Packet));
+                }
+                else
+                {
+                    Dropped = MoveTemp(Packet);
+                }
+            }
+            else
+            {
+                Pending.Add(MoveTemp(Packet));
+            }
+            bScheduleDrain = !bDrainScheduled;
+            bDrainScheduled = true;
+        }
+        if (Dropped.Frame.RawDataPtr.IsValid())
+        {
+            FramesDropped.Increment();
+            Release(Dropped);
+        }
+        if (bScheduleDrain)
+        {
+            TSharedRef<FLane, ESPMode::ThreadSafe> StrongLane = AsShared();
+            AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [StrongLane]()
+            {
+                StrongLane->Drain();
+            });
+        }
+    }
+
+    /** Fecha a lane: descarta a fila e espera o consumo em andamento terminar. */
+    void Close()
+    {
+        bClosed = true;
+        TArray<FIVR_FrameSinkPacket> Discarded;
+        {
+            FScopeLock Lock(&QueueLock);
+            Discarded = MoveTemp(Pending);
+        }
+        for (FIVR_FrameSinkPacket& Packet : Discarded)
+        {
+            Release(Packet);
+        }
+        {
+            FScopeLock ConsumeGuard(&ConsumeLock); // Retorna quando o ConsumeFrame em andamento terminar
+        }
+        // Espera a task de drenagem já agendada sair, para que nenhum ReleaseFrame chegue ao pool depois do Close.
+        // Sem prazo: com a task ainda agendada, drenar a caixa daqui criaria um segundo consumidor.
+        // Com bClosed a task sai sem entregar nada; a espera só é longa se o task graph estiver saturado.
+        const double WarnAtSeconds = FPlatformTime::Seconds() + 1.0;
+        bool bWarned = false;
+        for (;;)
+        {
+            {
+                FScopeLock Lock(&QueueLock);
+                if (!bDrainScheduled && FPlatformAtomics::AtomicRead(&LatestDrainScheduled) == 0)
+                {
+                    break;
+                }
+            }
+            if (!bWarned && FPlatformTime::Seconds() >= WarnAtSeconds)
+            {
+                UE_LOG(LogIVRFrameSink, Warning, TEXT("Sink '%s': drain task still scheduled 1s after Close. Waiting for it to exit."), *GetSinkName().ToString());
+                bWarned = true;
+            }
+            FPlatformProcess::Sleep(0.001f);
+        }
+        // Sem task de drenagem, a Game Thread passa a ser a única consumidora da caixa
+        FIVR_FrameSinkPacket Leftover;
+        while (LatestMailbox.TakeLatest(Leftover))
+        {
+            Release(Leftover);
+        }
+    }
+
+    FName GetSinkName() const { return Sink->GetSinkName(); }
+    const FIVR_FrameSinkLaneSettings& GetLaneSettings() const { return Settings; }
+
+    FIVR_FrameSinkStats GetStats() const
+    {
+        FIVR_FrameSinkStats Stats;
+        Stats.SinkName = GetSinkName();
+        Stats.FramesDelivered = FramesDelivered.GetValue();
+        Stats.FramesDropped = FramesDropped.GetValue();
+        Stats.AverageConsumeMs = Stats.FramesDelivered > 0 ? (ConsumeMicroseconds.GetValue() / 1000.0) / Stats.FramesDelivered : 0.0;
+        return Stats;
+    }
+
+private:
+    /** Lane "o mais recente vence": uma troca atômica por frame e nenhum lock na Game Thread. */
+    void PushLatest(FIVR_FrameSinkPacket&& Packet)
+    {
+        FIVR_FrameSinkPacket Stale;
+        if (LatestMailbox.Publish(MoveTemp(Packet), Stale))
+        {
+            FramesDropped.Increment();
+            Release(Stale); // Nunca entregue ao sink
+        }
+        ScheduleLatestDrain();
+    }
+
+    void ScheduleLatestDrain()
+    {
+        if (FPlatformAtomics::InterlockedCompareExchange(&LatestDrainScheduled, 1, 0) == 0)
+        {
+            TSharedRef<FLane, ESPMode::ThreadSafe> StrongLane = AsShared();
+            AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [StrongLane]()
+            {
+                StrongLane->DrainLatest();
+            });
+        }
+    }
+
+    void DrainLatest()
+    {
+        for (;;)
+        {
+            FIVR_FrameSinkPacket Packet;
+            while (!bClosed && LatestMailbox.TakeLatest(Packet))
+            {
+                Deliver(Packet);
+            }
+            FPlatformAtomics::InterlockedExchange(&LatestDrainScheduled, 0);
+            // Um frame publicado entre o último TakeLatest e a linha acima ficaria órfão: reassume a drenagem.
+            if (bClosed || !LatestMailbox.HasFreshValue() || FPlatformAtomics::InterlockedCompareExchange(&LatestDrainScheduled, 1, 0) != 0)
+            {
+                return;
+            }
+        }
+    }
+
+    void Drain()
+    {
+        for (;;)
+        {
+            FIVR_FrameSinkPacket Packet;
+            {
+                FScopeLock Lock(&QueueLock);
+                if (Pending.Num() == 0 || bClosed)
+                {
+                    bDrainScheduled = false;
+                    return;
+                }
+                Packet = MoveTemp(Pending[0]);
+                Pending.RemoveAt(0, 1, EAllowShrinking::No);
+            }
+            Deliver(Packet);
+        }
+    }
+
+    void Deliver(FIVR_FrameSinkPacket& Packet)
+    {
+        FScopeLock ConsumeGuard(&ConsumeLock);
+        if (bClosed)
+        {
+            Release(Packet);
+            return;
+        }
+        const double StartSeconds = FPlatformTime::Seconds();
+        const bool bRetained = Sink->ConsumeFrame(Packet);
+        ConsumeMicroseconds.Add((int64)((FPlatformTime::Seconds() - StartSeconds) * 1.0e6));
+        FramesDelivered.Increment();
+        if (!bRetained)
+        {
+            Release(Packet);
+        }
+    }
+
+    void Release(FIVR_FrameSinkPacket& Packet)
+    {
+        if (FramePool && Packet.Frame.RawDataPtr.IsValid())
+        {
+            FramePool->ReleaseFrame(Packet.Frame.RawDataPtr);
+        }
+        Packet.Frame.RawDataPtr.Reset();
+    }
+
+    TSharedRef<IIVRFrameSink, ESPMode::ThreadSafe> Sink;
+    FIVR_FrameSinkLaneSettings Settings;
+    UIVRFramePool* FramePool = nullptr;
+
+    FCriticalSection QueueLock;
+    TArray<FIVR_FrameSinkPacket> Pending; // Protegido por QueueLock
+    bool bDrainScheduled = false;         // Protegido por QueueLock
+    FCriticalSection ConsumeLock;         // Mantido durante ConsumeFrame
+    FThreadSafeBool bClosed;
+    TIVR_LatestValueMailbox<FIVR_FrameSinkPacket> LatestMailbox; // Lane LatestFrameWins (produtor: Game Thread)
+    volatile int32 LatestDrainScheduled = 0;
+
+    FThreadSafeCounter64 FramesDelivered;
+    FThreadSafeCounter64 FramesDropped;
+    FThreadSafeCounter64 ConsumeMicroseconds;
+};
+
+FIVR_FrameFanOut::FIVR_FrameFanOut(UIVRFramePool* InFramePool)
+    : FramePool(InFramePool)
+{
+}
+
+FIVR_FrameFanOut::~FIVR_FrameFanOut()
+{
+    RemoveAllSinks();
+}
+
+void FIVR_FrameFanOut::AddSink(const TSharedRef<IIVRFrameSink, ESPMode::ThreadSafe>& Sink)
+{
+    check(IsInGameThread());
+    RemoveSink(Sink->GetSinkName());
+    Lanes.Add(MakeShared<FLane, ESPMode::ThreadSafe>(Sink, FramePool));
+    UE_LOG(LogIVRFrameSink, Log, TEXT("Frame sink '%s' registered (%d sinks)."), *Sink->GetSinkName().ToString(), Lanes.Num());
+}
+
+bool FIVR_FrameFanOut::RemoveSink(FName SinkName)
+{
+    check(IsInGameThread());
+    for (int32 Index = 0; Index < Lanes.Num(); ++Index)
+    {
+        if (Lanes[Index]->GetSinkName() == SinkName)
+        {
+            TSharedRef<FLane, ESPMode::ThreadSafe> Lane = Lanes[Index];
+            Lanes.RemoveAt(Index);
+            Lane->Close();
+            const FIVR_FrameSinkStats Stats = Lane->GetStats();
+            UE_LOG(LogIVRFrameSink, Log, TEXT("Frame sink '%s' removed. Delivered: %lld, dropped: %lld, avg consume: %.2f ms."),
+                *SinkName.ToString(), Stats.FramesDelivered, Stats.FramesDropped, Stats.AverageConsumeMs);
+            return true;
+        }
+    }
+    return false;
+}
+
+void FIVR_FrameFanOut::RemoveAllSinks()
+{
+    while (Lanes.Num() > 0)
+    {
+        RemoveSink(Lanes.Last()->GetSinkName());
+    }
+}
+
+bool FIVR_FrameFanOut::HasSink(FName SinkName) const
+{
+    return Lanes.ContainsByPredicate([SinkName](const TSharedRef<FLane, ESPMode::ThreadSafe>& Lane) { return Lane->GetSinkName() == SinkName; });
+}
+
+void FIVR_FrameFanOut::Dispatch(FIVR_FrameSinkPacket&& Packet)
+{
+    check(IsInGameThread());
+    if (!Packet.Frame.RawDataPtr.IsValid())
+    {
+        return;
+    }
+    if (Lanes.Num() == 0)
+    {
+        if (FramePool)
+        {
+            FramePool->ReleaseFrame(Packet.Frame.RawDataPtr);
+        }
+        return;
+    }
+    if (FramePool)
+    {
+        FramePool->ShareFrame(Packet.Frame.RawDataPtr, Lanes.Num());
+    }
+
+    // Lanes Worker primeiro, para que comecem em paralelo enquanto os sinks Inline rodam na Game Thread.
+    TArray<TSharedRef<FLane, ESPMode::ThreadSafe>, TInlineAllocator<8>> Ordered;
+    for (const TSharedRef<FLane, ESPMode::ThreadSafe>& Lane : Lanes)
+    {
+        if (Lane->GetLaneSettings().Lane == EIVRFrameSinkLane::Worker)
+        {
+            Ordered.Add(Lane);
+        }
+    }
+    for (const TSharedRef<FLane, ESPMode::ThreadSafe>& Lane : Lanes)
+    {
+        if (Lane->GetLaneSettings().Lane == EIVRFrameSinkLane::Inline)
+        {
+            Ordered.Add(Lane);
+        }
+    }
+    for (int32 Index = 0; Index < Ordered.Num(); ++Index)
+    {
+        FIVR_FrameSinkPacket LanePacket = (Index == Ordered.Num() - 1) ? MoveTemp(Packet) : Packet;
+        Ordered[Index]->Push(MoveTemp(LanePacket));
+    }
+}
+
+TArray<FIVR_FrameSinkStats> FIVR_FrameFanOut::GetSinkStats() const
+{
+    TArray<FIVR_FrameSinkStats> Stats;
+    for (const TSharedRef<FLane, ESPMode::ThreadSafe>& Lane : Lanes)
+    {
+        Stats.Add(Lane->GetStats());
+    }
+    return Stats;
+}
@@ -0,0 +1,98 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#include "Components/IVRTileDiff.h"
+
+namespace
+{
+    /** Compara um bloco linha a linha; Memcmp já é vetorizado e para na primeira diferença. */
+    bool IsTileDirty(const uint8* Previous, const uint8* Current, int32 Pitch, int32 X0, int32 Y0, int32 TileWidth, int32 TileHeight)
+    {
+        const int32 RowBytes = TileWidth * 4;
+        SIZE_T Offset = (SIZE_T)Y0 * Pitch + (SIZE_T)X0 * 4;
+        for (int32 Row = 0; Row < TileHeight; ++Row, Offset += Pitch)
+        {
+            if (FMemory::Memcmp(Previous + Offset, Current + Offset, RowBytes) != 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+int32 FIVR_TileDiff::ComputeDirtyRegions(const uint8* Previous, const uint8* Current, int32 Width, int32 Height,
+                                         TArray<FUpdateTextureRegion2D>& OutRegions, float FullUploadFraction)
+{
+    OutRegions.Reset();
+    if (!Previous || !Current || Width <= 0 || Height <= 0)
+    {
+        return 0;
+    }
+    const int32 Pitch = Width * 4;
+    const int32 TilesX = (Width + TileSize - 1) / TileSize;
+    const int32 TilesY = (Height + TileSize - 1) / TileSize;
+    const int32 MaxDirtyTiles = FMath::Max(1, FMath::FloorToInt(TilesX * TilesY * FullUploadFraction));
+
+    // Regiões abertas na linha de blocos anterior: um trecho com o mesmo X inicial e largura é estendido para baixo.
+    TArray<int32, TInlineAllocator<32>> OpenRegions;
+    TArray<int32, TInlineAllocator<32>> NextOpenRegions;
+    int32 NumDirtyTiles = 0;
+
+    for (int32 TileY = 0; TileY < TilesY; ++TileY)
+    {
+        const int32 Y0 = TileY * TileSize;
+        const int32 TileHeight = FMath::Min(TileSize, Height - Y0);
+        NextOpenRegions.Reset();
+        int32 RunStart = INDEX_NONE;
+        for (int32 TileX = 0; TileX <= TilesX; ++TileX)
+        {
+            const bool bDirty = TileX < TilesX
+                && IsTileDirty(Previous, Current, Pitch, TileX * TileSize, Y0, FMath::Min(TileSize, Width - TileX * TileSize), TileHeight);
+            if (bDirty)
+            {
+                ++NumDirtyTiles;
+                if (NumDirtyTiles > MaxDirtyTiles)
+                {
+                    // Mudou demais: um upload único do frame inteiro sai mais barato que muitas regiões
+                    OutRegions.Reset();
+                    OutRegions.Add(FUpdateTextureRegion2D(0, 0, 0, 0, Width, Height));
+                    return NumDirtyTiles;
+                }
+                if (RunStart == INDEX_NONE)
+                {
+                    RunStart = TileX;
+                }
+                continue;
+            }
+            if (RunStart == INDEX_NONE)
+            {
+                continue;
+            }
+            // Fecha o trecho [RunStart, TileX) desta linha de blocos
+            const uint32 RunX = RunStart * TileSize;
+            const uint32 RunWidth = FMath::Min(TileX * TileSize, Width) - RunX;
+            int32 RegionIndex = INDEX_NONE;
+            for (int32 Open : OpenRegions)
+            {
+                if (OutRegions[Open].DestX == RunX && OutRegions[Open].Width == RunWidth)
+                {
+                    RegionIndex = Open;
+                    break;
+                }
+            }
+            if (RegionIndex != INDEX_NONE)
+            {
+                OutRegions[RegionIndex].Height += TileHeight;
+            }
+            else
+            {
+                RegionIndex = OutRegions.Add(FUpdateTextureRegion2D(RunX, Y0, RunX, Y0, RunWidth, TileHeight));
+            }
+            NextOpenRegions.Add(RegionIndex);
+            RunStart = INDEX_NONE;
+        }
+        Swap(OpenRegions, NextOpenRegions);
+    }
+    return NumDirtyTiles;
+}
@@ -5,6 +5,11 @@
 // -------------------------------------------------------------------------------
 #include "IVRGlobalStatics.h"
 #include "HAL/PlatformMisc.h"  
+#include "IVR_TransportBenchmark.h"
+#include "IVRFeatureResult.h"
+#include "IVR.h"
+#include "Async/Async.h"
+#include "HAL/ThreadSafeBool.h"
 
 FIVR_SystemErrorDetails UIVRGlobalStatics::GetLastSystemErrorDetails()
 {
@@ -37,4 +42,60 @@ FIVR_SystemErrorDetails UIVRGlobalStatics::GetLastSystemErrorDetails()
     return ErrorDetails;
 }
 
+void UIVRGlobalStatics::RunFrameTransportBenchmark(FOnIVRTransportBenchmarkFinished OnFinished, int32 NumFrames)
+{
+    // Uma rodada por vez: os transportes disputariam CPU e buffers do kernel, distorcendo as medidas.
+    static FThreadSafeBool bBenchmarkRunning;
+    if (bBenchmarkRunning.AtomicSet(true))
+    {
+        UE_LOG(LogIVR, Warning, TEXT("RunFrameTransportBenchmark: a benchmark is already running. Request ignored."));
+        return;
+    }
+    const int32 FramesPerRun = FMath::Max(NumFrames, 1);
+    Async(EAsyncExecution::Thread, [OnFinished, FramesPerRun]()
+    {
+        TArray<FString> Report;
+        for (const FIVR_TransportBenchmarkResult& Result : FIVR_TransportBenchmark::RunAll(FramesPerRun))
+        {
+            Report.Add(FIVR_TransportBenchmark::Describe(Result));
+        }
+        AsyncTask(ENamedThreads::GameThread, [OnFinished, Report = MoveTemp(Report)]()
+        {
+            bBenchmarkRunning.AtomicSet(false);
+            OnFinished.ExecuteIfBound(Report);
+        });
+    });
+}
+
+bool UIVRGlobalStatics::HasJustRTFramePixels(const FIVR_JustRTFrame& Frame)
+{
+    return Frame.HasPixelData();
+}
+
+TArray<uint8> UIVRGlobalStatics::GetJustRTFramePixels(const FIVR_JustRTFrame& Frame)
+{
+    return Frame.GetPixelData();
+}
+
+FLinearColor UIVRGlobalStatics::GetJustRTFramePixelColor(const FIVR_JustRTFrame& Frame, int32 X, int32 Y)
+{
+    const TArray<uint8>& Pixels = Frame.GetPixelData();
+    const int64 Offset = ((int64)Y * Frame.Width + X) * 4;
+    if (X < 0 || Y < 0 || X >= Frame.Width || Y >= Frame.Height || Offset + 4 > Pixels.Num())
+    {
+        return FLinearColor::Transparent;
+    }
+    const uint8* Pixel = Pixels.GetData() + Offset; // BGRA
+    return FColor(Pixel[2], Pixel[1], Pixel[0], Pixel[3]).ReinterpretAsLinear();
+}
 
+FIVR_JustRTFeatures UIVRGlobalStatics::GetJustRTFrameFeatures(const FIVR_JustRTFrame& Frame)
+{
+    if (!Frame.FeatureResult.IsValid())
+    {
+        return Frame.Features;
+    }
+    FIVR_JustRTFeatures Features;
+    Frame.FeatureResult->ToBlueprint(Features);
+    return Features;
+}
@@ -6,6 +6,8 @@
 #include "Recording/IVRECFactory.h" // Inclua o cabe�alho da sua pr�pria classe
 #include "Internationalization/Text.h" // Para FText e FText::Format
 #include "HAL/PlatformFileManager.h" // Necess�rio para FPlatformFileManager
+#include "HAL/PlatformProcess.h"
+#include "Misc/ScopeLock.h"
 
 // Defini��o do LogCategory (se j� definido em outro lugar, remova esta linha)
 DEFINE_LOG_CATEGORY(LogIVRECFactory);
@@ -27,7 +29,7 @@ void UIVRECFactory::IVR_BuildRawRgbCommand()
     ArgsArray.Add(TEXT("-y")); // Sobrescreve o arquivo de sa�da sem perguntar
 
     // Entrada de V�deo RGBA    
-    ArgsArray.Add(FString::Printf(TEXT("-f rawvideo -pix_fmt %s -s %dx%d -r %f"),*VideoSettings.PixelFormat, VideoSettings.Width, VideoSettings.Height, VideoSettings.FPS));
+    ArgsArray.Add(IVR_GetVideoInputArgs());
     
     //Informa Pipe de Entrada.
     ArgsArray.Add(FString::Printf(TEXT("-i %s"), *InVideoPipePath)); 
@@ -60,7 +62,7 @@ void UIVRECFactory::IVR_BuildLibx264Command()
 
     // Entrada de V�deo RGBA    
     // Entrada de V�deo RGBA - AGORA USANDO AS DIMENS�ES REAIS
-    ArgsArray.Add(FString::Printf(TEXT("-f rawvideo -pix_fmt %s -s %dx%d -r %f"), *VideoSettings.PixelFormat, ActualVideoWidth, ActualVideoHeight, VideoSettings.FPS));
+    ArgsArray.Add(IVR_GetVideoInputArgs());
     
     //Informa Caminho do Pipe de Entrada.
     ArgsArray.Add(FString::Printf(TEXT("-i %s"), *InVideoPipePath)); 
@@ -72,6 +74,7 @@ void UIVRECFactory::IVR_BuildLibx264Command()
     ArgsArray.Add(TEXT("-c:v libx264"));      // Usar o encoder libx264
     ArgsArray.Add(TEXT("-preset ultrafast")); // Preset para velocidade (menos exigente)
     ArgsArray.Add(TEXT("-crf 23 "));           // Constant Rate Factor (controle de qualidade)
+    ArgsArray.Add(IVR_GetFrameRateOutputArgs());
     //=========================================TESTE===========================================
     
     // Arquivo Saida
@@ -90,7 +93,7 @@ void UIVRECFactory::IVR_BuildSettingsCommand()
     ArgsArray.Add(TEXT("-y")); // Sobrescreve o arquivo de sa�da sem perguntar
 
     // Entrada de V�deo RGBA    
-    ArgsArray.Add(FString::Printf(TEXT("-f rawvideo -pix_fmt %s -s %dx%d -r %f"), *VideoSettings.PixelFormat, ActualVideoWidth, ActualVideoHeight, VideoSettings.FPS));
+    ArgsArray.Add(IVR_GetVideoInputArgs());
     //Informa Caminho.
     ArgsArray.Add(FString::Printf(TEXT("-i %s"), *InVideoPipePath)); 
     
@@ -99,6 +102,7 @@ void UIVRECFactory::IVR_BuildSettingsCommand()
 
     // Sa�da de V�deo
     ArgsArray.Add(FString::Printf(TEXT("-c:v %s -b:v %d"), *VideoSettings.Codec, VideoSettings.Bitrate));
+    ArgsArray.Add(IVR_GetFrameRateOutputArgs());
     
     // Arquivo de Sa�da
     ArgsArray.Add(*InOutputFilePath); 
@@ -138,6 +142,76 @@ void UIVRECFactory::IVR_BuildConcatenationCommand(const FString& InFilelistPath,
 }
 
 
+// --- INÍCIO DA ALTERAÇÃO: TIMESTAMPS POR FRAME (CFR/VFR) ---
+FString UIVRECFactory::IVR_GetVideoInputArgs() const
+{
+    if (VideoSettings.IVR_FrameTimingMode == EIVRFrameTimingMode::AssumeNominalFPS)
+    {
+        // Legado: o FFmpeg assume exatamente 1/FPS entre frames.
+        return FString::Printf(TEXT("-f rawvideo -pix_fmt %s -s %dx%d -r %f"), *VideoSettings.PixelFormat, ActualVideoWidth, ActualVideoHeight, VideoSettings.FPS);
+    }
+    // Matroska pelo pipe (FIVR_MatroskaPipeMuxer): dimensões e pixel format vêm do cabeçalho, timestamps de cada bloco.
+    return TEXT("-f matroska");
+}
+
+FString UIVRECFactory::IVR_GetFrameRateOutputArgs() const
+{
+    // -fps_mode substituiu -vsync no FFmpeg 5.1; executáveis mais antigos só conhecem o -vsync.
+    const TCHAR* FpsModeOption = IVR_SupportsFpsMode() ? TEXT("-fps_mode") : TEXT("-vsync");
+    switch (VideoSettings.IVR_FrameTimingMode)
+    {
+    case EIVRFrameTimingMode::ConstantFrameRate:
+        return FString::Printf(TEXT("%s cfr -r %f"), FpsModeOption, VideoSettings.FPS);
+    case EIVRFrameTimingMode::VariableFrameRate:
+        return FString::Printf(TEXT("%s vfr"), FpsModeOption);
+    default:
+        return FString();
+    }
+}
+
+bool UIVRECFactory::IVR_SupportsFpsMode() const
+{
+    static FCriticalSection CacheMutex;
+    static TMap<FString, bool> SupportsFpsModeByExecutable;
+    {
+        FScopeLock Lock(&CacheMutex);
+        if (const bool* Cached = SupportsFpsModeByExecutable.Find(FFmpegExecutablePath))
+        {
+            return *Cached;
+        }
+    }
+
+    bool bSupportsFpsMode = true;
+    int32 ReturnCode = -1;
+    FString StdOut;
+    FString StdErr;
+    if (!FFmpegExecutablePath.IsEmpty() && FPlatformProcess::ExecProcess(*FFmpegExecutablePath, TEXT("-version"), &ReturnCode, &StdOut, &StdErr) && ReturnCode == 0)
+    {
+        // "ffmpeg version 4.4.2-..." ou "ffmpeg version n5.0.1": apenas versões numeradas abaixo de 5.1 usam -vsync.
+        const FString VersionTag = TEXT("ffmpeg version ");
+        const int32 TagIndex = StdOut.Find(VersionTag, ESearchCase::IgnoreCase);
+        if (TagIndex != INDEX_NONE)
+        {
+            FString Version = StdOut.Mid(TagIndex + VersionTag.Len(), 16);
+            Version.RemoveFromStart(TEXT("n"));
+            FString MajorText;
+            FString Remainder;
+            if (Version.Split(TEXT("."), &MajorText, &Remainder) && MajorText.IsNumeric() && Remainder.Len() > 0 && FChar::IsDigit(Remainder[0]))
+            {
+                const int32 Major = FCString::Atoi(*MajorText);
+                const int32 Minor = FCString::Atoi(*Remainder);
+                bSupportsFpsMode = (Major > 5) || (Major == 5 && Minor >= 1);
+            }
+        }
+        UE_LOG(LogIVRECFactory, Log, TEXT("FFmpeg at %s %s -fps_mode."), *FFmpegExecutablePath, bSupportsFpsMode ? TEXT("supports") : TEXT("predates"));
+    }
+
+    FScopeLock Lock(&CacheMutex);
+    SupportsFpsModeByExecutable.Add(FFmpegExecutablePath, bSupportsFpsMode);
+    return bSupportsFpsMode;
+}
+// --- FIM DA ALTERAÇÃO ---
+
 FString UIVRECFactory::IVR_GetEncoderCommand(const FString& CommandName)
 {
     // Verifique se o formato de comando existe
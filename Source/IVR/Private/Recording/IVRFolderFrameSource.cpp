@@ -5,6 +5,7 @@
 #include "IVR.h"
 #include "IVRGlobalStatics.h"
 #include "Engine/World.h"
+#include "IVRCaptureClock.h"
 #include "Misc/Paths.h"
 #include "HAL/FileManager.h"
 #include "Misc/FileHelper.h" // For FFileHelper
@@ -129,7 +130,7 @@ void UIVRFolderFrameSource::ReadNextFrameFromFile()
 // Carrega a imagem e decodifica para BGRA
     if (LoadImageFromFile(ImageFiles[CurrentImageIndex], *FrameBuffer))
     {
-        FIVR_VideoFrame NewFrame(FrameSourceSettings.Width, FrameSourceSettings.Height, CurrentWorld->GetTimeSeconds());
+        FIVR_VideoFrame NewFrame(FrameSourceSettings.Width, FrameSourceSettings.Height, FIVR_CaptureClock::Get().NowNs());
         NewFrame.RawDataPtr = FrameBuffer;
         UE_LOG(LogIVRFrameSource, Warning, TEXT("UIVRFolderFrameSource: Leu frame %d de '%s'."), CurrentImageIndex, *ImageFiles[CurrentImageIndex]);
         OnFrameAcquired.Broadcast(MoveTemp(NewFrame));
@@ -132,14 +132,36 @@ void UIVRRecordingManager::StopRecording(UIVRRecordingSession* Session)
     Session->StopRecording(); 
     
     FString SessionOutputPath = Session->GetOutputPath();
-    if (!SessionOutputPath.IsEmpty() && FPlatformFileManager::Get().GetPlatformFile().FileExists(*SessionOutputPath))
+    if (Session->IsEncodingRaw())
+    {
+        // RawCapture: o .ivrraw está sendo codificado em segundo plano; o take entra na lista quando terminar.
+        Session->OnRawEncodeFinished.AddUniqueDynamic(this, &UIVRRecordingManager::HandleRawEncodeFinished);
+        ++PendingRawEncodes;
+        UE_LOG(LogIVR, Log, TEXT("Take raw container %s is being encoded in background. It will be added to CompletedTakes when done."), *SessionOutputPath);
+    }
+    // Takes em modo RawCapture sem codificação ao parar ficam como .ivrraw; não entram na concatenação do Master.
+    else if (FPaths::GetExtension(SessionOutputPath).Equals(TEXT("ivrraw"), ESearchCase::IgnoreCase))
+    {
+        UE_LOG(LogIVR, Log, TEXT("Take kept as raw container for later encoding: %s. Not added to CompletedTakes list."), *SessionOutputPath);
+    }
+    else
+    {
+        RegisterCompletedTake(Session, SessionOutputPath);
+    }
+    ActiveSessions.Remove(Session);
+    // <--- ALTERAÇÃO: A flag `bIsGeneratingMasterVideo` NÃO é resetada aqui, pois a concatenação pode acontecer depois.
+}
+
+void UIVRRecordingManager::RegisterCompletedTake(UIVRRecordingSession* Session, const FString& TakeFilePath)
+{
+    if (!TakeFilePath.IsEmpty() && FPlatformFileManager::Get().GetPlatformFile().FileExists(*TakeFilePath))
     {
         FIVR_TakeInfo TakeInfo;
         TakeInfo.TakeNumber = CompletedTakes.Num() + 1;
         TakeInfo.Duration = Session->GetDuration(); 
         TakeInfo.StartTime = Session->GetStartTime(); 
         TakeInfo.EndTime = FDateTime::Now(); 
-        TakeInfo.FilePath = SessionOutputPath; 
+        TakeInfo.FilePath = TakeFilePath; 
         TakeInfo.SessionID = Session->GetSessionID(); 
         
         // --- INÍCIO DA ALTERAÇÃO: SALVAR CONFIGURAÇÕES DE NOME CUSTOMIZADO NO TAKEINFO ---
@@ -151,10 +173,39 @@ void UIVRRecordingManager::StopRecording(UIVRRecordingSession* Session)
     }
     else
     {
-        UE_LOG(LogIVR, Warning, TEXT("Take completed, but file not found or path invalid: %s. Not added to CompletedTakes list."), *SessionOutputPath);
+        UE_LOG(LogIVR, Warning, TEXT("Take completed, but file not found or path invalid: %s. Not added to CompletedTakes list."), *TakeFilePath);
+    }
+}
+
+void UIVRRecordingManager::HandleRawEncodeFinished(UIVRRecordingSession* Session, bool bSuccess, const FString& OutputPath)
+{
+    if (!Session)
+        return;
+    Session->OnRawEncodeFinished.RemoveDynamic(this, &UIVRRecordingManager::HandleRawEncodeFinished);
+
+    bool bGenerateMasterVideo = false;
+    {
+        FScopeLock Lock(&ManagerMutex);
+        if (bSuccess)
+        {
+            RegisterCompletedTake(Session, OutputPath);
+        }
+        else
+        {
+            UE_LOG(LogIVR, Warning, TEXT("Raw container encode failed. Take kept as %s. Not added to CompletedTakes list."), *OutputPath);
+        }
+        PendingRawEncodes = FMath::Max(0, PendingRawEncodes - 1);
+        bGenerateMasterVideo = PendingRawEncodes == 0 && bMasterVideoDeferred;
+        if (bGenerateMasterVideo)
+        {
+            bMasterVideoDeferred = false;
+        }
+    }
+    if (bGenerateMasterVideo)
+    {
+        // Último take pendente concluído: gera o Master que o StopRecording pediu
+        GenerateMasterVideoAndCleanup();
     }
-    ActiveSessions.Remove(Session);
-    // <--- ALTERAÇÃO: A flag `bIsGeneratingMasterVideo` NÃO é resetada aqui, pois a concatenação pode acontecer depois.
 }
 
 void UIVRRecordingManager::FinalizeAllRecordings(FString MasterVideoPath, const FIVR_VideoSettings& VideoSettings, const FString& FFmpegExecutablePath)
@@ -222,6 +273,14 @@ FString UIVRRecordingManager::GenerateMasterVideoAndCleanup()
 {
     FScopeLock Lock(&ManagerMutex); // Garantir acesso exclusivo durante a geração do vídeo mestre
 
+    // NOVO: Takes RawCapture ainda sendo codificados entrariam no Master seguinte; a geração espera por eles.
+    if (PendingRawEncodes > 0)
+    {
+        bMasterVideoDeferred = true;
+        UE_LOG(LogIVR, Log, TEXT("Master video deferred until %d raw take encode(s) finish."), PendingRawEncodes);
+        return FString();
+    }
+
     // <--- ALTERAÇÃO: Definir flag de ocupado no início
     bIsGeneratingMasterVideo.AtomicSet(true); 
 
@@ -26,6 +26,7 @@ UIVRRecordingSession::UIVRRecordingSession()
     , HasNewFrameEvent(FPlatformProcess::GetSynchEventFromPool(true)) 
     , FramePool(nullptr) // Inicializa o FramePool
 {
+    SpaceAvailableEvent = FPlatformProcess::GetSynchEventFromPool(false); // auto-reset: acorda um produtor por vez
 }
 UIVRRecordingSession::~UIVRRecordingSession() // LINHA 37
 {
@@ -54,6 +55,11 @@ UIVRRecordingSession::~UIVRRecordingSession() // LINHA 37
         FGenericPlatformProcess::ReturnSynchEventToPool(HasNewFrameEvent);
         HasNewFrameEvent = nullptr;
     }
+    if (SpaceAvailableEvent)
+    {
+        FGenericPlatformProcess::ReturnSynchEventToPool(SpaceAvailableEvent);
+        SpaceAvailableEvent = nullptr;
+    }
     // O VideoEncoder (UPROPERTY()) será coletado pelo GC.
     // FramePool (UPROPERTY()) também será coletado pelo GC.
     // Eles não devem ser gerenciados aqui no destrutor.
@@ -61,6 +67,10 @@ UIVRRecordingSession::~UIVRRecordingSession() // LINHA 37
 void UIVRRecordingSession::Initialize(const FIVR_VideoSettings& InVideoSettings, const FString& InFFmpegExecutablePath, int32 InActualFrameWidth, int32 InActualFrameHeight, UIVRFramePool* InFramePool)
 {
     UserRecordingSettings = InVideoSettings;
+    ActualFrameWidth = InActualFrameWidth;
+    ActualFrameHeight = InActualFrameHeight;
+    FFmpegExecutablePath = InFFmpegExecutablePath;
+    bRawCaptureMode = (UserRecordingSettings.IVR_RecordingMode == EIVRRecordingMode::RawCapture);
     
     FramePool = InFramePool;
     if (!FramePool) // Verifica se o FramePool é válido
@@ -69,7 +79,8 @@ void UIVRRecordingSession::Initialize(const FIVR_VideoSettings& InVideoSettings,
         return;
     }
     // Garante que o VideoEncoder seja inicializado uma única vez para esta sessão/take.
-    if (!VideoEncoder)
+    // Em RawCapture não há encoder ao vivo: ele é criado apenas no StopRecording, se a codificação ao parar estiver ativa.
+    if (!VideoEncoder && !bRawCaptureMode)
     {
         VideoEncoder = NewObject<UIVRVideoEncoder>(this);
         if (!VideoEncoder)
@@ -98,7 +109,12 @@ bool UIVRRecordingSession::StartRecording()
         UE_LOG(LogIVRRecSession, Warning, TEXT("Recording is already in progress. Call StopRecording() first."));
         return false;
     }
-    if (!VideoEncoder || !VideoEncoder->IsInitialized())
+    if (bRawEncodeInProgress)
+    {
+        UE_LOG(LogIVRRecSession, Warning, TEXT("Previous take is still being encoded from its raw container. Wait for OnRawEncodeFinished."));
+        return false;
+    }
+    if (!bRawCaptureMode && (!VideoEncoder || !VideoEncoder->IsInitialized()))
     {
         UE_LOG(LogIVRRecSession, Error, TEXT("VideoEncoder is not initialized. Cannot start recording."));
         return false;
@@ -107,13 +123,43 @@ bool UIVRRecordingSession::StartRecording()
     bIsPaused.AtomicSet(false);
     bStopThread.AtomicSet(false);
     StartTime = FDateTime::Now();
+    CaptureTimeline.Start();
+    FirstFrameCaptureNs.Set(-1);
     ClearQueues(); // Limpa as filas de frames
+    ResetBackpressureState();
+    // Capacidade da fila em frames, derivada da taxa alvo e da janela configurada (mínimo de 2 frames).
+    const float CapacityFPS = (UserRecordingSettings.FPS > 0.0f) ? UserRecordingSettings.FPS : 30.0f;
+    QueueCapacityFrames = FMath::Max(2, FMath::CeilToInt(CapacityFPS * FMath::Max(UserRecordingSettings.IVR_QueueCapacitySeconds, 0.1f)));
+    bSpillAvailable = false;
+    bSpillActive = false;
+    if (UserRecordingSettings.IVR_BackpressurePolicy == EIVRBackpressurePolicy::SpillToDisk)
+    {
+        bSpillAvailable = OpenSpillRing();
+        if (!bSpillAvailable)
+        {
+            UE_LOG(LogIVRRecSession, Warning, TEXT("Failed to create spill file. Backpressure policy SpillToDisk falling back to DropNewest."));
+        }
+    }
     
     // Gera o caminho completo para o take atual.
     CurrentTakeFilePath = GenerateTakeFilePath();
+    if (bRawCaptureMode)
+    {
+        // RawCapture: os frames vão direto para o container, limitados apenas pela banda do disco.
+        RawContainerFilePath = FPaths::ChangeExtension(CurrentTakeFilePath, TEXT("ivrraw"));
+        bRawWriteErrorLogged = false;
+        const float RawFPS = (UserRecordingSettings.FPS > 0.0f) ? UserRecordingSettings.FPS : 30.0f;
+        if (!RawWriter.Open(RawContainerFilePath, ActualFrameWidth, ActualFrameHeight, RawFPS, UserRecordingSettings.IVR_RawCompressLZ4))
+        {
+            UE_LOG(LogIVRRecSession, Error, TEXT("Failed to create raw container %s. Aborting recording."), *RawContainerFilePath);
+            bIsRecording.AtomicSet(false);
+            SpillRing.Close();
+            return false;
+        }
+    }
     // Lança o processo FFmpeg através do VideoEncoder.
     // Passa o caminho do take atual para o encoder.
-    if (!VideoEncoder->LaunchEncoder(CurrentTakeFilePath))
+    else if (!VideoEncoder->LaunchEncoder(CurrentTakeFilePath))
     {
         UE_LOG(LogIVRRecSession, Error, TEXT("Failed to launch FFmpeg process via VideoEncoder. Aborting recording."));
         bIsRecording.AtomicSet(false);
@@ -132,10 +178,11 @@ bool UIVRRecordingSession::StartRecording()
         {
             VideoEncoder->ShutdownEncoder(); 
         }
+        RawWriter.Abort();
         bIsRecording.AtomicSet(false);
         return false;
     }
-    UE_LOG(LogIVRRecSession, Log, TEXT("FFmpeg recording session started for take: %s"), *CurrentTakeFilePath);
+    UE_LOG(LogIVRRecSession, Log, TEXT("%s recording session started for take: %s"), bRawCaptureMode ? TEXT("Raw capture") : TEXT("FFmpeg"), bRawCaptureMode ? *RawContainerFilePath : *CurrentTakeFilePath);
     return true; 
 }
 void UIVRRecordingSession::StopRecording() // LINHA 165 (aproximada)
@@ -143,7 +190,7 @@ void UIVRRecordingSession::StopRecording() // LINHA 165 (aproximada)
     // Validação robusta para evitar warnings falsos ou tentar parar algo que já está parado.
     // A condição `RecordingThread != nullptr` já é suficiente para saber se a thread está ativa.
     // `VideoEncoder != nullptr` é uma boa checagem se o encoder existe.
-    bool bNeedsStopping = bIsRecording || bIsPaused || RecordingThread != nullptr || (VideoEncoder != nullptr); // Simplificado
+    bool bNeedsStopping = bIsRecording || bIsPaused || RecordingThread != nullptr || (VideoEncoder != nullptr) || RawWriter.IsOpen(); // Simplificado
     if (!bNeedsStopping)
     {
         // Se a sessão já foi marcada como parada, seus threads e encoders já foram tratados.
@@ -160,17 +207,13 @@ void UIVRRecordingSession::StopRecording() // LINHA 165 (aproximada)
     {
         HasNewFrameEvent->Trigger();
     }
-
-    // 1. Sinaliza ao VideoEncoder para finalizar a codificação e fechar o pipe de entrada, se ele estiver inicializado.
-    // Esta parte é crucial, pois sinaliza EOF para o FFmpeg.
-    if (VideoEncoder && VideoEncoder->IsInitialized())
+    if (SpaceAvailableEvent)
     {
-        UE_LOG(LogIVRRecSession, Log, TEXT("StopRecording for SessionID %s: Calling VideoEncoder->FinishEncoding() and waiting."), *SessionID);
-        VideoEncoder->FinishEncoding(); 
+        SpaceAvailableEvent->Trigger(); // Libera um produtor que esteja bloqueado (BlockProducer)
     }
-    // <--- LINHA PROTECTED FFmpegProcHandle.IsValid() REMOVIDA AQUI, POIS NÃO É MAIS NECESSÁRIA.
 
-    // 2. Espera o thread de gravação local (que enfileira frames) ser concluído.
+    // 1. Espera o thread de gravação local concluir. Ele drena a fila da sessão para o encoder antes de sair,
+    // por isso precisa terminar ANTES do FinishEncoding (caso contrário o encoder recusaria esses frames).
     if (RecordingThread)
     {
         UE_LOG(LogIVRRecSession, Log, TEXT("StopRecording for SessionID %s: Waiting for RecordingThread to complete."), *SessionID);
@@ -179,6 +222,25 @@ void UIVRRecordingSession::StopRecording() // LINHA 165 (aproximada)
         RecordingThread = nullptr;
         UE_LOG(LogIVRRecSession, Log, TEXT("Recording thread stopped for SessionID %s."), *SessionID);
     }
+    // O IVRecThread já devolveu ao encoder tudo o que estava em disco; o arquivo de spill pode ser removido.
+    // O que ainda restar (encoder recusou o fim da sessão) é contado como perdido.
+    FramesLostFromSpillCounter.Add(SpillRing.Num());
+    SpillRing.Close();
+    bSpillAvailable = false;
+
+    // RawCapture: fecha o container e dispara a codificação posterior em segundo plano (com o próprio encoder).
+    if (RawWriter.IsOpen())
+    {
+        FinalizeRawCapture();
+    }
+
+    // 2. Sinaliza ao VideoEncoder para finalizar a codificação e fechar o pipe de entrada, se ele estiver inicializado.
+    // Esta parte é crucial, pois sinaliza EOF para o FFmpeg.
+    if (VideoEncoder && VideoEncoder->IsInitialized())
+    {
+        UE_LOG(LogIVRRecSession, Log, TEXT("StopRecording for SessionID %s: Calling VideoEncoder->FinishEncoding() and waiting."), *SessionID);
+        VideoEncoder->FinishEncoding(); 
+    }
 
     // 3. Executa um desligamento final dos recursos do VideoEncoder, incluindo o processo FFmpeg.
     // VideoEncoder->ShutdownEncoder() é projetado para ser idempotente e gerencia seu próprio estado interno.
@@ -190,9 +252,16 @@ void UIVRRecordingSession::StopRecording() // LINHA 165 (aproximada)
         VideoEncoder->ShutdownEncoder(); 
     }
     
-    // Calcula a duração final da gravação
-    RecordingDuration = (FDateTime::Now() - StartTime).GetTotalSeconds();
+    // Calcula a duração final da gravação (descontadas as pausas)
+    RecordingDuration = FIVR_CaptureClock::ToSeconds(CaptureTimeline.GetElapsedNs());
     UE_LOG(LogIVRRecSession, Log, TEXT("Take recording stopped. Final duration: %.2f seconds. File intended for: %s"), RecordingDuration, *CurrentTakeFilePath);
+    const FIVR_BackpressureStats FinalStats = GetBackpressureStats();
+    UE_LOG(LogIVRRecSession, Log, TEXT("Backpressure stats (SessionID %s): accepted %d, dropped newest %d, dropped oldest %d, blocks %d, block timeouts %d, decimated %d, spilled %d, restored %d, dropped spill full %d, lost from spill %d, dropped after finish %d, bursts %d, peak depth %d/%d."),
+        *SessionID, FinalStats.FramesAccepted, FinalStats.FramesDroppedNewest, FinalStats.FramesDroppedOldest, FinalStats.ProducerBlocks, FinalStats.BlockTimeouts,
+        FinalStats.FramesDecimated, FinalStats.FramesSpilled, FinalStats.FramesRestoredFromSpill, FinalStats.FramesDroppedSpillFull, FinalStats.FramesLostFromSpill,
+        FinalStats.FramesDroppedAfterFinish, FinalStats.DropBursts, FinalStats.PeakQueueDepth, QueueCapacityFrames);
+    UE_LOG(LogIVRRecSession, Log, TEXT("Capture clock (SessionID %s): first frame at %lld ns, paused %.3f s."),
+        *SessionID, FirstFrameCaptureNs.GetValue(), FIVR_CaptureClock::ToSeconds(CaptureTimeline.GetPausedNs()));
     
     // A validação se o arquivo foi realmente criado será feita pelo UIVRRecordingManager.
     // NENHUMA LÓGICA DE CONCATENAÇÃO AQUI.
@@ -201,6 +270,7 @@ void UIVRRecordingSession::PauseRecording()
 {
     if (bIsRecording && !bIsPaused)
     {
+        CaptureTimeline.Pause();
         bIsPaused.AtomicSet(true);
         UE_LOG(LogIVRRecSession, Log, TEXT("Recording session paused for take: %s"), *SessionID);
     }
@@ -210,6 +280,7 @@ void UIVRRecordingSession::ResumeRecording()
 {
     if (bIsRecording && bIsPaused)
     {
+        CaptureTimeline.Resume();
         bIsPaused.AtomicSet(false);
         UE_LOG(LogIVRRecSession, Log, TEXT("Recording session resumed for take: %s"), *SessionID);
     }
@@ -217,9 +288,9 @@ void UIVRRecordingSession::ResumeRecording()
 
 float UIVRRecordingSession::GetDuration() const
 {
-    if (bIsRecording && !bIsPaused)
+    if (bIsRecording)
     {
-        return (FDateTime::Now() - StartTime).GetTotalSeconds();
+        return FIVR_CaptureClock::ToSeconds(CaptureTimeline.GetElapsedNs());
     }
     return RecordingDuration;
 }
@@ -234,8 +305,8 @@ void UIVRRecordingSession::ClearQueues()
             FramePool->ReleaseFrame(DummyVideoFrame.RawDataPtr);
         }
     }
-    VideoConsumerQCounter = 0;
-    VideoProducerQCounter = 0;
+    VideoConsumerQCounter.Reset();
+    VideoProducerQCounter.Reset();
 }
 // Adiciona um frame de vídeo à fila. Timestamp já é o tempo global.
 void UIVRRecordingSession::AddVideoFrame(FIVR_VideoFrame Frame) // Assinatura mudada
@@ -249,29 +320,385 @@ void UIVRRecordingSession::AddVideoFrame(FIVR_VideoFrame Frame) // Assinatura mu
         }
         return;
     }
-    // Use a taxa de quadros alvo para estimar um limite de buffer mais preciso
-    int32 MaxBufferedFrames = (UserRecordingSettings.FPS > 0) ? FMath::CeilToInt(UserRecordingSettings.FPS * 1.0f) : 30; 
-    if (VideoProducerQCounter >= MaxBufferedFrames) 
+    // --- INÍCIO DA ALTERAÇÃO: POLÍTICAS DE BACKPRESSURE ---
+    const int32 QueueDepth = VideoProducerQCounter.GetValue();
+    switch (UserRecordingSettings.IVR_BackpressurePolicy)
     {
-        UE_LOG(LogIVRRecSession, Warning, TEXT("Video frame producer queue is full (%d frames, max %d). Dropping frame."), VideoProducerQCounter, MaxBufferedFrames);
-        // Libera o frame para o pool se a fila estiver cheia.
-        if (FramePool && Frame.RawDataPtr.IsValid())
+    case EIVRBackpressurePolicy::DropOldest:
+        // Sempre aceita o frame novo; o IVRecThread (único consumidor da fila Mpsc) descarta os mais antigos.
+        break;
+
+    case EIVRBackpressurePolicy::BlockProducer:
+        if (QueueDepth >= QueueCapacityFrames)
         {
-            FramePool->ReleaseFrame(Frame.RawDataPtr);
+            ProducerBlocksCounter.Increment();
+            const double Deadline = FPlatformTime::Seconds() + FMath::Max(UserRecordingSettings.IVR_BlockTimeoutMs, 1) / 1000.0;
+            while (bIsRecording && VideoProducerQCounter.GetValue() >= QueueCapacityFrames)
+            {
+                const int32 RemainingMs = FMath::CeilToInt((Deadline - FPlatformTime::Seconds()) * 1000.0);
+                if (RemainingMs <= 0 || !SpaceAvailableEvent)
+                {
+                    break;
+                }
+                SpaceAvailableEvent->Wait(RemainingMs);
+            }
+            if (!bIsRecording || VideoProducerQCounter.GetValue() >= QueueCapacityFrames)
+            {
+                DiscardFrame(Frame, BlockTimeoutsCounter);
+                return;
+            }
+        }
+        break;
+
+    case EIVRBackpressurePolicy::DecimateHalfRate:
+        // Histerese: entra em dizimação com a fila na metade e sai quando ela volta a um quarto.
+        if (!bDecimating && QueueDepth >= QueueCapacityFrames / 2)
+        {
+            bDecimating = true;
+            bSkipNextDecimatedFrame = true;
+        }
+        else if (bDecimating && QueueDepth <= QueueCapacityFrames / 4)
+        {
+            bDecimating = false;
+        }
+        if (QueueDepth >= QueueCapacityFrames)
+        {
+            DiscardFrame(Frame, FramesDroppedNewestCounter);
+            return;
+        }
+        if (bDecimating)
+        {
+            const bool bSkip = bSkipNextDecimatedFrame;
+            bSkipNextDecimatedFrame = !bSkipNextDecimatedFrame;
+            if (bSkip)
+            {
+                DiscardFrame(Frame, FramesDecimatedCounter);
+                return;
+            }
+        }
+        break;
+
+    case EIVRBackpressurePolicy::SpillToDisk:
+        // Com o anel disponível, sempre aceita: o IVRecThread move o excesso para o disco.
+        if (bSpillAvailable)
+        {
+            break;
+        }
+        // Sem camada de spill: comporta-se como DropNewest.
+        [[fallthrough]];
+    case EIVRBackpressurePolicy::DropNewest:
+    default:
+        if (QueueDepth >= QueueCapacityFrames)
+        {
+            DiscardFrame(Frame, FramesDroppedNewestCounter);
+            return;
         }
-        return; 
+        break;
     }
+    // --- FIM DA ALTERAÇÃO ---
     // LOG DE DEBUG: Confirma o tamanho do frame que está sendo enfileirado
     // UE_LOG(LogIVRRecSession, Warning, TEXT("UIVRRecordingSession: Enqueuing frame. RawDataPtr size: %d"), 
     //    Frame.RawDataPtr.IsValid() ? Frame.RawDataPtr->Num() : 0); // Descomente para debug intenso
+    // Leva o timestamp para a linha do tempo do take: o tempo em pausa não aparece como um buraco no vídeo.
+    Frame.SetTimestampNs(CaptureTimeline.RemovePausedTime(Frame.TimestampNs));
+    if (FirstFrameCaptureNs.GetValue() < 0)
+    {
+        FirstFrameCaptureNs.Set(Frame.TimestampNs);
+    }
+    EnqueueAcceptedFrame(MoveTemp(Frame));
+}
+// --- INÍCIO DA ALTERAÇÃO: AUXILIARES DE BACKPRESSURE ---
+void UIVRRecordingSession::ResetBackpressureState()
+{
+    bDecimating = false;
+    bSkipNextDecimatedFrame = false;
+    bInDropBurst.AtomicSet(false);
+    FramesAcceptedCounter.Reset();
+    FramesDroppedNewestCounter.Reset();
+    FramesDroppedOldestCounter.Reset();
+    ProducerBlocksCounter.Reset();
+    BlockTimeoutsCounter.Reset();
+    FramesDecimatedCounter.Reset();
+    FramesSpilledCounter.Reset();
+    FramesRestoredFromSpillCounter.Reset();
+    FramesDroppedSpillFullCounter.Reset();
+    FramesLostFromSpillCounter.Reset();
+    FramesDroppedAfterFinishCounter.Reset();
+    DropBurstsCounter.Reset();
+    PeakQueueDepthCounter.Reset();
+}
+
+FIVR_BackpressureStats UIVRRecordingSession::GetBackpressureStats() const
+{
+    FIVR_BackpressureStats Stats;
+    Stats.FramesAccepted = FramesAcceptedCounter.GetValue();
+    Stats.FramesDroppedNewest = FramesDroppedNewestCounter.GetValue();
+    Stats.FramesDroppedOldest = FramesDroppedOldestCounter.GetValue();
+    Stats.ProducerBlocks = ProducerBlocksCounter.GetValue();
+    Stats.BlockTimeouts = BlockTimeoutsCounter.GetValue();
+    Stats.FramesDecimated = FramesDecimatedCounter.GetValue();
+    Stats.FramesSpilled = FramesSpilledCounter.GetValue();
+    Stats.FramesRestoredFromSpill = FramesRestoredFromSpillCounter.GetValue();
+    Stats.FramesDroppedSpillFull = FramesDroppedSpillFullCounter.GetValue();
+    Stats.FramesLostFromSpill = FramesLostFromSpillCounter.GetValue();
+    Stats.FramesDroppedAfterFinish = FramesDroppedAfterFinishCounter.GetValue();
+    Stats.DropBursts = DropBurstsCounter.GetValue();
+    Stats.PeakQueueDepth = PeakQueueDepthCounter.GetValue();
+    return Stats;
+}
+
+void UIVRRecordingSession::EnqueueAcceptedFrame(FIVR_VideoFrame&& Frame)
+{
     // Enfileira o frame para a worker thread processar. Usa MoveTemp para mover o TSharedPtr eficientemente.
-    VideoFrameProducerQueue.Enqueue(MoveTemp(Frame)); 
-    VideoProducerQCounter++;
+    VideoFrameProducerQueue.Enqueue(MoveTemp(Frame));
+    const int32 NewDepth = VideoProducerQCounter.Increment();
+    FramesAcceptedCounter.Increment();
+    if (NewDepth > PeakQueueDepthCounter.GetValue())
+    {
+        PeakQueueDepthCounter.Set(NewDepth); // Apenas o produtor escreve o pico
+    }
+    // A rajada termina quando a fila volta abaixo da metade da capacidade.
+    if (bInDropBurst && NewDepth < QueueCapacityFrames / 2)
+    {
+        bInDropBurst.AtomicSet(false);
+    }
     if (HasNewFrameEvent)
     {
         HasNewFrameEvent->Trigger(); 
     }
 }
+
+void UIVRRecordingSession::DiscardFrame(FIVR_VideoFrame& Frame, FThreadSafeCounter& PolicyCounter)
+{
+    if (FramePool && Frame.RawDataPtr.IsValid())
+    {
+        FramePool->ReleaseFrame(Frame.RawDataPtr);
+    }
+    Frame.RawDataPtr.Reset();
+    PolicyCounter.Increment();
+
+    // Apenas o primeiro descarte da rajada notifica (log + delegate).
+    if (bInDropBurst.AtomicSet(true))
+    {
+        return;
+    }
+    DropBurstsCounter.Increment();
+    const EIVRBackpressurePolicy Policy = UserRecordingSettings.IVR_BackpressurePolicy;
+    UE_LOG(LogIVRRecSession, Warning, TEXT("Recording queue under backpressure (depth %d, capacity %d, policy %d). Frames are being discarded (SessionID: %s)."),
+        VideoProducerQCounter.GetValue(), QueueCapacityFrames, (int32)Policy, *SessionID);
+
+    TWeakObjectPtr<UIVRRecordingSession> WeakThis = this;
+    AsyncTask(ENamedThreads::GameThread, [WeakThis, Policy]()
+    {
+        if (UIVRRecordingSession* StrongThis = WeakThis.Get())
+        {
+            StrongThis->OnFrameDropBurst.Broadcast(Policy, StrongThis->GetBackpressureStats());
+        }
+    });
+}
+
+void UIVRRecordingSession::TrimQueueToCapacity()
+{
+    if (UserRecordingSettings.IVR_BackpressurePolicy != EIVRBackpressurePolicy::DropOldest)
+    {
+        return;
+    }
+    FIVR_VideoFrame OldestFrame;
+    while (VideoProducerQCounter.GetValue() > QueueCapacityFrames && VideoFrameProducerQueue.Dequeue(OldestFrame))
+    {
+        VideoProducerQCounter.Decrement();
+        DiscardFrame(OldestFrame, FramesDroppedOldestCounter);
+    }
+}
+
+bool UIVRRecordingSession::OpenSpillRing()
+{
+    int64 CapacityBytes = 0;
+    if (UserRecordingSettings.IVR_SpillCapacityGB > 0.0f)
+    {
+        CapacityBytes = (int64)(UserRecordingSettings.IVR_SpillCapacityGB * 1024.0 * 1024.0 * 1024.0);
+    }
+    else
+    {
+        const int64 FrameBytes = (int64)FMath::Max(ActualFrameWidth, 1) * FMath::Max(ActualFrameHeight, 1) * 4;
+        const float SpillFPS = (UserRecordingSettings.FPS > 0.0f) ? UserRecordingSettings.FPS : 30.0f;
+        CapacityBytes = FrameBytes * FMath::Max(1, FMath::CeilToInt(SpillFPS * FMath::Max(UserRecordingSettings.IVR_SpillCapacitySeconds, 0.5f)));
+    }
+    const FString SpillPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("IVRSpill"), FString::Printf(TEXT("%s.ivrspill"), *SessionID));
+    return SpillRing.Open(SpillPath, CapacityBytes, UserRecordingSettings.IVR_SpillCompressLZ4);
+}
+
+void UIVRRecordingSession::SpillQueueOverflow()
+{
+    if (!bSpillAvailable)
+    {
+        return;
+    }
+    // Move do INÍCIO da fila: tudo que está no disco é sempre mais antigo que o que está em memória,
+    // de modo que ler primeiro do disco preserva a ordem dos frames.
+    FIVR_VideoFrame OverflowFrame;
+    while (VideoProducerQCounter.GetValue() > QueueCapacityFrames && VideoFrameProducerQueue.Dequeue(OverflowFrame))
+    {
+        VideoProducerQCounter.Decrement();
+        if (SpillRing.Push(OverflowFrame))
+        {
+            FramesSpilledCounter.Increment();
+            if (!bSpillActive)
+            {
+                bSpillActive = true;
+                UE_LOG(LogIVRRecSession, Log, TEXT("Encoder falling behind. Spilling overflow frames to disk (SessionID: %s)."), *SessionID);
+            }
+            if (FramePool && OverflowFrame.RawDataPtr.IsValid())
+            {
+                FramePool->ReleaseFrame(OverflowFrame.RawDataPtr);
+            }
+        }
+        else
+        {
+            // Anel cheio ou erro de E/S: o frame mais antigo da fila é perdido (conta como rajada de descarte).
+            DiscardFrame(OverflowFrame, FramesDroppedSpillFullCounter);
+        }
+    }
+}
+
+bool UIVRRecordingSession::DequeueNextFrame(FIVR_VideoFrame& OutFrame)
+{
+    while (SpillRing.Num() > 0)
+    {
+        if (SpillRing.Pop(OutFrame, FramePool))
+        {
+            FramesRestoredFromSpillCounter.Increment();
+            return true;
+        }
+        // Pool sem buffer livre ou registro ilegível: o anel já o descartou; conta e tenta o próximo.
+        FramesLostFromSpillCounter.Increment();
+    }
+    if (bSpillActive)
+    {
+        bSpillActive = false;
+        UE_LOG(LogIVRRecSession, Log, TEXT("Spill drained. Encoder caught up (SessionID: %s)."), *SessionID);
+    }
+    if (VideoFrameProducerQueue.Dequeue(OutFrame))
+    {
+        VideoProducerQCounter.Decrement();
+        if (SpaceAvailableEvent) SpaceAvailableEvent->Trigger();
+        return true;
+    }
+    return false;
+}
+
+void UIVRRecordingSession::ForwardFrameToEncoder(FIVR_VideoFrame& Frame)
+{
+    if (bRawCaptureMode)
+    {
+        if (RawWriter.Append(Frame))
+        {
+            VideoConsumerQCounter.Increment();
+        }
+        else if (!bRawWriteErrorLogged)
+        {
+            bRawWriteErrorLogged = true;
+            UE_LOG(LogIVRRecSession, Error, TEXT("IVRecThread: Failed to write frame to raw container %s. Dropping frames (SessionID: %s)."), *RawContainerFilePath, *SessionID);
+        }
+        // O container copia os bytes: o buffer volta ao pool imediatamente.
+        if (FramePool && Frame.RawDataPtr.IsValid())
+        {
+            FramePool->ReleaseFrame(Frame.RawDataPtr);
+        }
+        return;
+    }
+    if (VideoEncoder)
+    {
+        // O VideoEncoder->EncodeFrame aceita a FIVR_VideoFrame completa e devolve o buffer ao pool se recusar.
+        if (VideoEncoder->EncodeFrame(Frame))
+        {
+            VideoConsumerQCounter.Increment();
+        }
+        else
+        {
+            FramesDroppedAfterFinishCounter.Increment();
+        }
+    }
+    else
+    {
+        UE_LOG(LogIVRRecSession, Error, TEXT("IVRecThread: VideoEncoder is null. Dropping frame."));
+        // Garante que o frame seja liberado de volta ao pool mesmo se o encoder for nulo
+        if (FramePool && Frame.RawDataPtr.IsValid())
+        {
+            FramePool->ReleaseFrame(Frame.RawDataPtr);
+        }
+    }
+}
+
+void UIVRRecordingSession::FinalizeRawCapture()
+{
+    const int32 RawFrameCount = RawWriter.Num();
+    // Até a codificação terminar, a saída do take é o próprio container.
+    const FString EncodedTakePath = CurrentTakeFilePath;
+    CurrentTakeFilePath = RawContainerFilePath;
+    if (!RawWriter.Finalize())
+    {
+        return;
+    }
+    if (!UserRecordingSettings.IVR_EncodeRawOnStop || RawFrameCount == 0)
+    {
+        // Mantém o .ivrraw para uma codificação posterior (UIVRVideoEncoder::EncodeRawContainer).
+        UE_LOG(LogIVRRecSession, Log, TEXT("Raw container kept for later encoding: %s (%d frames)."), *RawContainerFilePath, RawFrameCount);
+        return;
+    }
+
+    // A codificação lê o container inteiro e espera o FFmpeg: roda fora do Game Thread.
+    // A sessão é enraizada até o fim, mantendo vivos o encoder e o FramePool (UPROPERTY) mesmo depois do gerenciador soltá-la.
+    UIVRVideoEncoder* Encoder = NewObject<UIVRVideoEncoder>(this);
+    RawEncodeEncoder = Encoder;
+    bRawEncodeInProgress.AtomicSet(true);
+    AddToRoot();
+    UE_LOG(LogIVRRecSession, Log, TEXT("Encoding raw container %s to take %s in background (SessionID: %s)..."), *RawContainerFilePath, *EncodedTakePath, *SessionID);
+
+    TWeakObjectPtr<UIVRRecordingSession> WeakThis = this;
+    const FString RawPath = RawContainerFilePath;
+    const FIVR_VideoSettings Settings = UserRecordingSettings;
+    const FString FFmpegPath = FFmpegExecutablePath;
+    UIVRFramePool* Pool = FramePool;
+    Async(EAsyncExecution::Thread, [WeakThis, Encoder, Pool, RawPath, EncodedTakePath, Settings, FFmpegPath]()
+    {
+        const double EncodeStartSeconds = FPlatformTime::Seconds();
+        const bool bSuccess = Encoder->EncodeRawContainer(RawPath, EncodedTakePath, Settings, FFmpegPath, Pool);
+        if (bSuccess)
+        {
+            UE_LOG(LogIVRRecSession, Log, TEXT("Raw container encoded in %.2f seconds."), FPlatformTime::Seconds() - EncodeStartSeconds);
+            if (!Settings.IVR_KeepRawAfterEncode)
+            {
+                FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*RawPath);
+            }
+        }
+        AsyncTask(ENamedThreads::GameThread, [WeakThis, bSuccess, EncodedTakePath]()
+        {
+            if (UIVRRecordingSession* StrongThis = WeakThis.Get())
+            {
+                StrongThis->HandleRawEncodeCompleted(bSuccess, EncodedTakePath);
+            }
+        });
+    });
+}
+
+void UIVRRecordingSession::HandleRawEncodeCompleted(bool bSuccess, const FString& EncodedTakePath)
+{
+    RawEncodeEncoder = nullptr;
+    bRawEncodeInProgress.AtomicSet(false);
+    if (bSuccess)
+    {
+        CurrentTakeFilePath = EncodedTakePath;
+    }
+    else
+    {
+        // Falha na codificação: o container é preservado e continua sendo a saída do take.
+        UE_LOG(LogIVRRecSession, Error, TEXT("Failed to encode raw container. Keeping %s for later encoding."), *RawContainerFilePath);
+    }
+    OnRawEncodeFinished.Broadcast(this, bSuccess, CurrentTakeFilePath);
+    RemoveFromRoot();
+}
+// --- FIM DA ALTERAÇÃO ---
 // --- INÍCIO DA ALTERAÇÃO: CUSTOMIZAÇÃO DE NOME DE ARQUIVO ABSOLUTO (USANDO !FPaths::IsRelative) ---
 FString UIVRRecordingSession::GenerateTakeFilePath()
 {
@@ -342,52 +769,32 @@ uint32 UIVRRecordingSession::Run()
     
     while (!bStopThread)
     {
-        // Tenta processar todos os frames na fila
-        while (VideoFrameProducerQueue.Dequeue(VideoFrame))
+        TrimQueueToCapacity(); // DropOldest: descarta do início da fila
+        SpillQueueOverflow();  // SpillToDisk: move o excesso para o disco
+
+        // Encaminha frames enquanto o encoder tiver folga. O excesso permanece na fila da sessão (ou no disco),
+        // onde a política de backpressure configurada é aplicada.
+        while ((!VideoEncoder || VideoEncoder->GetPendingFrameCount() < EncoderInFlightLimit) && DequeueNextFrame(VideoFrame))
         {
-            VideoProducerQCounter--; 
-            if (VideoEncoder)
-            {
-                // O VideoEncoder->EncodeFrame agora aceita a FIVR_VideoFrame completa
-                // e acessa VideoFrame.RawDataPtr.
-                VideoEncoder->EncodeFrame(VideoFrame); 
-                VideoConsumerQCounter++; 
-            }
-            else
-            {
-                UE_LOG(LogIVRRecSession, Error, TEXT("IVRecThread: VideoEncoder is null. Dropping frame."));
-                // Garante que o frame seja liberado de volta ao pool mesmo se o encoder for nulo
-                if (FramePool && VideoFrame.RawDataPtr.IsValid())
-                {
-                    FramePool->ReleaseFrame(VideoFrame.RawDataPtr);
-                }
-            }
+            ForwardFrameToEncoder(VideoFrame);
         }
         
-        // Se a fila estiver vazia e o thread não for para parar, espera por um novo evento.
-        if (VideoFrameProducerQueue.IsEmpty() && !bStopThread)
+        // Nada pendente: espera por um novo frame. Encoder saturado: reavalia em intervalos curtos.
+        if (!bStopThread)
         {
-            HasNewFrameEvent->Wait(100); // Espera por até 100ms por um novo frame ou sinal de parada
+            HasNewFrameEvent->Wait((VideoFrameProducerQueue.IsEmpty() && SpillRing.Num() == 0) ? 100 : 5);
         }
     }
     
-    // Processa quaisquer frames remanescentes na fila antes de sair
-    while (VideoFrameProducerQueue.Dequeue(VideoFrame))
+    // Processa quaisquer frames remanescentes (disco e fila, em ordem) antes de sair (o FinishEncoding vem depois)
+    while (DequeueNextFrame(VideoFrame))
     {
-        VideoProducerQCounter--;
-        if (VideoEncoder)
-            {
-            VideoEncoder->EncodeFrame(VideoFrame);
-            VideoConsumerQCounter++;
-        }
-        else
+        // Respeita a janela do encoder também no shutdown, para não reidratar todo o spill em memória de uma vez.
+        while (VideoEncoder && VideoEncoder->IsWorkerRunning() && VideoEncoder->GetPendingFrameCount() >= EncoderInFlightLimit)
         {
-             // Garante que o frame seja liberado de volta ao pool mesmo se o encoder for nulo durante o shutdown
-            if (FramePool && VideoFrame.RawDataPtr.IsValid())
-            {
-                FramePool->ReleaseFrame(VideoFrame.RawDataPtr);
-            }
+            FPlatformProcess::Sleep(0.001f);
         }
+        ForwardFrameToEncoder(VideoFrame);
     }
     UE_LOG(LogIVRRecSession, Log, TEXT("IVRecThread: Run loop finished."));
     return 0;
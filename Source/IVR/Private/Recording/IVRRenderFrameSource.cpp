@@ -9,6 +9,7 @@
 #include "IVRGlobalStatics.h" 
 #include "Async/Async.h" 
 #include "Engine/World.h" // For UWorld and GetTimeSeconds()
+#include "IVRCaptureClock.h" // Relógio de captura compartilhado
 #include "TextureResource.h" // For FTextureResource
 
 DEFINE_LOG_CATEGORY(LogIVRRenderFrameSource);
@@ -239,7 +240,7 @@ void UIVRRenderFrameSource::ProcessRenderQueue()
             ConvertRgbaToBgraAndCopyToBuffer(*CurrentRequest->ImageBuffer, *AcquiredByteBuffer);
 
             // Cria o FIVR_VideoFrame. Ele agora contém uma cópia do TSharedPtr AcquiredByteBuffer.
-            FIVR_VideoFrame NewFrame(FrameSourceSettings.Width, FrameSourceSettings.Height, CurrentWorld->GetTimeSeconds());
+            FIVR_VideoFrame NewFrame(FrameSourceSettings.Width, FrameSourceSettings.Height, FIVR_CaptureClock::Get().NowNs());
             NewFrame.RawDataPtr = AcquiredByteBuffer; 
 
             // Faz o broadcast. Isso cria uma CÓPIA do TSharedPtr RawDataPtr para o delegate.
@@ -5,6 +5,7 @@
 // -------------------------------------------------------------------------------
 #include "Recording/IVRSimulatedFrameSource.h"
 #include "HAL/PlatformTime.h" // Para FPlatformTime::Seconds()
+#include "IVRCaptureClock.h"   // Relógio de captura compartilhado
 #include "Engine/World.h"     // Para GetWorldTimerManager()
 
 UIVRSimulatedFrameSource::UIVRSimulatedFrameSource()
@@ -102,7 +103,7 @@ void UIVRSimulatedFrameSource::GenerateSimulatedFrame()
     }
 
     // Cria um novo FIVR_VideoFrame e preenche-o com o buffer adquirido
-    FIVR_VideoFrame NewFrame(FrameWidth, FrameHeight, FPlatformTime::Seconds());
+    FIVR_VideoFrame NewFrame(FrameWidth, FrameHeight, FIVR_CaptureClock::Get().NowNs());
     NewFrame.RawDataPtr = FrameBuffer; // Atribui o buffer adquirido
 
     // Preenche o frame com dados simulados
@@ -16,6 +16,7 @@
 #include "IVROpenCVBridge/Public/IVR_PipeWrapper.h"
 // [MANUAL_REF_POINT] FVideoEncoderWorker agora é de IVROpenCVBridge
 #include "IVROpenCVBridge/Public/FVideoEncoderWorker.h"
+#include "IVROpenCVBridge/Public/IVR_RawContainer.h"
 // Definição do LogCategory
 DEFINE_LOG_CATEGORY(LogIVRVideoEncoder);
 // =====================================================================================
@@ -118,16 +119,30 @@ bool UIVRVideoEncoder::Initialize(const FIVR_VideoSettings& Settings, const FStr
     PipeSettings.bBlockingMode = true; // Escrita bloqueante para garantir dados sequenciais
     PipeSettings.bMessageMode = false; // Modo byte stream para dados de vídeo raw
     PipeSettings.bDuplexAccess = false; // Apenas o UE escreve, FFmpeg lê
-    // Tentar criar o Named Pipe
+    // Tentar criar o Named Pipe (ou o transporte escolhido nas configurações)
     // <--- ALTERAÇÃO: Passar a largura e altura reais para o FIVR_PipeWrapper::Create()
-    if (!VideoInputPipe.Create(PipeSettings, TEXT(""), ActualProcessingWidth, ActualProcessingHeight)) 
+    VideoInputPipe = IIVR_FrameTransport::MakeTransport(CurrentSettings.IVR_FrameTransport);
+    if (!VideoInputPipe->Create(PipeSettings, TEXT(""), ActualProcessingWidth, ActualProcessingHeight)) 
     {
-        UE_LOG(LogIVRVideoEncoder, Error, TEXT("Failed to create video Named Pipe: %s"), *VideoInputPipe.GetFullPipeName());
+        UE_LOG(LogIVRVideoEncoder, Error, TEXT("Failed to create video Named Pipe: %s"), *VideoInputPipe->GetFFmpegInputUrl());
+        VideoInputPipe->Close();
         return false;
     }
-    UE_LOG(LogIVRVideoEncoder, Log, TEXT("Video Named Pipe created: %s"), *VideoInputPipe.GetFullPipeName());
+    UE_LOG(LogIVRVideoEncoder, Log, TEXT("Video Named Pipe created: %s"), *VideoInputPipe->GetFFmpegInputUrl());
     // Inicia a worker thread para escrever frames no pipe
-    WorkerRunnable = new FVideoEncoderWorker(this, FrameQueue, VideoInputPipe, bStopWorkerThread, bNoMoreFramesToEncode, NewFrameEvent, FramePool);
+    PendingFrameCount.Reset();
+    bStopWorkerThread.AtomicSet(false);     // Permite reinicializar após um ShutdownEncoder
+    bNoMoreFramesToEncode.AtomicSet(false);
+    // CFR/VFR: os frames levam seu timestamp ao FFmpeg em Matroska; no modo legado seguem como rawvideo puro.
+    const bool bTimestampedStream = (CurrentSettings.IVR_FrameTimingMode != EIVRFrameTimingMode::AssumeNominalFPS);
+    if (bTimestampedStream && !StreamMuxer.Configure(ActualProcessingWidth, ActualProcessingHeight, CurrentSettings.PixelFormat))
+    {
+        // Sem FourCC o FFmpeg interpretaria os bytes com outro layout: recusa em vez de gravar cores erradas.
+        UE_LOG(LogIVRVideoEncoder, Error, TEXT("Pixel format '%s' has no Matroska FourCC. Use AssumeNominalFPS timing or a supported format (bgra, rgba, rgb24, gray, yuv420p...)."), *CurrentSettings.PixelFormat);
+        InternalCleanupEncoderResources();
+        return false;
+    }
+    WorkerRunnable = new FVideoEncoderWorker(this, FrameQueue, *VideoInputPipe, bStopWorkerThread, bNoMoreFramesToEncode, NewFrameEvent, FramePool, PendingFrameCount, bTimestampedStream ? &StreamMuxer : nullptr);
     WorkerThread = FRunnableThread::Create(WorkerRunnable, TEXT("IVRVideoEncoderWorkerThread"), 0, TPri_Normal);
     if (!WorkerThread)
     {
@@ -164,7 +179,7 @@ bool UIVRVideoEncoder::LaunchEncoder(const FString& LiveOutputFilePath)
     // Setta o caminho de saída do vídeo ao vivo
     EncoderCommandFactory->IVR_SetOutputFilePath(LiveOutputFilePath);
     // Setta o caminho do pipe de entrada para o FFmpeg
-    EncoderCommandFactory->IVR_SetInPipePath(VideoInputPipe.GetFullPipeName());
+    EncoderCommandFactory->IVR_SetInPipePath(VideoInputPipe->GetFFmpegInputUrl());
     // Pega Executavel FFmpeg
     FString ExecPath = GetFFmpegExecutablePathInternal();
     if (ExecPath.IsEmpty())
@@ -192,6 +207,7 @@ bool UIVRVideoEncoder::LaunchEncoder(const FString& LiveOutputFilePath)
         -1,      // PriorityModifier
         nullptr, // OptionalWorkingDirectory
         FFmpegWritePipeStdout, // stdout do FFmpeg vai para este pipe
+        VideoInputPipe->GetChildStdinPipe(), // stdin do FFmpeg (apenas no transporte "pipe:0")
         FFmpegWritePipeStderr  // stderr do FFmpeg vai para este pipe
     );
     if (!FFmpegProcHandle.IsValid())
@@ -205,6 +221,7 @@ bool UIVRVideoEncoder::LaunchEncoder(const FString& LiveOutputFilePath)
         return false;
     }
     UE_LOG(LogIVRVideoEncoder, Log, TEXT("FFmpeg main process launched successfully. PID: %d"), LaunchedProcessId);
+    VideoInputPipe->OnReaderLaunched();
     
     // Cria dois FFMpegLogReader, um para stdout e outro para stderr
     FFmpegStdoutLogReader = new FFMpegLogReader(FFmpegReadPipeStdout, TEXT("FFmpeg STDOUT"));
@@ -227,6 +244,8 @@ void UIVRVideoEncoder::ShutdownEncoder()
 // 1. Sinaliza à worker thread para parar
     bStopWorkerThread.AtomicSet(true); 
     if (NewFrameEvent) NewFrameEvent->Trigger(); // Acorda a thread caso esteja esperando por um evento
+    // Um worker ainda esperando o FFmpeg conectar (ou parado em um pipe cheio) desiste em vez de travar o join.
+    if (VideoInputPipe) VideoInputPipe->AbortConnect();
     // 2. Aguarda a conclusão da worker thread
     if (WorkerThread)
     {
@@ -263,6 +282,7 @@ bool UIVRVideoEncoder::EncodeFrame(FIVR_VideoFrame Frame)
     // LOG DE DEBUG: Confirma o tamanho do frame antes de enfileirar no Encoder
     // UE_LOG(LogIVRVideoEncoder, Warning, TEXT("UIVRVideoEncoder: Enqueuing frame for worker. RawDataPtr size: %d"), 
     //    Frame.RawDataPtr.IsValid() ? Frame.RawDataPtr->Num() : 0); // Descomente para debug intenso
+    PendingFrameCount.Increment();
     FrameQueue.Enqueue(MoveTemp(Frame)); // Usa MoveTemp para otimizar o TSharedPtr
     
     if (NewFrameEvent) NewFrameEvent->Trigger();
@@ -286,11 +306,18 @@ bool UIVRVideoEncoder::FinishEncoding()
     {
         FPlatformProcess::Sleep(0.01f); // Pequena pausa para permitir que o worker processe
     }
+    // A fila vazia não basta: o último frame pode estar sendo escrito, e no modo zero-copy (vmsplice)
+    // as páginas entregues ao pipe precisam ser lidas pelo FFmpeg antes que o worker as devolva ao pool.
+    const double DrainDeadline = FPlatformTime::Seconds() + 5.0;
+    while (WorkerRunnable && !WorkerRunnable->IsDrained() && !bStopWorkerThread && FPlatformTime::Seconds() < DrainDeadline)
+    {
+        FPlatformProcess::Sleep(0.002f);
+    }
     // Fecha o pipe de entrada para sinalizar EOF ao FFmpeg.
     // É crucial fechar o pipe APENAS depois que todos os dados foram escritos.
-    if (VideoInputPipe.IsValid())
+    if (VideoInputPipe && VideoInputPipe->IsValid())
     {
-        VideoInputPipe.Close(); 
+        VideoInputPipe->Close(); 
         UE_LOG(LogIVRVideoEncoder, Log, TEXT("Video input pipe closed, signaling EOF to FFmpeg."));
     }
     
@@ -371,15 +398,95 @@ bool UIVRVideoEncoder::ConcatenateVideos(const TArray<FString>& InTakePaths, con
     UE_LOG(LogIVRVideoEncoder, Log, TEXT("Videos concatenated successfully to: %s"), *InMasterOutputPath);
     return true;
 }
+// --- INÍCIO DA ALTERAÇÃO: CODIFICAÇÃO POSTERIOR DE CONTAINERS .ivrraw ---
+bool UIVRVideoEncoder::EncodeRawContainer(const FString& RawFilePath, const FString& OutputFilePath, const FIVR_VideoSettings& Settings, const FString& InFFmpegExecutablePath, UIVRFramePool* InFramePool)
+{
+    if (!InFramePool)
+    {
+        UE_LOG(LogIVRVideoEncoder, Error, TEXT("EncodeRawContainer: FramePool is null. Cannot encode %s."), *RawFilePath);
+        return false;
+    }
+    FIVR_RawContainerReader Reader;
+    if (!Reader.Open(RawFilePath))
+    {
+        return false;
+    }
+    const FIVR_RawContainerHeader& Header = Reader.GetHeader();
+    FIVR_VideoSettings RawSettings = Settings;
+    if (Header.NominalFPS > 0.0f)
+    {
+        RawSettings.FPS = Header.NominalFPS;
+    }
+    if (!Initialize(RawSettings, InFFmpegExecutablePath, Header.Width, Header.Height, InFramePool))
+    {
+        UE_LOG(LogIVRVideoEncoder, Error, TEXT("EncodeRawContainer: Failed to initialize encoder for %s."), *RawFilePath);
+        return false;
+    }
+    if (!LaunchEncoder(OutputFilePath))
+    {
+        UE_LOG(LogIVRVideoEncoder, Error, TEXT("EncodeRawContainer: Failed to launch FFmpeg for %s."), *RawFilePath);
+        ShutdownEncoder();
+        return false;
+    }
+    UE_LOG(LogIVRVideoEncoder, Log, TEXT("Encoding raw container %s (%d frames, %dx%d @ %.2f FPS) to %s."), *RawFilePath, Reader.Num(), Header.Width, Header.Height, RawSettings.FPS, *OutputFilePath);
+
+    // Mantém no máximo dois frames lidos e ainda não escritos: o mapeamento é lido sob demanda, sem reidratar o container em memória.
+    const int32 InFlightLimit = 2;
+    int32 FramesSent = 0;
+    for (int32 FrameIndex = 0; FrameIndex < Reader.Num(); ++FrameIndex)
+    {
+        while (IsWorkerRunning() && PendingFrameCount.GetValue() >= InFlightLimit)
+        {
+            FPlatformProcess::Sleep(0.001f);
+        }
+        if (!IsWorkerRunning())
+        {
+            UE_LOG(LogIVRVideoEncoder, Error, TEXT("EncodeRawContainer: Encoder worker stopped at frame %d of %d."), FrameIndex, Reader.Num());
+            break;
+        }
+        const FIVR_RawIndexEntry& Entry = Reader.GetEntry(FrameIndex);
+        FIVR_VideoFrame Frame(Header.Width, Header.Height, Entry.TimestampNs);
+        Frame.RawDataPtr = FramePool->AcquireFrame();
+        if (!Frame.RawDataPtr.IsValid())
+        {
+            Frame.RawDataPtr = MakeShared<TArray<uint8>>();
+        }
+        Frame.RawDataPtr->SetNumUninitialized(Entry.RawBytes, EAllowShrinking::No);
+        if (!Reader.ReadFrame(FrameIndex, Frame.RawDataPtr->GetData(), Frame.RawDataPtr->Num()))
+        {
+            UE_LOG(LogIVRVideoEncoder, Warning, TEXT("EncodeRawContainer: Skipping unreadable frame %d."), FrameIndex);
+            FramePool->ReleaseFrame(Frame.RawDataPtr);
+            continue;
+        }
+        if (EncodeFrame(MoveTemp(Frame)))
+        {
+            ++FramesSent;
+        }
+    }
+    Reader.Close();
+
+    FinishEncoding();
+    ShutdownEncoder();
+
+    const bool bOutputExists = FPlatformFileManager::Get().GetPlatformFile().FileExists(*OutputFilePath);
+    const bool bSuccess = bOutputExists && FramesSent == Header.FrameCount;
+    UE_LOG(LogIVRVideoEncoder, Log, TEXT("Raw container encode %s: %d/%lld frames sent. Output: %s"),
+        bSuccess ? TEXT("succeeded") : TEXT("FAILED"), FramesSent, Header.FrameCount, *OutputFilePath);
+    return bSuccess;
+}
+// --- FIM DA ALTERAÇÃO ---
 // --- INÍCIO DA ALTERAÇÃO: ADICIONAR TIMEOUT AO FECHAMENTO DO PROCESSO FFmpeg ---
 void UIVRVideoEncoder::InternalCleanupEncoderResources()
 {
     UE_LOG(LogIVRVideoEncoder, Log, TEXT("Cleaning up video encoder internal resources..."));
     // Apenas fecha o pipe se ele ainda estiver aberto (FinishEncoding já o faz).
-    if (VideoInputPipe.IsValid())
+    if (VideoInputPipe)
     {
-        VideoInputPipe.Close();
-        UE_LOG(LogIVRVideoEncoder, Log, TEXT("Video input pipe explicitly closed during cleanup."));
+        if (VideoInputPipe->IsValid())
+        {
+            UE_LOG(LogIVRVideoEncoder, Log, TEXT("Video input pipe explicitly closed during cleanup."));
+        }
+        VideoInputPipe->Close(); // Também remove FIFOs/sockets aos quais o FFmpeg nunca se conectou
     }
     // Limpa e deleta os leitores de log do FFmpeg (stdout e stderr)
     if (FFmpegStdoutLogReader)
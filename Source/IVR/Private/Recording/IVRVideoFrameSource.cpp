@@ -75,7 +75,8 @@ void UIVRVideoFrameSource::Initialize(UWorld* World, const FIVR_VideoSettings& S
         NewFrameEvent,
         Settings.IVR_VideoFilePath,
         Settings.FPS, // Usamos Settings.FPS como o FPS desejado para o OpenCV
-        Settings.IVR_LoopVideoPlayback
+        Settings.IVR_LoopVideoPlayback,
+        Settings.UsesLatestFrameDelivery() ? &LatestFrameMailbox : nullptr
     );
     if (WorkerRunnable)
     {
@@ -114,6 +115,14 @@ void UIVRVideoFrameSource::Shutdown()
         delete WorkerRunnable;
         WorkerRunnable = nullptr;
     }
+    // Com o worker parado, o frame que ficou na caixa coalescida volta ao pool
+    while (LatestFrameMailbox.TakeLatest(DummyFrame))
+    {
+        if (FramePool && DummyFrame.RawDataPtr.IsValid())
+        {
+            FramePool->ReleaseFrame(DummyFrame.RawDataPtr);
+        }
+    }
 
     CurrentWorld = nullptr;
     FramePool = nullptr;
@@ -161,6 +170,11 @@ void UIVRVideoFrameSource::PollForNewFrames()
     {
         OnFrameAcquired.Broadcast(MoveTemp(QueuedFrame));
     }
+    // Entrega coalescida: no máximo um frame por poll, sempre o mais recente
+    if (LatestFrameMailbox.TakeLatest(QueuedFrame))
+    {
+        OnFrameAcquired.Broadcast(MoveTemp(QueuedFrame));
+    }
 }
 int32 UIVRVideoFrameSource::GetActualFrameWidth() const
 {
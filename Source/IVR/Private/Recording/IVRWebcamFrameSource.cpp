@@ -60,7 +60,8 @@ void UIVRWebcamFrameSource::Initialize(UWorld* World, const FIVR_VideoSettings&
         Settings.IVR_WebcamFPS,
         // OpenCV API Preference agora é passado do bridge.
         // Use cv::CAP_DSHOW ou outro, mas agora vindo do módulo de bridge.
-        (VideoCaptureAPIs)0 // Placeholder, ou passe um valor real se o enum for exposto via bridge
+        (VideoCaptureAPIs)0, // Placeholder, ou passe um valor real se o enum for exposto via bridge
+        Settings.UsesLatestFrameDelivery() ? &LatestFrameMailbox : nullptr
     );
     if (WorkerRunnable)
     {
@@ -99,7 +100,7 @@ void UIVRWebcamFrameSource::Shutdown()
     }
 // Limpa a fila de quaisquer frames remanescentes
     FIVR_VideoFrame DummyFrame;
-    while (CapturedFrameQueue.Dequeue(DummyFrame))
+    while (CapturedFrameQueue.Dequeue(DummyFrame) || LatestFrameMailbox.TakeLatest(DummyFrame))
     {
         // Libera o buffer do frame de volta para o pool, se for válido
         if (FramePool && DummyFrame.RawDataPtr.IsValid())
@@ -154,6 +155,11 @@ void UIVRWebcamFrameSource::PollForNewFrames()
         // Broadcast do frame processado (o TSharedPtr dentro de QueuedFrame é movido)
         OnFrameAcquired.Broadcast(MoveTemp(QueuedFrame));
     }
+    // Entrega coalescida: no máximo um frame por poll, sempre o mais recente
+    if (LatestFrameMailbox.TakeLatest(QueuedFrame))
+    {
+        OnFrameAcquired.Broadcast(MoveTemp(QueuedFrame));
+    }
 }
 TArray<FString> UIVRWebcamFrameSource::ListWebcamDevices()
 {
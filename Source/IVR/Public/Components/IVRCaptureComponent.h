@@ -5,22 +5,44 @@
 
 #include "CoreMinimal.h"
 #include "Components/SceneComponent.h"
+#include "HAL/ThreadSafeCounter.h"
 #include "Recording/IVRSimulatedFrameSource.h"
 #include "Recording/IVRRenderFrameSource.h"
 #include "Recording/IVRFolderFrameSource.h"
 #include "Recording/IVRVideoFrameSource.h"
 #include "Recording/IVRWebcamFrameSource.h"
+#include "Recording/IVRRecordingSession.h" // Para FOnIVRFrameDropBurst
 #include "Engine/Texture2D.h" 
 #include "Engine/TextureRenderTarget2D.h" 
 #include "CineCameraComponent.h" // Se ainda estiver usando
 
 #include "IVRTypes.h"
 #include "IVRFramePool.h"
+#include "IVR_SharedFrameRing.h" // NOVO: Anel de frames em memória compartilhada
+#include "Components/IVRFrameSink.h" // NOVO: Fan-out de frames para múltiplos consumidores
+#include "Components/IVRFeatureWorkerPool.h" // NOVO: Pool de extração de features em tempo real
+#include "IVRFeatureResult.h" // NOVO: Resultado SoA das features (pool)
+#include "Components/IVRTileDiff.h" // NOVO: Regiões alteradas para o upload do preview
 
 #include "IVRCaptureComponent.generated.h"
 
 class UIVRRecordingSession;
 
+// Tipos do IVROpenCVBridge usados apenas por ponteiro/referência: o include fica no .cpp,
+// para não expor o bridge a todos que incluem este componente.
+enum class EOCV_FeatureStage : uint32;
+struct FOCV_FeatureStageParams;
+struct FOCV_TrackerSettings;
+struct FOCV_OverlayPrimitive;
+class FIVR_FeatureCache;
+namespace IVROpenCVBridge
+{
+    class FOCV_CVStage;
+    class FOCV_CVStageGraph;
+    class FOCV_FeatureTracker;
+    struct FOCV_StageTimingStats;
+}
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnIVRRecordingStarted);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnIVRRecordingPaused);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnIVRRecordingResumed);
@@ -104,6 +126,56 @@ public:
     FOnIVRRecordingStopped OnRecordingStopped;
     UPROPERTY(BlueprintAssignable, Category = "IVR|Recording Events")
     FOnIVRRecordingStartFailed OnRecordingStartFailed; // <--- NOVA LINHA: Delegate para falha ao iniciar gravação
+    // NOVO: Disparado no primeiro descarte de cada rajada na fila de gravação (ver IVR_BackpressurePolicy)
+    UPROPERTY(BlueprintAssignable, Category = "IVR|Recording Events")
+    FOnIVRFrameDropBurst OnFrameDropBurst;
+
+    /**
+     * @brief Retorna os contadores de backpressure da sessão de gravação atual (zerados se não houver sessão).
+     */
+    UFUNCTION(BlueprintPure, Category = "IVR|Recording")
+    FIVR_BackpressureStats GetBackpressureStats() const;
+
+    /**
+     * @brief Nome do anel de memória compartilhada no sistema operacional (vazio se IVR_PublishSharedRing estiver desligado).
+     *        Processos externos usam este nome para anexar ao anel (ver IVR_SharedFrameRingABI.h).
+     */
+    UFUNCTION(BlueprintPure, Category = "IVR|Shared Memory")
+    FString GetSharedFrameRingName() const;
+
+    /**
+     * @brief Registra um consumidor adicional de frames (Game Thread). Cada frame adquirido é entregue a
+     *        todos os sinks, cada um na sua lane. Um sink com o mesmo nome é substituído.
+     *        Os sinks são removidos no EndPlay.
+     */
+    void AddFrameSink(const TSharedRef<IIVRFrameSink, ESPMode::ThreadSafe>& Sink);
+
+    /** @brief Remove um sink registrado, esperando o frame que ele estiver consumindo. */
+    bool RemoveFrameSink(FName SinkName);
+
+    /** @brief Contadores de entrega/descarte de cada sink registrado. */
+    TArray<FIVR_FrameSinkStats> GetFrameSinkStats() const;
+
+    /** @brief Contadores do pool de extração de features em tempo real (zerados se o pool não estiver ativo). */
+    FIVR_FeatureWorkerPoolStats GetFeatureWorkerPoolStats() const;
+
+    /**
+     * @brief Adiciona uma etapa própria ao grafo de visão do tempo real (Game Thread). Roda junto das etapas de
+     *        IVR_FeatureStages, que só custam se estiverem ligadas. Uma etapa com o mesmo nome é substituída.
+     *        Com etapas próprias, o rastreamento (IVR_EnableFeatureTracking) e o cache de features não são usados.
+     */
+    void AddFeatureStage(const TSharedRef<IVROpenCVBridge::FOCV_CVStage, ESPMode::ThreadSafe>& Stage);
+
+    /** @brief Remove uma etapa adicionada por AddFeatureStage; se ela substituía uma etapa embutida ainda ligada, a embutida volta. */
+    bool RemoveFeatureStage(FName StageName);
+
+    /** @brief Tempo de cada etapa do grafo de visão do tempo real (último frame, média e máximo). */
+    TArray<IVROpenCVBridge::FOCV_StageTimingStats> GetFeatureStageTimings() const;
+
+    // Nomes dos sinks internos
+    static const FName RecordingSinkName;
+    static const FName RealTimeSinkName;
+    static const FName SharedRingSinkName;
 
     // Delegate para notificar que um frame em tempo real está pronto para coleta
     UPROPERTY(BlueprintAssignable, Category = "IVR|JustRTCapture Events")
@@ -155,10 +227,84 @@ private:
 
     UFUNCTION()
     void OnFrameAcquiredFromSource(FIVR_VideoFrame Frame);
+
+    // NOVO: Consumidor paralelo ao encoder; publica cada frame adquirido para leitores externos
+    FIVR_SharedFrameRingWriter SharedFrameRing;
+
+    // NOVO: Distribui cada frame para os sinks (gravação, tempo real, memória compartilhada e sinks externos)
+    TUniquePtr<FIVR_FrameFanOut> FrameFanOut;
+
+    FIVR_FrameFanOut& GetOrCreateFrameFanOut();
+
+    /** Registra/remove os sinks internos conforme as VideoSettings atuais. Sinks externos são mantidos. */
+    void RebuildBuiltInFrameSinks();
+
+    /** Verdadeiro quando os frames devem ir para a sessão de gravação (modo normal ou gravação junto do tempo real). */
+    bool IsRecordingSinkEnabled() const;
+
+    /** NOVO: Pool dedicado que extrai as features dos frames em tempo real e entrega os resultados em ordem. */
+    TSharedPtr<FIVR_FeatureWorkerPool, ESPMode::ThreadSafe> FeatureWorkerPool;
+
+    /** NOVO: Rastreador de cantos/quads (IVR_EnableFeatureTracking). Usado pelo único worker do pool, um frame por vez. */
+    TSharedPtr<IVROpenCVBridge::FOCV_FeatureTracker, ESPMode::ThreadSafe> FeatureTracker;
+
+    /** NOVO: Resultados recentes por hash do frame + parâmetros (IVR_FeatureCacheSize). Compartilhado pelos workers. */
+    TSharedPtr<FIVR_FeatureCache, ESPMode::ThreadSafe> FeatureCache;
+
+    /** NOVO: Resultados SoA reaproveitados entre frames; cada um volta ao pool quando o último listener solta o frame. */
+    TSharedPtr<FIVR_FeatureResultPool, ESPMode::ThreadSafe> FeatureResultPool;
+
+    /** NOVO: Etapas próprias (AddFeatureStage), mantidas entre sessões. */
+    TArray<TSharedRef<IVROpenCVBridge::FOCV_CVStage, ESPMode::ThreadSafe>> CustomFeatureStages;
+
+    /** NOVO: Grafo com as etapas embutidas de FeatureGraphStages e as etapas próprias; atualizado por etapa (os tempos acumulados ficam). */
+    TSharedPtr<IVROpenCVBridge::FOCV_CVStageGraph, ESPMode::ThreadSafe> FeatureGraph;
+    EOCV_FeatureStage FeatureGraphStages{}; // None
+
+    /** Encerra o pool de features, devolvendo ao FramePool os frames que ainda esperavam processamento. */
+    void ShutdownFeatureWorkerPool();
+
+    /**
+     * Corpo do sink de tempo real (Game Thread): captura as configurações atuais e envia o frame ao FeatureWorkerPool.
+     * @return Verdadeiro se o buffer do frame foi retido (o job o devolve ao FramePool).
+     */
+    bool SubmitRealTimeFrame(FIVR_FrameSinkPacket& Packet);
+
+    /** Repassa o OnFrameDropBurst da sessão atual para o delegate do componente. */
+    UFUNCTION()
+    void HandleSessionFrameDropBurst(EIVRBackpressurePolicy Policy, const FIVR_BackpressureStats& Stats);
     
     UPROPERTY(Transient)
     UTexture2D* RealTimeOutputTexture2D;
-    void UpdateTextureFromRawData(UTexture2D* Texture, const TArray<uint8>& RawData, int32 InWidth, int32 InHeight);
+    /**
+     * Envia o payload para a textura sem cópia: a referência é mantida até a RHI concluir o upload.
+     * @param DiffBase Payload contra o qual o worker calculou DirtyRegions (FIVR_TileDiff). As regiões só são usadas
+     *        se DiffBase ainda for o conteúdo da textura; caso contrário (ou sem diff) o frame inteiro é enviado.
+     * @return Falso se o upload foi pulado (dados inválidos ou uploads anteriores ainda pendentes na RHI).
+     */
+    bool UpdateTextureFromRawData(UTexture2D* Texture, const TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe>& PixelData, int32 InWidth, int32 InHeight,
+                                  const TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe>& DiffBase = nullptr, const TArray<FUpdateTextureRegion2D>* DirtyRegions = nullptr);
+
+    /** NOVO: Uploads da textura RT enviados e ainda não concluídos pela RHI. Compartilhado com o callback da Render Thread. */
+    TSharedRef<FThreadSafeCounter, ESPMode::ThreadSafe> RealTimeUploadsInFlight = MakeShared<FThreadSafeCounter, ESPMode::ThreadSafe>();
+    /** Limite de uploads pendentes (double-buffer): acima dele o frame não é enviado à textura. */
+    static constexpr int32 MaxRealTimeUploadsInFlight = 2;
+    /** Uploads pulados porque a RHI ainda não tinha concluído os anteriores. */
+    int64 RealTimeUploadsSkipped = 0;
+    /** NOVO: Último payload enviado à textura RT, base do diff por blocos (FIVR_TileDiff) do próximo upload. */
+    TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> LastUploadedPixels;
+    TWeakObjectPtr<UTexture2D> LastUploadedTexture;
+    /** LastUploadedPixels publicado para os workers de features, que calculam o diff do próximo upload fora da Game Thread. */
+    struct FUploadDiffBase
+    {
+        FCriticalSection Lock;
+        TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> Pixels;
+    };
+    TSharedRef<FUploadDiffBase, ESPMode::ThreadSafe> UploadDiffBase = MakeShared<FUploadDiffBase, ESPMode::ThreadSafe>();
+    /** Região do frame inteiro, usada quando não há diff aproveitável (reaproveitada entre frames). */
+    TArray<FUpdateTextureRegion2D> DirtyRegionScratch;
+    /** Uploads evitados porque o frame era idêntico ao que já está na textura. */
+    int64 RealTimeUploadsUnchanged = 0;
     
     /**
      * @brief Inicializa ou reinicializa a fonte de frames baseada nas 'VideoSettings' atuais.
@@ -166,17 +312,27 @@ private:
      */
     void Internal_InitializeFrameSource();
     /**
-     * @brief Processa a FIVR_JustRTFrame em uma thread de segundo plano para extrair features e deprojetá-las para 3D.
-     * O resultado é adicionado de volta à FIVR_JustRTFrame antes de ser transmitido via delegate.
-     * @param InOutFrame A estrutura FIVR_JustRTFrame a ser preenchida com as features. Passada por valor (cópia).
+     * @brief Extrai as features do frame e as deprojeta para 3D. Roda em uma thread do FeatureWorkerPool,
+     *        sem acessar o componente: todos os parâmetros são capturados na Game Thread antes do envio.
+     * @param OutResult Resultado SoA (vindo do FeatureResultPool) a ser preenchido; em regime não aloca.
+     * @param PixelData Pixels BGRA do frame (já tingidos). Nunca são escritos: o overlay de debug sai em OutOverlay.
+     * @param InWidth Largura do frame.
+     * @param InHeight Altura do frame.
      * @param CameraTransform A transformação da câmera de captura usada para a deprojeção 3D.
      * @param CameraFOV O Campo de Visão da câmera de captura.
-     * @param MaxCorners O número máximo de cantos para a goodFeaturesToTrack.
-     * @param QualityLevel O nível de qualidade para cantos, como uma fração da maior resposta de canto.
-     * @param MinDistance A distância mínima entre cantos para a goodFeaturesToTrack.
-     * @param bDebugDrawFeatures Se verdadeiro, desenha as detecções na imagem.
+     * @param Stages Etapas de extração a executar (IVR_FeatureStages + DebugOverlay); as demais não custam nada.
+     * @param Params Parâmetros das etapas (goodFeaturesToTrack, histogramas, pirâmide de detecção).
+     * @param Tracker Se não for nulo, cantos e quads são rastreados entre keyframes em vez de redetectados.
+     * @param TrackerSettings Intervalo de keyframes e critério de sobrevivência do Tracker.
+     * @param Cache Se não for nulo, um frame idêntico a um recente reaproveita o resultado (sem Tracker).
+     * @param Graph Se não for nulo (e sem Tracker), as etapas rodam neste grafo em vez do grafo embutido de Stages.
+     * @param OutOverlay Se não for nulo, recebe as primitivas da etapa DebugOverlay (compostas só no preview).
      */
-    void ProcessFrameAndFeaturesAsync(FIVR_JustRTFrame InOutFrame, FTransform CameraTransform, float CameraFOV, int32 MaxCorners, float QualityLevel, float MinDistance, bool bDebugDrawFeatures);
+    static void ExtractRealTimeFeatures(FIVR_FeatureResult& OutResult, uint8* PixelData, int32 InWidth, int32 InHeight, const FTransform& CameraTransform, float CameraFOV,
+                                        EOCV_FeatureStage Stages, const FOCV_FeatureStageParams& Params,
+                                        IVROpenCVBridge::FOCV_FeatureTracker* Tracker, const FOCV_TrackerSettings& TrackerSettings,
+                                        FIVR_FeatureCache* Cache = nullptr, IVROpenCVBridge::FOCV_CVStageGraph* Graph = nullptr,
+                                        TArray<FOCV_OverlayPrimitive>* OutOverlay = nullptr);
     
     /**
      * @brief Função auxiliar para realizar a deprojeção de um ponto 2D do frame para o mundo 3D.
@@ -196,4 +352,43 @@ private:
         const FIntPoint& ImageResolution, 
         FVector& OutWorldLocation,
         FVector& OutWorldDirection);
+
+    /**
+     * @brief NOVO: DeprojectPixelToWorld em lote. Tangente do FOV, aspect ratio e matriz de rotação são calculados
+     *        uma vez; os pontos (SoA) são processados de 4 em 4 com VectorRegister. Como na versão unitária, a
+     *        localização de todos os pontos é a da câmera, então só as direções são escritas (também em SoA).
+     * @param PixelX Coordenadas X na imagem, uma por ponto.
+     * @param PixelY Coordenadas Y na imagem (mesmo tamanho de PixelX).
+     * @param OutDirectionX Recebe o X da direção normalizada de cada ponto (mesmo tamanho de PixelX).
+     * @param OutDirectionY Recebe o Y da direção.
+     * @param OutDirectionZ Recebe o Z da direção. Com resolução inválida, as três saídas são zeradas.
+     */
+    static void DeprojectPixelsToWorld(
+        TArrayView<const float> PixelX,
+        TArrayView<const float> PixelY,
+        const FTransform& CameraTransform,
+        float FOVDegrees,
+        const FIntPoint& ImageResolution,
+        TArrayView<float> OutDirectionX,
+        TArrayView<float> OutDirectionY,
+        TArrayView<float> OutDirectionZ);
+
+    /**
+     * @brief NOVO: Projeta um ponto do mundo na imagem da câmera de captura (base da UE: X para frente, Y para a
+     *        direita, Z para cima; FOV horizontal).
+     * @param OutPixelPos O ponto na coordenada da imagem (pode cair fora da imagem).
+     * @return Falso se o ponto estiver atrás da câmera (X da vista <= 0).
+     */
+    static bool ProjectWorldToPixel(
+        const FVector& WorldLocation,
+        const FTransform& CameraTransform,
+        float FOVDegrees,
+        const FIntPoint& ImageResolution,
+        FVector2D& OutPixelPos);
+
+    /**
+     * NOVO: Regiões de interesse do frame atual, em pixels: IVR_FeatureRegions mais a projeção de IVR_FeatureRegionActor.
+     * Vazio = frame inteiro. Roda na Game Thread (lê os limites do ator).
+     */
+    void GatherFeatureRegions(const FTransform& CameraTransform, float CameraFOV, int32 InWidth, int32 InHeight, TArray<FIntRect>& OutRegions) const;
 };
\ No newline at end of file
@@ -0,0 +1,91 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+#include "HAL/CriticalSection.h"
+
+class FQueuedThreadPool;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogIVRFeatureWorkerPool, Log, All);
+
+/** Contadores do pool de extração de features. */
+struct IVR_API FIVR_FeatureWorkerPoolStats
+{
+    int64 JobsSubmitted = 0;
+    int64 JobsCompleted = 0;
+    int64 JobsDiscarded = 0;     // Substituídos por um frame mais novo antes de começar
+    double AverageWorkMs = 0.0;  // Tempo médio de um job nos workers
+    int32 NumWorkers = 0;
+};
+
+/**
+ * Pool dedicado e limitado de threads para a extração de features em tempo real.
+ *
+ * - No máximo NumWorkers jobs rodam ao mesmo tempo. Um job que chega com todos ocupados fica em um
+ *   único slot pendente e é substituído pelo próximo ("o mais recente vence"); o substituído é descartado.
+ * - Cada job devolve uma continuação, que roda na Game Thread na ordem em que os jobs começaram,
+ *   mesmo que terminem fora de ordem.
+ * Submit e Shutdown devem ser chamados na Game Thread.
+ */
+class IVR_API FIVR_FeatureWorkerPool : public TSharedFromThis<FIVR_FeatureWorkerPool, ESPMode::ThreadSafe>
+{
+public:
+    struct FJob
+    {
+        /** Roda em um worker. Retorna a continuação a executar na Game Thread (pode ser vazia). */
+        TUniqueFunction<TUniqueFunction<void()>()> Work;
+        /** Chamado no lugar de Work quando o job é descartado sem rodar (em qualquer thread). */
+        TUniqueFunction<void()> Discard;
+    };
+
+    FIVR_FeatureWorkerPool();
+    ~FIVR_FeatureWorkerPool();
+
+    /** Cria as threads do pool. */
+    bool Start(int32 InNumWorkers, const TCHAR* PoolName);
+
+    /** Descarta o job pendente, espera os jobs em andamento e descarta as continuações não entregues. */
+    void Shutdown();
+
+    bool IsRunning() const { return ThreadPool != nullptr; }
+
+    int32 GetNumWorkers() const { return NumWorkers; }
+
+    void Submit(FJob&& Job);
+
+    FIVR_FeatureWorkerPoolStats GetStats() const;
+
+    // Não copiável (possui as threads)
+    FIVR_FeatureWorkerPool(const FIVR_FeatureWorkerPool&) = delete;
+    FIVR_FeatureWorkerPool& operator=(const FIVR_FeatureWorkerPool&) = delete;
+
+private:
+    class FQueuedJob;
+
+    /** Enfileira um job no pool de threads. Chamar com Lock adquirido. */
+    void LaunchLocked(FJob&& Job);
+
+    /** Executado pelos workers ao terminar um job (Continuation vazia se o job foi abandonado). */
+    void OnJobFinished(uint64 Sequence, TUniqueFunction<void()>&& Continuation, double WorkSeconds);
+
+    /** Roda na Game Thread as continuações prontas, em ordem de sequência. */
+    void DeliverReadyResults();
+
+    FQueuedThreadPool* ThreadPool = nullptr;
+    int32 NumWorkers = 0;
+
+    mutable FCriticalSection Lock;
+    int32 JobsInFlight = 0;                                // Protegido por Lock
+    TUniquePtr<FJob> PendingJob;                           // Protegido por Lock
+    uint64 NextSequence = 0;                               // Protegido por Lock
+    uint64 NextSequenceToDeliver = 0;                      // Protegido por Lock
+    TMap<uint64, TUniqueFunction<void()>> ReadyResults;    // Protegido por Lock
+    bool bDeliveryScheduled = false;                       // Protegido por Lock
+    bool bShuttingDown = false;                            // Protegido por Lock
+
+    FIVR_FeatureWorkerPoolStats Stats;                     // Protegido por Lock
+    double TotalWorkSeconds = 0.0;                         // Protegido por Lock
+};
@@ -0,0 +1,133 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+#include "HAL/CriticalSection.h"
+#include "IVRTypes.h" // Para FIVR_VideoFrame
+#include "IVRFrameMailbox.h" // Para TIVR_LatestValueMailbox
+
+class UIVRFramePool;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogIVRFrameSink, Log, All);
+
+/** Frame entregue aos sinks, com o contexto da câmera no instante da captura. */
+struct IVR_API FIVR_FrameSinkPacket
+{
+    FIVR_VideoFrame Frame;          // Buffer compartilhado entre todos os sinks: somente leitura
+    FTransform CameraTransform = FTransform::Identity;
+    float CameraFOV = 90.0f;
+};
+
+/** Onde um sink consome seus frames. */
+enum class EIVRFrameSinkLane : uint8
+{
+    Inline, // Na Game Thread, dentro do Dispatch. Apenas para sinks que só enfileiram (ex.: sessão de gravação)
+    Worker  // Em uma task de background própria, com fila limitada
+};
+
+/** O que fazer quando a fila de uma lane Worker está cheia. */
+enum class EIVRFrameSinkDropPolicy : uint8
+{
+    DropOldest, // Descarta o frame mais antigo da fila (sinks que querem o frame mais recente)
+    DropNewest, // Descarta o frame que está chegando
+    LatestFrameWins // Caixa de um slot sem lock: o frame não consumido é trocado pelo novo (ignora QueueDepth)
+};
+
+struct IVR_API FIVR_FrameSinkLaneSettings
+{
+    EIVRFrameSinkLane Lane = EIVRFrameSinkLane::Worker;
+    int32 QueueDepth = 2; // Frames aguardando na lane Worker (o frame em consumo não conta)
+    EIVRFrameSinkDropPolicy DropPolicy = EIVRFrameSinkDropPolicy::DropOldest;
+};
+
+struct IVR_API FIVR_FrameSinkStats
+{
+    FName SinkName;
+    int64 FramesDelivered = 0;
+    int64 FramesDropped = 0;
+    double AverageConsumeMs = 0.0;
+};
+
+/**
+ * Consumidor de frames do UIVRCaptureComponent (encoder, features, IPC...).
+ * Um mesmo buffer é entregue a todos os sinks registrados; cada sink roda na sua lane e
+ * um sink lento apenas perde frames na própria fila, sem atrasar os outros.
+ */
+class IVR_API IIVRFrameSink
+{
+public:
+    virtual ~IIVRFrameSink() {}
+
+    virtual FName GetSinkName() const = 0;
+
+    virtual FIVR_FrameSinkLaneSettings GetLaneSettings() const { return FIVR_FrameSinkLaneSettings(); }
+
+    /**
+     * Consome o frame na lane do sink. Os pixels são compartilhados com os outros sinks: não escreva neles.
+     * @return true se o sink ficou com o buffer e chamará UIVRFramePool::ReleaseFrame depois;
+     *         false para que a lane devolva o buffer ao pool.
+     */
+    virtual bool ConsumeFrame(FIVR_FrameSinkPacket& Packet) = 0;
+};
+
+/** Sink definido por uma função, para consumidores simples que não precisam de uma classe própria. */
+class IVR_API FIVR_LambdaFrameSink : public IIVRFrameSink
+{
+public:
+    FIVR_LambdaFrameSink(FName InSinkName, const FIVR_FrameSinkLaneSettings& InLaneSettings, TFunction<bool(FIVR_FrameSinkPacket&)> InConsume)
+        : SinkName(InSinkName)
+        , LaneSettings(InLaneSettings)
+        , Consume(MoveTemp(InConsume))
+    {}
+
+    virtual FName GetSinkName() const override { return SinkName; }
+    virtual FIVR_FrameSinkLaneSettings GetLaneSettings() const override { return LaneSettings; }
+    virtual bool ConsumeFrame(FIVR_FrameSinkPacket& Packet) override { return Consume(Packet); }
+
+private:
+    FName SinkName;
+    FIVR_FrameSinkLaneSettings LaneSettings;
+    TFunction<bool(FIVR_FrameSinkPacket&)> Consume;
+};
+
+/**
+ * Distribui cada frame adquirido para todos os sinks registrados.
+ * O buffer é marcado no FramePool como compartilhado (UIVRFramePool::ShareFrame) e volta ao pool
+ * quando o último sink termina. AddSink/RemoveSink/Dispatch devem ser chamados na Game Thread.
+ */
+class IVR_API FIVR_FrameFanOut
+{
+public:
+    explicit FIVR_FrameFanOut(UIVRFramePool* InFramePool);
+    ~FIVR_FrameFanOut();
+
+    /** Registra o sink. Um sink já registrado com o mesmo nome é substituído. */
+    void AddSink(const TSharedRef<IIVRFrameSink, ESPMode::ThreadSafe>& Sink);
+
+    /** Remove o sink, descarta sua fila e espera o frame em consumo terminar. */
+    bool RemoveSink(FName SinkName);
+
+    void RemoveAllSinks();
+
+    bool HasSink(FName SinkName) const;
+
+    int32 NumSinks() const { return Lanes.Num(); }
+
+    /** Entrega o frame a todos os sinks, assumindo a posse do buffer. Sem sinks, o buffer volta ao pool. */
+    void Dispatch(FIVR_FrameSinkPacket&& Packet);
+
+    TArray<FIVR_FrameSinkStats> GetSinkStats() const;
+
+    // Não copiável (possui as lanes)
+    FIVR_FrameFanOut(const FIVR_FrameFanOut&) = delete;
+    FIVR_FrameFanOut& operator=(const FIVR_FrameFanOut&) = delete;
+
+private:
+    class FLane;
+
+    TArray<TSharedRef<FLane, ESPMode::ThreadSafe>> Lanes;
+    UIVRFramePool* FramePool = nullptr;
+};
@@ -0,0 +1,27 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHITypes.h" // FUpdateTextureRegion2D
+
+/**
+ * Detecção de regiões alteradas entre dois frames BGRA, em blocos de TileSize x TileSize pixels.
+ * Usada pelo preview em tempo real para enviar à textura apenas os retângulos que mudaram.
+ */
+struct IVR_API FIVR_TileDiff
+{
+    static constexpr int32 TileSize = 64;
+
+    /**
+     * Compara Previous e Current bloco a bloco e gera os retângulos alterados (blocos vizinhos são fundidos).
+     * @param Previous Pixels BGRA do último frame enviado à textura.
+     * @param Current Pixels BGRA do frame atual (mesmas dimensões).
+     * @param OutRegions Regiões a enviar. Vazio se os frames forem idênticos; uma única região do frame inteiro
+     *        quando a fração de blocos alterados passa de FullUploadFraction.
+     * @return Número de blocos alterados.
+     */
+    static int32 ComputeDirtyRegions(const uint8* Previous, const uint8* Current, int32 Width, int32 Height,
+                                     TArray<FUpdateTextureRegion2D>& OutRegions, float FullUploadFraction = 0.5f);
+};
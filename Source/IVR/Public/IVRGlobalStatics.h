@@ -6,11 +6,15 @@
 #include "CoreMinimal.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
 #include "HAL/PlatformMisc.h"
+#include "IVRTypes.h" // Para FIVR_JustRTFrame
 
 // [MANUAL_REF_POINT] Includes do OpenCV foram movidos para IVROpenCVBridge.
 
 #include "IVRGlobalStatics.generated.h"
 
+// Recebe (no Game Thread) o relatório de UIVRGlobalStatics::RunFrameTransportBenchmark
+DECLARE_DYNAMIC_DELEGATE_OneParam(FOnIVRTransportBenchmarkFinished, const TArray<FString>&, Report);
+
 // Definição da USTRUCT para empacotar os detalhes do erro
 USTRUCT(BlueprintType)
 struct IVR_API FIVR_SystemErrorDetails
@@ -46,4 +50,55 @@ public:
               ToolTip = "Retrieves the last system error code and its description, multi-platform aware.",
               Keywords = "error, system, last, code, description, platform, ivr"))
     static FIVR_SystemErrorDetails GetLastSystemErrorDetails();
+
+    /**
+    * Microbenchmark dos transportes de frames para o FFmpeg (Named Pipe/FIFO, stdin, socket Unix) em 1080p e 4K.
+    * Um leitor em processo substitui o FFmpeg, então apenas o custo do canal é medido.
+    * Roda em uma thread de segundo plano (leva alguns segundos); o relatório também vai para o log (LogIVRTransportBenchmark).
+    * Ignorado, com um aviso, se outro benchmark ainda estiver em andamento.
+    * @param OnFinished Chamado no Game Thread com uma linha por transporte/resolução (vazão, latência média/p99 e espera pelo leitor).
+    * @param NumFrames Frames BGRA enviados em cada rodada.
+    */
+    UFUNCTION(BlueprintCallable, Category = "IVR System|Diagnostics",
+              meta = (DisplayName = "Run Frame Transport Benchmark",
+              ToolTip = "Measures throughput and latency of each UE-to-FFmpeg frame transport at 1080p and 4K on a background thread. OnFinished receives the report on the game thread.",
+              Keywords = "benchmark, pipe, fifo, socket, stdin, transport, ffmpeg, ivr"))
+    static void RunFrameTransportBenchmark(FOnIVRTransportBenchmarkFinished OnFinished, int32 NumFrames = 120);
+
+    /**
+    * Verdadeiro se o frame em tempo real carrega pixels.
+    */
+    UFUNCTION(BlueprintPure, Category = "IVR System|JustRTFrame",
+              meta = (DisplayName = "Has Frame Pixels",
+              Keywords = "pixels, frame, realtime, justrt, ivr"))
+    static bool HasJustRTFramePixels(const FIVR_JustRTFrame& Frame);
+
+    /**
+    * Copia os pixels BGRA do frame em tempo real para um array.
+    * O frame compartilha um único buffer imutável entre todos os listeners; a cópia só acontece aqui, sob demanda.
+    * @return Width * Height * 4 bytes em ordem BGRA (vazio se o frame não carregar pixels).
+    */
+    UFUNCTION(BlueprintCallable, Category = "IVR System|JustRTFrame",
+              meta = (DisplayName = "Get Frame Pixels (Copy)",
+              ToolTip = "Copies the BGRA pixels of a real-time frame into a new byte array. Prefer Get Frame Pixel Color for sparse reads.",
+              Keywords = "pixels, raw, buffer, bgra, frame, realtime, justrt, ivr"))
+    static TArray<uint8> GetJustRTFramePixels(const FIVR_JustRTFrame& Frame);
+
+    /**
+    * Lê um único pixel do frame em tempo real, sem copiar o buffer.
+    * @return A cor do pixel (0-1 por canal, sem conversão sRGB) ou preto transparente se X/Y estiverem fora do frame.
+    */
+    UFUNCTION(BlueprintPure, Category = "IVR System|JustRTFrame",
+              meta = (DisplayName = "Get Frame Pixel Color",
+              Keywords = "pixel, color, sample, frame, realtime, justrt, ivr"))
+    static FLinearColor GetJustRTFramePixelColor(const FIVR_JustRTFrame& Frame, int32 X, int32 Y);
+
+    /**
+    * Monta as features do frame em tempo real a partir do resultado nativo (SoA).
+    * Com IVR_ExpandFeaturesForBlueprint ativo, equivale a ler Frame.Features.
+    */
+    UFUNCTION(BlueprintPure, Category = "IVR System|JustRTFrame",
+              meta = (DisplayName = "Get Frame Features",
+              Keywords = "features, points, corners, histogram, frame, realtime, justrt, ivr"))
+    static FIVR_JustRTFeatures GetJustRTFrameFeatures(const FIVR_JustRTFrame& Frame);
 };
\ No newline at end of file
@@ -95,6 +95,21 @@ protected:
     // Fun��o auxiliar para adicionar formatos de comando (usada no construtor)
     void IVR_AddCommandFormat(const FString& Name, const FString& Format);
 
+    /**
+     * Argumentos de entrada do pipe de vídeo conforme IVR_FrameTimingMode:
+     * rawvideo com -r FPS (legado) ou Matroska com timestamps por frame (CFR/VFR).
+     */
+    FString IVR_GetVideoInputArgs() const;
+
+    /** Argumentos de saída que aplicam CFR (duplica/descarta contra o FPS nominal) ou preservam os timestamps (VFR). */
+    FString IVR_GetFrameRateOutputArgs() const;
+
+    /**
+     * Verdadeiro se o FFmpeg configurado aceita -fps_mode (5.1 ou superior); senão usa-se o -vsync equivalente.
+     * A versão é lida uma vez por executável ("ffmpeg -version"); builds sem número de versão (git) são tratados como recentes.
+     */
+    bool IVR_SupportsFpsMode() const;
+
     FString InVideoPipePath;
     FString InOutputFilePath;
 
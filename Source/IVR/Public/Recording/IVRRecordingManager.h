@@ -41,6 +41,10 @@ public:
     UFUNCTION(BlueprintCallable, Category = "IVR")
     void ClearAllTakes();
 
+    /**
+     * Concatena os takes concluídos no vídeo Master. Com takes RawCapture ainda sendo codificados em segundo plano,
+     * a geração é adiada até a última codificação terminar e o retorno é vazio.
+     */
     UFUNCTION(BlueprintCallable, Category = "IVR|Recording")
     FString GenerateMasterVideoAndCleanup();
 
@@ -75,6 +79,19 @@ private:
     UPROPERTY()
     FString MasterVideoFilePath;
 
+    /** Adiciona o take da sessão à lista de concluídos se o arquivo existir. Chamado com ManagerMutex travado. */
+    void RegisterCompletedTake(UIVRRecordingSession* Session, const FString& TakeFilePath);
+
+    /** Registra o take de uma sessão RawCapture quando a codificação em segundo plano do .ivrraw termina. */
+    UFUNCTION()
+    void HandleRawEncodeFinished(UIVRRecordingSession* Session, bool bSuccess, const FString& OutputPath);
+
+    /** NOVO: Takes RawCapture em codificação; o take só entra em CompletedTakes quando ela termina (Game Thread). */
+    int32 PendingRawEncodes = 0;
+
+    /** NOVO: GenerateMasterVideoAndCleanup foi pedido com codificações pendentes; roda quando a última terminar. */
+    bool bMasterVideoDeferred = false;
+
     FString BuildFFmpegConcatCommand(const TArray<FString>& TakeFilePaths, const FString& OutputMasterPath);
     
     void CleanupIndividualTakes();
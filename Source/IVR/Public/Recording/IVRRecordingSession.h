@@ -6,6 +6,7 @@
 #include "UObject/NoExportTypes.h"
 #include "HAL/Runnable.h"
 #include "HAL/RunnableThread.h"
+#include "HAL/ThreadSafeCounter.h"
 #include "IVRTypes.h"
 #include "Containers/Queue.h"
 #include "Misc/Guid.h"
@@ -15,14 +16,25 @@
 #include "../IVRGlobalStatics.h"
 // [MANUAL_REF_POINT] FIVR_PipeWrapper é agora de IVROpenCVBridge
 #include "IVR_PipeWrapper.h"
+#include "IVR_SpillRingFile.h" // Camada de spill em disco (SpillToDisk)
+#include "IVR_RawContainer.h"  // Container .ivrraw (RawCapture)
 #include "IVRVideoEncoder.h" // Inclui o novo encoder centralizado
 #include "IVRFramePool.h" // Adicionar este include!
+#include "IVRCaptureClock.h" // Relógio de captura compartilhado / linha do tempo pausável
 
 #include "IVRRecordingSession.generated.h"
 
 // Definir um LogCategory para mensagens específicas da gravação IVR
 DECLARE_LOG_CATEGORY_EXTERN(LogIVRRecSession, Log, All);
 
+// Disparado (no Game Thread) no primeiro descarte de cada rajada de descartes da fila de gravação
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnIVRFrameDropBurst, EIVRBackpressurePolicy, Policy, const FIVR_BackpressureStats&, Stats);
+
+class UIVRRecordingSession;
+// Disparado (no Game Thread) quando a codificação em segundo plano do container .ivrraw termina (RawCapture + IVR_EncodeRawOnStop).
+// OutputPath é o take .mp4 em caso de sucesso ou o próprio .ivrraw em caso de falha.
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FOnIVRRawEncodeFinished, UIVRRecordingSession*, Session, bool, bSuccess, const FString&, OutputPath);
+
 /**
  * Classe responsável por gerenciar uma única sessão de gravação de um take de vídeo.
  * Ela orquestra a captura de frames e delega a codificação ao UIVRVideoEncoder.
@@ -85,9 +97,17 @@ public:
 
     UFUNCTION(BlueprintPure, Category = "IVR")
     FDateTime GetStartTime() const { return StartTime; }
+
+    /**
+     * @brief Instante (FIVR_CaptureClock, nanossegundos) do primeiro frame aceito neste take, ou -1 se nenhum.
+     * Como todas as sessões usam o mesmo relógio, a diferença entre os valores de dois takes alinha gravações multi-câmera.
+     */
+    UFUNCTION(BlueprintPure, Category = "IVR")
+    int64 GetFirstFrameCaptureTimeNs() const { return FirstFrameCaptureNs.GetValue(); }
     /**
      * @brief Retorna o caminho do arquivo do take gravado por esta sessão.
-     * Será válido após o StopRecording bem-sucedido.
+     * Será válido após o StopRecording bem-sucedido. Em RawCapture com codificação ao parar, aponta para o .ivrraw
+     * até OnRawEncodeFinished ser disparado.
      */
     UFUNCTION(BlueprintPure, Category = "IVR")
     FString GetOutputPath() const { return CurrentTakeFilePath; } 
@@ -107,8 +127,26 @@ public:
     
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Recording Settings")
     FIVR_VideoSettings UserRecordingSettings;
-    int32 GetConsumerQCounter() { return VideoConsumerQCounter; }
-    int32 GetProducerQCounter() { return VideoProducerQCounter; }
+    int32 GetConsumerQCounter() { return VideoConsumerQCounter.GetValue(); }
+    int32 GetProducerQCounter() { return VideoProducerQCounter.GetValue(); }
+
+    /**
+     * @brief Retorna um snapshot dos contadores de backpressure desta sessão.
+     */
+    UFUNCTION(BlueprintPure, Category = "IVR|Recording")
+    FIVR_BackpressureStats GetBackpressureStats() const;
+
+    /** Disparado no primeiro frame descartado de cada rajada (a rajada termina quando a fila volta abaixo da metade). */
+    UPROPERTY(BlueprintAssignable, Category = "IVR|Recording Events")
+    FOnIVRFrameDropBurst OnFrameDropBurst;
+
+    /** Disparado quando a codificação do .ivrraw iniciada pelo StopRecording termina (sucesso ou falha). */
+    UPROPERTY(BlueprintAssignable, Category = "IVR|Recording Events")
+    FOnIVRRawEncodeFinished OnRawEncodeFinished;
+
+    /** Verdadeiro enquanto o container .ivrraw do take está sendo codificado em segundo plano. */
+    UFUNCTION(BlueprintPure, Category = "IVR|Recording")
+    bool IsEncodingRaw() const { return bRawEncodeInProgress; }
 
 private:
     // Referência ao codificador de vídeo, que agora gerencia o FFmpeg.
@@ -120,6 +158,11 @@ private:
     
     FDateTime StartTime;
     float RecordingDuration = 0.0f;
+
+    // Linha do tempo do take sobre o FIVR_CaptureClock: pausada junto com a sessão.
+    FIVR_CaptureTimeline CaptureTimeline;
+    // Timestamp do primeiro frame aceito (já sem o tempo em pausa), -1 até o primeiro frame.
+    FThreadSafeCounter64 FirstFrameCaptureNs{ -1 };
     
     FString SessionID; // ID único para este take.
 
@@ -129,9 +172,100 @@ private:
     // Fila para frames do thread principal (produtor) para o worker thread (consumidor).
     TQueue<FIVR_VideoFrame, EQueueMode::Mpsc> VideoFrameProducerQueue; 
     
-    // Contadores para monitoramento da fila de frames de vídeo.
-    int32 VideoProducerQCounter = 0;
-    int32 VideoConsumerQCounter = 0;
+    // Contadores para monitoramento da fila de frames de vídeo (acessados pelo produtor e pelo IVRecThread).
+    FThreadSafeCounter VideoProducerQCounter;
+    FThreadSafeCounter VideoConsumerQCounter;
+
+    // --- Backpressure ---
+    // Capacidade da fila em frames, calculada em StartRecording a partir de FPS * IVR_QueueCapacitySeconds.
+    int32 QueueCapacityFrames = 30;
+    // Máximo de frames entregues ao encoder e ainda não escritos no pipe; o restante espera na fila da sessão.
+    static constexpr int32 EncoderInFlightLimit = 2;
+    // Sinalizado pelo IVRecThread sempre que um frame sai da fila (acorda o produtor em BlockProducer).
+    FEvent* SpaceAvailableEvent;
+    // Estado da dizimação (DecimateHalfRate), usado apenas pelo produtor.
+    bool bDecimating = false;
+    bool bSkipNextDecimatedFrame = false;
+    // Verdadeiro enquanto uma rajada de descartes está em andamento.
+    FThreadSafeBool bInDropBurst = false;
+    FThreadSafeCounter FramesAcceptedCounter;
+    FThreadSafeCounter FramesDroppedNewestCounter;
+    FThreadSafeCounter FramesDroppedOldestCounter;
+    FThreadSafeCounter ProducerBlocksCounter;
+    FThreadSafeCounter BlockTimeoutsCounter;
+    FThreadSafeCounter FramesDecimatedCounter;
+    FThreadSafeCounter FramesSpilledCounter;
+    FThreadSafeCounter FramesRestoredFromSpillCounter;
+    FThreadSafeCounter FramesDroppedSpillFullCounter;
+    FThreadSafeCounter FramesLostFromSpillCounter;
+    FThreadSafeCounter FramesDroppedAfterFinishCounter;
+    FThreadSafeCounter DropBurstsCounter;
+    FThreadSafeCounter PeakQueueDepthCounter;
+
+    /** Zera os contadores de backpressure e o estado de rajada/dizimação. */
+    void ResetBackpressureState();
+
+    /** Enfileira o frame na fila da sessão e atualiza profundidade, pico e fim de rajada. */
+    void EnqueueAcceptedFrame(FIVR_VideoFrame&& Frame);
+
+    /** Devolve o frame ao pool e marca o descarte na rajada atual (dispara OnFrameDropBurst se for o primeiro). */
+    void DiscardFrame(FIVR_VideoFrame& Frame, FThreadSafeCounter& PolicyCounter);
+
+    /** DropOldest: remove frames do início da fila até respeitar a capacidade. Executado apenas pelo IVRecThread. */
+    void TrimQueueToCapacity();
+
+    // --- Spill em disco (SpillToDisk) ---
+    // Dimensões reais dos frames, usadas para dimensionar o spill em segundos.
+    int32 ActualFrameWidth = 0;
+    int32 ActualFrameHeight = 0;
+    // Anel em disco com os frames excedentes. Acessado apenas pelo IVRecThread após o StartRecording.
+    FIVR_SpillRingFile SpillRing;
+    // Verdadeiro se o anel foi aberto com sucesso para a sessão atual.
+    bool bSpillAvailable = false;
+    // Verdadeiro enquanto há frames no disco (usado apenas para logar início/fim do spill).
+    bool bSpillActive = false;
+
+    /** Cria o arquivo de spill da sessão a partir das configurações (capacidade em segundos ou GB). */
+    bool OpenSpillRing();
+
+    /** SpillToDisk: move frames do início da fila para o disco até respeitar a capacidade. Executado apenas pelo IVRecThread. */
+    void SpillQueueOverflow();
+
+    /**
+     * Obtém o próximo frame, em ordem, para o encoder: primeiro os frames em disco (mais antigos),
+     * depois os da fila em memória. Executado apenas pelo IVRecThread.
+     */
+    bool DequeueNextFrame(FIVR_VideoFrame& OutFrame);
+
+    /** Encaminha um frame ao encoder (ou ao container .ivrraw em RawCapture), contabilizando recusas após o fim da codificação. */
+    void ForwardFrameToEncoder(FIVR_VideoFrame& Frame);
+
+    // --- Captura bruta (RawCapture) ---
+    // Caminho do FFmpeg guardado no Initialize para a codificação posterior do container.
+    FString FFmpegExecutablePath;
+    // Verdadeiro se a sessão foi inicializada em modo RawCapture (sem encoder ao vivo).
+    bool bRawCaptureMode = false;
+    // Container de saída do modo RawCapture. Acessado pelo IVRecThread entre StartRecording e o join do StopRecording.
+    FIVR_RawContainerWriter RawWriter;
+    // Caminho do container .ivrraw do take atual.
+    FString RawContainerFilePath;
+    // Evita repetir o log de erro de escrita a cada frame.
+    bool bRawWriteErrorLogged = false;
+
+    // Encoder dedicado à codificação em segundo plano do .ivrraw (separado do VideoEncoder, desligado pelo StopRecording).
+    UPROPERTY()
+    UIVRVideoEncoder* RawEncodeEncoder = nullptr;
+    // Verdadeiro entre o disparo da codificação do .ivrraw e o OnRawEncodeFinished. A sessão fica enraizada nesse intervalo.
+    FThreadSafeBool bRawEncodeInProgress = false;
+
+    /**
+     * Finaliza o container e, se configurado, dispara a codificação para o take .mp4 em uma thread de segundo plano.
+     * CurrentTakeFilePath aponta para o .ivrraw até a codificação terminar (HandleRawEncodeCompleted).
+     */
+    void FinalizeRawCapture();
+
+    /** Game Thread: publica o resultado da codificação do .ivrraw e libera a sessão para o GC. */
+    void HandleRawEncodeCompleted(bool bSuccess, const FString& EncodedTakePath);
     /**
     * @brief Gera o caminho completo para o arquivo de take desta sessão.
     * Será chamado uma vez durante a inicialização/start.
@@ -13,6 +13,7 @@
 // [MANUAL_REF_POINT] FFMpegLogReader é agora de IVROpenCVBridge
 #include "FFmpegLogReader.h"
 #include "HAL/ThreadSafeBool.h" // Incluir ThreadSafeBool
+#include "HAL/ThreadSafeCounter.h" // Para o contador de frames pendentes
 #include "IVRFramePool.h" // Adicionar este include!
 // [MANUAL_REF_POINT] FVideoEncoderWorker agora é de IVROpenCVBridge
 #include "FVideoEncoderWorker.h"
@@ -85,8 +86,34 @@ public:
     UFUNCTION(BlueprintCallable, Category = "IVR|Encoder")
     bool ConcatenateVideos(const TArray<FString>& InTakePaths, const FString& InMasterOutputPath);
 
+    /**
+     * @brief Codifica um container .ivrraw (gravado em modo RawCapture) usando o pipeline normal do UIVRECFactory.
+     * Resolução e FPS vêm do cabeçalho do container. Bloqueia até o FFmpeg terminar; pode ser chamado de uma thread de fundo.
+     * O encoder deve estar recém-criado (não inicializado); ele é desligado ao final.
+     * @param RawFilePath Caminho do container .ivrraw.
+     * @param OutputFilePath Caminho do vídeo de saída.
+     * @param Settings Configurações de codificação (FPS é substituído pelo FPS nominal do container).
+     * @param InFFmpegExecutablePath Caminho para o executável FFmpeg.
+     * @param InFramePool Pool usado para os buffers de leitura (obrigatório; nulo retorna false).
+     * @return true se todos os frames foram enviados ao FFmpeg e o arquivo de saída existe.
+     */
+    UFUNCTION(BlueprintCallable, Category = "IVR|Encoder")
+    bool EncodeRawContainer(const FString& RawFilePath, const FString& OutputFilePath, const FIVR_VideoSettings& Settings, const FString& InFFmpegExecutablePath, UIVRFramePool* InFramePool);
+
     UFUNCTION(BlueprintPure, Category = "IVR")
     bool IsInitialized() const { return bIsInitialized; }
+
+    /**
+     * @brief Retorna quantos frames foram aceitos por EncodeFrame e ainda não foram escritos no pipe.
+     * Usado pela sessão de gravação para aplicar backpressure na sua própria fila.
+     */
+    int32 GetPendingFrameCount() const { return PendingFrameCount.GetValue(); }
+
+    /** Verdadeiro enquanto o worker está ativo e consumindo a fila (falso após erro de escrita ou shutdown). */
+    bool IsWorkerRunning() const { return bIsInitialized && !bStopWorkerThread; }
+
+    /** Throughput (bytes/s) e tempo bloqueado esperando o FFmpeg ler o pipe de vídeo, desde a conexão. */
+    FIVR_PipeWriteStats GetPipeWriteStats() const { return VideoInputPipe ? VideoInputPipe->GetWriteStats() : FIVR_PipeWriteStats(); }
 protected:
     // Configurações de vídeo atuais
     FIVR_VideoSettings CurrentSettings;
@@ -102,13 +129,19 @@ protected:
     void* FFmpegWritePipeStdout;      // Handle de escrita para o pipe do FFmpeg stdout
     void* FFmpegReadPipeStderr;       // Handle de leitura para o pipe do FFmpeg stderr
     void* FFmpegWritePipeStderr;      // Handle de escrita para o pipe do FFmpeg stderr
-    // Wrapper para o Named Pipe de entrada de vídeo (UE -> FFmpeg)
-    FIVR_PipeWrapper VideoInputPipe;
+    // Transporte de entrada de vídeo (UE -> FFmpeg): Named Pipe/FIFO, stdin ou socket Unix (FIVR_VideoSettings::IVR_FrameTransport)
+    TUniquePtr<IIVR_FrameTransport> VideoInputPipe;
     
+    // Encapsulamento Matroska com timestamps por frame (usado quando IVR_FrameTimingMode != AssumeNominalFPS)
+    FIVR_MatroskaPipeMuxer StreamMuxer;
+
     // Nome único do pipe de vídeo para esta sessão
     FString VideoPipeBaseName; // Nome base para o pipe
     // Fila thread-safe para frames de vídeo (Mpsc: Multiple Producer, Single Consumer)
     TQueue<FIVR_VideoFrame, EQueueMode::Mpsc> FrameQueue;
+
+    // Frames enfileirados em FrameQueue que o worker ainda não escreveu (ou descartou)
+    FThreadSafeCounter PendingFrameCount;
     
     // Flag atômica para sinalizar ao worker thread para parar
     FThreadSafeBool bStopWorkerThread;
@@ -6,6 +6,7 @@
 #include "CoreMinimal.h"
 #include "Recording/IVRFrameSource.h"
 #include "IVRFramePool.h"
+#include "IVRFrameMailbox.h" // Para TIVR_LatestValueMailbox
 
 // Includes para Threading
 #include "HAL/Runnable.h"       // Para FRunnable
@@ -93,6 +94,9 @@ protected:
 
     /** Fila thread-safe para passar frames do worker thread (produtor) para o Game Thread (consumidor). */
     TQueue<FIVR_VideoFrame, EQueueMode::Mpsc> CapturedFrameQueue;
+
+    /** NOVO: Caixa "o mais recente vence", usada no lugar da fila quando VideoSettings.UsesLatestFrameDelivery(). */
+    TIVR_LatestValueMailbox<FIVR_VideoFrame> LatestFrameMailbox;
     /** Flag atômica para sinalizar à thread worker para parar. */
     FThreadSafeBool bShouldStopWorker;
 
@@ -0,0 +1,118 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#include "IVRCaptureClock.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
+#include "Algo/BinarySearch.h"
+
+// =====================================================================================
+// FIVR_CaptureClock
+// =====================================================================================
+FIVR_CaptureClock& FIVR_CaptureClock::Get()
+{
+    static FIVR_CaptureClock Instance;
+    return Instance;
+}
+
+FIVR_CaptureClock::FIVR_CaptureClock()
+{
+    EpochCycles = FPlatformTime::Cycles64();
+    CyclesPerSecond = FMath::Max<uint64>(1, (uint64)FMath::RoundToDouble(1.0 / FPlatformTime::GetSecondsPerCycle64()));
+}
+
+int64 FIVR_CaptureClock::NowNs() const
+{
+    const uint64 Elapsed = FPlatformTime::Cycles64() - EpochCycles;
+    // Divisão em duas partes para manter precisão de nanossegundos sem overflow em 64 bits.
+    const uint64 WholeSeconds = Elapsed / CyclesPerSecond;
+    const uint64 RemainderCycles = Elapsed % CyclesPerSecond;
+    return (int64)(WholeSeconds * NanosecondsPerSecond + (RemainderCycles * NanosecondsPerSecond) / CyclesPerSecond);
+}
+
+void FIVR_CaptureClock::SyncWorldTime(double WorldTimeSeconds, float WorldTimeDilation)
+{
+    const int64 Now = NowNs();
+    FScopeLock Lock(&AnchorLock);
+    bHasWorldAnchor = true;
+    AnchorCaptureNs = Now;
+    AnchorWorldSeconds = WorldTimeSeconds;
+    AnchorTimeDilation = WorldTimeDilation;
+}
+
+bool FIVR_CaptureClock::MapToWorldSeconds(int64 CaptureTimeNs, double& OutWorldTimeSeconds) const
+{
+    FScopeLock Lock(&AnchorLock);
+    if (!bHasWorldAnchor)
+    {
+        return false;
+    }
+    OutWorldTimeSeconds = AnchorWorldSeconds + ToSeconds(CaptureTimeNs - AnchorCaptureNs) * AnchorTimeDilation;
+    return true;
+}
+
+// =====================================================================================
+// FIVR_CaptureTimeline
+// =====================================================================================
+void FIVR_CaptureTimeline::Start()
+{
+    StartNs.Set(FIVR_CaptureClock::Get().NowNs());
+    AccumulatedPausedNs.Reset();
+    PauseStartNs.Set(-1);
+    FScopeLock Lock(&IntervalsLock);
+    PauseIntervals.Reset();
+}
+
+void FIVR_CaptureTimeline::Pause()
+{
+    if (!IsPaused())
+    {
+        PauseStartNs.Set(FIVR_CaptureClock::Get().NowNs());
+    }
+}
+
+void FIVR_CaptureTimeline::Resume()
+{
+    const int64 PausedAt = PauseStartNs.GetValue();
+    if (PausedAt >= 0)
+    {
+        const int64 Now = FIVR_CaptureClock::Get().NowNs();
+        // Sob o lock: GetPausedNsBefore nunca vê a mesma pausa como concluída e em andamento ao mesmo tempo.
+        FScopeLock Lock(&IntervalsLock);
+        PauseIntervals.Add({ PausedAt, Now, AccumulatedPausedNs.GetValue() });
+        AccumulatedPausedNs.Add(Now - PausedAt);
+        PauseStartNs.Set(-1);
+    }
+}
+
+int64 FIVR_CaptureTimeline::GetPausedNs() const
+{
+    const int64 PausedAt = PauseStartNs.GetValue();
+    const int64 CurrentPause = (PausedAt >= 0) ? FIVR_CaptureClock::Get().NowNs() - PausedAt : 0;
+    return AccumulatedPausedNs.GetValue() + CurrentPause;
+}
+
+int64 FIVR_CaptureTimeline::GetPausedNsBefore(int64 CaptureTimeNs) const
+{
+    int64 PausedNs = 0;
+    FScopeLock Lock(&IntervalsLock);
+    // Última pausa concluída que começou antes do instante: soma o que veio antes dela e o trecho dela até o instante.
+    const int32 Index = Algo::UpperBoundBy(PauseIntervals, CaptureTimeNs, &FPauseInterval::BeginNs) - 1;
+    if (PauseIntervals.IsValidIndex(Index))
+    {
+        const FPauseInterval& Interval = PauseIntervals[Index];
+        PausedNs = Interval.PausedBeforeNs + (FMath::Min(CaptureTimeNs, Interval.EndNs) - Interval.BeginNs);
+    }
+    // Pausa em andamento que começou antes do instante (frame capturado durante a pausa).
+    const int64 PausedAt = PauseStartNs.GetValue();
+    if (PausedAt >= 0 && PausedAt < CaptureTimeNs)
+    {
+        PausedNs += CaptureTimeNs - PausedAt;
+    }
+    return PausedNs;
+}
+
+int64 FIVR_CaptureTimeline::GetElapsedNs() const
+{
+    return FMath::Max<int64>(0, FIVR_CaptureClock::Get().NowNs() - StartNs.GetValue() - GetPausedNs());
+}
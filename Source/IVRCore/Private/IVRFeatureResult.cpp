@@ -0,0 +1,189 @@
+﻿// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of WilliÃ¤m Wolff and protected by copywright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+// -------------------------------------------------------------------------------
+#include "IVRFeatureResult.h"
+#include "Misc/ScopeLock.h"
+
+void FIVR_FeatureResult::Reset()
+{
+    SetNumPoints(0);
+    SetNumCorners(0);
+    CameraLocation = FVector3f::ZeroVector;
+    bHasHistograms = false;
+    BiggestPointIndex = INDEX_NONE;
+    SmallerPointIndex = INDEX_NONE;
+    NumOfQuads = 0;
+    NumOfRectangles = 0;
+    bIsKeyframe = true;
+    StageNames.Reset();
+    StageMilliseconds.Reset();
+}
+
+void FIVR_FeatureResult::SetNumPoints(int32 NumPoints)
+{
+    PointX.SetNumUninitialized(NumPoints, EAllowShrinking::No);
+    PointY.SetNumUninitialized(NumPoints, EAllowShrinking::No);
+    SizeX.SetNumUninitialized(NumPoints, EAllowShrinking::No);
+    SizeY.SetNumUninitialized(NumPoints, EAllowShrinking::No);
+    Angle.SetNumUninitialized(NumPoints, EAllowShrinking::No);
+    TrackId.SetNumUninitialized(NumPoints, EAllowShrinking::No);
+    IsQuad.SetNumUninitialized(NumPoints, EAllowShrinking::No);
+    DirectionX.SetNumUninitialized(NumPoints, EAllowShrinking::No);
+    DirectionY.SetNumUninitialized(NumPoints, EAllowShrinking::No);
+    DirectionZ.SetNumUninitialized(NumPoints, EAllowShrinking::No);
+}
+
+void FIVR_FeatureResult::SetNumCorners(int32 NumCorners)
+{
+    CornerX.SetNumUninitialized(NumCorners, EAllowShrinking::No);
+    CornerY.SetNumUninitialized(NumCorners, EAllowShrinking::No);
+    CornerIds.SetNumUninitialized(NumCorners, EAllowShrinking::No);
+}
+
+void FIVR_FeatureResult::QuantizeHistogram(const TArray<float>& Normalized, uint16* OutBins)
+{
+    const int32 NumBins = FMath::Min(Normalized.Num(), NumHistogramBins);
+    for (int32 Bin = 0; Bin < NumBins; ++Bin)
+    {
+        OutBins[Bin] = (uint16)FMath::RoundToInt32(FMath::Clamp(Normalized[Bin], 0.0f, 1.0f) * MAX_uint16);
+    }
+    for (int32 Bin = NumBins; Bin < NumHistogramBins; ++Bin)
+    {
+        OutBins[Bin] = 0;
+    }
+}
+
+void FIVR_FeatureResult::ToBlueprint(FIVR_JustRTFeatures& OutFeatures) const
+{
+    const int32 NumInterestPoints = NumPoints();
+    const FVector Location(CameraLocation);
+    OutFeatures.JustRTInterestPoints.SetNum(NumInterestPoints);
+    for (int32 Index = 0; Index < NumInterestPoints; ++Index)
+    {
+        FIVR_JustRTPoint& Point = OutFeatures.JustRTInterestPoints[Index];
+        Point.Point2D = FVector2D(PointX[Index], PointY[Index]);
+        Point.Point3D = Location;
+        Point.Direction = FVector(DirectionX[Index], DirectionY[Index], DirectionZ[Index]);
+        Point.Size2D = FVector2D(SizeX[Index], SizeY[Index]);
+        Point.Angle = Angle[Index];
+        Point.IsQuad = IsQuad[Index] != 0;
+        Point.TrackId = TrackId[Index];
+    }
+    OutFeatures.BiggestPointIndex = BiggestPointIndex;
+    OutFeatures.SmallerPointIndex = SmallerPointIndex;
+    OutFeatures.NumOfQuads = NumOfQuads;
+    OutFeatures.NumOfRectangles = NumOfRectangles;
+    OutFeatures.bIsKeyframe = bIsKeyframe;
+
+    const int32 NumFrameCorners = NumCorners();
+    OutFeatures.Corners.SetNumUninitialized(NumFrameCorners);
+    for (int32 Index = 0; Index < NumFrameCorners; ++Index)
+    {
+        OutFeatures.Corners[Index] = FVector2D(CornerX[Index], CornerY[Index]);
+    }
+    // Sem rastreamento os IDs são INDEX_NONE; a struct Blueprint só os expõe quando existem
+    OutFeatures.CornerIds.Reset();
+    if (NumFrameCorners > 0 && CornerIds[0] != INDEX_NONE)
+    {
+        OutFeatures.CornerIds = CornerIds;
+    }
+
+    auto Dequantize = [](const uint16* Bins, TArray<float>& Out)
+    {
+        Out.SetNumUninitialized(NumHistogramBins);
+        for (int32 Bin = 0; Bin < NumHistogramBins; ++Bin)
+        {
+            Out[Bin] = (float)Bins[Bin] / MAX_uint16;
+        }
+    };
+    if (bHasHistograms)
+    {
+        Dequantize(HistogramRed, OutFeatures.HistogramRed);
+        Dequantize(HistogramGreen, OutFeatures.HistogramGreen);
+        Dequantize(HistogramBlue, OutFeatures.HistogramBlue);
+    }
+    else
+    {
+        OutFeatures.HistogramRed.Reset();
+        OutFeatures.HistogramGreen.Reset();
+        OutFeatures.HistogramBlue.Reset();
+    }
+
+    OutFeatures.StageMilliseconds.Reset();
+    for (int32 Index = 0; Index < StageNames.Num(); ++Index)
+    {
+        OutFeatures.StageMilliseconds.Add(StageNames[Index], StageMilliseconds[Index]);
+    }
+}
+
+FIVR_FeatureResultPool::FIVR_FeatureResultPool(int32 InMaxFree)
+    : MaxFree(FMath::Max(0, InMaxFree))
+{
+}
+
+FIVR_FeatureResultPool::~FIVR_FeatureResultPool()
+{
+    // Resultados ainda em uso são liberados pelo próprio deleter (a referência fraca ao pool expira)
+    for (FIVR_FeatureResult* Result : FreeResults)
+    {
+        delete Result;
+    }
+}
+
+TSharedRef<FIVR_FeatureResult, ESPMode::ThreadSafe> FIVR_FeatureResultPool::Acquire()
+{
+    FIVR_FeatureResult* Result = nullptr;
+    {
+        FScopeLock Lock(&Mutex);
+        if (FreeResults.Num() > 0)
+        {
+            Result = FreeResults.Pop(EAllowShrinking::No);
+        }
+        else
+        {
+            ++NumAllocated;
+        }
+    }
+    if (Result)
+    {
+        Result->Reset();
+    }
+    else
+    {
+        Result = new FIVR_FeatureResult();
+    }
+    TWeakPtr<FIVR_FeatureResultPool, ESPMode::ThreadSafe> WeakPool = AsWeak();
+    return MakeShareable(Result, [WeakPool](FIVR_FeatureResult* Released)
+    {
+        if (TSharedPtr<FIVR_FeatureResultPool, ESPMode::ThreadSafe> Pool = WeakPool.Pin())
+        {
+            Pool->Release(Released);
+        }
+        else
+        {
+            delete Released;
+        }
+    });
+}
+
+int32 FIVR_FeatureResultPool::GetNumAllocated() const
+{
+    FScopeLock Lock(&Mutex);
+    return NumAllocated;
+}
+
+void FIVR_FeatureResultPool::Release(FIVR_FeatureResult* Result)
+{
+    {
+        FScopeLock Lock(&Mutex);
+        if (FreeResults.Num() < MaxFree)
+        {
+            FreeResults.Add(Result);
+            return;
+        }
+        --NumAllocated;
+    }
+    delete Result;
+}
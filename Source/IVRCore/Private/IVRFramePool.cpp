@@ -4,6 +4,7 @@
 // Proibited copy or distribution without expressed authorization of the Author.
 // -------------------------------------------------------------------------------
 #include "IVRFramePool.h"
+#include "Misc/ScopeLock.h"
 
 DEFINE_LOG_CATEGORY(LogIVRFramePool);
 
@@ -51,6 +52,8 @@ void UIVRFramePool::Initialize(int32 InPoolSize, int32 InFrameWidth, int32 InFra
     {
         TSharedPtr<TArray<uint8>> DummyBuffer;
         while (FrameBufferPool.Dequeue(DummyBuffer)) {} // Limpa buffers existentes
+        FScopeLock Lock(&SharedFrameRefsLock);
+        SharedFrameRefs.Empty();
         UE_LOG(LogIVRFramePool, Log, TEXT("UIVRFramePool forced re-initialization: Cleared previous buffers."));
     }
     
@@ -129,6 +132,47 @@ void UIVRFramePool::ReleaseFrame(TSharedPtr<TArray<uint8>> FrameBuffer)
         return;
     }
 
+    // NOVO: Buffers compartilhados entre sinks só voltam ao pool quando o último consumidor os libera.
+    {
+        FScopeLock Lock(&SharedFrameRefsLock);
+        if (FSharedFrameRefs* Refs = SharedFrameRefs.Find(FrameBuffer.Get()))
+        {
+            if (Refs->Buffer.Pin() == FrameBuffer && --Refs->PendingReleases > 0)
+            {
+                return;
+            }
+            SharedFrameRefs.Remove(FrameBuffer.Get());
+        }
+    }
     FrameBufferPool.Enqueue(FrameBuffer);
 }
+void UIVRFramePool::ShareFrame(const TSharedPtr<TArray<uint8>>& FrameBuffer, int32 NumConsumers)
+{
+    if (!FrameBuffer.IsValid() || NumConsumers <= 1)
+    {
+        return;
+    }
+    FScopeLock Lock(&SharedFrameRefsLock);
+    FSharedFrameRefs& Refs = SharedFrameRefs.FindOrAdd(FrameBuffer.Get());
+    Refs.Buffer = FrameBuffer;
+    Refs.PendingReleases = NumConsumers;
+}
+
+TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> UIVRFramePool::MakeImmutablePayload(TSharedPtr<TArray<uint8>> FrameBuffer)
+{
+    if (!FrameBuffer.IsValid())
+    {
+        return nullptr;
+    }
+    const TArray<uint8>* PayloadData = FrameBuffer.Get();
+    // O deleter mantém o buffer original vivo e o devolve ao pool. Se o pool já foi destruído, o buffer é apenas liberado.
+    TWeakObjectPtr<UIVRFramePool> WeakPool = this;
+    return MakeShareable(PayloadData, [WeakPool, FrameBuffer](const TArray<uint8>*)
+    {
+        if (UIVRFramePool* Pool = WeakPool.Get())
+        {
+            Pool->ReleaseFrame(FrameBuffer);
+        }
+    });
+}
 
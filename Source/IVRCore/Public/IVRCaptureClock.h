@@ -0,0 +1,116 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/ThreadSafeCounter64.h"
+
+/**
+ * Relógio de captura compartilhado por todas as fontes de frames, sessões e encoders do IVR.
+ *
+ * - Monotônico e com resolução de nanossegundos (baseado em FPlatformTime::Cycles64), independente de
+ *   pausa do jogo, dilatação de tempo ou hitches do Game Thread.
+ * - Época única por processo: timestamps de fontes diferentes (render, webcam, vídeo...) são diretamente comparáveis,
+ *   o que permite alinhar gravações multi-câmera.
+ * - Mapeável para o tempo do mundo através de âncoras registradas pelo Game Thread (SyncWorldTime).
+ *
+ * A pausa é aplicada por sessão (FIVR_CaptureTimeline), para que pausar um take não congele as demais câmeras.
+ * Thread-safe.
+ */
+class IVRCORE_API FIVR_CaptureClock
+{
+public:
+    static constexpr int64 NanosecondsPerSecond = 1000000000ll;
+
+    /** Instância única do processo. */
+    static FIVR_CaptureClock& Get();
+
+    /** Nanossegundos decorridos desde a época do relógio (criação da instância). Nunca regride. */
+    int64 NowNs() const;
+
+    /** Converte nanossegundos do relógio para segundos. */
+    static double ToSeconds(int64 Nanoseconds) { return (double)Nanoseconds / (double)NanosecondsPerSecond; }
+
+    /** Converte segundos para nanossegundos do relógio. */
+    static int64 FromSeconds(double Seconds) { return (int64)(Seconds * (double)NanosecondsPerSecond); }
+
+    /**
+     * Registra a correspondência entre o instante atual do relógio e o tempo do mundo.
+     * Deve ser chamado pelo Game Thread (tipicamente a cada Tick de um componente de captura).
+     * @param WorldTimeSeconds UWorld::GetTimeSeconds() no instante da chamada.
+     * @param WorldTimeDilation Dilatação efetiva do mundo (0 se o jogo está pausado).
+     */
+    void SyncWorldTime(double WorldTimeSeconds, float WorldTimeDilation = 1.0f);
+
+    /**
+     * Converte um instante do relógio para o tempo do mundo, extrapolando a partir da última âncora.
+     * @return false se nenhuma âncora foi registrada ainda (OutWorldTimeSeconds fica inalterado).
+     */
+    bool MapToWorldSeconds(int64 CaptureTimeNs, double& OutWorldTimeSeconds) const;
+
+private:
+    FIVR_CaptureClock();
+
+    uint64 EpochCycles = 0;
+    uint64 CyclesPerSecond = 1;
+
+    mutable FCriticalSection AnchorLock;
+    bool bHasWorldAnchor = false;
+    int64 AnchorCaptureNs = 0;
+    double AnchorWorldSeconds = 0.0;
+    float AnchorTimeDilation = 1.0f;
+};
+
+/**
+ * Linha do tempo pausável de uma sessão sobre o FIVR_CaptureClock.
+ * O tempo da sessão é o tempo do relógio menos o tempo acumulado em pausa; durante a pausa ele fica congelado.
+ * Pause/Resume/Start devem ser chamados de uma única thread (Game Thread); as leituras são thread-safe.
+ */
+class IVRCORE_API FIVR_CaptureTimeline
+{
+public:
+    /** Zera a linha do tempo a partir do instante atual do relógio. */
+    void Start();
+
+    void Pause();
+    void Resume();
+    bool IsPaused() const { return PauseStartNs.GetValue() >= 0; }
+
+    /** Instante (no relógio de captura) em que a linha do tempo foi iniciada. */
+    int64 GetStartNs() const { return StartNs.GetValue(); }
+
+    /** Total de nanossegundos em pausa até agora (inclui a pausa corrente, se houver). */
+    int64 GetPausedNs() const;
+
+    /** Tempo decorrido na sessão, em nanossegundos, descontando as pausas. */
+    int64 GetElapsedNs() const;
+
+    /** Nanossegundos em pausa entre o Start e o instante informado (apenas o trecho das pausas anterior a ele). */
+    int64 GetPausedNsBefore(int64 CaptureTimeNs) const;
+
+    /**
+     * Converte um timestamp do relógio de captura para o domínio da sessão, descontando apenas as pausas
+     * ocorridas antes dele: um frame capturado antes de uma pausa e entregue depois não é deslocado por ela.
+     * O resultado continua no domínio do relógio compartilhado, de modo que sessões diferentes permanecem alinháveis.
+     */
+    int64 RemovePausedTime(int64 CaptureTimeNs) const { return CaptureTimeNs - GetPausedNsBefore(CaptureTimeNs); }
+
+private:
+    /** Pausa concluída, com o total em pausa acumulado antes do seu início (permite busca binária por instante). */
+    struct FPauseInterval
+    {
+        int64 BeginNs;
+        int64 EndNs;
+        int64 PausedBeforeNs;
+    };
+
+    FThreadSafeCounter64 StartNs;
+    FThreadSafeCounter64 AccumulatedPausedNs;
+    FThreadSafeCounter64 PauseStartNs{ -1 };
+
+    // Pausas concluídas desde o Start, em ordem cronológica.
+    mutable FCriticalSection IntervalsLock;
+    TArray<FPauseInterval> PauseIntervals;
+};
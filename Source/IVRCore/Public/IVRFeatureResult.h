@@ -0,0 +1,102 @@
+﻿// -------------------------------------------------------------------------------
+// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of WilliÃ¤m Wolff and protected by copywright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+// -------------------------------------------------------------------------------
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SharedPointer.h"
+#include "HAL/CriticalSection.h"
+#include "IVRTypes.h" // Para FIVR_JustRTFeatures
+
+/**
+ * @brief Resultado nativo da extração de features em estrutura de arrays (SoA, float32).
+ *        Cada array de pontos tem uma entrada por ponto de interesse; os histogramas são normalizados (0-1) e
+ *        quantizados em 16 bits. As instâncias vêm de um FIVR_FeatureResultPool e mantêm a memória entre frames:
+ *        em regime, preencher um resultado não aloca nada. FIVR_JustRTFeatures (Blueprint) só é montada sob demanda.
+ */
+struct IVRCORE_API FIVR_FeatureResult
+{
+    static constexpr int32 NumHistogramBins = 256;
+
+    // Pontos de interesse (quads e retângulos), em pixels do frame
+    TArray<float> PointX;
+    TArray<float> PointY;
+    TArray<float> SizeX;
+    TArray<float> SizeY;
+    TArray<float> Angle;
+    TArray<int32> TrackId;
+    TArray<uint8> IsQuad;
+    // Direção no mundo de cada ponto; a localização de todos é a da câmera (CameraLocation)
+    TArray<float> DirectionX;
+    TArray<float> DirectionY;
+    TArray<float> DirectionZ;
+    FVector3f CameraLocation = FVector3f::ZeroVector;
+
+    // Cantos da etapa Corners, em pixels do frame
+    TArray<float> CornerX;
+    TArray<float> CornerY;
+    TArray<int32> CornerIds;
+
+    // Histogramas normalizados (0-1) quantizados para 0-65535; só válidos com bHasHistograms
+    uint16 HistogramRed[NumHistogramBins];
+    uint16 HistogramGreen[NumHistogramBins];
+    uint16 HistogramBlue[NumHistogramBins];
+    bool bHasHistograms = false;
+
+    int32 BiggestPointIndex = INDEX_NONE;
+    int32 SmallerPointIndex = INDEX_NONE;
+    int32 NumOfQuads = 0;
+    int32 NumOfRectangles = 0;
+    bool bIsKeyframe = true;
+
+    // Tempo de cada etapa do grafo de visão neste frame (arrays paralelos)
+    TArray<FName> StageNames;
+    TArray<float> StageMilliseconds;
+
+    int32 NumPoints() const { return PointX.Num(); }
+    int32 NumCorners() const { return CornerX.Num(); }
+
+    /** Esvazia o resultado sem liberar a memória dos arrays. */
+    void Reset();
+
+    /** Redimensiona todos os arrays de pontos (conteúdo não inicializado), sem encolher a alocação. */
+    void SetNumPoints(int32 NumPoints);
+
+    /** Redimensiona os arrays de cantos (conteúdo não inicializado), sem encolher a alocação. */
+    void SetNumCorners(int32 NumCorners);
+
+    /** Grava um histograma normalizado (0-1, NumHistogramBins entradas) em 16 bits. */
+    static void QuantizeHistogram(const TArray<float>& Normalized, uint16* OutBins);
+
+    /** Monta a struct Blueprint equivalente (aloca os arrays de FIVR_JustRTFeatures). */
+    void ToBlueprint(FIVR_JustRTFeatures& OutFeatures) const;
+};
+
+/**
+ * @brief Pool thread-safe de FIVR_FeatureResult. O resultado volta ao pool quando a última referência
+ *        é destruída, em qualquer thread; se o pool já não existir, é simplesmente liberado.
+ *        Deve ser criado com MakeShared (o deleter guarda uma referência fraca ao pool).
+ */
+class IVRCORE_API FIVR_FeatureResultPool : public TSharedFromThis<FIVR_FeatureResultPool, ESPMode::ThreadSafe>
+{
+public:
+    /** @param InMaxFree Resultados livres mantidos no pool; os excedentes são liberados. */
+    explicit FIVR_FeatureResultPool(int32 InMaxFree = 8);
+    ~FIVR_FeatureResultPool();
+
+    /** Um resultado vazio (Reset), reaproveitado quando houver um livre. */
+    TSharedRef<FIVR_FeatureResult, ESPMode::ThreadSafe> Acquire();
+
+    /** Resultados criados pelo pool que ainda existem (livres ou em uso). */
+    int32 GetNumAllocated() const;
+
+private:
+    void Release(FIVR_FeatureResult* Result);
+
+    TArray<FIVR_FeatureResult*> FreeResults;
+    const int32 MaxFree;
+    int32 NumAllocated = 0;
+    mutable FCriticalSection Mutex;
+};
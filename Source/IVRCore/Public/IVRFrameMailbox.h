@@ -0,0 +1,72 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformAtomics.h"
+
+/**
+ * Caixa de correio de um único valor, "o mais recente vence", entre UM produtor e UM consumidor.
+ *
+ * Três slots circulam entre produtor, consumidor e uma posição intermediária trocada atomicamente:
+ * Publish e TakeLatest são uma única troca atômica cada, sem locks e sem alocação. Se o consumidor
+ * não buscou o valor anterior, Publish o devolve em OutStale (ex.: para voltar ao FramePool sem ser
+ * processado), então a latência nunca passa de um valor, por mais atrasado que o consumidor esteja.
+ */
+template<typename ValueType>
+class TIVR_LatestValueMailbox
+{
+public:
+    TIVR_LatestValueMailbox() = default;
+
+    /**
+     * Publica um novo valor (thread do produtor).
+     * @param OutStale Recebe o valor anterior não consumido, quando houver.
+     * @return true se um valor anterior foi descartado em OutStale.
+     */
+    bool Publish(ValueType&& Value, ValueType& OutStale)
+    {
+        Slots[ProducerSlot] = MoveTemp(Value);
+        const int32 Previous = FPlatformAtomics::InterlockedExchange(&Shared, ProducerSlot | FreshBit);
+        ProducerSlot = Previous & SlotMask;
+        if (Previous & FreshBit)
+        {
+            OutStale = MoveTemp(Slots[ProducerSlot]);
+            return true;
+        }
+        return false;
+    }
+
+    /** Retira o valor mais recente, se houver um novo desde a última chamada (thread do consumidor). */
+    bool TakeLatest(ValueType& OutValue)
+    {
+        if (!HasFreshValue())
+        {
+            return false;
+        }
+        // Só o consumidor limpa o FreshBit, então a troca sempre devolve o slot recém-publicado.
+        const int32 Previous = FPlatformAtomics::InterlockedExchange(&Shared, ConsumerSlot);
+        ConsumerSlot = Previous & SlotMask;
+        OutValue = MoveTemp(Slots[ConsumerSlot]);
+        return true;
+    }
+
+    bool HasFreshValue() const
+    {
+        return (FPlatformAtomics::AtomicRead(&Shared) & FreshBit) != 0;
+    }
+
+    // Não copiável (os slots pertencem a produtor/consumidor específicos)
+    TIVR_LatestValueMailbox(const TIVR_LatestValueMailbox&) = delete;
+    TIVR_LatestValueMailbox& operator=(const TIVR_LatestValueMailbox&) = delete;
+
+private:
+    static constexpr int32 SlotMask = 0x3;
+    static constexpr int32 FreshBit = 0x4;
+
+    ValueType Slots[3];
+    int32 ProducerSlot = 0;       // Só o produtor acessa
+    int32 ConsumerSlot = 1;       // Só o consumidor acessa
+    volatile int32 Shared = 2;    // Slot intermediário | FreshBit
+};
@@ -9,6 +9,7 @@
 #include "UObject/NoExportTypes.h"
 #include "Containers/Queue.h"
 #include "Templates/SharedPointer.h"
+#include "HAL/CriticalSection.h"
 #include "IVRTypes.h" // Para FIVR_VideoFrame e TArray<uint8>
 
 #include "IVRFramePool.generated.h"
@@ -44,6 +45,23 @@ public:
      */
     void ReleaseFrame(TSharedPtr<TArray<uint8>> FrameBuffer);
 
+    /**
+     * @brief NOVO: Marca um buffer como compartilhado por vários consumidores (fan-out de sinks).
+     *        Cada consumidor continua chamando ReleaseFrame uma vez; o buffer só volta ao pool na última chamada.
+     * @param FrameBuffer O buffer adquirido deste pool.
+     * @param NumConsumers Número total de consumidores que chamarão ReleaseFrame.
+     */
+    void ShareFrame(const TSharedPtr<TArray<uint8>>& FrameBuffer, int32 NumConsumers);
+
+    /**
+     * @brief NOVO: Transforma um buffer do pool em um payload imutável compartilhado.
+     *        O buffer volta ao pool (ReleaseFrame) quando a última referência ao payload é destruída, em qualquer thread.
+     *        Quem chama transfere sua referência do buffer e não deve mais escrever nele nem chamar ReleaseFrame.
+     * @param FrameBuffer O buffer adquirido deste pool.
+     * @return O payload somente leitura (inválido se FrameBuffer for inválido).
+     */
+    TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> MakeImmutablePayload(TSharedPtr<TArray<uint8>> FrameBuffer);
+
     /**
      * @brief Adquire um buffer de frame do pool. Se o pool estiver vazio, um novo buffer � criado.
      * @return Um TSharedPtr para um TArray<uint8> que representa o buffer do frame.
@@ -68,6 +86,16 @@ public:
 private:
 
     TQueue<TSharedPtr<TArray<uint8>>> FrameBufferPool;
+
+    // NOVO: Referências pendentes dos buffers compartilhados (ShareFrame). O TWeakPtr confirma a identidade
+    // do buffer, para que uma entrada antiga não seja confundida com outro buffer alocado no mesmo endereço.
+    struct FSharedFrameRefs
+    {
+        TWeakPtr<TArray<uint8>> Buffer;
+        int32 PendingReleases = 0;
+    };
+    TMap<const TArray<uint8>*, FSharedFrameRefs> SharedFrameRefs;
+    FCriticalSection SharedFrameRefsLock;
     int32 PoolSize;
     int32 FrameWidth;
     int32 FrameHeight;
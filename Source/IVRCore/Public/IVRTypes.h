@@ -18,6 +18,57 @@ enum class EIVRFrameSourceType : uint8
     VideoFile       UMETA(DisplayName = "Video File"),
     Webcam          UMETA(DisplayName = "Webcam")
 };
+// NOVO: Política de contrapressão (backpressure) aplicada quando a fila de gravação da sessão enche
+UENUM(BlueprintType)
+enum class EIVRBackpressurePolicy : uint8
+{
+    DropNewest          UMETA(DisplayName = "Drop Newest", ToolTip = "Descarta o frame que está chegando (menor latência, comportamento original)."),
+    DropOldest          UMETA(DisplayName = "Drop Oldest", ToolTip = "Descarta o frame mais antigo da fila para abrir espaço ao novo."),
+    BlockProducer       UMETA(DisplayName = "Block Producer", ToolTip = "Bloqueia o produtor até haver espaço ou o timeout expirar."),
+    DecimateHalfRate    UMETA(DisplayName = "Decimate To Half Rate", ToolTip = "Sob pressão, aceita apenas um a cada dois frames até a fila esvaziar."),
+    SpillToDisk         UMETA(DisplayName = "Spill To Disk", ToolTip = "Excesso de frames é despejado em disco e reenviado ao encoder depois. Com o arquivo cheio, o frame mais antigo da fila é descartado (FramesDroppedSpillFull); frames que não puderem ser lidos de volta (pool sem buffer livre ou erro de E/S) são perdidos (FramesLostFromSpill).")
+};
+// NOVO: Como a temporização dos frames chega ao muxer do FFmpeg
+UENUM(BlueprintType)
+enum class EIVRFrameTimingMode : uint8
+{
+    AssumeNominalFPS    UMETA(DisplayName = "Assume Nominal FPS (Legacy)", ToolTip = "Envia rawvideo com -r FPS: o FFmpeg assume 1/FPS entre frames (frames perdidos ou atrasados deslocam a linha do tempo)."),
+    ConstantFrameRate   UMETA(DisplayName = "Constant Frame Rate", ToolTip = "Envia os timestamps reais e o FFmpeg duplica/descarta frames contra o relógio nominal (saída CFR no FPS configurado)."),
+    VariableFrameRate   UMETA(DisplayName = "Variable Frame Rate", ToolTip = "Envia e preserva os timestamps reais de cada frame (saída VFR).")
+};
+// NOVO: Modo de gravação da sessão (codificação ao vivo ou captura bruta para codificação posterior)
+UENUM(BlueprintType)
+enum class EIVRRecordingMode : uint8
+{
+    LiveEncode          UMETA(DisplayName = "Live Encode", ToolTip = "Os frames são codificados pelo FFmpeg durante a captura (comportamento original)."),
+    RawCapture          UMETA(DisplayName = "Raw Capture (Encode Later)", ToolTip = "Os frames são gravados sem codificação em um container .ivrraw e codificados depois da sessão.")
+};
+// NOVO: Como as fontes com worker (Webcam, VideoFile) entregam os frames à Game Thread
+UENUM(BlueprintType)
+enum class EIVRFrameDeliveryMode : uint8
+{
+    Auto                UMETA(DisplayName = "Auto", ToolTip = "Latest Frame Wins quando a saída em tempo real está ativa sem gravação; All Frames nos demais casos."),
+    AllFrames           UMETA(DisplayName = "All Frames", ToolTip = "Todos os frames capturados são entregues, em ordem (comportamento original)."),
+    LatestFrameWins     UMETA(DisplayName = "Latest Frame Wins", ToolTip = "Só o frame mais recente é entregue; frames que ficaram velhos voltam ao pool sem serem processados. Latência de no máximo um frame.")
+};
+// NOVO: Etapas da extração de features em tempo real (máscara de bits; só as etapas pedidas rodam)
+UENUM(BlueprintType, Meta = (Bitflags, UseEnumValuesAsMaskValuesInEditor = "true"))
+enum class EIVRFeatureStage : uint8
+{
+    None                = 0 UMETA(Hidden),
+    Corners             = 1 << 0 UMETA(DisplayName = "Corners", ToolTip = "Cantos da goodFeaturesToTrack (FIVR_JustRTFeatures::Corners)."),
+    Quads               = 1 << 1 UMETA(DisplayName = "Quads / Rectangles", ToolTip = "Limiar adaptativo e contornos: quadrados e retângulos como pontos de interesse."),
+    Histograms          = 1 << 2 UMETA(DisplayName = "Histograms", ToolTip = "Histogramas normalizados dos canais R, G e B.")
+};
+ENUM_CLASS_FLAGS(EIVRFeatureStage)
+// NOVO: Canal pelo qual os frames chegam ao FFmpeg
+UENUM(BlueprintType)
+enum class EIVRFrameTransport : uint8
+{
+    NamedPipe           UMETA(DisplayName = "Named Pipe / FIFO", ToolTip = "Named Pipe no Windows, FIFO em Saved/IVRTemporaryPipes no Linux/Mac (comportamento original)."),
+    StdinPipe           UMETA(DisplayName = "Anonymous Pipe (stdin)", ToolTip = "Pipe anônimo entregue como stdin do FFmpeg (-i pipe:0). Windows e Linux; no Mac usa o Named Pipe."),
+    UnixSocket          UMETA(DisplayName = "Unix Domain Socket", ToolTip = "Socket Unix com SO_SNDBUF ajustado ao tamanho do frame (-i unix:...). Linux e Mac; no Windows usa o Named Pipe.")
+};
 USTRUCT(BlueprintType)
 struct IVRCORE_API FIVR_VideoSettings
 {
@@ -46,6 +97,18 @@ struct IVRCORE_API FIVR_VideoSettings
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|JustRTCapture",
         meta = (DisplayName = "Enable Real-Time Frame Output", ToolTip = "Quando verdadeiro, os frames capturados são disponibilizados em tempo real via delegate, em vez de serem enviados para gravação FFmpeg. Ideal para integração com UI ou manipulação de pixels."))
     bool bEnableRTFrames = false;
+    // NOVO: Grava em paralelo à saída em tempo real (os frames são distribuídos para os dois sinks)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|JustRTCapture",
+        meta = (DisplayName = "Record Alongside Real-Time Output", EditCondition = "bEnableRTFrames", EditConditionHides, ToolTip = "Quando verdadeiro, os frames também são enviados para a sessão de gravação enquanto a saída em tempo real está ativa. Cada consumidor roda em sua própria fila, então um não atrasa o outro."))
+    bool IVR_RecordAlongsideRealTime = false;
+    // NOVO: Entrega coalescida para consumidores em tempo real
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|JustRTCapture",
+        meta = (DisplayName = "Frame Delivery Mode", ToolTip = "Como as fontes Webcam e VideoFile entregam frames. Latest Frame Wins mantém a latência em um frame quando o consumidor atrasa, descartando os frames velhos."))
+    EIVRFrameDeliveryMode IVR_FrameDeliveryMode = EIVRFrameDeliveryMode::Auto;
+    // NOVO: Threads dedicadas à extração de features em tempo real
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|JustRTCapture",
+        meta = (DisplayName = "Feature Worker Threads", EditCondition = "bEnableRTFrames", EditConditionHides, ClampMin = "1", ClampMax = "8", UIMin = "1", UIMax = "8", ToolTip = "Número de threads do pool que extrai features dos frames em tempo real. Os resultados são entregues na Game Thread na ordem de captura; com todas as threads ocupadas, apenas o frame mais recente espera."))
+    int32 IVR_FeatureWorkerCount = 2;
 // NOVO: Ator a ser seguido pela câmera
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Camera Follow")
     class AActor* IVR_FollowActor = nullptr;
@@ -106,8 +169,12 @@ struct IVRCORE_API FIVR_VideoSettings
     bool IVR_UseRandomPattern = true;
 // --- NOVOS PARÂMETROS PARA FEATURE EXTRACTION ---
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Feature Extraction",
-        meta = (DisplayName = "Enable Debug Draw Features", ToolTip = "Se verdadeiro, desenha caixas de detecção na saída de vídeo em tempo real."))
+        meta = (DisplayName = "Enable Debug Draw Features", ToolTip = "Se verdadeiro, desenha caixas de detecção e cantos na textura de preview em tempo real (a etapa Corners é ligada automaticamente). Os pixels entregues aos listeners não são alterados."))
     bool IVR_DebugDrawFeatures = false;
+    // NOVO: Etapas de extração executadas a cada frame
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Feature Extraction",
+        meta = (DisplayName = "Feature Stages", Bitmask, BitmaskEnum = "/Script/IVRCore.EIVRFeatureStage", ToolTip = "Etapas de extração executadas em cada frame em tempo real. Desmarque as que ninguém consome: um consumidor só de histogramas não paga pela análise de contornos."))
+    int32 IVR_FeatureStages = (int32)(EIVRFeatureStage::Quads | EIVRFeatureStage::Histograms);
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Feature Extraction",
         meta = (DisplayName = "Max Corners (goodFeaturesToTrack)", ClampMin = "1", UIMin = "1", ToolTip = "Número máximo de cantos a serem detectados pela goodFeaturesToTrack."))
     int32 IVR_GFTT_MaxCorners = 100;
@@ -117,6 +184,48 @@ struct IVRCORE_API FIVR_VideoSettings
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Feature Extraction",
         meta = (DisplayName = "Min Distance (goodFeaturesToTrack)", ClampMin = "1", UIMin = "1", ToolTip = "Distância euclidiana mínima entre os cantos detectados."))
     float IVR_GFTT_MinDistance = 10.0f;
+    // NOVO: Subamostragem dos histogramas
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Feature Extraction",
+        meta = (DisplayName = "Histogram Subsample", ClampMin = "1", ClampMax = "8", UIMin = "1", UIMax = "8", ToolTip = "Passo de amostragem em linhas e colunas dos histogramas (1 = todos os pixels, 2 = um pixel a cada bloco 2x2). Os histogramas são normalizados, então a forma se mantém com menos leituras."))
+    int32 IVR_HistogramSubsample = 1;
+    // NOVO: Pirâmide de detecção (Corners e Quads rodam sobre uma imagem reduzida)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Feature Extraction",
+        meta = (DisplayName = "Detection Pyramid Level", ClampMin = "0", ClampMax = "4", UIMin = "0", UIMax = "4", ToolTip = "Nível da pirâmide em que cantos e quads são detectados: 0 = resolução cheia, cada nível reduz a imagem pela metade (média por área). As coordenadas voltam para a resolução do frame."))
+    int32 IVR_FeaturePyramidLevel = 0;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Feature Extraction",
+        meta = (DisplayName = "Max Detection Width", ClampMin = "0", UIMin = "0", ToolTip = "Se maior que zero, sobe o nível da pirâmide até a imagem de detecção ter no máximo esta largura (ex.: 960). Mantém a latência das features quase independente da resolução de captura."))
+    int32 IVR_FeatureDetectionMaxWidth = 0;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Feature Extraction",
+        meta = (DisplayName = "Refine Corners At Full Resolution", ToolTip = "Com a pirâmide ativa, refina a posição de cada canto (subpixel) na imagem em resolução cheia."))
+    bool IVR_RefineCornersAtFullResolution = false;
+    // NOVO: Rastreamento temporal (detecta em keyframes, acompanha com optical flow nos demais frames)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Feature Extraction",
+        meta = (DisplayName = "Enable Feature Tracking", ToolTip = "Detecta cantos e quads só em keyframes e os acompanha com Lucas-Kanade nos frames seguintes. Cada ponto ganha um TrackId estável. Exige frames em ordem: o pool de features passa a usar um único worker."))
+    bool IVR_EnableFeatureTracking = false;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Feature Extraction",
+        meta = (DisplayName = "Tracking Keyframe Interval", ClampMin = "1", ClampMax = "120", UIMin = "1", UIMax = "120", EditCondition = "IVR_EnableFeatureTracking", ToolTip = "Número máximo de frames rastreados entre duas detecções completas."))
+    int32 IVR_TrackingKeyframeInterval = 15;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Feature Extraction",
+        meta = (DisplayName = "Tracking Min Survival Ratio", ClampMin = "0.0", ClampMax = "1.0", UIMin = "0.0", UIMax = "1.0", EditCondition = "IVR_EnableFeatureTracking", ToolTip = "Fração das trilhas do último keyframe que precisa sobreviver; abaixo dela um novo keyframe é forçado."))
+    float IVR_TrackingMinSurvivalRatio = 0.5f;
+    // NOVO: Regiões de interesse (o custo da extração acompanha a área das regiões, não a do frame)
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Feature Extraction",
+        meta = (DisplayName = "Feature Regions (Normalized)", ToolTip = "Retângulos onde as features são extraídas, em coordenadas normalizadas do frame (0-1, origem no canto superior esquerdo). Vazio (e sem ator de região) = frame inteiro."))
+    TArray<FBox2D> IVR_FeatureRegions;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Feature Extraction",
+        meta = (DisplayName = "Feature Region Actor", ToolTip = "Se definido, os limites deste ator projetados na câmera de captura viram mais uma região de interesse, atualizada a cada frame. Fora da visão da câmera, nada é extraído dele."))
+    class AActor* IVR_FeatureRegionActor = nullptr;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Feature Extraction",
+        meta = (DisplayName = "Feature Region Actor Padding", ClampMin = "0", UIMin = "0", UIMax = "256", ToolTip = "Margem em pixels adicionada em volta da projeção do ator."))
+    int32 IVR_FeatureRegionActorPadding = 16;
+    // NOVO: Cache de resultados por conteúdo do frame
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Feature Extraction",
+        meta = (DisplayName = "Feature Cache Size", ClampMin = "0", ClampMax = "256", UIMin = "0", UIMax = "64", ToolTip = "Quantos resultados de extração guardar, indexados pelo hash dos pixels e pelos parâmetros. Um frame idêntico (loop de pasta, frames simulados) pula a extração. Usado só com as fontes Folder e Simulated; nas demais o hash por frame não compensa. 0 desativa. Não se aplica com rastreamento."))
+    int32 IVR_FeatureCacheSize = 8;
+    // NOVO: Conversão das features para a struct Blueprint
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Feature Extraction",
+        meta = (DisplayName = "Expand Features For Blueprint", ToolTip = "Se verdadeiro, cada frame em tempo real já chega com Features preenchida (arrays alocados por frame). Desative quando os consumidores usam Get Frame Features sob demanda ou o resultado nativo (FeatureResult) em C++."))
+    bool IVR_ExpandFeaturesForBlueprint = true;
     // --- INÍCIO DA ALTERAÇÃO: NOVAS PROPRIEDADES PARA CUSTOMIZAÇÃO DE NOME DE ARQUIVO ---
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Output",
               meta = (DisplayName = "Custom Output Folder Name", ToolTip = "Nome de uma subpasta opcional dentro de Project/Saved/Recordings. Deixe vazio para usar a pasta padrão 'Recordings'."))
@@ -125,6 +234,115 @@ struct IVRCORE_API FIVR_VideoSettings
               meta = (DisplayName = "Custom Output Base Filename", ToolTip = "Nome base opcional para o arquivo de saída (sem extensão). Será combinado com timestamp e ID de sessão. Deixe vazio para o padrão com timestamp."))
     FString IVR_CustomOutputBaseFilename;
     // --- FIM DA ALTERAÇÃO ---
+    // --- INÍCIO DA ALTERAÇÃO: POLÍTICAS DE BACKPRESSURE DA FILA DE GRAVAÇÃO ---
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Backpressure",
+              meta = (DisplayName = "Backpressure Policy", EditCondition = "!bEnableRTFrames || IVR_RecordAlongsideRealTime", ToolTip = "Como a sessão reage quando o encoder não acompanha a taxa de captura e a fila de gravação enche."))
+    EIVRBackpressurePolicy IVR_BackpressurePolicy = EIVRBackpressurePolicy::DropNewest;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Backpressure",
+              meta = (DisplayName = "Queue Capacity (Seconds)", ClampMin = "0.1", UIMin = "0.1", EditCondition = "!bEnableRTFrames || IVR_RecordAlongsideRealTime", ToolTip = "Capacidade da fila de gravação em segundos de vídeo (multiplicado pelo FPS)."))
+    float IVR_QueueCapacitySeconds = 1.0f;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Backpressure",
+              meta = (DisplayName = "Block Timeout (ms)", ClampMin = "1", UIMin = "1", EditCondition = "IVR_BackpressurePolicy == EIVRBackpressurePolicy::BlockProducer", EditConditionHides, ToolTip = "Tempo máximo que o produtor fica bloqueado esperando espaço na fila antes de descartar o frame."))
+    int32 IVR_BlockTimeoutMs = 50;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Backpressure",
+              meta = (DisplayName = "Spill Capacity (Seconds)", ClampMin = "0.5", UIMin = "0.5", EditCondition = "IVR_BackpressurePolicy == EIVRBackpressurePolicy::SpillToDisk", EditConditionHides, ToolTip = "Capacidade do arquivo de spill em segundos de vídeo não comprimido. Ignorado se 'Spill Capacity (GB)' for maior que zero."))
+    float IVR_SpillCapacitySeconds = 10.0f;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Backpressure",
+              meta = (DisplayName = "Spill Capacity (GB)", ClampMin = "0.0", UIMin = "0.0", EditCondition = "IVR_BackpressurePolicy == EIVRBackpressurePolicy::SpillToDisk", EditConditionHides, ToolTip = "Capacidade do arquivo de spill em gigabytes. Zero usa a capacidade em segundos."))
+    float IVR_SpillCapacityGB = 0.0f;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Backpressure",
+              meta = (DisplayName = "Compress Spill (LZ4)", EditCondition = "IVR_BackpressurePolicy == EIVRBackpressurePolicy::SpillToDisk", EditConditionHides, ToolTip = "Comprime os frames despejados em disco com LZ4. Reduz E/S e espaço ao custo de CPU."))
+    bool IVR_SpillCompressLZ4 = false;
+    // --- FIM DA ALTERAÇÃO ---
+    // --- INÍCIO DA ALTERAÇÃO: TEMPORIZAÇÃO DOS FRAMES (CFR/VFR) ---
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Timing",
+              meta = (DisplayName = "Frame Timing Mode", ToolTip = "Como os timestamps dos frames chegam ao FFmpeg. CFR/VFR enviam os frames em Matroska pelo pipe, cada um com seu timestamp."))
+    EIVRFrameTimingMode IVR_FrameTimingMode = EIVRFrameTimingMode::ConstantFrameRate;
+    // --- FIM DA ALTERAÇÃO ---
+    // --- INÍCIO DA ALTERAÇÃO: CAPTURA BRUTA (CAPTURE-NOW / ENCODE-LATER) ---
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Raw Capture",
+              meta = (DisplayName = "Recording Mode", EditCondition = "!bEnableRTFrames || IVR_RecordAlongsideRealTime", ToolTip = "LiveEncode codifica durante a captura. RawCapture grava os frames BGRA em um container .ivrraw (limitado apenas pela banda do disco) e codifica depois."))
+    EIVRRecordingMode IVR_RecordingMode = EIVRRecordingMode::LiveEncode;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Raw Capture",
+              meta = (DisplayName = "Compress Raw Frames (LZ4)", EditCondition = "IVR_RecordingMode == EIVRRecordingMode::RawCapture", EditConditionHides, ToolTip = "Comprime cada frame do container .ivrraw com LZ4. Reduz a banda de disco ao custo de CPU."))
+    bool IVR_RawCompressLZ4 = false;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Raw Capture",
+              meta = (DisplayName = "Encode Raw On Stop", EditCondition = "IVR_RecordingMode == EIVRRecordingMode::RawCapture", EditConditionHides, ToolTip = "Se verdadeiro, o container .ivrraw é codificado para o take .mp4 em segundo plano ao parar a sessão (UIVRRecordingSession::OnRawEncodeFinished avisa o término). Se falso, o .ivrraw é mantido para codificação posterior (UIVRVideoEncoder::EncodeRawContainer)."))
+    bool IVR_EncodeRawOnStop = true;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Raw Capture",
+              meta = (DisplayName = "Keep Raw After Encode", EditCondition = "IVR_RecordingMode == EIVRRecordingMode::RawCapture && IVR_EncodeRawOnStop", EditConditionHides, ToolTip = "Mantém o container .ivrraw no disco depois de codificado com sucesso."))
+    bool IVR_KeepRawAfterEncode = false;
+    // --- FIM DA ALTERAÇÃO ---
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Transport",
+              meta = (DisplayName = "Frame Transport", ToolTip = "Canal usado para enviar os frames ao FFmpeg. Use UIVRGlobalStatics::RunFrameTransportBenchmark para escolher o mais rápido na plataforma."))
+    EIVRFrameTransport IVR_FrameTransport = EIVRFrameTransport::NamedPipe;
+    // --- INÍCIO DA ALTERAÇÃO: ANEL DE FRAMES EM MEMÓRIA COMPARTILHADA ---
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Shared Memory",
+              meta = (DisplayName = "Publish Shared Memory Ring", ToolTip = "Publica cada frame capturado em um anel de memória compartilhada para consumidores locais externos (ver IVR_SharedFrameRingABI.h). Leitores lentos perdem frames; a captura nunca espera por eles."))
+    bool IVR_PublishSharedRing = false;
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Shared Memory",
+              meta = (DisplayName = "Shared Ring Name", EditCondition = "IVR_PublishSharedRing", EditConditionHides, ToolTip = "Nome do anel. Os leitores anexam em '/IVR_<nome>' (POSIX shm) ou no file mapping 'IVR_<nome>' do namespace Local (Windows)."))
+    FString IVR_SharedRingName = TEXT("IVRFrames");
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "IVR|Video Settings|Shared Memory",
+              meta = (DisplayName = "Shared Ring Slots", ClampMin = "2", ClampMax = "64", UIMin = "2", UIMax = "16", EditCondition = "IVR_PublishSharedRing", EditConditionHides, ToolTip = "Número de frames mantidos no anel. Mais slots dão mais folga aos leitores às custas de memória."))
+    int32 IVR_SharedRingSlots = 4;
+    // --- FIM DA ALTERAÇÃO ---
+
+    /** Resolve IVR_FrameDeliveryMode: verdadeiro se as fontes devem entregar apenas o frame mais recente. */
+    bool UsesLatestFrameDelivery() const
+    {
+        if (IVR_FrameDeliveryMode == EIVRFrameDeliveryMode::Auto)
+        {
+            return bEnableRTFrames && !IVR_RecordAlongsideRealTime;
+        }
+        return IVR_FrameDeliveryMode == EIVRFrameDeliveryMode::LatestFrameWins;
+    }
+};
+
+// NOVO: Contadores de backpressure por política, expostos pela sessão de gravação
+USTRUCT(BlueprintType)
+struct IVRCORE_API FIVR_BackpressureStats
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Backpressure")
+    int32 FramesAccepted = 0; // Frames aceitos na fila de gravação
+
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Backpressure")
+    int32 FramesDroppedNewest = 0; // Descartados na chegada (DropNewest ou fila cheia durante a dizimação)
+
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Backpressure")
+    int32 FramesDroppedOldest = 0; // Descartados do início da fila (DropOldest)
+
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Backpressure")
+    int32 ProducerBlocks = 0; // Quantas vezes o produtor precisou esperar (BlockProducer)
+
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Backpressure")
+    int32 BlockTimeouts = 0; // Esperas que expiraram e descartaram o frame (BlockProducer)
+
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Backpressure")
+    int32 FramesDecimated = 0; // Frames pulados pela dizimação para meia taxa
+
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Backpressure")
+    int32 FramesSpilled = 0; // Frames despejados em disco (SpillToDisk)
+
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Backpressure")
+    int32 FramesRestoredFromSpill = 0; // Frames lidos de volta do disco e entregues ao encoder (SpillToDisk)
+
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Backpressure")
+    int32 FramesDroppedSpillFull = 0; // Descartados do início da fila porque o arquivo de spill estava cheio (ou falhou a escrita)
+
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Backpressure")
+    int32 FramesLostFromSpill = 0; // Gravados no spill mas não entregues: pool sem buffer livre, erro de leitura ou sessão encerrada
+
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Backpressure")
+    int32 FramesDroppedAfterFinish = 0; // Recusados pelo encoder após o sinal de fim de codificação
+
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Backpressure")
+    int32 DropBursts = 0; // Número de rajadas de descarte (cada uma dispara o delegate uma vez)
+
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Backpressure")
+    int32 PeakQueueDepth = 0; // Maior profundidade de fila observada
 };
 
 // ... (Restante do arquivo IVRTypes.h permanece inalterado) ...
@@ -149,6 +367,8 @@ struct IVRCORE_API FIVR_JustRTPoint
     float Angle; // Orientação em graus (para quads/retângulos)
     UPROPERTY(BlueprintReadOnly, Category = "IVR|Features|Point")
     bool IsQuad; // True se for quadrado (ou próximo disso), false se for retângulo
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Features|Point")
+    int32 TrackId; // NOVO: Identidade estável entre frames (IVR_EnableFeatureTracking); INDEX_NONE sem rastreamento
 
     // NOVO: Construtor padrão para inicializar todas as propriedades
     FIVR_JustRTPoint()
@@ -158,6 +378,7 @@ struct IVRCORE_API FIVR_JustRTPoint
         , Size2D(FVector2D::ZeroVector)
         , Angle(0.0f)
         , IsQuad(false)
+        , TrackId(INDEX_NONE)
     {}
 };
 // NOVO: Estrutura para encapsular todas as características extraídas
@@ -188,6 +409,19 @@ struct IVRCORE_API FIVR_JustRTFeatures
     UPROPERTY(BlueprintReadOnly, Category = "IVR|Features")
     TArray<float> HistogramBlue; // Histograma normalizado (0-1) do canal Azul
 
+    // NOVO: Cantos da goodFeaturesToTrack, em pixels do frame (só preenchido com a etapa Corners)
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Features")
+    TArray<FVector2D> Corners;
+    // NOVO: TrackId de cada canto de Corners (só com IVR_EnableFeatureTracking)
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Features")
+    TArray<int32> CornerIds;
+    // NOVO: Falso quando cantos e quads vieram do rastreamento entre keyframes, sem nova detecção
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Features")
+    bool bIsKeyframe = true;
+    // NOVO: Tempo de cada etapa do grafo de visão neste frame, em ms (vazio quando o resultado veio do cache)
+    UPROPERTY(BlueprintReadOnly, Category = "IVR|Features")
+    TMap<FName, float> StageMilliseconds;
+
     // NOVO: Construtor padrão para inicializar todas as propriedades
     FIVR_JustRTFeatures()
         : BiggestPointIndex(INDEX_NONE)
@@ -199,6 +433,8 @@ struct IVRCORE_API FIVR_JustRTFeatures
 
 
 // Estrutura para os dados de saída de frames em tempo real
+struct FIVR_FeatureResult; // IVRFeatureResult.h
+
 USTRUCT(BlueprintType)
 struct IVRCORE_API FIVR_JustRTFrame
 {
@@ -210,9 +446,10 @@ struct IVRCORE_API FIVR_JustRTFrame
     UPROPERTY(BlueprintReadOnly, Category = "JustRTFrame Output")
     UTexture2D* LiveTexture = nullptr; // Inicializado para nullptr
 
-    // Dados brutos de pixel do frame (BGRA).
-    UPROPERTY(BlueprintReadOnly, Category = "JustRTFrame Output")
-    TArray<uint8> RawDataBuffer; 
+    // NOVO: Dados brutos de pixel do frame (BGRA), compartilhados e imutáveis. Um único buffer do pool serve
+    // a extração de features, o upload da textura e todos os listeners; copiar a struct só copia a referência.
+    // Sem UPROPERTY: Blueprint acessa os pixels sob demanda via UIVRGlobalStatics (GetJustRTFramePixels/GetJustRTFramePixelColor).
+    TSharedPtr<const TArray<uint8>, ESPMode::ThreadSafe> PixelData;
 
     UPROPERTY(BlueprintReadOnly, Category = "JustRTFrame Output")
     int32 Width = 0;
@@ -231,6 +468,11 @@ struct IVRCORE_API FIVR_JustRTFrame
     UPROPERTY(BlueprintReadOnly, Category = "JustRTFrame Output")
     FIVR_JustRTFeatures Features; // O construtor padrão de FIVR_JustRTFeatures já a inicializará
 
+    // NOVO: Resultado nativo das features (SoA, float32, de um pool), compartilhado e imutável. Features só é
+    // preenchida com IVR_ExpandFeaturesForBlueprint; sem ela, Blueprint monta a struct sob demanda via
+    // UIVRGlobalStatics::GetJustRTFrameFeatures.
+    TSharedPtr<const FIVR_FeatureResult, ESPMode::ThreadSafe> FeatureResult;
+
     // NOVO: Construtor padrão para inicializar todas as propriedades
     FIVR_JustRTFrame()
         : RenderTarget(nullptr)
@@ -241,6 +483,16 @@ struct IVRCORE_API FIVR_JustRTFrame
         , DisplayTint(FLinearColor::White)
         , SourceFrameTint(FLinearColor::White)
     {}
+
+    /** Verdadeiro se o frame carrega pixels. */
+    bool HasPixelData() const { return PixelData.IsValid() && PixelData->Num() > 0; }
+
+    /** Pixels BGRA do frame (array vazio se não houver payload). A referência vale enquanto a struct existir. */
+    const TArray<uint8>& GetPixelData() const
+    {
+        static const TArray<uint8> EmptyPixelData;
+        return PixelData.IsValid() ? *PixelData : EmptyPixelData;
+    }
 };
 
 
@@ -290,21 +542,32 @@ struct IVRCORE_API FIVR_VideoFrame
 
     int32 Height; // Height of the frame
 
-    float Timestamp; // Time when the frame was generated/captured (in seconds)
+    float Timestamp; // Time when the frame was generated/captured (in seconds, derived from TimestampNs)
+
+    int64 TimestampNs; // NOVO: Instante da captura no FIVR_CaptureClock (nanossegundos). Fonte de verdade da temporização.
 
     // Construtor padrão
     FIVR_VideoFrame()
         : Width(0)
         , Height(0)
         , Timestamp(0.0f)
+        , TimestampNs(0)
     {}
 
-    // Construtor para facilitar a criação
-    FIVR_VideoFrame(int32 InWidth, int32 InHeight, float InTimestamp)
+    // Construtor para facilitar a criação. InTimestampNs deve vir de FIVR_CaptureClock::Get().NowNs().
+    FIVR_VideoFrame(int32 InWidth, int32 InHeight, int64 InTimestampNs)
         : Width(InWidth)
         , Height(InHeight)
-        , Timestamp(InTimestamp)
+        , Timestamp((float)(InTimestampNs / 1.0e9))
+        , TimestampNs(InTimestampNs)
     {}
+
+    // Atualiza o timestamp mantendo os dois campos coerentes.
+    void SetTimestampNs(int64 InTimestampNs)
+    {
+        TimestampNs = InTimestampNs;
+        Timestamp = (float)(InTimestampNs / 1.0e9);
+    }
 };
 
 /**
@@ -359,6 +622,18 @@ struct IVRCORE_API FIVR_PipeSettings
      */
     int32 InBufferSize = 65536; // 64 KB
 
+    /**
+     * NOVO (Linux): escreve os frames com vmsplice, mapeando as páginas do buffer no pipe em vez de copiá-las.
+     * Os buffers só voltam ao pool depois que o leitor (FFmpeg) os consome. Ignorado nas demais plataformas.
+     */
+    bool bUseZeroCopySplice = true;
+
+    /**
+     * NOVO: Tempo máximo (segundos) que Connect() espera o FFmpeg abrir o FIFO/socket.
+     * Se o FFmpeg morrer antes de conectar, o worker desiste em vez de bloquear para sempre.
+     */
+    float ConnectTimeoutSeconds = 10.0f;
+
     // NOVO: Construtor padrão para inicializar todas as propriedades
     FIVR_PipeSettings()
         : BasePipeName(TEXT("UnrealRecordingPipe"))
@@ -11,7 +11,7 @@ DEFINE_LOG_CATEGORY(LogIVRVideoEncoderWorker); // Se quiser um LogCategory separ
 // =====================================================================================
 // FVideoEncoderWorker Implementation
 // =====================================================================================
-FVideoEncoderWorker::FVideoEncoderWorker(UIVRVideoEncoder* InEncoder, TQueue<FIVR_VideoFrame, EQueueMode::Mpsc>& InFrameQueue, FIVR_PipeWrapper& InVideoInputPipe, FThreadSafeBool& InStopFlag, FThreadSafeBool& InNoMoreFramesFlag, FEvent* InNewFrameEvent, UIVRFramePool* InFramePool)
+FVideoEncoderWorker::FVideoEncoderWorker(UIVRVideoEncoder* InEncoder, TQueue<FIVR_VideoFrame, EQueueMode::Mpsc>& InFrameQueue, IIVR_FrameTransport& InVideoInputPipe, FThreadSafeBool& InStopFlag, FThreadSafeBool& InNoMoreFramesFlag, FEvent* InNewFrameEvent, UIVRFramePool* InFramePool, FThreadSafeCounter& InPendingFrameCount, FIVR_MatroskaPipeMuxer* InStreamMuxer)
     : Encoder(InEncoder)
     , FrameQueue(InFrameQueue)
     , VideoInputPipe(InVideoInputPipe)
@@ -19,6 +19,8 @@ FVideoEncoderWorker::FVideoEncoderWorker(UIVRVideoEncoder* InEncoder, TQueue<FIV
     , bNoMoreFramesToEncode(InNoMoreFramesFlag)
     , NewFrameEvent(InNewFrameEvent)
     , FramePool(InFramePool) 
+    , PendingFrameCount(InPendingFrameCount)
+    , StreamMuxer(InStreamMuxer)
 {
 }
 FVideoEncoderWorker::~FVideoEncoderWorker()
@@ -45,60 +47,190 @@ uint32 FVideoEncoderWorker::Run()
         return 1; // Retorna com erro
     }
     UE_LOG(LogIVRVideoEncoderWorker, Log, TEXT("FVideoEncoderWorker: Video input pipe successfully connected."));
+    // CFR/VFR: o cabeçalho Matroska precede o primeiro frame.
+    if (StreamMuxer)
+    {
+        StreamMuxer->ResetTimeline();
+        const TArray<uint8>& StreamHeader = StreamMuxer->GetStreamHeader();
+        if (VideoInputPipe.Write(StreamHeader.GetData(), StreamHeader.Num()) != StreamHeader.Num())
+        {
+            UE_LOG(LogIVRVideoEncoderWorker, Error, TEXT("FVideoEncoderWorker: Failed to write Matroska stream header. Signaling worker to stop."));
+            bShouldStop.AtomicSet(true);
+            return 1;
+        }
+    }
+    
+    // Linux: os payloads vão por vmsplice e os buffers só voltam ao pool após o FFmpeg lê-los.
+    bZeroCopy = VideoInputPipe.IsZeroCopyEnabled();
+    if (bZeroCopy)
+    {
+        UE_LOG(LogIVRVideoEncoderWorker, Log, TEXT("FVideoEncoderWorker: Zero-copy (vmsplice) enabled. Pipe buffer: %d bytes."), VideoInputPipe.GetPipeCapacity());
+    }
+    Batch.Reserve(MaxBatchFrames);
+    BatchSpans.Reserve(MaxBatchFrames * 2);
     
-    FIVR_VideoFrame CurrentFrame; // Vai receber o frame do tipo FIVR_VideoFrame (com TSharedPtr)
     while (!bShouldStop) 
     {
-        while (FrameQueue.Dequeue(CurrentFrame)) // Dequeue de FIVR_VideoFrame
+        ReclaimConsumedBuffers();
+        bIsWritingFrame.AtomicSet(true); // Marcado antes do Dequeue: a fila pode ficar vazia com um frame ainda em trânsito
+        while (!bShouldStop && DequeueBatch())
         {
-            if (bShouldStop) 
+            // UE_LOG(LogIVRVideoEncoder, Warning, TEXT("Video Encoder Worker: Attempting to write %d frame(s) to pipe."), Batch.Num()); // Descomente para debug intenso.
+            const bool bBatchWritten = WriteBatch();
+            if (!bBatchWritten)
             {
-                // Se o thread foi sinalizado para parar, libera o frame atual antes de sair.
-                if (FramePool && CurrentFrame.RawDataPtr.IsValid())
-                {
-                    FramePool->ReleaseFrame(CurrentFrame.RawDataPtr);
-                }
-                break; 
+                UE_LOG(LogIVRVideoEncoderWorker, Error, TEXT("Failed to write video frame to pipe. Pipe may be closed or in error state. Signalling worker stop."));
+                bShouldStop.AtomicSet(true); 
             }
-            
-            // Acessa os dados do buffer via RawDataPtr
-            if (!CurrentFrame.RawDataPtr.IsValid() || CurrentFrame.RawDataPtr->Num() == 0)
+            const int64 BatchEndOffset = VideoInputPipe.GetTotalBytesWritten();
+            for (FIVR_VideoFrame& Frame : Batch)
             {
-                UE_LOG(LogIVRVideoEncoderWorker, Error, TEXT("Video Encoder Worker: Received invalid or empty frame buffer. Dropping frame."));
-                if (FramePool && CurrentFrame.RawDataPtr.IsValid())
+                if (bZeroCopy && bBatchWritten)
                 {
-                    FramePool->ReleaseFrame(CurrentFrame.RawDataPtr);
+                    // As páginas agora pertencem ao pipe: reutilizar o buffer antes do FFmpeg lê-lo corromperia o frame.
+                    DeferredBuffers.Add({ MoveTemp(Frame.RawDataPtr), BatchEndOffset });
+                }
+                else
+                {
+                    // SEMPRE RETORNA O FRAME PARA O POOL APÓS USÁ-LO
+                    ReleaseFrameBuffer(Frame.RawDataPtr);
                 }
-                continue; 
-            }
-            // UE_LOG(LogIVRVideoEncoder, Warning, TEXT("Video Encoder Worker: Attempting to write %d bytes to pipe (Frame %dx%d)."), 
-            //    CurrentFrame.RawDataPtr->Num(), CurrentFrame.Width, CurrentFrame.Height); // Descomente para debug intenso.
-            // Escreve o frame no pipe
-            if (VideoInputPipe.Write(CurrentFrame.RawDataPtr->GetData(), CurrentFrame.RawDataPtr->Num()))
-            {
-                // UE_LOG(LogIVRVideoEncoder, Warning, TEXT("Video Encoder Worker: Successfully wrote %d bytes to video pipe."),CurrentFrame.RawDataPtr->Num()); // Descomente para debug intenso.
-            }
-            else
-            {
-                UE_LOG(LogIVRVideoEncoderWorker, Error, TEXT("Failed to write video frame to pipe. Pipe may be closed or in error state. Signalling worker stop."));
-                bShouldStop.AtomicSet(true); 
             }
-            // SEMPRE RETORNA O FRAME PARA O POOL APÓS USÁ-LO
-            if (FramePool && CurrentFrame.RawDataPtr.IsValid())
+            DeferredBufferCount.Set(DeferredBuffers.Num());
+            PendingFrameCount.Subtract(Batch.Num());
+            if (bBatchWritten && Batch.Num() > 0)
             {
-                FramePool->ReleaseFrame(CurrentFrame.RawDataPtr);
+                ++NumBatches;
+                NumFramesWritten += Batch.Num();
             }
+            Batch.Reset();
+            ReclaimConsumedBuffers();
         }
+        bIsWritingFrame.AtomicSet(false);
         // Se a fila estiver vazia e não houver mais frames ou não for para parar, espera por um novo evento.
         if (FrameQueue.IsEmpty() && !bShouldStop)
         {
-            NewFrameEvent->Wait(100); // Espera por até 100ms por um novo frame ou sinal de parada
+            // Com buffers emprestados ao pipe, acorda com mais frequência para devolvê-los ao pool.
+            NewFrameEvent->Wait(DeferredBuffers.Num() > 0 ? 2 : 100); // Espera por até 100ms por um novo frame ou sinal de parada
         }
     }
+    // Dá ao FFmpeg uma última chance de consumir as páginas emprestadas antes de devolvê-las.
+    const double DrainDeadline = FPlatformTime::Seconds() + 2.0;
+    while (DeferredBuffers.Num() > 0 && VideoInputPipe.IsValid() && FPlatformTime::Seconds() < DrainDeadline)
+    {
+        ReclaimConsumedBuffers();
+        FPlatformProcess::Sleep(0.002f);
+    }
+    if (DeferredBuffers.Num() > 0)
+    {
+        // Ainda referenciados pelo pipe: são descartados (não voltam ao pool) para que nunca sejam reescritos.
+        UE_LOG(LogIVRVideoEncoderWorker, Warning, TEXT("Video Encoder Worker: %d spliced buffer(s) were not consumed by FFmpeg; dropping them instead of pooling."), DeferredBuffers.Num());
+        DeferredBuffers.Empty();
+        DeferredBufferCount.Set(0);
+    }
+    if (StreamMuxer && StreamMuxer->GetNonMonotonicFrames() > 0)
+    {
+        UE_LOG(LogIVRVideoEncoderWorker, Warning, TEXT("Video Encoder Worker: %d frame(s) had non-increasing timestamps and were nudged forward by one tick."), StreamMuxer->GetNonMonotonicFrames());
+    }
+    const FIVR_PipeWriteStats WriteStats = VideoInputPipe.GetWriteStats();
+    UE_LOG(LogIVRVideoEncoderWorker, Log, TEXT("Video Encoder Worker: %lld frames in %lld batches (avg %.2f), %.1f MB at %.1f MB/s, %lld write calls (%lld partial), reader stall %.2fs (%.0f%%)."),
+        NumFramesWritten, NumBatches, NumBatches > 0 ? (double)NumFramesWritten / NumBatches : 0.0,
+        WriteStats.BytesWritten / (1024.0 * 1024.0), WriteStats.GetBytesPerSecond() / (1024.0 * 1024.0),
+        WriteStats.WriteCalls, WriteStats.PartialWrites, WriteStats.StallSeconds, WriteStats.GetStallRatio() * 100.0);
     UE_LOG(LogIVRVideoEncoderWorker, Log, TEXT("Video Encoder Worker thread stopped."));
     return 0;
 }
 
+bool FVideoEncoderWorker::DequeueBatch()
+{
+    Batch.Reset();
+    FIVR_VideoFrame CurrentFrame; // Vai receber o frame do tipo FIVR_VideoFrame (com TSharedPtr)
+    bool bDequeuedAny = false;
+    // Só continua retirando frames enquanto já houver outros na fila: o lote nunca espera por frames novos.
+    while (Batch.Num() < MaxBatchFrames && FrameQueue.Dequeue(CurrentFrame))
+    {
+        bDequeuedAny = true;
+        // Acessa os dados do buffer via RawDataPtr
+        if (!CurrentFrame.RawDataPtr.IsValid() || CurrentFrame.RawDataPtr->Num() == 0)
+        {
+            UE_LOG(LogIVRVideoEncoderWorker, Error, TEXT("Video Encoder Worker: Received invalid or empty frame buffer. Dropping frame."));
+            ReleaseFrameBuffer(CurrentFrame.RawDataPtr);
+            PendingFrameCount.Decrement();
+            continue; 
+        }
+        Batch.Add(MoveTemp(CurrentFrame));
+    }
+    return bDequeuedAny;
+}
+
+bool FVideoEncoderWorker::WriteBatch()
+{
+    if (Batch.Num() == 0)
+    {
+        return true; // Apenas frames inválidos (já descartados)
+    }
+    // Em CFR/VFR, o Cluster/SimpleBlock com o timestamp do frame vai imediatamente antes do payload.
+    if (StreamMuxer && bZeroCopy)
+    {
+        // Os cabeçalhos são reaproveitados a cada lote, então não podem ser emprestados ao pipe por vmsplice:
+        // vão por cópia, um frame por vez, e só o payload é entregue sem cópia.
+        for (const FIVR_VideoFrame& Frame : Batch)
+        {
+            uint8 (&FrameHeader)[FIVR_MatroskaPipeMuxer::FrameHeaderBytes] = BatchHeaders[0];
+            StreamMuxer->BuildFrameHeader(StreamMuxer->ComputeFrameTicks(Frame.TimestampNs), Frame.RawDataPtr->Num(), FrameHeader);
+            if (VideoInputPipe.Write(FrameHeader, FIVR_MatroskaPipeMuxer::FrameHeaderBytes) != FIVR_MatroskaPipeMuxer::FrameHeaderBytes
+                || VideoInputPipe.WriteZeroCopy(Frame.RawDataPtr->GetData(), Frame.RawDataPtr->Num()) != Frame.RawDataPtr->Num())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    BatchSpans.Reset();
+    for (int32 i = 0; i < Batch.Num(); ++i)
+    {
+        const FIVR_VideoFrame& Frame = Batch[i];
+        if (StreamMuxer)
+        {
+            StreamMuxer->BuildFrameHeader(StreamMuxer->ComputeFrameTicks(Frame.TimestampNs), Frame.RawDataPtr->Num(), BatchHeaders[i]);
+            BatchSpans.Add({ BatchHeaders[i], FIVR_MatroskaPipeMuxer::FrameHeaderBytes });
+        }
+        BatchSpans.Add({ Frame.RawDataPtr->GetData(), Frame.RawDataPtr->Num() });
+    }
+    return bZeroCopy
+        ? VideoInputPipe.WriteZeroCopyGather(BatchSpans.GetData(), BatchSpans.Num())
+        : VideoInputPipe.WriteGather(BatchSpans.GetData(), BatchSpans.Num());
+}
+
+void FVideoEncoderWorker::ReclaimConsumedBuffers()
+{
+    if (DeferredBuffers.Num() == 0 || !VideoInputPipe.IsValid())
+    {
+        return; // Pipe fechado: não há como saber o que foi lido
+    }
+    const int64 ConsumedBytes = VideoInputPipe.GetBytesConsumedByReader();
+    int32 NumReclaimed = 0;
+    while (NumReclaimed < DeferredBuffers.Num() && DeferredBuffers[NumReclaimed].EndOffset <= ConsumedBytes)
+    {
+        ReleaseFrameBuffer(DeferredBuffers[NumReclaimed].Buffer);
+        ++NumReclaimed;
+    }
+    if (NumReclaimed > 0)
+    {
+        DeferredBuffers.RemoveAt(0, NumReclaimed, EAllowShrinking::No);
+        DeferredBufferCount.Set(DeferredBuffers.Num());
+    }
+}
+
+void FVideoEncoderWorker::ReleaseFrameBuffer(TSharedPtr<TArray<uint8>>& Buffer)
+{
+    if (FramePool && Buffer.IsValid())
+    {
+        FramePool->ReleaseFrame(Buffer);
+    }
+    Buffer.Reset();
+}
+
 void FVideoEncoderWorker::Stop()
 {
     bShouldStop.AtomicSet(true); 
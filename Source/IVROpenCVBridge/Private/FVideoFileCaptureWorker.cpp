@@ -3,6 +3,7 @@
 // Proibited copy or distribution without expressed authorization of the Author.
 #include "FVideoFileCaptureWorker.h"
 #include "IVROpenCVBridge.h" // Inclua o log principal do IVR se quiser usar LogIVR
+#include "IVRCaptureClock.h" // Relógio de captura compartilhado
 
 // --- INÍCIO DA ALTERAÇÃO: Includes de OpenCV APENAS no arquivo .cpp ---
 #if WITH_OPENCV 
@@ -24,7 +25,7 @@
 // FVideoFileCaptureWorker Implementation (FRunnable para Thread de Captura de Arquivo)
 // ESTA CLASSE FRunnable É DEFINIDA AQUI (AGORA COM ACESSO DIRETO AOS TIPOS DO OpenCV)
 // ==============================================================================
-FVideoFileCaptureWorker::FVideoFileCaptureWorker(UIVRFramePool* InFramePool, TQueue<FIVR_VideoFrame, EQueueMode::Mpsc>& InQueue, FThreadSafeBool& InStopFlag, FEvent* InNewFrameEvent, const FString& InVideoFilePath, float InDesiredFPS, bool InLoopPlayback)
+FVideoFileCaptureWorker::FVideoFileCaptureWorker(UIVRFramePool* InFramePool, TQueue<FIVR_VideoFrame, EQueueMode::Mpsc>& InQueue, FThreadSafeBool& InStopFlag, FEvent* InNewFrameEvent, const FString& InVideoFilePath, float InDesiredFPS, bool InLoopPlayback, TIVR_LatestValueMailbox<FIVR_VideoFrame>* InLatestFrameMailbox)
     : CapturedFrameQueue(InQueue)
     , FramePool(InFramePool)
     , bShouldStop(InStopFlag)
@@ -32,6 +33,7 @@ FVideoFileCaptureWorker::FVideoFileCaptureWorker(UIVRFramePool* InFramePool, TQu
     , VideoFilePath(InVideoFilePath)
     , DesiredFPS(InDesiredFPS)
     , bLoopPlayback(InLoopPlayback)
+    , LatestFrameMailbox(InLatestFrameMailbox)
     // --- INÍCIO DA ALTERAÇÃO: Inicialização de OpenCVVideoCapture ---
 #if WITH_OPENCV
     , OpenCVVideoCapture(new cv::VideoCapture()) // Aloca o objeto cv::VideoCapture
@@ -170,11 +172,23 @@ uint32 FVideoFileCaptureWorker::Run()
         }
         
         // Cria o FIVR_VideoFrame (contém o TSharedPtr para o buffer)
-        FIVR_VideoFrame NewFrame(BGRAFrame.cols, BGRAFrame.rows, FPlatformTime::Seconds());
+        FIVR_VideoFrame NewFrame(BGRAFrame.cols, BGRAFrame.rows, FIVR_CaptureClock::Get().NowNs());
         NewFrame.RawDataPtr = FrameBuffer; // Atribui o buffer adquirido
         
-        // Enfileira o frame para ser consumido pelo Game Thread
-        CapturedFrameQueue.Enqueue(MoveTemp(NewFrame));
+        if (LatestFrameMailbox)
+        {
+            // Entrega coalescida: o frame ainda não consumido fica velho e volta ao pool sem ser tocado
+            FIVR_VideoFrame StaleFrame;
+            if (LatestFrameMailbox->Publish(MoveTemp(NewFrame), StaleFrame) && StaleFrame.RawDataPtr.IsValid())
+            {
+                FramePool->ReleaseFrame(StaleFrame.RawDataPtr);
+            }
+        }
+        else
+        {
+            // Enfileira o frame para ser consumido pelo Game Thread
+            CapturedFrameQueue.Enqueue(MoveTemp(NewFrame));
+        }
         
         // Sinaliza o evento para o Game Thread, indicando que há um novo frame disponível
         NewFrameEvent->Trigger(); 
@@ -3,6 +3,7 @@
 // Proibited copy or distribution without expressed authorization of the Author.
 #include "IVROpenCVBridge/Public/FWebcamCaptureWorker.h"
 #include "IVROpenCVBridge.h" // Inclua o log principal do IVR se quiser usar LogIVROpenCVBridge
+#include "IVRCaptureClock.h" // Relógio de captura compartilhado
 
 // --- INÍCIO DA ALTERAÇÃO: Includes de OpenCV APENAS no arquivo .cpp ---
 #if WITH_OPENCV 
@@ -24,7 +25,7 @@
 // IMPLEMENTAÇÃO DOS MÉTODOS DA CLASSE FWebcamCaptureWorker
 // ==============================================================================
 FWebcamCaptureWorker::FWebcamCaptureWorker(UIVRFramePool* InFramePool, TQueue<FIVR_VideoFrame, EQueueMode::Mpsc>& InQueue, FThreadSafeBool& InStopFlag, FEvent* InNewFrameEvent, int32 InDeviceIndex, int32 InWidth, int32 InHeight, float InFPS,
-    VideoCaptureAPIs InApiPreference
+    VideoCaptureAPIs InApiPreference, TIVR_LatestValueMailbox<FIVR_VideoFrame>* InLatestFrameMailbox
 )
     : CapturedFrameQueue(InQueue)
     , FramePool(InFramePool)
@@ -42,6 +43,7 @@ FWebcamCaptureWorker::FWebcamCaptureWorker(UIVRFramePool* InFramePool, TQueue<FI
 #endif
     , ApiPreference(InApiPreference)
     // --- FIM DA ALTERAÇÃO ---
+    , LatestFrameMailbox(InLatestFrameMailbox)
 {
     // --- INÍCIO DA ALTERAÇÃO: Remove o bloco de erro/fallback de OpenCV não habilitado ---
     // A lógica de fallback e erro para WITH_OPENCV é agora tratada nos métodos
@@ -151,11 +153,23 @@ uint32 FWebcamCaptureWorker::Run()
             FMemory::Memcpy(DestRowPtr, SourceRowPtr, RowSizeInBytes);
         }
         // Cria o FIVR_VideoFrame (contém o TSharedPtr para o buffer)
-        FIVR_VideoFrame NewFrame(BGRAFrame.cols, BGRAFrame.rows, FPlatformTime::Seconds());
+        FIVR_VideoFrame NewFrame(BGRAFrame.cols, BGRAFrame.rows, FIVR_CaptureClock::Get().NowNs());
         NewFrame.RawDataPtr = FrameBuffer; // Atribui o buffer adquirido
         
-        // Enfileira o frame para ser consumido pelo Game Thread
-        CapturedFrameQueue.Enqueue(MoveTemp(NewFrame));
+        if (LatestFrameMailbox)
+        {
+            // Entrega coalescida: o frame ainda não consumido fica velho e volta ao pool sem ser tocado
+            FIVR_VideoFrame StaleFrame;
+            if (LatestFrameMailbox->Publish(MoveTemp(NewFrame), StaleFrame) && StaleFrame.RawDataPtr.IsValid())
+            {
+                FramePool->ReleaseFrame(StaleFrame.RawDataPtr);
+            }
+        }
+        else
+        {
+            // Enfileira o frame para ser consumido pelo Game Thread
+            CapturedFrameQueue.Enqueue(MoveTemp(NewFrame));
+        }
         
         // Sinaliza o evento para o Game Thread, indicando que há um novo frame disponível
         NewFrameEvent->Trigger(); 
@@ -4,6 +4,10 @@
 // Proibited copy or distribution without expressed authorization of the Author.
 #include "IVROpenCVGlobals.h" // NOSSO NOVO ARQUIVO DE CABEÇALHO GLOBAL
 #include "IVROpenCVBridge.h" // Para LogCategory do módulo IVROpenCVBridge
+#include "Misc/ScopeLock.h"
+#include "IVR_HistogramKernel.h" // NOVO: Histogramas B/G/R em uma passada (não depende do OpenCV)
+#include "IVR_CVStageGraph.h" // NOVO: Grafo de etapas (ExtractFeatureStages usa o grafo embutido)
+#include "IVROpenCVStageKernels.h"
 
 // Includes do OpenCV
 #if WITH_OPENCV 
@@ -24,55 +28,126 @@ namespace IVROpenCVBridge
 
 #if WITH_OPENCV 
 
-    void ProcessFrameAndExtractFeatures(
-        uint8* PixelData,
-        int32 Width,
-        int32 Height,
-        FTransform CameraTransform,
-        float CameraFOV,
-        int32 MaxCorners,
-        float QualityLevel,
-        float MinDistance,
-        bool bDebugDrawFeatures,
-        FOCV_NativeJustRTFeatures& OutFeatures // Saída das features
-    )
+    // --- NOVO: Kernels compartilhados pelas etapas fixas (FOCV_StageContext) e pelo grafo de etapas (IVR_CVStageGraph) ---
+    namespace StageKernels
     {
-        // Limpa as features antigas para garantir um estado limpo
-        OutFeatures.JustRTInterestPoints.Empty();
-        OutFeatures.HistogramRed.Empty();
-        OutFeatures.HistogramGreen.Empty();
-        OutFeatures.HistogramBlue.Empty();
-        OutFeatures.BiggestPointIndex = INDEX_NONE;
-        OutFeatures.SmallerPointIndex = INDEX_NONE;
-        OutFeatures.NumOfQuads = 0;
-        OutFeatures.NumOfRectangles = 0;
+        /** Fator de redução (potência de 2) pedido pelos parâmetros, limitado para a imagem de detecção não ficar minúscula. */
+        int32 ResolveDetectionFactor(int32 Width, int32 Height, const FOCV_FeatureStageParams& Params)
+        {
+            constexpr int32 MaxPyramidLevel = 4;
+            constexpr int32 MinDetectionSize = 64;
+            int32 Level = FMath::Clamp(Params.PyramidLevel, 0, MaxPyramidLevel);
+            if (Params.MaxDetectionWidth > 0)
+            {
+                while (Level < MaxPyramidLevel && (Width >> Level) > Params.MaxDetectionWidth)
+                {
+                    ++Level;
+                }
+            }
+            while (Level > 0 && ((Width >> Level) < MinDetectionSize || (Height >> Level) < MinDetectionSize))
+            {
+                --Level;
+            }
+            return 1 << Level;
+        }
 
-        if (PixelData != nullptr && Width > 0 && Height > 0)
+        cv::Point2f ToFrame(const cv::Point2f& DetectionPoint, int32 DetectionFactor)
         {
-            cv::Mat InputMat(Height, Width, CV_8UC4, PixelData); // Assume BGRA como entrada
+            const float Factor = (float)DetectionFactor;
+            return cv::Point2f((DetectionPoint.x + 0.5f) * Factor - 0.5f, (DetectionPoint.y + 0.5f) * Factor - 0.5f);
+        }
 
-            // --- Lógica de detecção de cantos ---
-            cv::Mat GrayMat;
-            cv::cvtColor(InputMat, GrayMat, cv::COLOR_BGRA2GRAY);
-            std::vector<cv::Point2f> OpenCVInterestPoints;
-            cv::goodFeaturesToTrack(GrayMat, OpenCVInterestPoints, MaxCorners, QualityLevel, MinDistance);
+        cv::Point2f FromFrame(const cv::Point2f& FramePoint, int32 DetectionFactor)
+        {
+            const float Factor = (float)DetectionFactor;
+            return cv::Point2f((FramePoint.x + 0.5f) / Factor - 0.5f, (FramePoint.y + 0.5f) / Factor - 0.5f);
+        }
 
-            // --- Lógica de detecção de contornos (quads/rects) ---
-            cv::Mat BinaryMat;
-            cv::adaptiveThreshold(GrayMat, BinaryMat, 255, cv::ADAPTIVE_THRESH_GAUSSIAN_C, cv::THRESH_BINARY_INV, 11, 2);
+        void ReduceToGray(const cv::Mat& BGRA, int32 DetectionFactor, cv::Mat& OutGray)
+        {
+            if (DetectionFactor <= 1)
+            {
+                cv::cvtColor(BGRA, OutGray, cv::COLOR_BGRA2GRAY);
+                return;
+            }
+            // Reduz o BGRA primeiro (INTER_AREA com fator inteiro é uma média por blocos vetorizada no OpenCV)
+            // e converte só a imagem pequena: o frame cheio é lido uma única vez.
+            cv::Mat SmallBGRA;
+            cv::resize(BGRA, SmallBGRA, cv::Size(BGRA.cols / DetectionFactor, BGRA.rows / DetectionFactor), 0, 0, cv::INTER_AREA);
+            cv::cvtColor(SmallBGRA, OutGray, cv::COLOR_BGRA2GRAY);
+        }
+
+        // --- Etapa Corners: goodFeaturesToTrack ---
+        void DetectCorners(const cv::Mat& DetectionGray, int32 DetectionFactor, const FOCV_FeatureStageParams& Params,
+                           TFunctionRef<const cv::Mat&()> GetFullGray, std::vector<cv::Point2f>& OutCorners)
+        {
+            const int32 Factor = DetectionFactor;
+            cv::goodFeaturesToTrack(DetectionGray, OutCorners, Params.MaxCorners, Params.QualityLevel,
+                                    FMath::Max(1.0f, Params.MinDistance / Factor));
+            if (Factor > 1)
+            {
+                for (cv::Point2f& Corner : OutCorners)
+                {
+                    Corner = ToFrame(Corner, Factor);
+                }
+                // Refinamento opcional: posição subpixel no cinza cheio, em uma janela do tamanho de um pixel de detecção
+                if (Params.bRefineCornersAtFullResolution && !OutCorners.empty())
+                {
+                    const cv::Mat& FullGray = GetFullGray();
+                    const int32 HalfWindow = FMath::Max(2, Factor);
+                    // Cantos a menos de uma janela da borda ficam sem refinamento (mantêm a posição da detecção),
+                    // em vez de serem empurrados para dentro da imagem.
+                    const float MinX = (float)HalfWindow + 1, MaxX = (float)(FullGray.cols - HalfWindow - 2);
+                    const float MinY = (float)HalfWindow + 1, MaxY = (float)(FullGray.rows - HalfWindow - 2);
+                    std::vector<int32> RefineIndices;
+                    std::vector<cv::Point2f> RefineCorners;
+                    RefineIndices.reserve(OutCorners.size());
+                    RefineCorners.reserve(OutCorners.size());
+                    for (int32 Index = 0; Index < (int32)OutCorners.size(); ++Index)
+                    {
+                        const cv::Point2f& Corner = OutCorners[Index];
+                        if (Corner.x >= MinX && Corner.x <= MaxX && Corner.y >= MinY && Corner.y <= MaxY)
+                        {
+                            RefineIndices.push_back(Index);
+                            RefineCorners.push_back(Corner);
+                        }
+                    }
+                    if (!RefineCorners.empty())
+                    {
+                        cv::cornerSubPix(FullGray, RefineCorners, cv::Size(HalfWindow, HalfWindow), cv::Size(-1, -1),
+                                         cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::COUNT, 10, 0.03));
+                        for (size_t Refined = 0; Refined < RefineCorners.size(); ++Refined)
+                        {
+                            OutCorners[RefineIndices[Refined]] = RefineCorners[Refined];
+                        }
+                    }
+                }
+            }
+        }
+
+        // --- Etapa Quads: limiar adaptativo + detecção de contornos (quads/rects) ---
+        void ThresholdForQuads(const cv::Mat& DetectionGray, cv::Mat& OutBinary)
+        {
+            cv::adaptiveThreshold(DetectionGray, OutBinary, 255, cv::ADAPTIVE_THRESH_GAUSSIAN_C, cv::THRESH_BINARY_INV, 11, 2);
+        }
+
+        void DetectQuads(const cv::Mat& Binary, int32 Width, int32 Height, int32 DetectionFactor,
+                         FOCV_NativeJustRTFeatures& OutFeatures, std::vector<cv::RotatedRect>& OutShapes)
+        {
+            // Contornos na imagem de detecção; áreas e retângulos são convertidos para pixels do frame
+            const float Factor = (float)DetectionFactor;
+            const double AreaToFrame = (double)Factor * Factor;
             std::vector<std::vector<cv::Point>> Contours;
-            cv::findContours(BinaryMat, Contours, cv::RETR_LIST, cv::CHAIN_APPROX_SIMPLE);
+            cv::findContours(Binary.clone(), Contours, cv::RETR_LIST, cv::CHAIN_APPROX_SIMPLE); // Cópia: o binário pode ser lido por outras etapas
 
             float MaxShapeArea = FLT_MIN;
             int32 MaxShapeIndex = INDEX_NONE;
             float MinShapeArea = FLT_MAX; 
             int32 MinShapeIndex = INDEX_NONE;
-            
-            std::vector<cv::RotatedRect> AllDetectedShapesForDrawing; // Para o debug draw
 
             for (const auto& Contour : Contours)
             {
-                double contourArea = cv::contourArea(Contour);
+                double contourArea = cv::contourArea(Contour) * AreaToFrame;
                 // Filtra contornos muito pequenos ou muito grandes
                 if (contourArea < 100.0 || contourArea > (Width * Height * 0.9))
                 {
@@ -85,13 +160,18 @@ namespace IVROpenCVBridge
                 // Verifica se é um quadrilátero convexo
                 if (Approx.size() == 4 && cv::isContourConvex(Approx))
                 {
-                    cv::Rect BoundingRect = cv::boundingRect(Approx);
+                    cv::Rect DetectionRect = cv::boundingRect(Approx);
+                    const int32 IntFactor = DetectionFactor;
+                    cv::Rect BoundingRect(DetectionRect.x * IntFactor, DetectionRect.y * IntFactor, DetectionRect.width * IntFactor, DetectionRect.height * IntFactor);
                     
                     FOCV_NativeJustRTPoint CurrentInterestPoint; // Usar nossa nova struct local
                     CurrentInterestPoint.Point2D = FVector2D(BoundingRect.x + BoundingRect.width / 2.0f, BoundingRect.y + BoundingRect.height / 2.0f); 
                     CurrentInterestPoint.Size2D = FVector2D(BoundingRect.width, BoundingRect.height);
                     
                     cv::RotatedRect RotatedRect = cv::minAreaRect(Contour);
+                    RotatedRect.center = ToFrame(RotatedRect.center, DetectionFactor);
+                    RotatedRect.size.width *= Factor;
+                    RotatedRect.size.height *= Factor;
                     CurrentInterestPoint.Angle = RotatedRect.angle; // Ângulo do retângulo rotacionado
 
                     // Verifica se é um quadrado ou um retângulo
@@ -115,15 +195,12 @@ namespace IVROpenCVBridge
                         CurrentInterestPoint.IsQuad = false; // Se altura for zero, não é um quad/rect válido
                     }
 
-                    // Deprojeção para o mundo 3D (ainda preenchida com zeros aqui)
-                    // NOTA: A lógica de deprojeção manual precisaria ser implementada aqui se fosse necessário.
-                    // Atualmente, IVRCaptureComponent::DeprojectPixelToWorld é um UFUNCTION.
-                    // Para funcionar aqui, uma versão C++ pura teria que ser criada dentro deste namespace.
+                    // A deprojeção para o mundo 3D é feita pelo chamador (UIVRCaptureComponent::ExtractRealTimeFeatures).
                     CurrentInterestPoint.Point3D = FVector::ZeroVector; 
                     CurrentInterestPoint.Direction = FVector::ZeroVector; 
                     
                     OutFeatures.JustRTInterestPoints.Add(CurrentInterestPoint);
-                    AllDetectedShapesForDrawing.push_back(RotatedRect);
+                    OutShapes.push_back(RotatedRect);
 
                     // Atualiza índices do maior e menor
                     if (contourArea > MaxShapeArea)
@@ -140,65 +217,687 @@ namespace IVROpenCVBridge
             }
             OutFeatures.BiggestPointIndex = MaxShapeArea == FLT_MIN ? INDEX_NONE : MaxShapeIndex; 
             OutFeatures.SmallerPointIndex = MinShapeArea == FLT_MAX ? INDEX_NONE : MinShapeIndex; 
+        }
 
-            // --- Cálculo de Histograma ---
-            std::vector<cv::Mat> BGRChannels(3); 
-            cv::split(InputMat, BGRChannels); 
-            
-            cv::Mat B_hist, G_hist, R_hist;
-            int HistSize = 256;
-            float Range[] = {0, 256};
-            const float* HistRanges[] = { Range }; 
-            int channels_idx[] = {0};
-            int hist_dims[] = {HistSize};
-            bool Uniform = true;
-            bool Accumulate = false;
-
-            cv::calcHist(&BGRChannels[0], 1, channels_idx, cv::Mat(), B_hist, 1, hist_dims, HistRanges, Uniform, Accumulate);
-            cv::calcHist(&BGRChannels[1], 1, channels_idx, cv::Mat(), G_hist, 1, hist_dims, HistRanges, Uniform, Accumulate);
-            cv::calcHist(&BGRChannels[2], 1, channels_idx, cv::Mat(), R_hist, 1, hist_dims, HistRanges, Uniform, Accumulate);
-            
-            cv::normalize(B_hist, B_hist, 0, 1, cv::NORM_MINMAX, -1, cv::Mat());
-            cv::normalize(G_hist, G_hist, 0, 1, cv::NORM_MINMAX, -1, cv::Mat());
-            cv::normalize(R_hist, R_hist, 0, 1, cv::NORM_MINMAX, -1, cv::Mat());
-            
-            OutFeatures.HistogramBlue.SetNumUninitialized(HistSize);
-            OutFeatures.HistogramGreen.SetNumUninitialized(HistSize);
-            OutFeatures.HistogramRed.SetNumUninitialized(HistSize);
-            for (int j = 0; j < HistSize; ++j)
-            {
-                OutFeatures.HistogramBlue[j] = B_hist.at<float>(j);
-                OutFeatures.HistogramGreen[j] = G_hist.at<float>(j);
-                OutFeatures.HistogramRed[j] = R_hist.at<float>(j);
-            }
-            
-            // --- Debug Draw Features (se habilitado) ---
-            if (bDebugDrawFeatures)
-            {
-                for (const auto& RotatedRect : AllDetectedShapesForDrawing)
+        // --- Etapa DebugOverlay: primitivas do resultado das etapas que rodaram (os pixels não são tocados) ---
+        void AppendShapesAndCorners(const std::vector<cv::RotatedRect>& Shapes, const std::vector<cv::Point2f>& Corners, TArray<FOCV_OverlayPrimitive>& OutOverlay)
+        {
+            OutOverlay.Reserve(OutOverlay.Num() + (int32)Shapes.size() + (int32)Corners.size());
+            for (const auto& RotatedRect : Shapes)
+            {
+                cv::Point2f Points[4];
+                RotatedRect.points(Points);
+                FOCV_OverlayPrimitive& Polygon = OutOverlay.AddDefaulted_GetRef();
+                Polygon.Shape = EOCV_OverlayShape::Polygon;
+                for (int i = 0; i < 4; ++i)
+                {
+                    Polygon.Points[i] = FVector2f(Points[i].x, Points[i].y);
+                }
+                Polygon.Thickness = 2;
+                Polygon.Color = FColor::Green;
+            }
+            for (const cv::Point2f& Corner : Corners)
+            { 
+                FOCV_OverlayPrimitive& Circle = OutOverlay.AddDefaulted_GetRef();
+                Circle.Shape = EOCV_OverlayShape::Circle;
+                Circle.Points[0] = FVector2f(Corner.x, Corner.y);
+                Circle.Radius = 5.0f;
+                Circle.Color = FColor::Red;
+            }
+        }
+
+        /** Recalcula contagens e maior/menor pela área do retângulo envolvente (quads rastreados ou vindos de várias regiões). */
+        void RecountShapesBySize(FOCV_NativeJustRTFeatures& OutFeatures)
+        {
+            float MaxArea = -1.0f;
+            float MinArea = FLT_MAX;
+            for (int32 Index = 0; Index < OutFeatures.JustRTInterestPoints.Num(); ++Index)
+            {
+                const FOCV_NativeJustRTPoint& Point = OutFeatures.JustRTInterestPoints[Index];
+                (Point.IsQuad ? OutFeatures.NumOfQuads : OutFeatures.NumOfRectangles)++;
+                const float Area = Point.Size2D.X * Point.Size2D.Y;
+                if (Area > MaxArea)
+                {
+                    MaxArea = Area;
+                    OutFeatures.BiggestPointIndex = Index;
+                }
+                if (Area < MinArea)
                 {
-                    cv::Point2f Points[4];
-                    RotatedRect.points(Points);
-                    std::vector<std::vector<cv::Point>> Polygon(1);
-                    for (int i = 0; i < 4; ++i)
+                    MinArea = Area;
+                    OutFeatures.SmallerPointIndex = Index;
+                }
+            }
+        }
+
+        // --- NOVO: Regiões de interesse ---
+
+        /** Regiões recortadas ao frame, com as sobreposições fundidas no retângulo envolvente. Sem regiões = frame inteiro. */
+        TArray<cv::Rect> ResolveRegions(const FOCV_FeatureStageParams& Params, int32 Width, int32 Height)
+        {
+            const cv::Rect Frame(0, 0, Width, Height);
+            TArray<cv::Rect> Regions;
+            if (Params.Regions.Num() == 0)
+            {
+                Regions.Add(Frame);
+                return Regions;
+            }
+            for (const FIntRect& Region : Params.Regions)
+            {
+                const cv::Rect Clipped = cv::Rect(Region.Min.X, Region.Min.Y, Region.Width(), Region.Height()) & Frame;
+                if (Clipped.area() > 0)
+                {
+                    Regions.Add(Clipped);
+                }
+            }
+            for (bool bMerged = true; bMerged; )
+            {
+                bMerged = false;
+                for (int32 A = 0; A < Regions.Num() && !bMerged; ++A)
+                {
+                    for (int32 B = A + 1; B < Regions.Num(); ++B)
                     {
-                        Polygon[0].push_back(Points[i]);
+                        if ((Regions[A] & Regions[B]).area() > 0)
+                        {
+                            Regions[A] |= Regions[B];
+                            Regions.RemoveAtSwap(B);
+                            bMerged = true;
+                            break;
+                        }
                     }
-                    cv::Scalar Color = cv::Scalar(0, 255, 0, 255); // Verde
-                    
-                    cv::polylines(InputMat, Polygon, true, Color, 2); // Desenha polígono
                 }
-                for (const cv::Point2f& Corner : OpenCVInterestPoints) { 
-                    cv::circle(InputMat, Corner, 5, cv::Scalar(0, 0, 255, 255), -1); // Desenha círculos vermelhos
+            }
+            return Regions;
+        }
+
+        /** Leva as coordenadas de uma região (vista) para o frame. */
+        void OffsetFeatures(FOCV_NativeJustRTFeatures& Features, const cv::Point& Origin)
+        {
+            if (Origin.x == 0 && Origin.y == 0)
+            {
+                return;
+            }
+            const FVector2D Offset(Origin.x, Origin.y);
+            for (FVector2D& Corner : Features.Corners)
+            {
+                Corner += Offset;
+            }
+            for (FOCV_NativeJustRTPoint& Point : Features.JustRTInterestPoints)
+            {
+                Point.Point2D += Offset;
+            }
+            const FVector2f OverlayOffset(Origin.x, Origin.y);
+            for (FOCV_OverlayPrimitive& Primitive : Features.Overlay)
+            {
+                for (FVector2f& Point : Primitive.Points)
+                {
+                    Point += OverlayOffset;
                 }
             }
         }
-        else 
+
+        /** Histogramas somando as contagens de todas as regiões antes de normalizar. */
+        void CountRegionHistograms(const cv::Mat& Frame, const TArray<cv::Rect>& Regions, const FOCV_FeatureStageParams& Params, FOCV_NativeJustRTFeatures& OutFeatures)
         {
-            UE_LOG(LogIVROpenCVBridge, Error, TEXT("IVROpenCVBridge: PixelData é inválido ou vazio. Não é possível processar features."));
+            FIVR_HistogramKernel::FCounts Total;
+            FIVR_HistogramKernel::FCounts RegionCounts;
+            FMemory::Memzero(&Total, sizeof(Total));
+            int64 NumSamples = 0;
+            for (const cv::Rect& Region : Regions)
+            {
+                const cv::Mat View = Frame(Region);
+                NumSamples += FIVR_HistogramKernel::Count(View.data, View.cols, View.rows, Params.HistogramSubsample, RegionCounts, View.step);
+                FIVR_HistogramKernel::Accumulate(Total, RegionCounts);
+            }
+            if (NumSamples > 0)
+            {
+                FIVR_HistogramKernel::Normalize(Total, OutFeatures.HistogramBlue, OutFeatures.HistogramGreen, OutFeatures.HistogramRed);
+            }
+        }
+
+        /** Contorno azul das regiões pedidas (só quando há regiões explícitas). */
+        void AppendRegionOutlines(const TArray<cv::Rect>& Regions, const FOCV_FeatureStageParams& Params, TArray<FOCV_OverlayPrimitive>& OutOverlay)
+        {
+            if (Params.Regions.Num() == 0)
+            {
+                return;
+            }
+            for (const cv::Rect& Region : Regions)
+            {
+                // Mesmos pixels que cv::rectangle: da borda esquerda/superior até a última coluna/linha da região
+                const float X0 = (float)Region.x;
+                const float Y0 = (float)Region.y;
+                const float X1 = (float)(Region.x + Region.width - 1);
+                const float Y1 = (float)(Region.y + Region.height - 1);
+                FOCV_OverlayPrimitive& Outline = OutOverlay.AddDefaulted_GetRef();
+                Outline.Shape = EOCV_OverlayShape::Polygon;
+                Outline.Points[0] = FVector2f(X0, Y0);
+                Outline.Points[1] = FVector2f(X1, Y0);
+                Outline.Points[2] = FVector2f(X1, Y1);
+                Outline.Points[3] = FVector2f(X0, Y1);
+                Outline.Color = FColor::Blue;
+            }
+        }
+    }
+    using namespace StageKernels;
+
+    namespace
+    {
+        /** Intermediários compartilhados entre as etapas, calculados na primeira vez que alguma etapa os pede. */
+        struct FOCV_StageContext
+        {
+            cv::Mat Input; // BGRA, aponta para os pixels do chamador (sem cópia)
+            int32 DetectionFactor = 1; // 2^Nível da pirâmide: pixels do frame por pixel de detecção
+            std::vector<cv::Point2f> Corners;           // Em coordenadas do frame
+            std::vector<cv::RotatedRect> Shapes;        // Em coordenadas do frame
+
+            /** Cinza em resolução cheia. */
+            const cv::Mat& GetGray()
+            {
+                if (Gray.empty())
+                {
+                    ReduceToGray(Input, 1, Gray);
+                }
+                return Gray;
+            }
+
+            /** Cinza reduzido pelo fator de detecção (o próprio GetGray() no nível 0). */
+            const cv::Mat& GetDetectionGray()
+            {
+                if (DetectionFactor <= 1)
+                {
+                    return GetGray();
+                }
+                if (DetectionGray.empty())
+                {
+                    ReduceToGray(Input, DetectionFactor, DetectionGray);
+                }
+                return DetectionGray;
+            }
+
+            /** Converte um ponto da imagem de detecção para o frame (centros de pixel alinhados). */
+            cv::Point2f ToFrame(const cv::Point2f& DetectionPoint) const
+            {
+                return StageKernels::ToFrame(DetectionPoint, DetectionFactor);
+            }
+
+            /** Inverso de ToFrame. */
+            cv::Point2f FromFrame(const cv::Point2f& FramePoint) const
+            {
+                return StageKernels::FromFrame(FramePoint, DetectionFactor);
+            }
+
+        private:
+            cv::Mat Gray;
+            cv::Mat DetectionGray;
+        };
+
+        void RunCornerStage(FOCV_StageContext& Context, const FOCV_FeatureStageParams& Params, FOCV_NativeJustRTFeatures& OutFeatures)
+        {
+            DetectCorners(Context.GetDetectionGray(), Context.DetectionFactor, Params,
+                          [&Context]() -> const cv::Mat& { return Context.GetGray(); }, Context.Corners);
+            OutFeatures.Corners.Reset((int32)Context.Corners.size());
+            for (const cv::Point2f& Corner : Context.Corners)
+            {
+                OutFeatures.Corners.Add(FVector2D(Corner.x, Corner.y));
+            }
+        }
+
+        void RunQuadStage(FOCV_StageContext& Context, FOCV_NativeJustRTFeatures& OutFeatures)
+        {
+            cv::Mat BinaryMat;
+            ThresholdForQuads(Context.GetDetectionGray(), BinaryMat);
+            DetectQuads(BinaryMat, Context.Input.cols, Context.Input.rows, Context.DetectionFactor, OutFeatures, Context.Shapes);
+        }
+
+        // --- Etapa Histograms: uma única leitura do frame BGRA intercalado (sem cv::split/calcHist por plano) ---
+        void RunHistogramStage(FOCV_StageContext& Context, const FOCV_FeatureStageParams& Params, FOCV_NativeJustRTFeatures& OutFeatures)
+        {
+            FIVR_HistogramKernel::ComputeNormalized(Context.Input.data, Context.Input.cols, Context.Input.rows, Params.HistogramSubsample,
+                                                    OutFeatures.HistogramBlue, OutFeatures.HistogramGreen, OutFeatures.HistogramRed, Context.Input.step);
+        }
+
+        void RunDebugOverlayStage(FOCV_StageContext& Context, FOCV_NativeJustRTFeatures& OutFeatures)
+        {
+            AppendShapesAndCorners(Context.Shapes, Context.Corners, OutFeatures.Overlay);
+        }
+
+        /** Roda as etapas pedidas, em ordem, sobre um contexto já preparado. */
+        void RunStages(FOCV_StageContext& Context, EOCV_FeatureStage Stages, const FOCV_FeatureStageParams& Params, FOCV_NativeJustRTFeatures& OutFeatures)
+        {
+            if (EnumHasAnyFlags(Stages, EOCV_FeatureStage::Corners))
+            {
+                RunCornerStage(Context, Params, OutFeatures);
+            }
+            if (EnumHasAnyFlags(Stages, EOCV_FeatureStage::Quads))
+            {
+                RunQuadStage(Context, OutFeatures);
+            }
+            if (EnumHasAnyFlags(Stages, EOCV_FeatureStage::Histograms))
+            {
+                RunHistogramStage(Context, Params, OutFeatures);
+            }
+            if (EnumHasAnyFlags(Stages, EOCV_FeatureStage::DebugOverlay))
+            {
+                RunDebugOverlayStage(Context, OutFeatures);
+            }
+        }
+    }
+
+    void ExtractFeatureStages(
+        uint8* PixelData,
+        int32 Width,
+        int32 Height,
+        EOCV_FeatureStage Stages,
+        const FOCV_FeatureStageParams& Params,
+        FOCV_NativeJustRTFeatures& OutFeatures
+    )
+    {
+        // Só as etapas de Stages (e os intermediários que elas leem) estão no grafo embutido
+        FOCV_CVStageGraph::GetBuiltIn(Stages).Execute(PixelData, Width, Height, Params, OutFeatures);
+    }
+
+    void ProcessFrameAndExtractFeatures(
+        uint8* PixelData,
+        int32 Width,
+        int32 Height,
+        FTransform CameraTransform,
+        float CameraFOV,
+        int32 MaxCorners,
+        float QualityLevel,
+        float MinDistance,
+        bool bDebugDrawFeatures,
+        FOCV_NativeJustRTFeatures& OutFeatures // Saída das features
+    )
+    {
+        // Os cantos só eram usados pelo desenho de debug; sem ele, a etapa Corners não roda.
+        EOCV_FeatureStage Stages = EOCV_FeatureStage::Quads | EOCV_FeatureStage::Histograms;
+        if (bDebugDrawFeatures)
+        {
+            Stages |= EOCV_FeatureStage::Corners | EOCV_FeatureStage::DebugOverlay;
+        }
+        FOCV_FeatureStageParams Params;
+        Params.MaxCorners = MaxCorners;
+        Params.QualityLevel = QualityLevel;
+        Params.MinDistance = MinDistance;
+        ExtractFeatureStages(PixelData, Width, Height, Stages, Params, OutFeatures);
+        if (bDebugDrawFeatures)
+        {
+            DrawOverlay(PixelData, Width, Height, OutFeatures.Overlay); // Saída legada: o overlay vai para os pixels do chamador
+        }
+        OutFeatures.Corners.Reset(); // Saída legada: sem cantos
+        OutFeatures.Overlay.Reset();
+    }
+
+    void DrawOverlay(uint8* PixelData, int32 Width, int32 Height, const TArray<FOCV_OverlayPrimitive>& Overlay)
+    {
+        if (PixelData == nullptr || Width <= 0 || Height <= 0 || Overlay.Num() == 0)
+        {
+            return;
+        }
+        cv::Mat Frame(Height, Width, CV_8UC4, PixelData); // BGRA
+        std::vector<std::vector<cv::Point>> Polygon(1, std::vector<cv::Point>(4));
+        for (const FOCV_OverlayPrimitive& Primitive : Overlay)
+        {
+            const cv::Scalar Color(Primitive.Color.B, Primitive.Color.G, Primitive.Color.R, Primitive.Color.A);
+            if (Primitive.Shape == EOCV_OverlayShape::Circle)
+            {
+                cv::circle(Frame, cv::Point2f(Primitive.Points[0].X, Primitive.Points[0].Y), FMath::RoundToInt32(Primitive.Radius), Color, -1);
+                continue;
+            }
+            for (int i = 0; i < 4; ++i)
+            {
+                Polygon[0][i] = cv::Point(FMath::RoundToInt32(Primitive.Points[i].X), FMath::RoundToInt32(Primitive.Points[i].Y));
+            }
+            cv::polylines(Frame, Polygon, true, Color, Primitive.Thickness);
+        }
+    }
+
+
+    // --- NOVO: Rastreamento temporal (FOCV_FeatureTracker) ---
+    struct FOCV_FeatureTracker::FState
+    {
+        cv::Mat PrevGray;                           // Cinza de detecção do último frame processado
+        cv::Rect Window;                            // Área do frame rastreada (regiões de interesse ou frame inteiro)
+        int32 DetectionFactor = 1;
+        std::vector<cv::Point2f> CornerPoints;      // Coordenadas da imagem de detecção
+        TArray<int32> CornerIds;
+        std::vector<cv::Point2f> QuadPoints;        // Centros dos quads, coordenadas da imagem de detecção
+        TArray<FOCV_NativeJustRTPoint> Quads;       // Tamanho, ângulo, tipo e TrackId de cada quad
+        int32 KeyframeTrackCount = 0;               // Trilhas criadas no último keyframe
+        int32 FramesSinceKeyframe = 0;
+        int32 NextTrackId = 0;
+    };
+
+    namespace
+    {
+        /** Acompanha Points de PrevGray para Gray com Lucas-Kanade piramidal; os perdidos saem junto com o item paralelo. */
+        template<typename ItemArrayType>
+        void TrackPoints(const cv::Mat& PrevGray, const cv::Mat& Gray, const FOCV_TrackerSettings& Settings, std::vector<cv::Point2f>& Points, ItemArrayType& Items)
+        {
+            if (Points.empty())
+            {
+                return;
+            }
+            std::vector<cv::Point2f> NextPoints;
+            std::vector<uchar> Status;
+            std::vector<float> Error;
+            const int32 Window = FMath::Max(5, Settings.WindowSize) | 1;
+            cv::calcOpticalFlowPyrLK(PrevGray, Gray, Points, NextPoints, Status, Error, cv::Size(Window, Window),
+                                     FMath::Clamp(Settings.MaxPyramidLevel, 0, 6),
+                                     cv::TermCriteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 20, 0.03));
+            int32 NumKept = 0;
+            for (int32 Index = 0; Index < (int32)Points.size(); ++Index)
+            {
+                const cv::Point2f& Next = NextPoints[Index];
+                if (Status[Index] && Next.x >= 0.0f && Next.y >= 0.0f && Next.x < Gray.cols && Next.y < Gray.rows)
+                {
+                    Points[NumKept] = Next;
+                    Items[NumKept] = Items[Index];
+                    ++NumKept;
+                }
+            }
+            Points.resize(NumKept);
+            Items.SetNum(NumKept, EAllowShrinking::No);
+        }
+
+        bool IsInRegions(const TArray<cv::Rect>& Regions, const cv::Point2f& Point)
+        {
+            for (const cv::Rect& Region : Regions)
+            {
+                if (Point.x >= Region.x && Point.y >= Region.y && Point.x < Region.x + Region.width && Point.y < Region.y + Region.height)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /** Descarta as trilhas (pontos de detecção) que saíram das regiões da janela; o item paralelo sai junto. */
+        template<typename ItemArrayType>
+        void KeepTracksInRegions(const TArray<cv::Rect>& WindowRegions, const FOCV_StageContext& Context, std::vector<cv::Point2f>& Points, ItemArrayType& Items)
+        {
+            int32 NumKept = 0;
+            for (int32 Index = 0; Index < (int32)Points.size(); ++Index)
+            {
+                if (IsInRegions(WindowRegions, Context.ToFrame(Points[Index])))
+                {
+                    Points[NumKept] = Points[Index];
+                    Items[NumKept] = Items[Index];
+                    ++NumKept;
+                }
+            }
+            Points.resize(NumKept);
+            Items.SetNum(NumKept, EAllowShrinking::No);
+        }
+
+        /**
+         * A janela do keyframe é o retângulo envolvente das regiões: cantos e formas detectados fora delas (ex.: entre
+         * duas regiões separadas) saem antes de virarem trilhas, como no caminho do grafo, que só olha as regiões.
+         */
+        void KeepDetectionsInRegions(const TArray<cv::Rect>& WindowRegions, FOCV_StageContext& Context, FOCV_NativeJustRTFeatures& OutFeatures)
+        {
+            Context.Corners.clear();
+            int32 NumKept = 0;
+            for (int32 Index = 0; Index < OutFeatures.Corners.Num(); ++Index)
+            {
+                const cv::Point2f Corner((float)OutFeatures.Corners[Index].X, (float)OutFeatures.Corners[Index].Y);
+                if (IsInRegions(WindowRegions, Corner))
+                {
+                    OutFeatures.Corners[NumKept++] = OutFeatures.Corners[Index];
+                    Context.Corners.push_back(Corner);
+                }
+            }
+            OutFeatures.Corners.SetNum(NumKept, EAllowShrinking::No);
+
+            const bool bHasShapes = Context.Shapes.size() == (size_t)OutFeatures.JustRTInterestPoints.Num();
+            NumKept = 0;
+            for (int32 Index = 0; Index < OutFeatures.JustRTInterestPoints.Num(); ++Index)
+            {
+                const FVector2D& Center = OutFeatures.JustRTInterestPoints[Index].Point2D;
+                if (IsInRegions(WindowRegions, cv::Point2f((float)Center.X, (float)Center.Y)))
+                {
+                    OutFeatures.JustRTInterestPoints[NumKept] = OutFeatures.JustRTInterestPoints[Index];
+                    if (bHasShapes)
+                    {
+                        Context.Shapes[NumKept] = Context.Shapes[Index];
+                    }
+                    ++NumKept;
+                }
+            }
+            OutFeatures.JustRTInterestPoints.SetNum(NumKept, EAllowShrinking::No);
+            if (bHasShapes)
+            {
+                Context.Shapes.resize(NumKept);
+            }
+            OutFeatures.NumOfQuads = 0;
+            OutFeatures.NumOfRectangles = 0;
+            OutFeatures.BiggestPointIndex = INDEX_NONE;
+            OutFeatures.SmallerPointIndex = INDEX_NONE;
+            RecountShapesBySize(OutFeatures);
+        }
+
+        /** Cada detecção herda o ID da trilha viva mais próxima dentro do seu raio; as demais recebem IDs novos. */
+        void InheritTrackIds(const std::vector<cv::Point2f>& Detected, const TArray<float>& MaxDistances,
+                             const std::vector<cv::Point2f>& Tracked, const TArray<int32>& TrackedIds,
+                             int32& NextTrackId, TArray<int32>& OutIds)
+        {
+            TArray<bool> Used;
+            Used.SetNumZeroed(TrackedIds.Num());
+            OutIds.Reset((int32)Detected.size());
+            for (int32 Index = 0; Index < (int32)Detected.size(); ++Index)
+            {
+                int32 Best = INDEX_NONE;
+                float BestDistanceSq = MaxDistances[Index] * MaxDistances[Index];
+                for (int32 Track = 0; Track < TrackedIds.Num(); ++Track)
+                {
+                    if (Used[Track])
+                    {
+                        continue;
+                    }
+                    const cv::Point2f Delta = Detected[Index] - Tracked[Track];
+                    const float DistanceSq = Delta.dot(Delta);
+                    if (DistanceSq <= BestDistanceSq)
+                    {
+                        Best = Track;
+                        BestDistanceSq = DistanceSq;
+                    }
+                }
+                if (Best != INDEX_NONE)
+                {
+                    Used[Best] = true;
+                    OutIds.Add(TrackedIds[Best]);
+                }
+                else
+                {
+                    OutIds.Add(NextTrackId++);
+                }
+            }
         }
     }
 
+    void FOCV_FeatureTracker::ProcessFrame(
+        uint8* PixelData,
+        int32 Width,
+        int32 Height,
+        EOCV_FeatureStage Stages,
+        const FOCV_FeatureStageParams& Params,
+        const FOCV_TrackerSettings& Settings,
+        FOCV_NativeJustRTFeatures& OutFeatures
+    )
+    {
+        FScopeLock Lock(&Mutex);
+        OutFeatures.Reset();
+        if (PixelData == nullptr || Width <= 0 || Height <= 0)
+        {
+            UE_LOG(LogIVROpenCVBridge, Error, TEXT("IVROpenCVBridge: PixelData é inválido ou vazio. Não é possível processar features."));
+            return;
+        }
+        if (Stages == EOCV_FeatureStage::None)
+        {
+            return;
+        }
+
+        const TArray<cv::Rect> Regions = ResolveRegions(Params, Width, Height);
+        if (Regions.Num() == 0)
+        {
+            return; // Todas as regiões de interesse estão fora do frame
+        }
+        cv::Mat Frame(Height, Width, CV_8UC4, PixelData); // Assume BGRA como entrada
+        if (!EnumHasAnyFlags(Stages, EOCV_FeatureStage::Corners | EOCV_FeatureStage::Quads))
+        {
+            FOCV_CVStageGraph::GetBuiltIn(Stages).Execute(PixelData, Width, Height, Params, OutFeatures); // Nada para rastrear
+            return;
+        }
+
+        // O rastreamento usa uma única janela: o retângulo envolvente das regiões, alinhado a 32 px para que
+        // pequenos deslocamentos de uma região (ex.: seguindo um ator) não forcem um keyframe a cada frame.
+        cv::Rect Window = Regions[0];
+        for (const cv::Rect& Region : Regions)
+        {
+            Window |= Region;
+        }
+        if (Params.Regions.Num() > 0)
+        {
+            constexpr int32 Alignment = 32;
+            const int32 X0 = Window.x / Alignment * Alignment;
+            const int32 Y0 = Window.y / Alignment * Alignment;
+            const int32 X1 = (Window.x + Window.width + Alignment - 1) / Alignment * Alignment;
+            const int32 Y1 = (Window.y + Window.height + Alignment - 1) / Alignment * Alignment;
+            Window = cv::Rect(X0, Y0, X1 - X0, Y1 - Y0) & cv::Rect(0, 0, Width, Height);
+        }
+        FOCV_StageContext Context;
+        Context.Input = Frame(Window); // Vista: sem cópia
+        Context.DetectionFactor = ResolveDetectionFactor(Window.width, Window.height, Params);
+        // Regiões em coordenadas da janela: só o que cai nelas é detectado e rastreado
+        TArray<cv::Rect> WindowRegions;
+        const bool bFilterRegions = Params.Regions.Num() > 0;
+        if (bFilterRegions)
+        {
+            for (const cv::Rect& Region : Regions)
+            {
+                WindowRegions.Add(Region - Window.tl());
+            }
+        }
+
+        FState& S = *State;
+        const bool bSameGeometry = !S.PrevGray.empty() && S.Window == Window && S.DetectionFactor == Context.DetectionFactor;
+        if (!bSameGeometry)
+        {
+            const int32 NextTrackId = S.NextTrackId; // IDs nunca se repetem, nem depois de uma troca de resolução
+            S = FState();
+            S.NextTrackId = NextTrackId;
+        }
+
+        // Acompanha as trilhas vivas até este frame (também em keyframes, para que as novas detecções herdem os IDs)
+        const cv::Mat& Gray = Context.GetDetectionGray();
+        if (bSameGeometry)
+        {
+            TrackPoints(S.PrevGray, Gray, Settings, S.CornerPoints, S.CornerIds);
+            TrackPoints(S.PrevGray, Gray, Settings, S.QuadPoints, S.Quads);
+            if (bFilterRegions)
+            {
+                KeepTracksInRegions(WindowRegions, Context, S.CornerPoints, S.CornerIds);
+                KeepTracksInRegions(WindowRegions, Context, S.QuadPoints, S.Quads);
+            }
+        }
+        ++S.FramesSinceKeyframe;
+        const int32 NumTracks = S.CornerIds.Num() + S.Quads.Num();
+        const bool bKeyframe = !bSameGeometry
+            || S.KeyframeTrackCount == 0
+            || S.FramesSinceKeyframe >= FMath::Max(1, Settings.KeyframeInterval)
+            || NumTracks < S.KeyframeTrackCount * Settings.MinSurvivalRatio;
+
+        if (bKeyframe)
+        {
+            RunStages(Context, Stages & (EOCV_FeatureStage::Corners | EOCV_FeatureStage::Quads), Params, OutFeatures);
+            if (bFilterRegions)
+            {
+                KeepDetectionsInRegions(WindowRegions, Context, OutFeatures);
+            }
+            const float Factor = (float)Context.DetectionFactor;
+
+            std::vector<cv::Point2f> DetectedCorners;
+            TArray<float> CornerRadii;
+            DetectedCorners.reserve(OutFeatures.Corners.Num());
+            for (const FVector2D& Corner : OutFeatures.Corners)
+            {
+                DetectedCorners.push_back(Context.FromFrame(cv::Point2f((float)Corner.X, (float)Corner.Y)));
+                CornerRadii.Add(FMath::Max(2.0f, Params.MinDistance / Factor));
+            }
+            InheritTrackIds(DetectedCorners, CornerRadii, S.CornerPoints, S.CornerIds, S.NextTrackId, OutFeatures.CornerIds);
+            S.CornerPoints = MoveTemp(DetectedCorners);
+            S.CornerIds = OutFeatures.CornerIds;
+
+            std::vector<cv::Point2f> DetectedQuads;
+            TArray<float> QuadRadii;
+            TArray<int32> QuadIds;
+            TArray<int32> TrackedQuadIds;
+            for (const FOCV_NativeJustRTPoint& Quad : S.Quads)
+            {
+                TrackedQuadIds.Add(Quad.TrackId);
+            }
+            for (const FOCV_NativeJustRTPoint& Quad : OutFeatures.JustRTInterestPoints)
+            {
+                DetectedQuads.push_back(Context.FromFrame(cv::Point2f((float)Quad.Point2D.X, (float)Quad.Point2D.Y)));
+                QuadRadii.Add(FMath::Max(2.0f, 0.5f * (float)FMath::Min(Quad.Size2D.X, Quad.Size2D.Y) / Factor));
+            }
+            InheritTrackIds(DetectedQuads, QuadRadii, S.QuadPoints, TrackedQuadIds, S.NextTrackId, QuadIds);
+            for (int32 Index = 0; Index < QuadIds.Num(); ++Index)
+            {
+                OutFeatures.JustRTInterestPoints[Index].TrackId = QuadIds[Index];
+            }
+            S.QuadPoints = MoveTemp(DetectedQuads);
+            S.Quads = OutFeatures.JustRTInterestPoints;
+
+            S.KeyframeTrackCount = S.CornerIds.Num() + S.Quads.Num();
+            S.FramesSinceKeyframe = 0;
+        }
+        else
+        {
+            // Frame rastreado: as trilhas vivas são a saída, sem goodFeaturesToTrack nem contornos
+            OutFeatures.bIsKeyframe = false;
+            if (EnumHasAnyFlags(Stages, EOCV_FeatureStage::Corners))
+            {
+                OutFeatures.CornerIds = S.CornerIds;
+                for (const cv::Point2f& Point : S.CornerPoints)
+                {
+                    const cv::Point2f FramePoint = Context.ToFrame(Point);
+                    OutFeatures.Corners.Add(FVector2D(FramePoint.x, FramePoint.y));
+                    Context.Corners.push_back(FramePoint);
+                }
+            }
+            if (EnumHasAnyFlags(Stages, EOCV_FeatureStage::Quads))
+            {
+                for (int32 Index = 0; Index < S.Quads.Num(); ++Index)
+                {
+                    FOCV_NativeJustRTPoint Quad = S.Quads[Index];
+                    const cv::Point2f FramePoint = Context.ToFrame(S.QuadPoints[Index]);
+                    Quad.Point2D = FVector2D(FramePoint.x, FramePoint.y);
+                    OutFeatures.JustRTInterestPoints.Add(Quad);
+                    Context.Shapes.push_back(cv::RotatedRect(FramePoint, cv::Size2f((float)Quad.Size2D.X, (float)Quad.Size2D.Y), Quad.Angle));
+                }
+                RecountShapesBySize(OutFeatures);
+            }
+        }
+
+        if (EnumHasAnyFlags(Stages, EOCV_FeatureStage::DebugOverlay))
+        {
+            RunDebugOverlayStage(Context, OutFeatures); // Coordenadas da janela, como os pontos
+        }
+        // Coordenadas da janela -> frame; os histogramas cobrem as regiões (não a janela alinhada)
+        OffsetFeatures(OutFeatures, Window.tl());
+        if (EnumHasAnyFlags(Stages, EOCV_FeatureStage::Histograms))
+        {
+            CountRegionHistograms(Frame, Regions, Params, OutFeatures);
+        }
+        if (EnumHasAnyFlags(Stages, EOCV_FeatureStage::DebugOverlay))
+        {
+            AppendRegionOutlines(Regions, Params, OutFeatures.Overlay);
+        }
+        S.PrevGray = Gray; // Cabeçalho com contagem de referência: o cinza sobrevive ao contexto
+        S.Window = Window;
+        S.DetectionFactor = Context.DetectionFactor;
+    }
 
     TArray<FString> ListWebcamDevicesNative()
     {
@@ -224,6 +923,72 @@ namespace IVROpenCVBridge
     }
 #else // WITH_OPENCV == 0
     // Forneça implementações de fallback para plataformas sem OpenCV
+    void ExtractFeatureStages(
+        uint8* PixelData,
+        int32 Width,
+        int32 Height,
+        EOCV_FeatureStage Stages,
+        const FOCV_FeatureStageParams& Params,
+        FOCV_NativeJustRTFeatures& OutFeatures
+    )
+    {
+        OutFeatures.Reset();
+        // Histogramas não dependem do OpenCV; as demais etapas não rodam nesta plataforma
+        if (EnumHasAnyFlags(Stages, EOCV_FeatureStage::Histograms) && PixelData && Width > 0 && Height > 0)
+        {
+            // Mesmas regras de ResolveRegions: recorte ao frame e regiões sobrepostas fundidas
+            TArray<FIntRect> Regions;
+            for (FIntRect Region : Params.Regions)
+            {
+                Region.Clip(FIntRect(0, 0, Width, Height));
+                if (Region.Width() > 0 && Region.Height() > 0)
+                {
+                    Regions.Add(Region);
+                }
+            }
+            if (Params.Regions.Num() == 0)
+            {
+                Regions.Add(FIntRect(0, 0, Width, Height));
+            }
+            for (bool bMerged = true; bMerged; )
+            {
+                bMerged = false;
+                for (int32 A = 0; A < Regions.Num() && !bMerged; ++A)
+                {
+                    for (int32 B = A + 1; B < Regions.Num(); ++B)
+                    {
+                        if (Regions[A].Intersect(Regions[B]))
+                        {
+                            Regions[A].Union(Regions[B]);
+                            Regions.RemoveAtSwap(B);
+                            bMerged = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            const SIZE_T Pitch = (SIZE_T)Width * 4;
+            FIVR_HistogramKernel::FCounts Total;
+            FIVR_HistogramKernel::FCounts RegionCounts;
+            FMemory::Memzero(&Total, sizeof(Total));
+            int64 NumSamples = 0;
+            for (const FIntRect& Region : Regions)
+            {
+                const uint8* RegionData = PixelData + (SIZE_T)Region.Min.Y * Pitch + (SIZE_T)Region.Min.X * 4;
+                NumSamples += FIVR_HistogramKernel::Count(RegionData, Region.Width(), Region.Height(), Params.HistogramSubsample, RegionCounts, Pitch);
+                FIVR_HistogramKernel::Accumulate(Total, RegionCounts);
+            }
+            if (NumSamples > 0)
+            {
+                FIVR_HistogramKernel::Normalize(Total, OutFeatures.HistogramBlue, OutFeatures.HistogramGreen, OutFeatures.HistogramRed);
+            }
+        }
+        if (EnumHasAnyFlags(Stages, EOCV_FeatureStage::Corners | EOCV_FeatureStage::Quads | EOCV_FeatureStage::DebugOverlay))
+        {
+            UE_LOG(LogIVROpenCVBridge, Warning, TEXT("OpenCV não habilitado para a plataforma. Etapas Corners/Quads/DebugOverlay de ExtractFeatureStages são operações vazias (no-op)."));
+        }
+    }
+
     void ProcessFrameAndExtractFeatures(
         uint8* PixelData,
         int32 Width,
@@ -249,7 +1014,30 @@ namespace IVROpenCVBridge
         OutFeatures.HistogramBlue.Empty();
         // --- FIM DA CORREÇÃO ---
     }
+
+    void DrawOverlay(uint8* PixelData, int32 Width, int32 Height, const TArray<FOCV_OverlayPrimitive>& Overlay)
+    {
+        // Sem OpenCV nenhuma etapa gera primitivas de overlay
+    }
     
+    // Sem OpenCV não há rastreamento: cada frame passa pelas etapas disponíveis
+    struct FOCV_FeatureTracker::FState
+    {
+    };
+
+    void FOCV_FeatureTracker::ProcessFrame(
+        uint8* PixelData,
+        int32 Width,
+        int32 Height,
+        EOCV_FeatureStage Stages,
+        const FOCV_FeatureStageParams& Params,
+        const FOCV_TrackerSettings& Settings,
+        FOCV_NativeJustRTFeatures& OutFeatures
+    )
+    {
+        ExtractFeatureStages(PixelData, Width, Height, Stages, Params, OutFeatures);
+    }
+
     bool LoadAndResizeImage(const FString& FilePath, int32 TargetWidth, int32 TargetHeight, TArray<uint8>& OutRawData)
     {
         UE_LOG(LogIVROpenCVBridge, Warning, TEXT("OpenCV não habilitado para a plataforma. LoadAndResizeImage será implementado no fallback do ImageLoadingHelpers.cpp."));
@@ -266,4 +1054,19 @@ namespace IVROpenCVBridge
     }
 #endif // WITH_OPENCV
 
+    FOCV_FeatureTracker::FOCV_FeatureTracker()
+        : State(MakeUnique<FState>())
+    {
+    }
+
+    FOCV_FeatureTracker::~FOCV_FeatureTracker()
+    {
+    }
+
+    void FOCV_FeatureTracker::Reset()
+    {
+        FScopeLock Lock(&Mutex);
+        State = MakeUnique<FState>();
+    }
+
 } // namespace IVROpenCVBridge
\ No newline at end of file
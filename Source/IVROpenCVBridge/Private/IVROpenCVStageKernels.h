@@ -0,0 +1,65 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IVROpenCVGlobals.h"
+
+#if WITH_OPENCV
+#include "PreOpenCVHeaders.h"
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "PostOpenCVHeaders.h"
+
+/**
+ * Algoritmos das etapas embutidas, compartilhados pela extração fixa, pelo FOCV_FeatureTracker e pelo
+ * FOCV_CVStageGraph. Nenhuma função guarda estado: todas podem rodar em paralelo sobre Mats diferentes.
+ * Definidas em IVROpenCVGlobals.cpp.
+ */
+namespace IVROpenCVBridge::StageKernels
+{
+    /** Fator de redução (potência de 2) das imagens de detecção de Corners e Quads. */
+    int32 ResolveDetectionFactor(int32 Width, int32 Height, const FOCV_FeatureStageParams& Params);
+
+    /** Converte um ponto da imagem de detecção para o frame (centros de pixel alinhados). */
+    cv::Point2f ToFrame(const cv::Point2f& DetectionPoint, int32 DetectionFactor);
+
+    /** Inverso de ToFrame. */
+    cv::Point2f FromFrame(const cv::Point2f& FramePoint, int32 DetectionFactor);
+
+    /** Cinza de um Mat BGRA, reduzido por área em DetectionFactor (1 = resolução cheia). */
+    void ReduceToGray(const cv::Mat& BGRA, int32 DetectionFactor, cv::Mat& OutGray);
+
+    /** goodFeaturesToTrack na imagem de detecção; cantos de saída em coordenadas do frame. GetFullGray só é chamado com bRefineCornersAtFullResolution. */
+    void DetectCorners(const cv::Mat& DetectionGray, int32 DetectionFactor, const FOCV_FeatureStageParams& Params,
+                       TFunctionRef<const cv::Mat&()> GetFullGray, std::vector<cv::Point2f>& OutCorners);
+
+    /** Limiar adaptativo usado pela etapa Quads. */
+    void ThresholdForQuads(const cv::Mat& DetectionGray, cv::Mat& OutBinary);
+
+    /** Contornos do binário classificados em quadrados/retângulos; preenche pontos, contagens e índices de OutFeatures. */
+    void DetectQuads(const cv::Mat& Binary, int32 Width, int32 Height, int32 DetectionFactor,
+                     FOCV_NativeJustRTFeatures& OutFeatures, std::vector<cv::RotatedRect>& OutShapes);
+
+    /** Primitivas da etapa DebugOverlay: contornos em verde, cantos em vermelho. */
+    void AppendShapesAndCorners(const std::vector<cv::RotatedRect>& Shapes, const std::vector<cv::Point2f>& Corners, TArray<FOCV_OverlayPrimitive>& OutOverlay);
+
+    /** Recalcula contagens e índices de maior/menor depois de juntar pontos de várias origens. */
+    void RecountShapesBySize(FOCV_NativeJustRTFeatures& OutFeatures);
+
+    /** Regiões de interesse recortadas ao frame e fundidas quando se sobrepõem. Sem regiões = frame inteiro. */
+    TArray<cv::Rect> ResolveRegions(const FOCV_FeatureStageParams& Params, int32 Width, int32 Height);
+
+    /** Desloca pontos, cantos e primitivas do overlay de coordenadas da região para coordenadas do frame. */
+    void OffsetFeatures(FOCV_NativeJustRTFeatures& Features, const cv::Point& Origin);
+
+    /** Histogramas B/G/R somados sobre as regiões e normalizados uma vez. */
+    void CountRegionHistograms(const cv::Mat& Frame, const TArray<cv::Rect>& Regions, const FOCV_FeatureStageParams& Params, FOCV_NativeJustRTFeatures& OutFeatures);
+
+    /** Contorno azul de cada região no overlay (só quando há regiões explícitas). */
+    void AppendRegionOutlines(const TArray<cv::Rect>& Regions, const FOCV_FeatureStageParams& Params, TArray<FOCV_OverlayPrimitive>& OutOverlay);
+}
+#endif
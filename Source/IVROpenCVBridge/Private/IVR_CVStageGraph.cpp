@@ -0,0 +1,802 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#include "IVR_CVStageGraph.h"
+#include "IVROpenCVStageKernels.h"
+#include "Misc/ScopeLock.h"
+#include "Async/ParallelFor.h"
+
+namespace IVROpenCVBridge
+{
+    const FName FOCV_CVStageKeys::Gray(TEXT("Gray"));
+    const FName FOCV_CVStageKeys::DetectionGray(TEXT("DetectionGray"));
+    const FName FOCV_CVStageKeys::Blur(TEXT("Blur"));
+    const FName FOCV_CVStageKeys::Threshold(TEXT("Threshold"));
+    const FName FOCV_CVStageKeys::QuadShapes(TEXT("QuadShapes"));
+    const FName FOCV_CVStageKeys::CornerPoints(TEXT("CornerPoints"));
+
+    // --- Contexto ---
+
+    struct FOCV_CVStageContext::FImpl
+    {
+        FImpl(const FOCV_FeatureStageParams& InParams, const TArray<FIntRect>& InRegions, const FOCV_NativeJustRTFeatures& InMergedFeatures)
+            : Params(InParams)
+            , Regions(InRegions)
+            , MergedFeatures(InMergedFeatures)
+        {
+        }
+
+#if WITH_OPENCV
+        cv::Mat Frame;
+        TMap<FName, cv::Mat> Mats; // Uma entrada por chave publicada no escopo, criada antes de rodar: sem realocação durante as ondas paralelas
+#endif
+        FIntPoint Origin = FIntPoint::ZeroValue;
+        int32 DetectionFactor = 1;
+        const FOCV_FeatureStageParams& Params;
+        const TArray<FIntRect>& Regions;
+        const FOCV_NativeJustRTFeatures& MergedFeatures;
+    };
+
+#if WITH_OPENCV
+    cv::Mat& FOCV_CVStageContext::GetFrame() const
+    {
+        return Impl.Frame;
+    }
+
+    const cv::Mat& FOCV_CVStageContext::GetMat(FName Key) const
+    {
+        static const cv::Mat Empty;
+        const cv::Mat* Mat = Impl.Mats.Find(Key);
+        return Mat ? *Mat : Empty;
+    }
+
+    void FOCV_CVStageContext::SetMat(FName Key, const cv::Mat& Mat)
+    {
+        cv::Mat* Slot = Impl.Mats.Find(Key);
+        if (!ensureMsgf(Slot != nullptr, TEXT("IVROpenCVBridge: a chave '%s' não foi declarada em GetOutputs()."), *Key.ToString()))
+        {
+            return;
+        }
+        *Slot = Mat;
+    }
+#endif
+
+    bool FOCV_CVStageContext::HasMat(FName Key) const
+    {
+#if WITH_OPENCV
+        const cv::Mat* Mat = Impl.Mats.Find(Key);
+        return Mat != nullptr && !Mat->empty();
+#else
+        return false;
+#endif
+    }
+
+    FIntPoint FOCV_CVStageContext::GetOrigin() const
+    {
+        return Impl.Origin;
+    }
+
+    const TArray<FIntRect>& FOCV_CVStageContext::GetRegions() const
+    {
+        return Impl.Regions;
+    }
+
+    int32 FOCV_CVStageContext::GetDetectionFactor() const
+    {
+        return Impl.DetectionFactor;
+    }
+
+    const FOCV_FeatureStageParams& FOCV_CVStageContext::GetParams() const
+    {
+        return Impl.Params;
+    }
+
+    const FOCV_NativeJustRTFeatures& FOCV_CVStageContext::GetMergedFeatures() const
+    {
+        return Impl.MergedFeatures;
+    }
+
+    // --- Etapas embutidas ---
+
+#if WITH_OPENCV
+    namespace
+    {
+        using namespace StageKernels;
+
+        class FGrayStage : public FOCV_CVStage
+        {
+        public:
+            virtual FName GetName() const override { return TEXT("Gray"); }
+            virtual TArray<FName> GetOutputs() const override { return { FOCV_CVStageKeys::Gray }; }
+            virtual void Execute(FOCV_CVStageContext& Context, FOCV_NativeJustRTFeatures& OutFeatures) override
+            {
+                cv::Mat Gray;
+                ReduceToGray(Context.GetFrame(), 1, Gray);
+                Context.SetMat(FOCV_CVStageKeys::Gray, Gray);
+            }
+        };
+
+        class FDetectionGrayStage : public FOCV_CVStage
+        {
+        public:
+            virtual FName GetName() const override { return TEXT("DetectionGray"); }
+            virtual TArray<FName> GetOutputs() const override { return { FOCV_CVStageKeys::DetectionGray }; }
+            virtual void Execute(FOCV_CVStageContext& Context, FOCV_NativeJustRTFeatures& OutFeatures) override
+            {
+                cv::Mat DetectionGray;
+                ReduceToGray(Context.GetFrame(), Context.GetDetectionFactor(), DetectionGray);
+                Context.SetMat(FOCV_CVStageKeys::DetectionGray, DetectionGray);
+            }
+        };
+
+        class FBlurStage : public FOCV_CVStage
+        {
+        public:
+            virtual FName GetName() const override { return TEXT("Blur"); }
+            virtual TArray<FName> GetInputs() const override { return { FOCV_CVStageKeys::DetectionGray }; }
+            virtual TArray<FName> GetOutputs() const override { return { FOCV_CVStageKeys::Blur }; }
+            virtual void Execute(FOCV_CVStageContext& Context, FOCV_NativeJustRTFeatures& OutFeatures) override
+            {
+                cv::Mat Blurred;
+                cv::GaussianBlur(Context.GetMat(FOCV_CVStageKeys::DetectionGray), Blurred, cv::Size(5, 5), 0);
+                Context.SetMat(FOCV_CVStageKeys::Blur, Blurred);
+            }
+        };
+
+        class FThresholdStage : public FOCV_CVStage
+        {
+        public:
+            virtual FName GetName() const override { return TEXT("Threshold"); }
+            virtual TArray<FName> GetInputs() const override { return { FOCV_CVStageKeys::DetectionGray }; }
+            virtual TArray<FName> GetOutputs() const override { return { FOCV_CVStageKeys::Threshold }; }
+            virtual void Execute(FOCV_CVStageContext& Context, FOCV_NativeJustRTFeatures& OutFeatures) override
+            {
+                cv::Mat Binary;
+                ThresholdForQuads(Context.GetMat(FOCV_CVStageKeys::DetectionGray), Binary);
+                Context.SetMat(FOCV_CVStageKeys::Threshold, Binary);
+            }
+        };
+
+        /** Contornos do limiar classificados em quadrados/retângulos. Publica os retângulos rotacionados para o overlay. */
+        class FQuadStage : public FOCV_CVStage
+        {
+        public:
+            virtual FName GetName() const override { return TEXT("Quads"); }
+            virtual TArray<FName> GetInputs() const override { return { FOCV_CVStageKeys::Threshold }; }
+            virtual TArray<FName> GetOutputs() const override { return { FOCV_CVStageKeys::QuadShapes }; }
+            virtual bool IsTerminal() const override { return true; }
+            virtual void Execute(FOCV_CVStageContext& Context, FOCV_NativeJustRTFeatures& OutFeatures) override
+            {
+                const cv::Mat& Frame = Context.GetFrame();
+                std::vector<cv::RotatedRect> Shapes;
+                DetectQuads(Context.GetMat(FOCV_CVStageKeys::Threshold), Frame.cols, Frame.rows, Context.GetDetectionFactor(), OutFeatures, Shapes);
+
+                cv::Mat ShapesMat((int)Shapes.size(), 5, CV_32F);
+                for (int32 Index = 0; Index < (int32)Shapes.size(); ++Index)
+                {
+                    float* Row = ShapesMat.ptr<float>(Index);
+                    Row[0] = Shapes[Index].center.x;
+                    Row[1] = Shapes[Index].center.y;
+                    Row[2] = Shapes[Index].size.width;
+                    Row[3] = Shapes[Index].size.height;
+                    Row[4] = Shapes[Index].angle;
+                }
+                Context.SetMat(FOCV_CVStageKeys::QuadShapes, ShapesMat);
+            }
+        };
+
+        /** goodFeaturesToTrack na imagem de detecção. Usa o cinza cheio do grafo no refinamento, se alguma etapa o publicar. */
+        class FCornerStage : public FOCV_CVStage
+        {
+        public:
+            virtual FName GetName() const override { return TEXT("Corners"); }
+            virtual TArray<FName> GetInputs() const override { return { FOCV_CVStageKeys::DetectionGray }; }
+            virtual TArray<FName> GetOutputs() const override { return { FOCV_CVStageKeys::CornerPoints }; }
+            virtual bool IsTerminal() const override { return true; }
+            virtual void Execute(FOCV_CVStageContext& Context, FOCV_NativeJustRTFeatures& OutFeatures) override
+            {
+                cv::Mat LocalGray;
+                auto GetFullGray = [&Context, &LocalGray]() -> const cv::Mat&
+                {
+                    if (Context.HasMat(FOCV_CVStageKeys::Gray))
+                    {
+                        return Context.GetMat(FOCV_CVStageKeys::Gray);
+                    }
+                    ReduceToGray(Context.GetFrame(), 1, LocalGray);
+                    return LocalGray;
+                };
+                std::vector<cv::Point2f> Corners;
+                DetectCorners(Context.GetMat(FOCV_CVStageKeys::DetectionGray), Context.GetDetectionFactor(), Context.GetParams(), GetFullGray, Corners);
+
+                OutFeatures.Corners.Reset((int32)Corners.size());
+                for (const cv::Point2f& Corner : Corners)
+                {
+                    OutFeatures.Corners.Add(FVector2D(Corner.x, Corner.y));
+                }
+                if (!Corners.empty())
+                {
+                    Context.SetMat(FOCV_CVStageKeys::CornerPoints, cv::Mat(Corners, true).reshape(1)); // N x 2
+                }
+            }
+        };
+
+        /** Histogramas somando todas as regiões: roda uma vez por frame. */
+        class FHistogramStage : public FOCV_CVStage
+        {
+        public:
+            virtual FName GetName() const override { return TEXT("Histograms"); }
+            virtual EOCV_CVStageScope GetScope() const override { return EOCV_CVStageScope::PerFrame; }
+            virtual void Execute(FOCV_CVStageContext& Context, FOCV_NativeJustRTFeatures& OutFeatures) override
+            {
+                TArray<cv::Rect> Regions;
+                Regions.Reserve(Context.GetRegions().Num());
+                for (const FIntRect& Region : Context.GetRegions())
+                {
+                    Regions.Add(cv::Rect(Region.Min.X, Region.Min.Y, Region.Width(), Region.Height()));
+                }
+                CountRegionHistograms(Context.GetFrame(), Regions, Context.GetParams(), OutFeatures);
+            }
+        };
+
+        /** Primitivas do que Quads e Corners publicaram (entradas opcionais) e do contorno da região. Não escreve nos pixels. */
+        class FDebugOverlayStage : public FOCV_CVStage
+        {
+        public:
+            virtual FName GetName() const override { return TEXT("DebugOverlay"); }
+            virtual TArray<FName> GetOptionalInputs() const override { return { FOCV_CVStageKeys::QuadShapes, FOCV_CVStageKeys::CornerPoints }; }
+            virtual void Execute(FOCV_CVStageContext& Context, FOCV_NativeJustRTFeatures& OutFeatures) override
+            {
+                std::vector<cv::RotatedRect> Shapes;
+                if (Context.HasMat(FOCV_CVStageKeys::QuadShapes))
+                {
+                    const cv::Mat& ShapesMat = Context.GetMat(FOCV_CVStageKeys::QuadShapes);
+                    for (int32 Index = 0; Index < ShapesMat.rows; ++Index)
+                    {
+                        const float* Row = ShapesMat.ptr<float>(Index);
+                        Shapes.push_back(cv::RotatedRect(cv::Point2f(Row[0], Row[1]), cv::Size2f(Row[2], Row[3]), Row[4]));
+                    }
+                }
+                std::vector<cv::Point2f> Corners;
+                if (Context.HasMat(FOCV_CVStageKeys::CornerPoints))
+                {
+                    const cv::Mat& CornersMat = Context.GetMat(FOCV_CVStageKeys::CornerPoints);
+                    for (int32 Index = 0; Index < CornersMat.rows; ++Index)
+                    {
+                        Corners.push_back(cv::Point2f(CornersMat.at<float>(Index, 0), CornersMat.at<float>(Index, 1)));
+                    }
+                }
+                const cv::Mat& Frame = Context.GetFrame();
+                AppendShapesAndCorners(Shapes, Corners, OutFeatures.Overlay);
+                AppendRegionOutlines({ cv::Rect(0, 0, Frame.cols, Frame.rows) }, Context.GetParams(), OutFeatures.Overlay);
+            }
+        };
+
+        /** Junta um resultado parcial; pontos vindos de mais de uma origem pedem recontagem de maior/menor. */
+        void MergeFeatures(FOCV_NativeJustRTFeatures& Into, FOCV_NativeJustRTFeatures& From, bool& bOutNeedsRecount)
+        {
+            if (From.JustRTInterestPoints.Num() > 0)
+            {
+                if (Into.JustRTInterestPoints.Num() == 0)
+                {
+                    Into.JustRTInterestPoints = MoveTemp(From.JustRTInterestPoints);
+                    Into.BiggestPointIndex = From.BiggestPointIndex;
+                    Into.SmallerPointIndex = From.SmallerPointIndex;
+                    Into.NumOfQuads = From.NumOfQuads;
+                    Into.NumOfRectangles = From.NumOfRectangles;
+                }
+                else
+                {
+                    Into.JustRTInterestPoints.Append(From.JustRTInterestPoints);
+                    bOutNeedsRecount = true;
+                }
+            }
+            Into.Corners.Append(From.Corners);
+            Into.CornerIds.Append(From.CornerIds);
+            Into.Overlay.Append(From.Overlay);
+            if (From.HistogramRed.Num() > 0)
+            {
+                Into.HistogramRed = MoveTemp(From.HistogramRed);
+                Into.HistogramGreen = MoveTemp(From.HistogramGreen);
+                Into.HistogramBlue = MoveTemp(From.HistogramBlue);
+            }
+        }
+
+        void RecountMergedShapes(FOCV_NativeJustRTFeatures& Features)
+        {
+            Features.NumOfQuads = 0;
+            Features.NumOfRectangles = 0;
+            Features.BiggestPointIndex = INDEX_NONE;
+            Features.SmallerPointIndex = INDEX_NONE;
+            RecountShapesBySize(Features);
+        }
+    }
+#endif
+
+    // --- Plano de execução ---
+
+    /** Etapas válidas e necessárias, em ondas: cada onda só depende das anteriores e roda em paralelo. */
+    struct FOCV_CVStageGraph::FPlan
+    {
+        struct FScope
+        {
+            TArray<TArray<int32>> Waves;
+            TArray<int32> Writers;  // Em ordem de inserção, uma por vez, depois das ondas
+            TArray<int32> Order;    // Ondas seguidas dos escritores (ordem de junção dos resultados)
+            TArray<FName> Keys;     // Chaves publicadas no escopo
+        };
+
+        TArray<FStageRef> Stages;
+        TArray<FName> Names;
+        FScope RegionScope;
+        FScope FrameScope;
+
+        FPlan(const TArray<FStageRef>& AllStages, TSet<FName>& WarnedStages)
+        {
+            const int32 Num = AllStages.Num();
+            TArray<TArray<FName>> Inputs;
+            TArray<TArray<FName>> OptionalInputs;
+            TArray<TArray<FName>> Outputs;
+            TArray<bool> bValid;
+            Inputs.SetNum(Num);
+            OptionalInputs.SetNum(Num);
+            Outputs.SetNum(Num);
+            bValid.Init(true, Num);
+            for (int32 Index = 0; Index < Num; ++Index)
+            {
+                Inputs[Index] = AllStages[Index]->GetInputs();
+                OptionalInputs[Index] = AllStages[Index]->GetOptionalInputs();
+                Outputs[Index] = AllStages[Index]->GetOutputs();
+            }
+            auto Discard = [&](int32 Index, const FString& Reason)
+            {
+                bValid[Index] = false;
+                const FName Name = AllStages[Index]->GetName();
+                if (!WarnedStages.Contains(Name))
+                {
+                    WarnedStages.Add(Name);
+                    UE_LOG(LogIVROpenCVBridge, Warning, TEXT("IVROpenCVBridge: Etapa '%s' descartada do grafo: %s"), *Name.ToString(), *Reason);
+                }
+            };
+
+            // Descarta etapas cujas entradas ninguém publica (no mesmo escopo), até estabilizar
+            TMap<FName, int32> Producers;
+            for (bool bChanged = true; bChanged; )
+            {
+                bChanged = false;
+                Producers.Reset();
+                for (int32 Index = 0; Index < Num; ++Index)
+                {
+                    for (const FName& Key : Outputs[Index])
+                    {
+                        if (!bValid[Index])
+                        {
+                            break;
+                        }
+                        if (const int32* Other = Producers.Find(Key))
+                        {
+                            Discard(Index, FString::Printf(TEXT("a chave '%s' já é publicada por '%s'"), *Key.ToString(), *AllStages[*Other]->GetName().ToString()));
+                            bChanged = true;
+                        }
+                        else
+                        {
+                            Producers.Add(Key, Index);
+                        }
+                    }
+                }
+                for (int32 Index = 0; Index < Num && !bChanged; ++Index)
+                {
+                    for (const FName& Key : Inputs[Index])
+                    {
+                        if (!bValid[Index])
+                        {
+                            break;
+                        }
+                        const int32* Producer = Producers.Find(Key);
+                        if (Producer == nullptr || *Producer == Index
+                            || AllStages[*Producer]->GetScope() != AllStages[Index]->GetScope()
+                            || (AllStages[*Producer]->WritesFrame() && !AllStages[Index]->WritesFrame()))
+                        {
+                            Discard(Index, FString::Printf(TEXT("nenhuma etapa compatível publica '%s'"), *Key.ToString()));
+                            bChanged = true;
+                        }
+                    }
+                }
+            }
+
+            // Só as etapas terminais e o que elas leem (direta ou indiretamente) rodam
+            TArray<bool> bNeeded;
+            bNeeded.Init(false, Num);
+            TArray<int32> Pending;
+            for (int32 Index = 0; Index < Num; ++Index)
+            {
+                if (bValid[Index] && AllStages[Index]->IsTerminal())
+                {
+                    bNeeded[Index] = true;
+                    Pending.Add(Index);
+                }
+            }
+            while (Pending.Num() > 0)
+            {
+                const int32 Index = Pending.Pop(EAllowShrinking::No);
+                for (const FName& Key : Inputs[Index])
+                {
+                    const int32 Producer = Producers.FindChecked(Key);
+                    if (!bNeeded[Producer])
+                    {
+                        bNeeded[Producer] = true;
+                        Pending.Add(Producer);
+                    }
+                }
+            }
+
+            TArray<int32> PlanIndices;
+            PlanIndices.Init(INDEX_NONE, Num);
+            auto BuildScope = [&](EOCV_CVStageScope ScopeKind, FScope& Scope)
+            {
+                TArray<int32> Remaining;
+                TArray<int32> Writers;
+                for (int32 Index = 0; Index < Num; ++Index)
+                {
+                    if (bNeeded[Index] && AllStages[Index]->GetScope() == ScopeKind)
+                    {
+                        (AllStages[Index]->WritesFrame() ? Writers : Remaining).Add(Index);
+                    }
+                }
+                auto PlanStage = [&](int32 Index)
+                {
+                    PlanIndices[Index] = Stages.Add(AllStages[Index]);
+                    Names.Add(AllStages[Index]->GetName());
+                    Scope.Keys.Append(Outputs[Index]);
+                    Scope.Order.Add(PlanIndices[Index]);
+                    return PlanIndices[Index];
+                };
+                // Entradas opcionais só esperam produtores que vão rodar nas ondas deste escopo
+                TSet<FName> Planned;
+                for (int32 Index : Remaining)
+                {
+                    Planned.Append(Outputs[Index]);
+                }
+                TSet<FName> Available;
+                while (Remaining.Num() > 0)
+                {
+                    TArray<int32> Wave;
+                    for (int32 Index : Remaining)
+                    {
+                        bool bReady = true;
+                        for (const FName& Key : Inputs[Index])
+                        {
+                            bReady &= Available.Contains(Key);
+                        }
+                        for (const FName& Key : OptionalInputs[Index])
+                        {
+                            bReady &= !Planned.Contains(Key) || Available.Contains(Key);
+                        }
+                        if (bReady)
+                        {
+                            Wave.Add(Index);
+                        }
+                    }
+                    if (Wave.Num() == 0)
+                    {
+                        for (int32 Index : Remaining)
+                        {
+                            Discard(Index, TEXT("dependência circular"));
+                        }
+                        break;
+                    }
+                    TArray<int32>& PlannedWave = Scope.Waves.AddDefaulted_GetRef();
+                    for (int32 Index : Wave)
+                    {
+                        PlannedWave.Add(PlanStage(Index));
+                        Remaining.Remove(Index);
+                    }
+                    for (int32 Index : Wave)
+                    {
+                        Available.Append(Outputs[Index]);
+                    }
+                }
+                for (int32 Index : Writers)
+                {
+                    bool bReady = true;
+                    for (const FName& Key : Inputs[Index])
+                    {
+                        bReady &= Available.Contains(Key);
+                    }
+                    if (!bReady)
+                    {
+                        Discard(Index, TEXT("lê a saída de uma etapa que escreve no frame e roda depois dela"));
+                        continue;
+                    }
+                    Scope.Writers.Add(PlanStage(Index));
+                    Available.Append(Outputs[Index]);
+                }
+            };
+            BuildScope(EOCV_CVStageScope::PerRegion, RegionScope);
+            BuildScope(EOCV_CVStageScope::PerFrame, FrameScope);
+        }
+    };
+
+    // --- Grafo ---
+
+    FOCV_CVStageGraph::FOCV_CVStageGraph()
+    {
+    }
+
+    FOCV_CVStageGraph::~FOCV_CVStageGraph()
+    {
+    }
+
+    void FOCV_CVStageGraph::AddStage(FStageRef Stage)
+    {
+        FScopeLock Lock(&StagesMutex);
+        const FName Name = Stage->GetName();
+        Stages.RemoveAll([Name](const FStageRef& Existing) { return Existing->GetName() == Name; });
+        Stages.Add(Stage);
+        WarnedStages.Remove(Name);
+        CachedPlan.Reset();
+    }
+
+    bool FOCV_CVStageGraph::RemoveStage(FName Name)
+    {
+        FScopeLock Lock(&StagesMutex);
+        const int32 NumRemoved = Stages.RemoveAll([Name](const FStageRef& Existing) { return Existing->GetName() == Name; });
+        CachedPlan.Reset();
+        return NumRemoved > 0;
+    }
+
+    TArray<FName> FOCV_CVStageGraph::GetStageNames() const
+    {
+        FScopeLock Lock(&StagesMutex);
+        TArray<FName> Names;
+        for (const FStageRef& Stage : Stages)
+        {
+            Names.Add(Stage->GetName());
+        }
+        return Names;
+    }
+
+    void FOCV_CVStageGraph::AddBuiltInStages(EOCV_FeatureStage InStages)
+    {
+#if WITH_OPENCV
+        // Produtores de intermediários: podados quando nenhuma etapa os lê
+        AddStage(MakeShared<FGrayStage, ESPMode::ThreadSafe>());
+        AddStage(MakeShared<FDetectionGrayStage, ESPMode::ThreadSafe>());
+        AddStage(MakeShared<FBlurStage, ESPMode::ThreadSafe>());
+        AddStage(MakeShared<FThresholdStage, ESPMode::ThreadSafe>());
+        if (EnumHasAnyFlags(InStages, EOCV_FeatureStage::Quads))
+        {
+            AddStage(MakeShared<FQuadStage, ESPMode::ThreadSafe>());
+        }
+        if (EnumHasAnyFlags(InStages, EOCV_FeatureStage::Corners))
+        {
+            AddStage(MakeShared<FCornerStage, ESPMode::ThreadSafe>());
+        }
+        if (EnumHasAnyFlags(InStages, EOCV_FeatureStage::Histograms))
+        {
+            AddStage(MakeShared<FHistogramStage, ESPMode::ThreadSafe>());
+        }
+        if (EnumHasAnyFlags(InStages, EOCV_FeatureStage::DebugOverlay))
+        {
+            AddStage(MakeShared<FDebugOverlayStage, ESPMode::ThreadSafe>());
+        }
+#endif
+    }
+
+    bool FOCV_CVStageGraph::AddBuiltInStage(FName Name, EOCV_FeatureStage InStages)
+    {
+#if WITH_OPENCV
+        TSharedPtr<FOCV_CVStage, ESPMode::ThreadSafe> Stage;
+        if (Name == FOCV_CVStageKeys::Gray)
+        {
+            Stage = MakeShared<FGrayStage, ESPMode::ThreadSafe>();
+        }
+        else if (Name == FOCV_CVStageKeys::DetectionGray)
+        {
+            Stage = MakeShared<FDetectionGrayStage, ESPMode::ThreadSafe>();
+        }
+        else if (Name == FOCV_CVStageKeys::Blur)
+        {
+            Stage = MakeShared<FBlurStage, ESPMode::ThreadSafe>();
+        }
+        else if (Name == FOCV_CVStageKeys::Threshold)
+        {
+            Stage = MakeShared<FThresholdStage, ESPMode::ThreadSafe>();
+        }
+        else if (Name == GetBuiltInStageName(EOCV_FeatureStage::Quads) && EnumHasAnyFlags(InStages, EOCV_FeatureStage::Quads))
+        {
+            Stage = MakeShared<FQuadStage, ESPMode::ThreadSafe>();
+        }
+        else if (Name == GetBuiltInStageName(EOCV_FeatureStage::Corners) && EnumHasAnyFlags(InStages, EOCV_FeatureStage::Corners))
+        {
+            Stage = MakeShared<FCornerStage, ESPMode::ThreadSafe>();
+        }
+        else if (Name == GetBuiltInStageName(EOCV_FeatureStage::Histograms) && EnumHasAnyFlags(InStages, EOCV_FeatureStage::Histograms))
+        {
+            Stage = MakeShared<FHistogramStage, ESPMode::ThreadSafe>();
+        }
+        else if (Name == GetBuiltInStageName(EOCV_FeatureStage::DebugOverlay) && EnumHasAnyFlags(InStages, EOCV_FeatureStage::DebugOverlay))
+        {
+            Stage = MakeShared<FDebugOverlayStage, ESPMode::ThreadSafe>();
+        }
+        if (Stage.IsValid())
+        {
+            AddStage(Stage.ToSharedRef());
+            return true;
+        }
+#endif
+        return false;
+    }
+
+    FName FOCV_CVStageGraph::GetBuiltInStageName(EOCV_FeatureStage Stage)
+    {
+        // Mesmos nomes de FQuadStage/FCornerStage/FHistogramStage/FDebugOverlayStage::GetName()
+        switch (Stage)
+        {
+            case EOCV_FeatureStage::Quads:          return FName(TEXT("Quads"));
+            case EOCV_FeatureStage::Corners:        return FName(TEXT("Corners"));
+            case EOCV_FeatureStage::Histograms:     return FName(TEXT("Histograms"));
+            case EOCV_FeatureStage::DebugOverlay:   return FName(TEXT("DebugOverlay"));
+            default:                                return NAME_None;
+        }
+    }
+
+    FOCV_CVStageGraph& FOCV_CVStageGraph::GetBuiltIn(EOCV_FeatureStage InStages)
+    {
+        static FCriticalSection BuiltInMutex;
+        static TMap<uint32, TUniquePtr<FOCV_CVStageGraph>> BuiltInGraphs; // No máximo uma por máscara de etapas
+        FScopeLock Lock(&BuiltInMutex);
+        TUniquePtr<FOCV_CVStageGraph>& Graph = BuiltInGraphs.FindOrAdd((uint32)InStages);
+        if (!Graph.IsValid())
+        {
+            Graph = MakeUnique<FOCV_CVStageGraph>();
+            Graph->AddBuiltInStages(InStages);
+        }
+        return *Graph;
+    }
+
+    TSharedPtr<const FOCV_CVStageGraph::FPlan, ESPMode::ThreadSafe> FOCV_CVStageGraph::GetPlan()
+    {
+        FScopeLock Lock(&StagesMutex);
+        if (!CachedPlan.IsValid())
+        {
+            CachedPlan = MakeShared<FPlan, ESPMode::ThreadSafe>(Stages, WarnedStages);
+        }
+        return CachedPlan;
+    }
+
+    void FOCV_CVStageGraph::Execute(uint8* PixelData, int32 Width, int32 Height, const FOCV_FeatureStageParams& Params, FOCV_NativeJustRTFeatures& OutFeatures)
+    {
+        OutFeatures.Reset();
+        if (PixelData == nullptr || Width <= 0 || Height <= 0)
+        {
+            UE_LOG(LogIVROpenCVBridge, Error, TEXT("IVROpenCVBridge: PixelData é inválido ou vazio. Não é possível processar features."));
+            return;
+        }
+
+#if WITH_OPENCV
+        const TSharedPtr<const FPlan, ESPMode::ThreadSafe> Plan = GetPlan();
+        if (Plan->Stages.Num() == 0)
+        {
+            return;
+        }
+        const TArray<cv::Rect> Regions = ResolveRegions(Params, Width, Height);
+        if (Regions.Num() == 0)
+        {
+            return; // Todas as regiões de interesse estão fora do frame
+        }
+        TArray<FIntRect> RegionRects;
+        for (const cv::Rect& Region : Regions)
+        {
+            RegionRects.Add(FIntRect(Region.x, Region.y, Region.x + Region.width, Region.y + Region.height));
+        }
+        cv::Mat Frame(Height, Width, CV_8UC4, PixelData); // Assume BGRA como entrada
+
+        TArray<double> Milliseconds;
+        Milliseconds.SetNumZeroed(Plan->Stages.Num());
+        TArray<FOCV_NativeJustRTFeatures> Partials;
+        Partials.SetNum(Plan->Stages.Num());
+
+        auto RunStage = [&](FOCV_CVStageContext& Context, int32 StageIndex)
+        {
+            Partials[StageIndex].Reset();
+            const uint64 StartCycles = FPlatformTime::Cycles64();
+            Plan->Stages[StageIndex]->Execute(Context, Partials[StageIndex]);
+            Milliseconds[StageIndex] += FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+        };
+        auto RunScope = [&](const FPlan::FScope& Scope, FOCV_CVStageContext::FImpl& Impl, FOCV_NativeJustRTFeatures& ScopeFeatures, bool& bOutNeedsRecount)
+        {
+            for (const FName& Key : Scope.Keys)
+            {
+                Impl.Mats.Add(Key);
+            }
+            FOCV_CVStageContext Context(Impl);
+            for (const TArray<int32>& Wave : Scope.Waves)
+            {
+                // Cada etapa da onda escreve só no próprio parcial e nas próprias chaves
+                ParallelFor(Wave.Num(), [&](int32 WaveIndex)
+                {
+                    RunStage(Context, Wave[WaveIndex]);
+                }, Wave.Num() == 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+            }
+            for (int32 StageIndex : Scope.Writers)
+            {
+                RunStage(Context, StageIndex);
+            }
+            for (int32 StageIndex : Scope.Order)
+            {
+                MergeFeatures(ScopeFeatures, Partials[StageIndex], bOutNeedsRecount);
+            }
+        };
+
+        bool bNeedsRecount = false;
+        if (Plan->RegionScope.Order.Num() > 0)
+        {
+            for (const cv::Rect& Region : Regions)
+            {
+                FOCV_CVStageContext::FImpl Impl(Params, RegionRects, OutFeatures);
+                Impl.Frame = Frame(Region); // Vista: sem cópia
+                Impl.Origin = FIntPoint(Region.x, Region.y);
+                Impl.DetectionFactor = ResolveDetectionFactor(Region.width, Region.height, Params);
+                FOCV_NativeJustRTFeatures RegionFeatures;
+                RunScope(Plan->RegionScope, Impl, RegionFeatures, bNeedsRecount);
+                OffsetFeatures(RegionFeatures, Region.tl());
+                MergeFeatures(OutFeatures, RegionFeatures, bNeedsRecount);
+            }
+        }
+        if (Plan->FrameScope.Order.Num() > 0)
+        {
+            FOCV_CVStageContext::FImpl Impl(Params, RegionRects, OutFeatures);
+            Impl.Frame = Frame;
+            Impl.DetectionFactor = ResolveDetectionFactor(Width, Height, Params);
+            FOCV_NativeJustRTFeatures FrameFeatures;
+            RunScope(Plan->FrameScope, Impl, FrameFeatures, bNeedsRecount);
+            MergeFeatures(OutFeatures, FrameFeatures, bNeedsRecount);
+        }
+        if (bNeedsRecount)
+        {
+            RecountMergedShapes(OutFeatures);
+        }
+        RecordTimings(*Plan, Milliseconds, OutFeatures);
+#else
+        static bool bWarned = false;
+        if (!bWarned)
+        {
+            bWarned = true;
+            UE_LOG(LogIVROpenCVBridge, Warning, TEXT("IVROpenCVBridge: OpenCV não disponível nesta plataforma; o grafo de etapas não roda."));
+        }
+#endif
+    }
+
+    void FOCV_CVStageGraph::RecordTimings(const FPlan& Plan, const TArray<double>& Milliseconds, FOCV_NativeJustRTFeatures& OutFeatures)
+    {
+        constexpr double AverageWeight = 0.1; // Média móvel: ~10 frames
+        OutFeatures.StageTimings.Reset(Plan.Names.Num());
+        FScopeLock Lock(&TimingMutex);
+        for (int32 Index = 0; Index < Plan.Names.Num(); ++Index)
+        {
+            const double Elapsed = Milliseconds[Index];
+            OutFeatures.StageTimings.Add({ Plan.Names[Index], (float)Elapsed });
+
+            FOCV_StageTimingStats& Stats = Timings.FindOrAdd(Plan.Names[Index]);
+            Stats.Stage = Plan.Names[Index];
+            Stats.LastMilliseconds = Elapsed;
+            Stats.AverageMilliseconds = Stats.NumRuns == 0 ? Elapsed : Stats.AverageMilliseconds + AverageWeight * (Elapsed - Stats.AverageMilliseconds);
+            Stats.MaxMilliseconds = FMath::Max(Stats.MaxMilliseconds, Elapsed);
+            ++Stats.NumRuns;
+        }
+    }
+
+    TArray<FOCV_StageTimingStats> FOCV_CVStageGraph::GetTimingStats() const
+    {
+        FScopeLock Lock(&TimingMutex);
+        TArray<FOCV_StageTimingStats> Stats;
+        Timings.GenerateValueArray(Stats);
+        return Stats;
+    }
+
+    void FOCV_CVStageGraph::ResetTimingStats()
+    {
+        FScopeLock Lock(&TimingMutex);
+        Timings.Reset();
+    }
+} // namespace IVROpenCVBridge
@@ -0,0 +1,195 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#include "IVR_FeatureCache.h"
+#include "Misc/ScopeLock.h"
+
+namespace
+{
+    constexpr uint64 Prime1 = 11400714785092373249ULL;
+    constexpr uint64 Prime2 = 14029467366897019727ULL;
+    constexpr uint64 Prime3 = 1609587929392839161ULL;
+    constexpr uint64 Prime4 = 9650029242287828579ULL;
+    constexpr uint64 Prime5 = 2870177450012600261ULL;
+
+    FORCEINLINE uint64 RotateLeft(uint64 Value, int32 Bits)
+    {
+        return (Value << Bits) | (Value >> (64 - Bits));
+    }
+
+    FORCEINLINE uint64 Read64(const uint8* Data)
+    {
+        uint64 Value;
+        FMemory::Memcpy(&Value, Data, sizeof(Value)); // Leitura desalinhada; vira um único load
+        return Value;
+    }
+
+    FORCEINLINE uint32 Read32(const uint8* Data)
+    {
+        uint32 Value;
+        FMemory::Memcpy(&Value, Data, sizeof(Value));
+        return Value;
+    }
+
+    FORCEINLINE uint64 Round(uint64 Accumulator, uint64 Input)
+    {
+        Accumulator += Input * Prime2;
+        Accumulator = RotateLeft(Accumulator, 31);
+        return Accumulator * Prime1;
+    }
+
+    FORCEINLINE uint64 MergeRound(uint64 Accumulator, uint64 Value)
+    {
+        Accumulator ^= Round(0, Value);
+        return Accumulator * Prime1 + Prime4;
+    }
+
+    /** Mistura um valor de parâmetro na chave. */
+    template<typename ValueType>
+    void HashValue(uint64& InOutKey, const ValueType& Value)
+    {
+        InOutKey = FIVR_FrameHash::Hash64(&Value, sizeof(Value), InOutKey);
+    }
+}
+
+uint64 FIVR_FrameHash::Hash64(const void* Data, SIZE_T NumBytes, uint64 Seed)
+{
+    const uint8* Cursor = static_cast<const uint8*>(Data);
+    const uint8* const End = Cursor + NumBytes;
+    uint64 Hash;
+
+    if (NumBytes >= 32)
+    {
+        // Quatro faixas independentes: sem dependência entre elas dentro de uma iteração
+        uint64 V1 = Seed + Prime1 + Prime2;
+        uint64 V2 = Seed + Prime2;
+        uint64 V3 = Seed;
+        uint64 V4 = Seed - Prime1;
+        const uint8* const Limit = End - 32;
+        do
+        {
+            V1 = Round(V1, Read64(Cursor));
+            V2 = Round(V2, Read64(Cursor + 8));
+            V3 = Round(V3, Read64(Cursor + 16));
+            V4 = Round(V4, Read64(Cursor + 24));
+            Cursor += 32;
+        } while (Cursor <= Limit);
+
+        Hash = RotateLeft(V1, 1) + RotateLeft(V2, 7) + RotateLeft(V3, 12) + RotateLeft(V4, 18);
+        Hash = MergeRound(Hash, V1);
+        Hash = MergeRound(Hash, V2);
+        Hash = MergeRound(Hash, V3);
+        Hash = MergeRound(Hash, V4);
+    }
+    else
+    {
+        Hash = Seed + Prime5;
+    }
+    Hash += (uint64)NumBytes;
+
+    for (; Cursor + 8 <= End; Cursor += 8)
+    {
+        Hash ^= Round(0, Read64(Cursor));
+        Hash = RotateLeft(Hash, 27) * Prime1 + Prime4;
+    }
+    if (Cursor + 4 <= End)
+    {
+        Hash ^= (uint64)Read32(Cursor) * Prime1;
+        Hash = RotateLeft(Hash, 23) * Prime2 + Prime3;
+        Cursor += 4;
+    }
+    for (; Cursor < End; ++Cursor)
+    {
+        Hash ^= (uint64)(*Cursor) * Prime5;
+        Hash = RotateLeft(Hash, 11) * Prime1;
+    }
+
+    // Avalanche final
+    Hash ^= Hash >> 33;
+    Hash *= Prime2;
+    Hash ^= Hash >> 29;
+    Hash *= Prime3;
+    Hash ^= Hash >> 32;
+    return Hash;
+}
+
+FIVR_FeatureCache::FIVR_FeatureCache(int32 InCapacity)
+    : Capacity(FMath::Max(1, InCapacity))
+{
+    Entries.Reserve(Capacity);
+}
+
+uint64 FIVR_FeatureCache::MakeKey(const uint8* PixelData, int32 Width, int32 Height, EOCV_FeatureStage Stages, const FOCV_FeatureStageParams& Params)
+{
+    uint64 Key = FIVR_FrameHash::Hash64(PixelData, PixelData ? (SIZE_T)Width * Height * 4 : 0);
+    HashValue(Key, Width);
+    HashValue(Key, Height);
+    HashValue(Key, (uint32)Stages);
+    HashValue(Key, Params.MaxCorners);
+    HashValue(Key, Params.QualityLevel);
+    HashValue(Key, Params.MinDistance);
+    HashValue(Key, Params.HistogramSubsample);
+    HashValue(Key, Params.PyramidLevel);
+    HashValue(Key, Params.MaxDetectionWidth);
+    HashValue(Key, Params.bRefineCornersAtFullResolution);
+    for (const FIntRect& Region : Params.Regions)
+    {
+        HashValue(Key, Region.Min);
+        HashValue(Key, Region.Max);
+    }
+    return Key;
+}
+
+bool FIVR_FeatureCache::Find(uint64 Key, FOCV_NativeJustRTFeatures& OutFeatures)
+{
+    FScopeLock Lock(&Mutex);
+    FEntry* Entry = Entries.Find(Key);
+    if (!Entry)
+    {
+        ++Stats.Misses;
+        return false;
+    }
+    Entry->LastUsed = ++UseCounter;
+    OutFeatures = Entry->Features;
+    OutFeatures.StageTimings.Reset(); // Nenhuma etapa rodou neste frame
+    ++Stats.Hits;
+    return true;
+}
+
+void FIVR_FeatureCache::Add(uint64 Key, const FOCV_NativeJustRTFeatures& Features)
+{
+    FScopeLock Lock(&Mutex);
+    if (!Entries.Contains(Key) && Entries.Num() >= Capacity)
+    {
+        // Capacidade pequena (dezenas): a busca linear pelo menos recente é mais barata que manter uma lista encadeada
+        uint64 OldestKey = 0;
+        uint64 OldestUse = MAX_uint64;
+        for (const TPair<uint64, FEntry>& Pair : Entries)
+        {
+            if (Pair.Value.LastUsed < OldestUse)
+            {
+                OldestUse = Pair.Value.LastUsed;
+                OldestKey = Pair.Key;
+            }
+        }
+        Entries.Remove(OldestKey);
+        ++Stats.Evictions;
+    }
+    FEntry& Entry = Entries.FindOrAdd(Key);
+    Entry.Features = Features;
+    Entry.LastUsed = ++UseCounter;
+}
+
+void FIVR_FeatureCache::Empty()
+{
+    FScopeLock Lock(&Mutex);
+    Entries.Reset();
+}
+
+FIVR_FeatureCacheStats FIVR_FeatureCache::GetStats() const
+{
+    FScopeLock Lock(&Mutex);
+    FIVR_FeatureCacheStats Result = Stats;
+    Result.NumEntries = Entries.Num();
+    return Result;
+}
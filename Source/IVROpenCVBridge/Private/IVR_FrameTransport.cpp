@@ -0,0 +1,274 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#include "IVR_FrameTransport.h"
+#include "IVR_PipeWrapper.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+#if PLATFORM_LINUX || PLATFORM_MAC
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#endif
+
+TUniquePtr<IIVR_FrameTransport> IIVR_FrameTransport::MakeTransport(EIVRFrameTransport Kind)
+{
+    switch (Kind)
+    {
+    case EIVRFrameTransport::StdinPipe:
+#if PLATFORM_WINDOWS || PLATFORM_LINUX
+        return MakeUnique<FIVR_StdinPipeTransport>();
+#else
+        UE_LOG(LogIVRPipeWrapper, Warning, TEXT("Stdin pipe transport is not supported on this platform. Falling back to Named Pipe/FIFO."));
+        break;
+#endif
+    case EIVRFrameTransport::UnixSocket:
+#if PLATFORM_LINUX || PLATFORM_MAC
+        return MakeUnique<FIVR_UnixSocketTransport>();
+#else
+        UE_LOG(LogIVRPipeWrapper, Warning, TEXT("Unix socket transport is not supported on this platform. Falling back to Named Pipe."));
+        break;
+#endif
+    default:
+        break;
+    }
+    return MakeUnique<FIVR_PipeWrapper>();
+}
+
+// =====================================================================================
+// FIVR_StdinPipeTransport
+// =====================================================================================
+#if PLATFORM_WINDOWS || PLATFORM_LINUX
+FIVR_StdinPipeTransport::~FIVR_StdinPipeTransport()
+{
+    Close();
+}
+
+bool FIVR_StdinPipeTransport::Create(const FIVR_PipeSettings& Settings, const FString& SessionID, int32 InWidth, int32 InHeight)
+{
+    if (bIsCreatedAndConnected)
+    {
+        Close();
+    }
+    PipeSettings = Settings;
+    FrameBytesHint = (InWidth > 0 && InHeight > 0) ? InWidth * InHeight * 4 : 0;
+    PipeCapacityBytes = 0;
+    TotalBytesWritten = 0;
+    bConnectAborted.AtomicSet(false);
+    FullPipePath = TEXT("pipe:0"); // Apenas para os logs
+#if PLATFORM_WINDOWS
+    // CreatePipe próprio (em vez de FPlatformProcess::CreatePipe) para pedir um buffer do tamanho de um frame.
+    SECURITY_ATTRIBUTES Attributes = { sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+    HANDLE ReadHandle = INVALID_HANDLE_VALUE;
+    HANDLE WriteHandle = INVALID_HANDLE_VALUE;
+    if (!::CreatePipe(&ReadHandle, &WriteHandle, &Attributes, (DWORD)FMath::Max(FrameBytesHint, Settings.OutBufferSize)))
+    {
+        UE_LOG(LogIVRPipeWrapper, Error, TEXT("Failed to create anonymous pipe for FFmpeg stdin. Error: %d"), GetLastError());
+        return false;
+    }
+    // Só a extremidade de leitura é herdada pelo FFmpeg; se a de escrita vazasse, o FFmpeg nunca receberia EOF.
+    SetHandleInformation(WriteHandle, HANDLE_FLAG_INHERIT, 0);
+    ChildReadPipe = ReadHandle;
+    LocalWritePipe = WriteHandle;
+    PipeHandle = WriteHandle;
+    PipeCapacityBytes = FMath::Max(FrameBytesHint, Settings.OutBufferSize);
+#else
+    // FPlatformProcess::CreatePipe devolve FPipeHandle*, que é o tipo esperado por CreateProc para o stdin do filho.
+    if (!FPlatformProcess::CreatePipe(ChildReadPipe, LocalWritePipe, true))
+    {
+        UE_LOG(LogIVRPipeWrapper, Error, TEXT("Failed to create anonymous pipe for FFmpeg stdin."));
+        return false;
+    }
+    FileDescriptor = static_cast<FPipeHandle*>(LocalWritePipe)->GetHandle();
+    // Só a extremidade de leitura é herdada pelo FFmpeg; se a de escrita vazasse, o FFmpeg nunca receberia EOF.
+    fcntl(FileDescriptor, F_SETFD, fcntl(FileDescriptor, F_GETFD) | FD_CLOEXEC);
+#endif
+    bIsCreatedAndConnected = true;
+    UE_LOG(LogIVRPipeWrapper, Log, TEXT("Anonymous pipe created for FFmpeg stdin."));
+    return true;
+}
+
+bool FIVR_StdinPipeTransport::Connect()
+{
+    // O pipe já nasce conectado ao FFmpeg (herdado no CreateProc): não há o que esperar.
+    if (!IsValid())
+    {
+        UE_LOG(LogIVRPipeWrapper, Error, TEXT("Cannot connect. Anonymous stdin pipe was not created. Call Create() first."));
+        return false;
+    }
+#if PLATFORM_LINUX
+    fcntl(FileDescriptor, F_SETFL, fcntl(FileDescriptor, F_GETFL) | O_NONBLOCK);
+    GrowPipeBuffer();
+#endif
+    ResetWriteStats();
+    return true;
+}
+
+void FIVR_StdinPipeTransport::OnReaderLaunched()
+{
+    // O FFmpeg herdou a extremidade de leitura. Fechar a nossa cópia faz escritas falharem (EPIPE) se ele sair.
+    if (ChildReadPipe)
+    {
+#if PLATFORM_WINDOWS
+        CloseHandle((HANDLE)ChildReadPipe);
+#else
+        FPlatformProcess::ClosePipe(ChildReadPipe, nullptr);
+#endif
+        ChildReadPipe = nullptr;
+    }
+}
+
+void FIVR_StdinPipeTransport::AbortConnect()
+{
+    FIVR_PipeWrapper::AbortConnect();
+    OnReaderLaunched();
+}
+
+void FIVR_StdinPipeTransport::Close()
+{
+    if (LocalWritePipe)
+    {
+#if PLATFORM_WINDOWS
+        CloseHandle((HANDLE)LocalWritePipe);
+        PipeHandle = INVALID_HANDLE_VALUE;
+#else
+        FPlatformProcess::ClosePipe(nullptr, LocalWritePipe); // Fecha o descritor (FileDescriptor)
+        FileDescriptor = -1;
+#endif
+        LocalWritePipe = nullptr;
+        UE_LOG(LogIVRPipeWrapper, Log, TEXT("Anonymous stdin pipe closed, signaling EOF to FFmpeg."));
+    }
+    OnReaderLaunched(); // Se o FFmpeg nunca foi lançado, a extremidade de leitura ainda é nossa
+    bIsCreatedAndConnected = false;
+}
+#endif
+
+// =====================================================================================
+// FIVR_UnixSocketTransport
+// =====================================================================================
+#if PLATFORM_LINUX || PLATFORM_MAC
+FIVR_UnixSocketTransport::~FIVR_UnixSocketTransport()
+{
+    Close();
+}
+
+bool FIVR_UnixSocketTransport::Create(const FIVR_PipeSettings& Settings, const FString& SessionID, int32 InWidth, int32 InHeight)
+{
+    if (bIsCreatedAndConnected)
+    {
+        Close();
+    }
+    PipeSettings = Settings;
+    FrameBytesHint = (InWidth > 0 && InHeight > 0) ? InWidth * InHeight * 4 : 0;
+    PipeCapacityBytes = 0;
+    TotalBytesWritten = 0;
+    bConnectAborted.AtomicSet(false);
+    bStreamSocket = true;
+
+    // Mesmo diretório dos FIFOs. sun_path tem ~104-108 bytes: caminhos de projeto longos caem para o temp do usuário.
+    const FString SocketName = FString::Printf(TEXT("%s%s.sock"), *Settings.BasePipeName, *SessionID);
+    const FString TempPipeDir = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("IVRTemporaryPipes"));
+    FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*TempPipeDir);
+    SocketPath = FPaths::ConvertRelativePathToFull(FPaths::Combine(TempPipeDir, SocketName));
+    struct sockaddr_un Address = {};
+    Address.sun_family = AF_UNIX;
+    if (FCStringAnsi::Strlen(TCHAR_TO_UTF8(*SocketPath)) >= (int32)sizeof(Address.sun_path))
+    {
+        SocketPath = FPaths::Combine(FPlatformProcess::UserTempDir(), SocketName);
+    }
+    if (FCStringAnsi::Strlen(TCHAR_TO_UTF8(*SocketPath)) >= (int32)sizeof(Address.sun_path))
+    {
+        UE_LOG(LogIVRPipeWrapper, Error, TEXT("Unix socket path '%s' is too long."), *SocketPath);
+        return false;
+    }
+    FCStringAnsi::Strncpy(Address.sun_path, TCHAR_TO_UTF8(*SocketPath), sizeof(Address.sun_path));
+    unlink(Address.sun_path); // Resto de uma sessão anterior
+
+    ListenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (ListenSocket == -1
+        || bind(ListenSocket, (struct sockaddr*)&Address, sizeof(Address)) == -1
+        || listen(ListenSocket, 1) == -1)
+    {
+        UE_LOG(LogIVRPipeWrapper, Error, TEXT("Failed to create Unix socket '%s'. Error: %s"), *SocketPath, UTF8_TO_TCHAR(strerror(errno)));
+        Close();
+        return false;
+    }
+    fcntl(ListenSocket, F_SETFL, fcntl(ListenSocket, F_GETFL) | O_NONBLOCK);
+    FullPipePath = SocketPath;
+    bIsCreatedAndConnected = true;
+    UE_LOG(LogIVRPipeWrapper, Log, TEXT("Unix socket '%s' listening. FFmpeg connects in Connect()."), *SocketPath);
+    return true;
+}
+
+bool FIVR_UnixSocketTransport::Connect()
+{
+    if (FileDescriptor != -1)
+    {
+        return true;
+    }
+    if (ListenSocket == -1)
+    {
+        UE_LOG(LogIVRPipeWrapper, Error, TEXT("Cannot connect. Unix socket was not created. Call Create() first."));
+        return false;
+    }
+    UE_LOG(LogIVRPipeWrapper, Log, TEXT("Waiting up to %.1fs for FFmpeg to connect to '%s'..."), PipeSettings.ConnectTimeoutSeconds, *SocketPath);
+    const double ConnectDeadline = FPlatformTime::Seconds() + PipeSettings.ConnectTimeoutSeconds;
+    while (FileDescriptor == -1)
+    {
+        struct pollfd WaitFd = { ListenSocket, POLLIN, 0 };
+        if (poll(&WaitFd, 1, 50) > 0)
+        {
+            FileDescriptor = accept(ListenSocket, nullptr, nullptr);
+            if (FileDescriptor == -1 && errno != EAGAIN && errno != EINTR && errno != ECONNABORTED)
+            {
+                UE_LOG(LogIVRPipeWrapper, Error, TEXT("accept() failed on Unix socket '%s'. Error: %s"), *SocketPath, UTF8_TO_TCHAR(strerror(errno)));
+                return false;
+            }
+        }
+        if (FileDescriptor == -1 && ShouldGiveUpConnecting(ConnectDeadline))
+        {
+            return false;
+        }
+    }
+    // Conexão única: o socket de escuta e o caminho no sistema de arquivos não são mais necessários.
+    close(ListenSocket);
+    ListenSocket = -1;
+    unlink(TCHAR_TO_UTF8(*SocketPath));
+
+    fcntl(FileDescriptor, F_SETFL, fcntl(FileDescriptor, F_GETFL) | O_NONBLOCK);
+#if PLATFORM_MAC
+    int NoSigPipe = 1;
+    setsockopt(FileDescriptor, SOL_SOCKET, SO_NOSIGPIPE, &NoSigPipe, sizeof(NoSigPipe));
+#endif
+    // O padrão (~200 KiB) força dezenas de trocas de contexto por frame 1080p. O kernel limita o valor a net.core.wmem_max.
+    int SendBufferBytes = FMath::Clamp(FrameBytesHint * 2, 1024 * 1024, 64 * 1024 * 1024);
+    setsockopt(FileDescriptor, SOL_SOCKET, SO_SNDBUF, &SendBufferBytes, sizeof(SendBufferBytes));
+    socklen_t OptionLength = sizeof(SendBufferBytes);
+    if (getsockopt(FileDescriptor, SOL_SOCKET, SO_SNDBUF, &SendBufferBytes, &OptionLength) == 0)
+    {
+        PipeCapacityBytes = SendBufferBytes;
+    }
+    UE_LOG(LogIVRPipeWrapper, Log, TEXT("FFmpeg connected to Unix socket '%s'. SO_SNDBUF: %d bytes (frame: %d bytes)."), *SocketPath, PipeCapacityBytes, FrameBytesHint);
+    ResetWriteStats();
+    return true;
+}
+
+void FIVR_UnixSocketTransport::Close()
+{
+    if (FileDescriptor != -1)
+    {
+        close(FileDescriptor);
+        FileDescriptor = -1;
+        UE_LOG(LogIVRPipeWrapper, Log, TEXT("Unix socket '%s' closed, signaling EOF to FFmpeg."), *SocketPath);
+    }
+    if (ListenSocket != -1)
+    {
+        // FFmpeg nunca conectou: remove o socket para não deixar arquivos órfãos.
+        close(ListenSocket);
+        ListenSocket = -1;
+        unlink(TCHAR_TO_UTF8(*SocketPath));
+    }
+    bIsCreatedAndConnected = false;
+}
+#endif
@@ -0,0 +1,139 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#include "IVR_HistogramKernel.h"
+#include "Async/ParallelFor.h"
+
+namespace
+{
+    /** Linhas amostradas mínimas por faixa: abaixo disso o custo de despachar a tarefa domina. */
+    constexpr int32 MinRowsPerBand = 32;
+
+    /** Conta uma faixa de linhas em NumLanes sub-histogramas e os soma em OutCounts. */
+    void CountBand(const uint8* PixelData, int32 Width, SIZE_T Pitch, int32 FirstRow, int32 EndRow, int32 Subsample, FIVR_HistogramKernel::FCounts& OutCounts)
+    {
+        constexpr int32 NumBins = FIVR_HistogramKernel::NumBins;
+        constexpr int32 NumLanes = FIVR_HistogramKernel::NumLanes;
+        // [Lane][Canal][Bin]: 12 KB, cabe no L1
+        uint32 Lanes[NumLanes][3][NumBins];
+        FMemory::Memzero(Lanes, sizeof(Lanes));
+
+        const SIZE_T PixelStep = (SIZE_T)Subsample * 4;
+        const int32 NumSamples = (Width + Subsample - 1) / Subsample;
+        const int32 NumUnrolled = NumSamples - NumSamples % NumLanes;
+
+        for (int32 Row = FirstRow; Row < EndRow; Row += Subsample)
+        {
+            const uint8* Pixel = PixelData + (SIZE_T)Row * Pitch;
+            int32 Sample = 0;
+            for (; Sample < NumUnrolled; Sample += NumLanes)
+            {
+                const uint8* P0 = Pixel;
+                const uint8* P1 = P0 + PixelStep;
+                const uint8* P2 = P1 + PixelStep;
+                const uint8* P3 = P2 + PixelStep;
+                ++Lanes[0][0][P0[0]]; ++Lanes[0][1][P0[1]]; ++Lanes[0][2][P0[2]];
+                ++Lanes[1][0][P1[0]]; ++Lanes[1][1][P1[1]]; ++Lanes[1][2][P1[2]];
+                ++Lanes[2][0][P2[0]]; ++Lanes[2][1][P2[1]]; ++Lanes[2][2][P2[2]];
+                ++Lanes[3][0][P3[0]]; ++Lanes[3][1][P3[1]]; ++Lanes[3][2][P3[2]];
+                Pixel = P3 + PixelStep;
+            }
+            for (; Sample < NumSamples; ++Sample, Pixel += PixelStep)
+            {
+                ++Lanes[0][0][Pixel[0]]; ++Lanes[0][1][Pixel[1]]; ++Lanes[0][2][Pixel[2]];
+            }
+        }
+
+        for (int32 Bin = 0; Bin < NumBins; ++Bin)
+        {
+            OutCounts.Blue[Bin] = Lanes[0][0][Bin] + Lanes[1][0][Bin] + Lanes[2][0][Bin] + Lanes[3][0][Bin];
+            OutCounts.Green[Bin] = Lanes[0][1][Bin] + Lanes[1][1][Bin] + Lanes[2][1][Bin] + Lanes[3][1][Bin];
+            OutCounts.Red[Bin] = Lanes[0][2][Bin] + Lanes[1][2][Bin] + Lanes[2][2][Bin] + Lanes[3][2][Bin];
+        }
+    }
+
+    void NormalizeMinMax(const uint32* Counts, TArray<float>& Out)
+    {
+        constexpr int32 NumBins = FIVR_HistogramKernel::NumBins;
+        uint32 MinCount = Counts[0];
+        uint32 MaxCount = Counts[0];
+        for (int32 Bin = 1; Bin < NumBins; ++Bin)
+        {
+            MinCount = FMath::Min(MinCount, Counts[Bin]);
+            MaxCount = FMath::Max(MaxCount, Counts[Bin]);
+        }
+        // Como cv::normalize NORM_MINMAX: faixa nula resulta em zeros
+        const float Scale = MaxCount > MinCount ? 1.0f / (float)(MaxCount - MinCount) : 0.0f;
+        Out.SetNumUninitialized(NumBins);
+        for (int32 Bin = 0; Bin < NumBins; ++Bin)
+        {
+            Out[Bin] = (float)(Counts[Bin] - MinCount) * Scale;
+        }
+    }
+}
+
+int64 FIVR_HistogramKernel::Count(const uint8* PixelData, int32 Width, int32 Height, int32 Subsample, FCounts& OutCounts, SIZE_T RowPitch)
+{
+    FMemory::Memzero(&OutCounts, sizeof(OutCounts));
+    if (!PixelData || Width <= 0 || Height <= 0)
+    {
+        return 0;
+    }
+    Subsample = FMath::Max(1, Subsample);
+    const SIZE_T Pitch = RowPitch > 0 ? RowPitch : (SIZE_T)Width * 4;
+    const int32 SampledRows = (Height + Subsample - 1) / Subsample;
+    const int32 SampledCols = (Width + Subsample - 1) / Subsample;
+    const int32 MaxBands = FMath::Max(1, FPlatformMisc::NumberOfWorkerThreadsToSpawn() + 1);
+    const int32 NumBands = FMath::Clamp(SampledRows / MinRowsPerBand, 1, MaxBands);
+    // Faixas começam em múltiplos de Subsample para manter a mesma grade de amostragem
+    const int32 RowsPerBand = ((SampledRows + NumBands - 1) / NumBands) * Subsample;
+
+    TArray<FCounts> BandCounts;
+    BandCounts.SetNumUninitialized(NumBands);
+    ParallelFor(NumBands, [&](int32 Band)
+    {
+        const int32 FirstRow = Band * RowsPerBand;
+        const int32 EndRow = FMath::Min(Height, FirstRow + RowsPerBand);
+        CountBand(PixelData, Width, Pitch, FirstRow, EndRow, Subsample, BandCounts[Band]);
+    }, NumBands == 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+    // Soma das faixas
+    OutCounts = BandCounts[0];
+    for (int32 Band = 1; Band < NumBands; ++Band)
+    {
+        Accumulate(OutCounts, BandCounts[Band]);
+    }
+    return (int64)SampledRows * SampledCols;
+}
+
+void FIVR_HistogramKernel::Accumulate(FCounts& InOutCounts, const FCounts& Other)
+{
+    for (int32 Bin = 0; Bin < NumBins; ++Bin)
+    {
+        InOutCounts.Blue[Bin] += Other.Blue[Bin];
+        InOutCounts.Green[Bin] += Other.Green[Bin];
+        InOutCounts.Red[Bin] += Other.Red[Bin];
+    }
+}
+
+void FIVR_HistogramKernel::Normalize(const FCounts& Counts, TArray<float>& OutBlue, TArray<float>& OutGreen, TArray<float>& OutRed)
+{
+    NormalizeMinMax(Counts.Blue, OutBlue);
+    NormalizeMinMax(Counts.Green, OutGreen);
+    NormalizeMinMax(Counts.Red, OutRed);
+}
+
+bool FIVR_HistogramKernel::ComputeNormalized(const uint8* PixelData, int32 Width, int32 Height, int32 Subsample,
+                                             TArray<float>& OutBlue, TArray<float>& OutGreen, TArray<float>& OutRed, SIZE_T RowPitch)
+{
+    OutBlue.Reset();
+    OutGreen.Reset();
+    OutRed.Reset();
+    FCounts Counts;
+    if (Count(PixelData, Width, Height, Subsample, Counts, RowPitch) == 0)
+    {
+        return false;
+    }
+    Normalize(Counts, OutBlue, OutGreen, OutRed);
+    return true;
+}
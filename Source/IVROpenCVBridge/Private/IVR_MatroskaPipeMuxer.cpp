@@ -0,0 +1,232 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#include "IVR_MatroskaPipeMuxer.h"
+
+namespace
+{
+    // IDs de elementos EBML/Matroska utilizados (os bits marcadores fazem parte do ID).
+    enum : uint32
+    {
+        EBML_Header             = 0x1A45DFA3,
+        EBML_Version            = 0x4286,
+        EBML_ReadVersion        = 0x42F7,
+        EBML_MaxIDLength        = 0x42F2,
+        EBML_MaxSizeLength      = 0x42F3,
+        EBML_DocType            = 0x4282,
+        EBML_DocTypeVersion     = 0x4287,
+        EBML_DocTypeReadVersion = 0x4285,
+        MKV_Segment             = 0x18538067,
+        MKV_Info                = 0x1549A966,
+        MKV_TimestampScale      = 0x2AD7B1,
+        MKV_MuxingApp           = 0x4D80,
+        MKV_WritingApp          = 0x5741,
+        MKV_Tracks              = 0x1654AE6B,
+        MKV_TrackEntry          = 0xAE,
+        MKV_TrackNumber         = 0xD7,
+        MKV_TrackUID            = 0x73C5,
+        MKV_TrackType           = 0x83,
+        MKV_FlagLacing          = 0x9C,
+        MKV_CodecID             = 0x86,
+        MKV_Video               = 0xE0,
+        MKV_PixelWidth          = 0xB0,
+        MKV_PixelHeight         = 0xBA,
+        MKV_ColourSpace         = 0x2EB524,
+        MKV_Cluster             = 0x1F43B675,
+        MKV_Timestamp           = 0xE7,
+        MKV_SimpleBlock         = 0xA3,
+    };
+
+    void WriteId(TArray<uint8>& Out, uint32 Id)
+    {
+        const int32 NumBytes = (Id > 0xFFFFFF) ? 4 : (Id > 0xFFFF) ? 3 : (Id > 0xFF) ? 2 : 1;
+        for (int32 Index = NumBytes - 1; Index >= 0; --Index)
+        {
+            Out.Add((uint8)(Id >> (Index * 8)));
+        }
+    }
+
+    // Tamanho sempre codificado em 8 bytes (marcador 0x01): simplifica o cálculo dos cabeçalhos de tamanho fixo.
+    void WriteSize8(uint8* Out, uint64 Size)
+    {
+        Out[0] = 0x01;
+        for (int32 Index = 1; Index < 8; ++Index)
+        {
+            Out[Index] = (uint8)(Size >> ((7 - Index) * 8));
+        }
+    }
+
+    void WriteSize8(TArray<uint8>& Out, uint64 Size)
+    {
+        uint8 Bytes[8];
+        WriteSize8(Bytes, Size);
+        Out.Append(Bytes, 8);
+    }
+
+    void WriteUInt(TArray<uint8>& Out, uint32 Id, uint64 Value)
+    {
+        WriteId(Out, Id);
+        Out.Add(0x88); // Tamanho de 8 bytes
+        for (int32 Index = 7; Index >= 0; --Index)
+        {
+            Out.Add((uint8)(Value >> (Index * 8)));
+        }
+    }
+
+    void WriteBinary(TArray<uint8>& Out, uint32 Id, const uint8* Data, int32 NumBytes)
+    {
+        WriteId(Out, Id);
+        WriteSize8(Out, NumBytes);
+        Out.Append(Data, NumBytes);
+    }
+
+    void WriteString(TArray<uint8>& Out, uint32 Id, const ANSICHAR* Value)
+    {
+        WriteBinary(Out, Id, reinterpret_cast<const uint8*>(Value), FCStringAnsi::Strlen(Value));
+    }
+
+    void WriteMaster(TArray<uint8>& Out, uint32 Id, const TArray<uint8>& Children)
+    {
+        WriteId(Out, Id);
+        WriteSize8(Out, Children.Num());
+        Out.Append(Children);
+    }
+}
+
+bool FIVR_MatroskaPipeMuxer::Configure(int32 InWidth, int32 InHeight, const FString& InPixelFormat)
+{
+    // FourCC do pixel format, como o demuxer Matroska do FFmpeg o procura para V_UNCOMPRESSED (tabela de tags raw).
+    struct FPixelFormatTag { const TCHAR* Name; uint8 FourCC[4]; };
+    static const FPixelFormatTag KnownTags[] =
+    {
+        { TEXT("bgra"),    { 'B', 'G', 'R', 'A' } },
+        { TEXT("rgba"),    { 'R', 'G', 'B', 'A' } },
+        { TEXT("argb"),    { 'A', 'R', 'G', 'B' } },
+        { TEXT("abgr"),    { 'A', 'B', 'G', 'R' } },
+        { TEXT("bgr0"),    { 'B', 'G', 'R', 0 } },
+        { TEXT("rgb0"),    { 'R', 'G', 'B', 0 } },
+        { TEXT("bgr24"),   { 'B', 'G', 'R', 24 } },
+        { TEXT("rgb24"),   { 'R', 'G', 'B', 24 } },
+        { TEXT("gray"),    { 'Y', '8', '0', '0' } },
+        { TEXT("yuv420p"), { 'I', '4', '2', '0' } },
+        { TEXT("nv12"),    { 'N', 'V', '1', '2' } },
+        { TEXT("yuyv422"), { 'Y', 'U', 'Y', '2' } },
+        { TEXT("uyvy422"), { 'U', 'Y', 'V', 'Y' } },
+    };
+    const FPixelFormatTag* Tag = nullptr;
+    for (const FPixelFormatTag& Candidate : KnownTags)
+    {
+        if (InPixelFormat.Equals(Candidate.Name, ESearchCase::IgnoreCase))
+        {
+            Tag = &Candidate;
+            break;
+        }
+    }
+    if (!Tag)
+    {
+        StreamHeader.Reset();
+        return false;
+    }
+    const uint8* FourCC = Tag->FourCC;
+
+    TArray<uint8> EbmlChildren;
+    WriteUInt(EbmlChildren, EBML_Version, 1);
+    WriteUInt(EbmlChildren, EBML_ReadVersion, 1);
+    WriteUInt(EbmlChildren, EBML_MaxIDLength, 4);
+    WriteUInt(EbmlChildren, EBML_MaxSizeLength, 8);
+    WriteString(EbmlChildren, EBML_DocType, "matroska");
+    WriteUInt(EbmlChildren, EBML_DocTypeVersion, 4);
+    WriteUInt(EbmlChildren, EBML_DocTypeReadVersion, 2);
+
+    TArray<uint8> InfoChildren;
+    WriteUInt(InfoChildren, MKV_TimestampScale, 1000000000ull / TimestampTicksPerSecond);
+    WriteString(InfoChildren, MKV_MuxingApp, "IVR");
+    WriteString(InfoChildren, MKV_WritingApp, "IVR");
+
+    TArray<uint8> VideoChildren;
+    WriteUInt(VideoChildren, MKV_PixelWidth, InWidth);
+    WriteUInt(VideoChildren, MKV_PixelHeight, InHeight);
+    WriteBinary(VideoChildren, MKV_ColourSpace, FourCC, 4);
+
+    TArray<uint8> TrackChildren;
+    WriteUInt(TrackChildren, MKV_TrackNumber, 1);
+    WriteUInt(TrackChildren, MKV_TrackUID, 1);
+    WriteUInt(TrackChildren, MKV_TrackType, 1); // Vídeo
+    WriteUInt(TrackChildren, MKV_FlagLacing, 0);
+    WriteString(TrackChildren, MKV_CodecID, "V_UNCOMPRESSED");
+    WriteMaster(TrackChildren, MKV_Video, VideoChildren);
+
+    TArray<uint8> TracksChildren;
+    WriteMaster(TracksChildren, MKV_TrackEntry, TrackChildren);
+
+    StreamHeader.Reset();
+    WriteMaster(StreamHeader, EBML_Header, EbmlChildren);
+    // Segment com tamanho desconhecido: o stream termina com o EOF do pipe.
+    WriteId(StreamHeader, MKV_Segment);
+    const uint8 UnknownSize[8] = { 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    StreamHeader.Append(UnknownSize, 8);
+    WriteMaster(StreamHeader, MKV_Info, InfoChildren);
+    WriteMaster(StreamHeader, MKV_Tracks, TracksChildren);
+
+    ResetTimeline();
+    return true;
+}
+
+void FIVR_MatroskaPipeMuxer::ResetTimeline()
+{
+    bHasFirstTimestamp = false;
+    FirstTimestampNs = 0;
+    LastFrameTicks = -1;
+    NonMonotonicFrames = 0;
+}
+
+int64 FIVR_MatroskaPipeMuxer::ComputeFrameTicks(int64 FrameTimestampNs)
+{
+    if (!bHasFirstTimestamp)
+    {
+        bHasFirstTimestamp = true;
+        FirstTimestampNs = FrameTimestampNs;
+    }
+    const int64 NanosecondsPerTick = 1000000000ll / TimestampTicksPerSecond;
+    const int64 ElapsedNs = FrameTimestampNs - FirstTimestampNs;
+    int64 FrameTicks = (ElapsedNs >= 0) ? (ElapsedNs + NanosecondsPerTick / 2) / NanosecondsPerTick : -1;
+    if (FrameTicks <= LastFrameTicks)
+    {
+        // Timestamp repetido ou regressivo (frame atrasado, fonte retomada após pausa): avança um tick para o muxer de saída aceitar.
+        FrameTicks = LastFrameTicks + 1;
+        ++NonMonotonicFrames;
+    }
+    LastFrameTicks = FrameTicks;
+    return FrameTicks;
+}
+
+int32 FIVR_MatroskaPipeMuxer::BuildFrameHeader(int64 FrameTicks, int32 PayloadBytes, uint8 (&OutHeader)[FrameHeaderBytes]) const
+{
+    // Um Cluster por frame, com tamanho conhecido: Timestamp absoluto no Cluster e SimpleBlock com offset relativo zero.
+    //   Cluster   : ID(4) + Size(8)
+    //   Timestamp : ID(1) + Size(1) + Valor(8)
+    //   SimpleBlock: ID(1) + Size(8) + Track(1) + Offset(2) + Flags(1) + payload
+    const uint64 BlockBytes = 4 + (uint64)PayloadBytes;
+    const uint64 ClusterBytes = 10 + 9 + BlockBytes;
+    uint8* Cursor = OutHeader;
+
+    *Cursor++ = 0x1F; *Cursor++ = 0x43; *Cursor++ = 0xB6; *Cursor++ = 0x75;
+    WriteSize8(Cursor, ClusterBytes); Cursor += 8;
+
+    *Cursor++ = (uint8)MKV_Timestamp;
+    *Cursor++ = 0x88;
+    for (int32 Index = 7; Index >= 0; --Index)
+    {
+        *Cursor++ = (uint8)((uint64)FrameTicks >> (Index * 8));
+    }
+
+    *Cursor++ = (uint8)MKV_SimpleBlock;
+    WriteSize8(Cursor, BlockBytes); Cursor += 8;
+    *Cursor++ = 0x81; // Track 1 (vint)
+    *Cursor++ = 0x00; // Offset relativo ao Cluster (int16)
+    *Cursor++ = 0x00;
+    *Cursor++ = 0x80; // Keyframe
+
+    check(Cursor - OutHeader == FrameHeaderBytes);
+    return FrameHeaderBytes;
+}
@@ -9,6 +9,25 @@
 #include "Misc/Paths.h" // Para FPaths::GetTempDir
 #include "HAL/PlatformFileManager.h" // Para IPlatformFileManager (adicionado para mkpath)
 #include "HAL/FileManager.h" // Para IFileManager (adicionado para mkpath)
+#include "Misc/ScopeExit.h"
+#include "Misc/ScopeLock.h"
+#if PLATFORM_LINUX
+#include <sys/ioctl.h>   // Para FIONREAD
+#include <sys/syscall.h> // Para SYS_vmsplice
+#include <sys/socket.h>  // Para sendmsg (FIVR_UnixSocketTransport)
+#ifndef F_SETPIPE_SZ
+#define F_SETPIPE_SZ 1031
+#endif
+#ifndef F_GETPIPE_SZ
+#define F_GETPIPE_SZ 1032
+#endif
+#endif
+#if PLATFORM_LINUX || PLATFORM_MAC
+#include <poll.h>
+#include <limits.h>
+// Máximo de segmentos por writev/vmsplice (IOV_MAX é 1024 no Linux e no macOS).
+#define IVR_PIPE_MAX_IOVECS 1024
+#endif
 // Definição de LogCategory (agora do módulo IVR, se for usado o LogIVR.
 // Se quiser um log separado, defina LogIVRPipeWrapper no IVROpenCVBridge.h/.cpp)
 DEFINE_LOG_CATEGORY(LogIVRPipeWrapper);
@@ -42,6 +61,10 @@ bool FIVR_PipeWrapper::Create(const FIVR_PipeSettings& Settings, const FString&
 
     PipeSettings = Settings;
     FString BasePipeName = Settings.BasePipeName;
+    FrameBytesHint = (InWidth > 0 && InHeight > 0) ? InWidth * InHeight * 4 : 0;
+    PipeCapacityBytes = 0;
+    TotalBytesWritten = 0;
+    bConnectAborted.AtomicSet(false);
 
     // Construir o caminho completo do pipe.
     // Para Windows: \.\pipe\<BasePipeName>_<SessionID>
@@ -127,6 +150,7 @@ bool FIVR_PipeWrapper::Create(const FIVR_PipeSettings& Settings, const FString&
     
     // Apenas criamos o FIFO no sistema de arquivos. A abertura para escrita (que bloqueia)
     // será feita em Connect().
+    bFifoLinked = true;
     bIsCreatedAndConnected = true;
     UE_LOG(LogIVRPipeWrapper, Log, TEXT("FIFO '%s' created successfully. Opening for writing will happen in Connect()."), *FullPipePath);
 #else // Outras plataformas (se houver)
@@ -156,6 +180,13 @@ bool FIVR_PipeWrapper::Connect()
     
     UE_LOG(LogIVRPipeWrapper, Log, TEXT("Awaiting client connection for pipe: %s"), *FullPipePath);
     BOOL bSuccess = ConnectNamedPipe(PipeHandle, NULL);
+    if (bConnectAborted)
+    {
+        // AbortConnect() libera o ConnectNamedPipe conectando um cliente descartável.
+        UE_LOG(LogIVRPipeWrapper, Warning, TEXT("Connection to Named Pipe '%s' aborted before FFmpeg connected."), *FullPipePath);
+        DisconnectNamedPipe(PipeHandle);
+        return false;
+    }
     if (!bSuccess && GetLastError() != ERROR_PIPE_CONNECTED)
     {
         DWORD ErrorCode = GetLastError();
@@ -165,26 +196,46 @@ bool FIVR_PipeWrapper::Connect()
         return false;
     }
     UE_LOG(LogIVRPipeWrapper, Log, TEXT("Named Pipe '%s' connected successfully."), *FullPipePath);
+    ResetWriteStats();
     return true;
 #elif PLATFORM_LINUX || PLATFORM_MAC
     // Para POSIX, mover a chamada open() bloqueante para Connect()
     if (FileDescriptor != -1) // Se já estiver aberto (ex: tentativa anterior de Connect()), consideramos conectado.
     {
-        UE_LOG(LogIVRPipeWrapper, Log, TEXT("FIFO '%s' already open for writing (FileDescriptor: %d).", *FullPipePath, FileDescriptor));
+        UE_LOG(LogIVRPipeWrapper, Log, TEXT("FIFO '%s' already open for writing (FileDescriptor: %d)."), *FullPipePath, FileDescriptor);
         return true;
     }
     
-    // Abrir o FIFO para escrita. Esta é a chamada que BLOQUEIA se não houver leitor.
-    UE_LOG(LogIVRPipeWrapper, Log, TEXT("Opening FIFO '%s' for writing... (will block if no reader)"), *FullPipePath);
-    // Não usar O_NONBLOCK aqui, para que 'open()' bloqueie até que um leitor se conecte.
-    FileDescriptor = open(TCHAR_TO_UTF8(*FullPipePath), O_WRONLY);
-    if (FileDescriptor == -1)
-    {
-        UE_LOG(LogIVRPipeWrapper, Error, TEXT("Failed to open FIFO '%s' for writing. Error: %s"), *FullPipePath, UTF8_TO_TCHAR(strerror(errno)));
-        // Não precisa de unlink aqui, o FIFO já existe, apenas falhou a abertura para escrita.
-        return false;
+    // Abrir o FIFO para escrita. Com O_NONBLOCK, open() falha com ENXIO enquanto não há leitor:
+    // tentamos de novo até o FFmpeg abrir o FIFO, o prazo expirar ou AbortConnect() ser chamado,
+    // em vez de bloquear a worker thread para sempre se o FFmpeg morrer antes de abrir o FIFO.
+    UE_LOG(LogIVRPipeWrapper, Log, TEXT("Opening FIFO '%s' for writing... (waiting up to %.1fs for a reader)"), *FullPipePath, PipeSettings.ConnectTimeoutSeconds);
+    const double ConnectDeadline = FPlatformTime::Seconds() + PipeSettings.ConnectTimeoutSeconds;
+    while ((FileDescriptor = open(TCHAR_TO_UTF8(*FullPipePath), O_WRONLY | O_NONBLOCK)) == -1)
+    {
+        if (errno != ENXIO && errno != EINTR)
+        {
+            UE_LOG(LogIVRPipeWrapper, Error, TEXT("Failed to open FIFO '%s' for writing. Error: %s"), *FullPipePath, UTF8_TO_TCHAR(strerror(errno)));
+            return false;
+        }
+        if (ShouldGiveUpConnecting(ConnectDeadline))
+        {
+            return false;
+        }
+        FPlatformProcess::Sleep(0.005f);
+    }
+    UE_LOG(LogIVRPipeWrapper, Log, TEXT("FIFO '%s' opened successfully for writing (FileDescriptor: %d)."), *FullPipePath, FileDescriptor);
+    // O descritor permanece não bloqueante: pipe cheio vira EAGAIN + poll, o que permite medir o tempo
+    // de espera pelo leitor e detectar sua saída (POLLERR).
+    // Os dois lados já estão abertos: o nome no sistema de arquivos não é mais necessário.
+    if (bFifoLinked && unlink(TCHAR_TO_UTF8(*FullPipePath)) == 0)
+    {
+        bFifoLinked = false;
     }
-    UE_LOG(LogIVRPipeWrapper, Log, TEXT("FIFO '%s' opened successfully for writing (FileDescriptor: %d).", *FullPipePath, FileDescriptor));
+    ResetWriteStats();
+#if PLATFORM_LINUX
+    GrowPipeBuffer();
+#endif
     return true;
 #else
     UE_LOG(LogIVRPipeWrapper, Warning, TEXT("Connect() not explicitly implemented for this platform. Defaulting to true."));
@@ -193,37 +244,152 @@ bool FIVR_PipeWrapper::Connect()
 }
 // Write to Pipe
 int32 FIVR_PipeWrapper::Write(const uint8* Data, int32 NumBytes)
+{
+    const FIVR_PipeWriteSpan Span{ Data, NumBytes };
+    return DeliverSpans(&Span, 1, false) ? NumBytes : -1;
+}
+
+bool FIVR_PipeWrapper::WriteGather(const FIVR_PipeWriteSpan* Spans, int32 NumSpans)
+{
+    return DeliverSpans(Spans, NumSpans, false);
+}
+
+// --- INÍCIO DA ALTERAÇÃO: ENTREGA COMPLETA (ESCRITAS PARCIAIS, EINTR/EAGAIN) E ESCRITA EM LOTE ---
+bool FIVR_PipeWrapper::DeliverSpans(const FIVR_PipeWriteSpan* Spans, int32 NumSpans, bool bSplice)
 {
     // <--- ALTERAÇÃO: Re-checagem de IsValid() e tratamento de erros de pipe quebrado
     if (!IsValid())
     {
         UE_LOG(LogIVRPipeWrapper, Error, TEXT("Attempted to write to an invalid or uninitialized pipe: %s. Data will be dropped."), *FullPipePath);
-        return -1;
+        return false;
+    }
+    int64 RequestedBytes = 0;
+    for (int32 i = 0; i < NumSpans; ++i)
+    {
+        RequestedBytes += Spans[i].NumBytes;
+    }
+    // Acumulado localmente e somado a WriteStats uma vez, sob o lock, ao sair (sucesso ou erro).
+    FIVR_PipeWriteStats Delta;
+    ON_SCOPE_EXIT { MergeWriteStats(Delta); };
+    if (NumSpans > 1)
+    {
+        ++Delta.GatherWrites;
     }
 #if PLATFORM_WINDOWS
-    DWORD BytesWritten;
-    if (!WriteFile(PipeHandle, Data, NumBytes, &BytesWritten, nullptr))
+    // Named pipes não suportam WriteFileGather (exige arquivo sem buffer): um WriteFile por segmento.
+    for (int32 i = 0; i < NumSpans; ++i)
     {
-        DWORD ErrorCode = GetLastError();
-        UE_LOG(LogIVRPipeWrapper, Error, TEXT("Failed to write to Windows Named Pipe '%s'. Error: %d. Pipe may be broken or closed."), *FullPipePath, ErrorCode);
-        // Se o pipe estiver quebrado, invalidar o handle imediatamente.
-        if (ErrorCode == ERROR_BROKEN_PIPE || ErrorCode == ERROR_PIPE_NOT_CONNECTED)
+        int32 Delivered = 0;
+        while (Delivered < Spans[i].NumBytes)
         {
-            Close(); // <--- ALTERAÇÃO: Marcar como fechado para evitar mais tentativas.
+            DWORD BytesWritten = 0;
+            const uint64 StartCycles = FPlatformTime::Cycles64();
+            const BOOL bWriteOk = WriteFile(PipeHandle, Spans[i].Data + Delivered, (DWORD)(Spans[i].NumBytes - Delivered), &BytesWritten, nullptr);
+            // WriteFile bloqueia enquanto o buffer do pipe está cheio: esse tempo é a espera pelo leitor.
+            Delta.StallSeconds += FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+            ++Delta.WriteCalls;
+            if (!bWriteOk)
+            {
+                DWORD ErrorCode = GetLastError();
+                UE_LOG(LogIVRPipeWrapper, Error, TEXT("Failed to write to Windows Named Pipe '%s'. Error: %d. Pipe may be broken or closed."), *FullPipePath, ErrorCode);
+                // Se o pipe estiver quebrado, invalidar o handle imediatamente.
+                if (ErrorCode == ERROR_BROKEN_PIPE || ErrorCode == ERROR_PIPE_NOT_CONNECTED)
+                {
+                    Close(); // <--- ALTERAÇÃO: Marcar como fechado para evitar mais tentativas.
+                }
+                return false;
+            }
+            if ((int32)BytesWritten < Spans[i].NumBytes - Delivered)
+            {
+                ++Delta.PartialWrites;
+            }
+            Delivered += (int32)BytesWritten;
+            TotalBytesWritten += BytesWritten;
         }
-        return -1;
     }
-    if (BytesWritten != (DWORD)NumBytes)
+    Delta.BytesWritten += RequestedBytes;
+    return true;
+
+#elif PLATFORM_LINUX || PLATFORM_MAC
+    TArray<struct iovec, TInlineAllocator<32>> IoVecs;
+    IoVecs.Reserve(NumSpans);
+    for (int32 i = 0; i < NumSpans; ++i)
     {
-        UE_LOG(LogIVRPipeWrapper, Warning, TEXT("Incomplete write to Named Pipe '%s'. Wrote %d bytes out of %d requested."), *FullPipePath, BytesWritten, NumBytes);
+        if (Spans[i].NumBytes <= 0)
+        {
+            continue;
+        }
+        struct iovec& Vec = IoVecs.AddDefaulted_GetRef();
+        Vec.iov_base = const_cast<uint8*>(Spans[i].Data);
+        Vec.iov_len = (size_t)Spans[i].NumBytes;
     }
 
-    return (int32)BytesWritten;
-
-#elif PLATFORM_LINUX || PLATFORM_MAC
-    ssize_t BytesWritten = write(FileDescriptor, Data, NumBytes);
-    if (BytesWritten == -1)
+    int32 FirstVec = 0;
+    while (FirstVec < IoVecs.Num())
     {
+        const int32 NumVecs = FMath::Min(IoVecs.Num() - FirstVec, IVR_PIPE_MAX_IOVECS);
+        size_t CallBytes = 0;
+        for (int32 i = FirstVec; i < FirstVec + NumVecs; ++i)
+        {
+            CallBytes += IoVecs[i].iov_len;
+        }
+        ssize_t BytesWritten = -1;
+#if PLATFORM_LINUX
+        if (bSplice)
+        {
+            BytesWritten = (ssize_t)syscall(SYS_vmsplice, FileDescriptor, &IoVecs[FirstVec], (unsigned long)NumVecs, 0u);
+        }
+        else
+#endif
+#if PLATFORM_LINUX
+        if (!bSplice && bStreamSocket)
+        {
+            // Socket: sendmsg com MSG_NOSIGNAL para receber EPIPE em vez de SIGPIPE se o FFmpeg sair.
+            struct msghdr Message = {};
+            Message.msg_iov = &IoVecs[FirstVec];
+            Message.msg_iovlen = (size_t)NumVecs;
+            BytesWritten = sendmsg(FileDescriptor, &Message, MSG_NOSIGNAL);
+        }
+        else
+#endif
+        {
+            BytesWritten = writev(FileDescriptor, &IoVecs[FirstVec], NumVecs);
+        }
+        if (BytesWritten > 0)
+        {
+            ++Delta.WriteCalls;
+            TotalBytesWritten += BytesWritten;
+            if ((size_t)BytesWritten < CallBytes)
+            {
+                // Escrita parcial: avança sobre os segmentos completos e ajusta o primeiro pendente.
+                ++Delta.PartialWrites;
+            }
+            size_t Remaining = (size_t)BytesWritten;
+            while (FirstVec < IoVecs.Num() && Remaining >= IoVecs[FirstVec].iov_len)
+            {
+                Remaining -= IoVecs[FirstVec].iov_len;
+                ++FirstVec;
+            }
+            if (Remaining > 0)
+            {
+                IoVecs[FirstVec].iov_base = (uint8*)IoVecs[FirstVec].iov_base + Remaining;
+                IoVecs[FirstVec].iov_len -= Remaining;
+            }
+            continue;
+        }
+        if (BytesWritten == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (BytesWritten == 0 || errno == EAGAIN)
+        {
+            // Pipe cheio (descritor não bloqueante): espera o leitor liberar espaço.
+            if (!WaitUntilWritable())
+            {
+                return false;
+            }
+            continue;
+        }
         // Checar errno para erros específicos que indicam um pipe quebrado (e.g., EPIPE)
         if (errno == EPIPE)
         {
@@ -234,15 +400,110 @@ int32 FIVR_PipeWrapper::Write(const uint8* Data, int32 NumBytes)
         {
             UE_LOG(LogIVRPipeWrapper, Error, TEXT("Failed to write to FIFO '%s'. Error: %s"), *FullPipePath, UTF8_TO_TCHAR(strerror(errno)));
         }
-        return -1;
+        return false;
     }
-    return (int32)BytesWritten;
+    Delta.BytesWritten += RequestedBytes;
+    return true;
 #else // Outras plataformas
     UE_LOG(LogIVRPipeWrapper, Error, TEXT("FIVR_PipeWrapper::Write not implemented for this platform."));
-    return -1;
+    return false;
+#endif
+}
+
+#if PLATFORM_LINUX || PLATFORM_MAC
+bool FIVR_PipeWrapper::WaitUntilWritable()
+{
+    const uint64 StartCycles = FPlatformTime::Cycles64();
+    bool bWritable = false;
+    while (!bWritable)
+    {
+        if (bConnectAborted)
+        {
+            // AbortConnect() também interrompe uma escrita parada (ex.: FFmpeg nunca lançado no modo stdin).
+            UE_LOG(LogIVRPipeWrapper, Warning, TEXT("Write to '%s' aborted while waiting for the reader."), *FullPipePath);
+            break;
+        }
+        struct pollfd WaitFd = { FileDescriptor, POLLOUT, 0 };
+        const int Ready = poll(&WaitFd, 1, 100);
+        if (Ready == -1 && errno != EINTR)
+        {
+            UE_LOG(LogIVRPipeWrapper, Error, TEXT("poll() failed on FIFO '%s'. Error: %s"), *FullPipePath, UTF8_TO_TCHAR(strerror(errno)));
+            break;
+        }
+        if (Ready > 0 && (WaitFd.revents & (POLLERR | POLLHUP | POLLNVAL)))
+        {
+            UE_LOG(LogIVRPipeWrapper, Error, TEXT("FIFO '%s' reader went away while waiting to write."), *FullPipePath);
+            Close();
+            break;
+        }
+        bWritable = Ready > 0 && (WaitFd.revents & POLLOUT);
+    }
+    FIVR_PipeWriteStats StallDelta;
+    StallDelta.StallSeconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+    MergeWriteStats(StallDelta);
+    return bWritable;
+}
+#endif
+
+void FIVR_PipeWrapper::ResetWriteStats()
+{
+    TotalBytesWritten = 0;
+    FScopeLock Lock(&WriteStatsLock);
+    WriteStats = FIVR_PipeWriteStats();
+    ConnectCycles = FPlatformTime::Cycles64();
+}
+
+void FIVR_PipeWrapper::MergeWriteStats(const FIVR_PipeWriteStats& Delta)
+{
+    FScopeLock Lock(&WriteStatsLock);
+    WriteStats.BytesWritten += Delta.BytesWritten;
+    WriteStats.WriteCalls += Delta.WriteCalls;
+    WriteStats.GatherWrites += Delta.GatherWrites;
+    WriteStats.PartialWrites += Delta.PartialWrites;
+    WriteStats.StallSeconds += Delta.StallSeconds;
+}
+
+void FIVR_PipeWrapper::AbortConnect()
+{
+    bConnectAborted.AtomicSet(true);
+#if PLATFORM_WINDOWS
+    // ConnectNamedPipe não tem timeout: um cliente descartável faz a chamada retornar.
+    if (PipeHandle != INVALID_HANDLE_VALUE && !FullPipePath.IsEmpty())
+    {
+        HANDLE WakeHandle = CreateFile(*FullPipePath, GENERIC_READ, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+        if (WakeHandle != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(WakeHandle);
+        }
+    }
 #endif
+}
 
+#if PLATFORM_LINUX || PLATFORM_MAC
+bool FIVR_PipeWrapper::ShouldGiveUpConnecting(double DeadlineSeconds) const
+{
+    if (bConnectAborted)
+    {
+        UE_LOG(LogIVRPipeWrapper, Warning, TEXT("Connection to '%s' aborted before FFmpeg connected."), *FullPipePath);
+        return true;
+    }
+    if (FPlatformTime::Seconds() >= DeadlineSeconds)
+    {
+        UE_LOG(LogIVRPipeWrapper, Error, TEXT("Timed out after %.1fs waiting for FFmpeg to open '%s'. Is the FFmpeg process still running?"), PipeSettings.ConnectTimeoutSeconds, *FullPipePath);
+        return true;
+    }
+    return false;
 }
+#endif
+
+FIVR_PipeWriteStats FIVR_PipeWrapper::GetWriteStats() const
+{
+    FScopeLock Lock(&WriteStatsLock);
+    FIVR_PipeWriteStats Stats = WriteStats;
+    Stats.ConnectedSeconds = ConnectCycles != 0 ? FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - ConnectCycles) : 0.0;
+    return Stats;
+}
+// --- FIM DA ALTERAÇÃO ---
 // Close Pipe
 void FIVR_PipeWrapper::Close()
 {
@@ -266,24 +527,79 @@ void FIVR_PipeWrapper::Close()
         FileDescriptor = -1; // <--- ALTERAÇÃO: Garantir que seja SEMPRE setado para inválido
         UE_LOG(LogIVRPipeWrapper, Log, TEXT("FIFO '%s' file descriptor closed."), *FullPipePath);
     }
-    // No Linux, o arquivo FIFO em si é limpo quando o módulo IVROpenCVBridge é desligado
-    // (ex: na ShutdownModule() ou um Clean() mais abrangente).
-    // Evitamos unlink() aqui para não remover o FIFO enquanto o FFmpeg ainda pode estar lendo dele,
-// ou se o processo precisar reabrir o pipe rapidamente.
-    // O ideal é que o 'unlink' do FIFO seja feito *antes* de 'mkfifo' para garantir uma limpeza antes da criação,
-    // ou no momento de desligamento do módulo/plugin, se o FIFO for persistir durante a execução do processo.
-    // Para o nosso caso, a criação já faz um 'unlink' para limpar.
-    // if (!FullPipePath.IsEmpty() && access(TCHAR_TO_UTF8(*FullPipePath), F_OK) == 0)
-    // {
-    //     unlink(TCHAR_TO_UTF8(*FullPipePath));
-    //     UE_LOG(LogIVRPipeWrapper, Log, TEXT("FIFO file '%s' unlinked."), *FullPipePath);
-    // }
+    // Normalmente o FIFO já foi removido no Connect (o FFmpeg mantém seu descritor aberto e continua lendo).
+    // Aqui cobrimos o caso em que o leitor nunca se conectou, para não deixar FIFOs órfãos em IVRTemporaryPipes.
+    if (bFifoLinked)
+    {
+        unlink(TCHAR_TO_UTF8(*FullPipePath));
+        bFifoLinked = false;
+        UE_LOG(LogIVRPipeWrapper, Log, TEXT("FIFO file '%s' unlinked."), *FullPipePath);
+    }
 #else // Outras plataformas
     // No-op
 #endif
     bIsCreatedAndConnected = false;
     FullPipePath = TEXT(""); // Limpa o caminho para indicar que não há pipe ativo.
 }
+// --- INÍCIO DA ALTERAÇÃO: BUFFER AMPLIADO E ESCRITA ZERO-COPY (LINUX) ---
+#if PLATFORM_LINUX
+void FIVR_PipeWrapper::GrowPipeBuffer()
+{
+    // O padrão do kernel é 64 KiB: um frame 1080p BGRA exigiria mais de 100 trocas de contexto com o FFmpeg.
+    int32 MaxPipeBytes = 1024 * 1024;
+    FString MaxSizeText;
+    if (FFileHelper::LoadFileToString(MaxSizeText, TEXT("/proc/sys/fs/pipe-max-size")))
+    {
+        MaxPipeBytes = FMath::Max(MaxPipeBytes, FCString::Atoi(*MaxSizeText.TrimStartAndEnd()));
+    }
+    int32 RequestedBytes = FMath::Min(FMath::Max(FrameBytesHint, 1024 * 1024), MaxPipeBytes);
+    // Sem privilégio, o kernel também recusa (EPERM) se o usuário excedeu o limite global de páginas em pipes.
+    while (RequestedBytes > 65536 && fcntl(FileDescriptor, F_SETPIPE_SZ, RequestedBytes) == -1)
+    {
+        RequestedBytes /= 2;
+    }
+    PipeCapacityBytes = fcntl(FileDescriptor, F_GETPIPE_SZ);
+    UE_LOG(LogIVRPipeWrapper, Log, TEXT("Pipe '%s' buffer set to %d bytes (frame: %d bytes, system max: %d)."), *FullPipePath, PipeCapacityBytes, FrameBytesHint, MaxPipeBytes);
+}
+#endif
+
+bool FIVR_PipeWrapper::IsZeroCopyEnabled() const
+{
+#if PLATFORM_LINUX
+    return PipeSettings.bUseZeroCopySplice && IsValid();
+#else
+    return false;
+#endif
+}
+
+int32 FIVR_PipeWrapper::WriteZeroCopy(const uint8* Data, int32 NumBytes)
+{
+    const FIVR_PipeWriteSpan Span{ Data, NumBytes };
+    return WriteZeroCopyGather(&Span, 1) ? NumBytes : -1;
+}
+
+bool FIVR_PipeWrapper::WriteZeroCopyGather(const FIVR_PipeWriteSpan* Spans, int32 NumSpans)
+{
+#if PLATFORM_LINUX
+    return DeliverSpans(Spans, NumSpans, PipeSettings.bUseZeroCopySplice);
+#else
+    // Sem vmsplice: cai para a escrita normal (com cópia).
+    return DeliverSpans(Spans, NumSpans, false);
+#endif
+}
+
+int64 FIVR_PipeWrapper::GetBytesConsumedByReader() const
+{
+#if PLATFORM_LINUX
+    int PendingBytes = 0;
+    if (FileDescriptor != -1 && ioctl(FileDescriptor, FIONREAD, &PendingBytes) == 0)
+    {
+        return TotalBytesWritten - PendingBytes;
+    }
+#endif
+    return TotalBytesWritten;
+}
+// --- FIM DA ALTERAÇÃO ---
 bool FIVR_PipeWrapper::IsValid() const
 {
 #if PLATFORM_WINDOWS
@@ -0,0 +1,244 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#include "IVR_RawContainer.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Compression.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY(LogIVRRawContainer);
+
+namespace
+{
+    static const ANSICHAR IVRRawMagic[8] = { 'I', 'V', 'R', 'R', 'A', 'W', 0, 0 };
+    static const uint32 IVRRawFourCC_BGRA = 'B' | ('G' << 8) | ('R' << 16) | ('A' << 24);
+}
+
+// =====================================================================================
+// FIVR_RawContainerWriter
+// =====================================================================================
+FIVR_RawContainerWriter::FIVR_RawContainerWriter()
+{
+    FMemory::Memzero(Header);
+}
+
+FIVR_RawContainerWriter::~FIVR_RawContainerWriter()
+{
+    if (IsOpen())
+    {
+        UE_LOG(LogIVRRawContainer, Warning, TEXT("Container '%s' destruído sem Finalize. Finalizando agora."), *FilePath);
+        Finalize();
+    }
+}
+
+bool FIVR_RawContainerWriter::Open(const FString& InFilePath, int32 InWidth, int32 InHeight, float InNominalFPS, bool bInCompressLZ4)
+{
+    if (IsOpen())
+    {
+        UE_LOG(LogIVRRawContainer, Warning, TEXT("Container '%s' já aberto. Abortando o anterior."), *FilePath);
+        Abort();
+    }
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    PlatformFile.CreateDirectoryTree(*FPaths::GetPath(InFilePath));
+    FileHandle.Reset(PlatformFile.OpenWrite(*InFilePath, false, false));
+    if (!FileHandle.IsValid())
+    {
+        UE_LOG(LogIVRRawContainer, Error, TEXT("Falha ao criar container raw: %s"), *InFilePath);
+        return false;
+    }
+    FilePath = InFilePath;
+
+    FMemory::Memzero(Header);
+    FMemory::Memcpy(Header.Magic, IVRRawMagic, sizeof(Header.Magic));
+    Header.Version = IVR_RAW_VERSION;
+    Header.HeaderBytes = sizeof(FIVR_RawContainerHeader);
+    Header.Width = InWidth;
+    Header.Height = InHeight;
+    Header.NominalFPS = InNominalFPS;
+    Header.PixelFormat = IVRRawFourCC_BGRA;
+    Header.Flags = bInCompressLZ4 ? IVR_RAW_FLAG_LZ4 : 0;
+
+    Index.Reset();
+    ZeroPadding.SetNumZeroed(IVR_RAW_BLOCK_ALIGNMENT);
+
+    // Cabeçalho provisório (IndexOffset = 0) ocupando o primeiro bloco alinhado.
+    if (!FileHandle->Write(reinterpret_cast<const uint8*>(&Header), sizeof(Header))
+        || !FileHandle->Write(ZeroPadding.GetData(), IVR_RAW_BLOCK_ALIGNMENT - sizeof(Header)))
+    {
+        UE_LOG(LogIVRRawContainer, Error, TEXT("Falha ao gravar cabeçalho do container raw: %s"), *FilePath);
+        Abort();
+        return false;
+    }
+    WriteOffset = IVR_RAW_BLOCK_ALIGNMENT;
+    UE_LOG(LogIVRRawContainer, Log, TEXT("Container raw aberto: %s (%dx%d @ %.2f FPS, LZ4: %s)."), *FilePath, InWidth, InHeight, InNominalFPS, bInCompressLZ4 ? TEXT("sim") : TEXT("não"));
+    return true;
+}
+
+bool FIVR_RawContainerWriter::Append(const FIVR_VideoFrame& Frame)
+{
+    if (!FileHandle.IsValid() || !Frame.RawDataPtr.IsValid() || Frame.RawDataPtr->Num() == 0)
+    {
+        return false;
+    }
+    const int32 RawBytes = Frame.RawDataPtr->Num();
+    const uint8* Payload = Frame.RawDataPtr->GetData();
+    int32 StoredBytes = RawBytes;
+    uint32 EntryFlags = 0;
+
+    if (Header.Flags & IVR_RAW_FLAG_LZ4)
+    {
+        int32 CompressedBytes = FCompression::CompressMemoryBound(NAME_LZ4, RawBytes);
+        CompressionScratch.SetNumUninitialized(CompressedBytes, EAllowShrinking::No);
+        if (FCompression::CompressMemory(NAME_LZ4, CompressionScratch.GetData(), CompressedBytes, Payload, RawBytes) && CompressedBytes < RawBytes)
+        {
+            Payload = CompressionScratch.GetData();
+            StoredBytes = CompressedBytes;
+            EntryFlags |= IVR_RAW_FLAG_LZ4;
+        }
+    }
+
+    const int64 SpanBytes = Align((int64)StoredBytes, (int64)IVR_RAW_BLOCK_ALIGNMENT);
+    if (!FileHandle->Write(Payload, StoredBytes)
+        || (SpanBytes > StoredBytes && !FileHandle->Write(ZeroPadding.GetData(), SpanBytes - StoredBytes)))
+    {
+        UE_LOG(LogIVRRawContainer, Error, TEXT("Falha ao gravar frame %d no container raw '%s' (disco cheio?)."), Index.Num(), *FilePath);
+        return false;
+    }
+
+    FIVR_RawIndexEntry& Entry = Index.AddZeroed_GetRef();
+    Entry.Offset = WriteOffset;
+    Entry.StoredBytes = StoredBytes;
+    Entry.RawBytes = RawBytes;
+    Entry.TimestampNs = Frame.TimestampNs;
+    Entry.Flags = EntryFlags;
+    WriteOffset += SpanBytes;
+    return true;
+}
+
+bool FIVR_RawContainerWriter::Finalize()
+{
+    if (!FileHandle.IsValid())
+    {
+        return false;
+    }
+    Header.IndexOffset = WriteOffset;
+    Header.FrameCount = Index.Num();
+
+    bool bOk = FileHandle->Write(reinterpret_cast<const uint8*>(Index.GetData()), (int64)Index.Num() * sizeof(FIVR_RawIndexEntry));
+    bOk = bOk && FileHandle->Seek(0) && FileHandle->Write(reinterpret_cast<const uint8*>(&Header), sizeof(Header));
+    bOk = bOk && FileHandle->Flush();
+    FileHandle.Reset();
+
+    if (!bOk)
+    {
+        UE_LOG(LogIVRRawContainer, Error, TEXT("Falha ao finalizar container raw: %s"), *FilePath);
+        return false;
+    }
+    UE_LOG(LogIVRRawContainer, Log, TEXT("Container raw finalizado: %s (%d frames, %.2f MB)."), *FilePath, Index.Num(), WriteOffset / (1024.0 * 1024.0));
+    return true;
+}
+
+void FIVR_RawContainerWriter::Abort()
+{
+    FileHandle.Reset();
+    if (!FilePath.IsEmpty())
+    {
+        FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*FilePath);
+    }
+    Index.Reset();
+    WriteOffset = 0;
+}
+
+// =====================================================================================
+// FIVR_RawContainerReader
+// =====================================================================================
+FIVR_RawContainerReader::FIVR_RawContainerReader()
+{
+    FMemory::Memzero(Header);
+}
+
+FIVR_RawContainerReader::~FIVR_RawContainerReader()
+{
+    Close();
+}
+
+bool FIVR_RawContainerReader::Open(const FString& InFilePath)
+{
+    Close();
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    FOpenMappedResult MappedResult = PlatformFile.OpenMappedEx(*InFilePath);
+    if (MappedResult.HasError())
+    {
+        UE_LOG(LogIVRRawContainer, Error, TEXT("Falha ao mapear container raw: %s"), *InFilePath);
+        return false;
+    }
+    MappedHandle = MappedResult.StealValue();
+    MappedSize = MappedHandle->GetFileSize();
+    if (MappedSize < (int64)sizeof(FIVR_RawContainerHeader))
+    {
+        UE_LOG(LogIVRRawContainer, Error, TEXT("Container raw truncado: %s"), *InFilePath);
+        Close();
+        return false;
+    }
+    MappedRegion.Reset(MappedHandle->MapRegion(0, MappedSize));
+    if (!MappedRegion.IsValid())
+    {
+        UE_LOG(LogIVRRawContainer, Error, TEXT("Falha ao mapear região do container raw: %s"), *InFilePath);
+        Close();
+        return false;
+    }
+    MappedData = MappedRegion->GetMappedPtr();
+
+    FMemory::Memcpy(&Header, MappedData, sizeof(Header));
+    if (FMemory::Memcmp(Header.Magic, IVRRawMagic, sizeof(Header.Magic)) != 0 || Header.Version != IVR_RAW_VERSION)
+    {
+        UE_LOG(LogIVRRawContainer, Error, TEXT("Arquivo não é um container .ivrraw válido (ou versão incompatível): %s"), *InFilePath);
+        Close();
+        return false;
+    }
+    const int64 IndexBytes = Header.FrameCount * (int64)sizeof(FIVR_RawIndexEntry);
+    if (Header.IndexOffset <= 0 || Header.FrameCount < 0 || Header.IndexOffset + IndexBytes > MappedSize)
+    {
+        UE_LOG(LogIVRRawContainer, Error, TEXT("Container raw não finalizado ou com índice corrompido: %s"), *InFilePath);
+        Close();
+        return false;
+    }
+    IndexEntries = reinterpret_cast<const FIVR_RawIndexEntry*>(MappedData + Header.IndexOffset);
+    FrameCount = (int32)Header.FrameCount;
+    return true;
+}
+
+void FIVR_RawContainerReader::Close()
+{
+    MappedRegion.Reset(); // A região precisa ser liberada antes do handle
+    MappedHandle.Reset();
+    MappedData = nullptr;
+    MappedSize = 0;
+    IndexEntries = nullptr;
+    FrameCount = 0;
+}
+
+bool FIVR_RawContainerReader::ReadFrame(int32 FrameIndex, uint8* Dest, int32 DestBytes) const
+{
+    if (!IsOpen() || FrameIndex < 0 || FrameIndex >= FrameCount || !Dest)
+    {
+        return false;
+    }
+    const FIVR_RawIndexEntry& Entry = IndexEntries[FrameIndex];
+    // Índice corrompido ou truncado: tamanhos/offset negativos, leitura além do arquivo mapeado, ou frame sem
+    // compressão cujo tamanho lido (RawBytes) difere do tamanho gravado (StoredBytes)
+    const bool bCompressed = (Entry.Flags & IVR_RAW_FLAG_LZ4) != 0;
+    if (Entry.Offset < 0 || Entry.RawBytes < 0 || Entry.StoredBytes < 0 || Entry.RawBytes > DestBytes ||
+        Entry.Offset > MappedSize - Entry.StoredBytes || (!bCompressed && Entry.RawBytes != Entry.StoredBytes))
+    {
+        UE_LOG(LogIVRRawContainer, Error, TEXT("Entrada %d inválida no container raw (offset %lld, %d bytes)."), FrameIndex, Entry.Offset, Entry.StoredBytes);
+        return false;
+    }
+    const uint8* Source = MappedData + Entry.Offset;
+    if (bCompressed)
+    {
+        return FCompression::UncompressMemory(NAME_LZ4, Dest, Entry.RawBytes, Source, Entry.StoredBytes);
+    }
+    FMemory::Memcpy(Dest, Source, Entry.RawBytes);
+    return true;
+}
@@ -0,0 +1,233 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#include "IVR_SharedFrameRing.h"
+#include "HAL/PlatformProcess.h"
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include <windows.h>
+#include "Windows/HideWindowsPlatformTypes.h"
+#elif PLATFORM_LINUX || PLATFORM_MAC
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#if PLATFORM_LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+DEFINE_LOG_CATEGORY(LogIVRSharedFrameRing);
+
+FIVR_SharedFrameRingWriter::FIVR_SharedFrameRingWriter()
+{
+}
+
+FIVR_SharedFrameRingWriter::~FIVR_SharedFrameRingWriter()
+{
+    Close();
+}
+
+bool FIVR_SharedFrameRingWriter::Open(const FString& InRingName, int32 InWidth, int32 InHeight, int32 InSlotCount)
+{
+    if (IsOpen())
+    {
+        Close();
+    }
+    if (InWidth <= 0 || InHeight <= 0)
+    {
+        UE_LOG(LogIVRSharedFrameRing, Error, TEXT("Invalid frame size for shared frame ring (%dx%d)."), InWidth, InHeight);
+        return false;
+    }
+
+    // Só caracteres seguros para nomes de shm/objetos do kernel. O macOS limita nomes POSIX a 31 caracteres.
+    FString SafeName;
+    for (const TCHAR Char : InRingName)
+    {
+        SafeName.AppendChar(FChar::IsAlnum(Char) || Char == TEXT('_') || Char == TEXT('-') ? Char : TEXT('_'));
+    }
+    if (SafeName.IsEmpty())
+    {
+        SafeName = TEXT("IVRFrames");
+    }
+    SafeName = SafeName.Left(26);
+
+    const uint32 SlotCount = (uint32)FMath::Clamp(InSlotCount, 2, 64);
+    const uint64 PayloadBytes = (uint64)InWidth * (uint64)InHeight * 4;
+    const uint64 SlotPayloadBytes = Align(PayloadBytes, (uint64)IVR_SHM_PAYLOAD_ALIGNMENT);
+    // O header de cada slot ocupa os últimos 64 bytes da página anterior ao seu payload, que assim começa alinhado.
+    const uint64 SlotStride = SlotPayloadBytes + IVR_SHM_PAYLOAD_ALIGNMENT;
+    const uint32 HeaderBytes = IVR_SHM_PAYLOAD_ALIGNMENT - sizeof(IVR_ShmSlotHeader);
+    const uint64 TotalBytes = HeaderBytes + SlotCount * SlotStride;
+    static_assert(sizeof(IVR_ShmRingHeader) <= IVR_SHM_PAYLOAD_ALIGNMENT - sizeof(IVR_ShmSlotHeader), "Ring header must fit before the first slot header");
+
+    void* MappedBase = nullptr;
+#if PLATFORM_WINDOWS
+    SystemName = FString::Printf(TEXT("Local\\IVR_%s"), *SafeName);
+    MappingHandle = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)(TotalBytes >> 32), (DWORD)(TotalBytes & 0xFFFFFFFFull), *SystemName);
+    if (!MappingHandle)
+    {
+        UE_LOG(LogIVRSharedFrameRing, Error, TEXT("Failed to create shared frame ring '%s'. Error: %d"), *SystemName, GetLastError());
+        SystemName.Empty();
+        return false;
+    }
+    if (GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        // Um leitor ainda segura o mapeamento da sessão anterior: reaproveitamos (o MapViewOfFile falha se for menor).
+        UE_LOG(LogIVRSharedFrameRing, Log, TEXT("Shared frame ring '%s' already exists. Reusing it."), *SystemName);
+    }
+    MappedBase = MapViewOfFile(MappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)TotalBytes);
+    DoorbellEvents[0] = CreateEventW(nullptr, TRUE, FALSE, *FString::Printf(TEXT("%s_Even"), *SystemName));
+    DoorbellEvents[1] = CreateEventW(nullptr, TRUE, FALSE, *FString::Printf(TEXT("%s_Odd"), *SystemName));
+#else
+    SystemName = FString::Printf(TEXT("/IVR_%s"), *SafeName);
+    const FTCHARToUTF8 SystemNameUtf8(*SystemName);
+    // Remove o anel de uma sessão anterior. Leitores ainda anexados a ele mantêm o mapeamento antigo (WriterState = 0).
+    shm_unlink(SystemNameUtf8.Get());
+    const int Fd = shm_open(SystemNameUtf8.Get(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (Fd == -1)
+    {
+        UE_LOG(LogIVRSharedFrameRing, Error, TEXT("shm_open('%s') failed. Error: %s"), *SystemName, UTF8_TO_TCHAR(strerror(errno)));
+        SystemName.Empty();
+        return false;
+    }
+    if (ftruncate(Fd, (off_t)TotalBytes) == 0)
+    {
+        MappedBase = mmap(nullptr, (size_t)TotalBytes, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+        if (MappedBase == MAP_FAILED)
+        {
+            MappedBase = nullptr;
+        }
+    }
+    close(Fd); // O mapeamento mantém o objeto vivo
+#endif
+    if (!MappedBase)
+    {
+        UE_LOG(LogIVRSharedFrameRing, Error, TEXT("Failed to map %llu bytes for shared frame ring '%s'."), TotalBytes, *SystemName);
+#if PLATFORM_LINUX || PLATFORM_MAC
+        shm_unlink(SystemNameUtf8.Get());
+#endif
+        Close();
+        return false;
+    }
+
+    // Zerar o Magic primeiro invalida o header de uma sessão anterior reaproveitada (Windows).
+    FPlatformAtomics::InterlockedExchange((volatile int32*)&((IVR_ShmRingHeader*)MappedBase)->Magic, 0);
+    // Toca todas as páginas agora, para que a primeira volta do anel não pague page faults na Game Thread.
+    FMemory::Memzero(MappedBase, (SIZE_T)TotalBytes);
+    Header = (IVR_ShmRingHeader*)MappedBase;
+    MappedBytes = TotalBytes;
+    Header->Version = IVR_SHM_RING_VERSION;
+    Header->HeaderBytes = HeaderBytes;
+    Header->SlotCount = SlotCount;
+    Header->SlotStride = SlotStride;
+    Header->SlotPayloadBytes = SlotPayloadBytes;
+    Header->Width = (uint32)InWidth;
+    Header->Height = (uint32)InHeight;
+    Header->PixelFormat = IVR_SHM_FOURCC_BGRA;
+    Header->WriterPid = FPlatformProcess::GetCurrentProcessId();
+    Header->TotalBytes = TotalBytes;
+    Header->WriterState = 1;
+    // Magic por último: um leitor que anexa durante a inicialização não valida um header incompleto.
+    FPlatformAtomics::InterlockedExchange((volatile int32*)&Header->Magic, (int32)IVR_SHM_RING_MAGIC);
+
+    FramesPublished = 0;
+    FramesRejected = 0;
+    UE_LOG(LogIVRSharedFrameRing, Log, TEXT("Shared frame ring '%s' opened: %u slots of %dx%d BGRA (%.1f MB)."),
+        *SystemName, SlotCount, InWidth, InHeight, TotalBytes / (1024.0 * 1024.0));
+    return true;
+}
+
+void FIVR_SharedFrameRingWriter::Close()
+{
+    if (Header)
+    {
+        FPlatformAtomics::InterlockedExchange((volatile int32*)&Header->WriterState, 0);
+        // Acorda quem estiver esperando, para que percebam o fechamento.
+        RingDoorbell((uint32)FPlatformAtomics::InterlockedIncrement((volatile int32*)&Header->Doorbell));
+        UE_LOG(LogIVRSharedFrameRing, Log, TEXT("Shared frame ring '%s' closed. Published: %llu, rejected: %llu."), *SystemName, FramesPublished, FramesRejected);
+    }
+#if PLATFORM_WINDOWS
+    if (Header)
+    {
+        UnmapViewOfFile(Header);
+    }
+    for (void*& Event : DoorbellEvents)
+    {
+        if (Event)
+        {
+            CloseHandle((HANDLE)Event);
+            Event = nullptr;
+        }
+    }
+    if (MappingHandle)
+    {
+        CloseHandle((HANDLE)MappingHandle); // O nome some quando o último leitor fechar o seu handle
+        MappingHandle = nullptr;
+    }
+#else
+    if (Header)
+    {
+        munmap(Header, (size_t)MappedBytes);
+        shm_unlink(TCHAR_TO_UTF8(*SystemName));
+    }
+#endif
+    Header = nullptr;
+    MappedBytes = 0;
+}
+
+bool FIVR_SharedFrameRingWriter::Publish(const FIVR_VideoFrame& Frame)
+{
+    if (!Header || !Frame.RawDataPtr.IsValid())
+    {
+        return false;
+    }
+    const uint64 PayloadBytes = (uint64)Frame.RawDataPtr->Num();
+    if (Frame.Width <= 0 || Frame.Height <= 0 || PayloadBytes > Header->SlotPayloadBytes || PayloadBytes < (uint64)Frame.Width * Frame.Height * 4)
+    {
+        if (FramesRejected++ == 0)
+        {
+            UE_LOG(LogIVRSharedFrameRing, Warning, TEXT("Frame %dx%d (%llu bytes) does not fit shared frame ring '%s' (%llu bytes per slot). Skipping."),
+                Frame.Width, Frame.Height, PayloadBytes, *SystemName, (uint64)Header->SlotPayloadBytes);
+        }
+        return false;
+    }
+
+    const uint64 FrameIndex = FramesPublished;
+    IVR_ShmSlotHeader* Slot = (IVR_ShmSlotHeader*)IVR_ShmRing_Slot(Header, FrameIndex);
+    uint8* Payload = (uint8*)IVR_ShmRing_SlotPayload(Header, Slot);
+
+    // Seqlock: ímpar durante a cópia. As trocas atômicas são barreiras completas, o que impede que a cópia
+    // "vaze" para antes da marcação ou para depois da publicação.
+    FPlatformAtomics::InterlockedExchange((volatile int64*)&Slot->Sequence, (int64)(IVR_SHM_PUBLISHED_SEQUENCE(FrameIndex) - 1));
+    Slot->FrameIndex = FrameIndex;
+    Slot->TimestampNs = Frame.TimestampNs;
+    Slot->Width = (uint32)Frame.Width;
+    Slot->Height = (uint32)Frame.Height;
+    Slot->Stride = (uint32)Frame.Width * 4;
+    Slot->PayloadBytes = (uint32)PayloadBytes;
+    FMemory::Memcpy(Payload, Frame.RawDataPtr->GetData(), PayloadBytes);
+    FPlatformAtomics::InterlockedExchange((volatile int64*)&Slot->Sequence, (int64)IVR_SHM_PUBLISHED_SEQUENCE(FrameIndex));
+
+    ++FramesPublished;
+    FPlatformAtomics::InterlockedExchange((volatile int64*)&Header->WriteSequence, (int64)FramesPublished);
+    RingDoorbell((uint32)FPlatformAtomics::InterlockedIncrement((volatile int32*)&Header->Doorbell));
+    return true;
+}
+
+void FIVR_SharedFrameRingWriter::RingDoorbell(uint32 NewDoorbell)
+{
+#if PLATFORM_LINUX
+    // FUTEX_WAKE sem esperadores é só uma syscall barata; nunca bloqueia o escritor.
+    syscall(SYS_futex, (volatile uint32*)&Header->Doorbell, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#elif PLATFORM_WINDOWS
+    const int32 Parity = NewDoorbell & 1;
+    if (DoorbellEvents[Parity] && DoorbellEvents[Parity ^ 1])
+    {
+        SetEvent((HANDLE)DoorbellEvents[Parity]);
+        ResetEvent((HANDLE)DoorbellEvents[Parity ^ 1]);
+    }
+#endif
+    // macOS: os leitores fazem polling de WriteSequence.
+}
@@ -0,0 +1,249 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#include "IVR_SpillRingFile.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Compression.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY(LogIVRSpillRingFile);
+
+FIVR_SpillRingFile::FIVR_SpillRingFile()
+{
+}
+
+FIVR_SpillRingFile::~FIVR_SpillRingFile()
+{
+    Close();
+}
+
+bool FIVR_SpillRingFile::Open(const FString& InFilePath, int64 InCapacityBytes, bool bInCompressLZ4)
+{
+    if (IsOpen())
+    {
+        UE_LOG(LogIVRSpillRingFile, Warning, TEXT("Spill ring '%s' já aberto. Fechando e recriando."), *FilePath);
+        Close();
+    }
+    if (InCapacityBytes < SpillBlockAlignment)
+    {
+        UE_LOG(LogIVRSpillRingFile, Error, TEXT("Capacidade de spill inválida (%lld bytes)."), InCapacityBytes);
+        return false;
+    }
+
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    PlatformFile.CreateDirectoryTree(*FPaths::GetPath(InFilePath));
+
+    // Escrita com leitura habilitada: o mesmo handle grava e relê os registros.
+    FileHandle.Reset(PlatformFile.OpenWrite(*InFilePath, false, true));
+    if (!FileHandle.IsValid())
+    {
+        UE_LOG(LogIVRSpillRingFile, Error, TEXT("Falha ao criar arquivo de spill: %s"), *InFilePath);
+        return false;
+    }
+
+    FilePath = InFilePath;
+    CapacityBytes = Align(InCapacityBytes, SpillBlockAlignment);
+    // Reserva a extensão completa do anel de uma vez, evitando crescimento do arquivo durante a gravação.
+    if (!FileHandle->Truncate(CapacityBytes))
+    {
+        UE_LOG(LogIVRSpillRingFile, Warning, TEXT("Não foi possível pré-alocar %lld bytes para '%s'. O arquivo crescerá sob demanda."), CapacityBytes, *FilePath);
+    }
+
+    WriteOffset = 0;
+    ReadOffset = 0;
+    UsedBytes = 0;
+    WrapWasteBytes = 0;
+    bWrapped = false;
+    bCompressLZ4 = bInCompressLZ4;
+    Records.Empty();
+    NumRecords = 0;
+    ZeroPadding.SetNumZeroed(SpillBlockAlignment);
+
+    UE_LOG(LogIVRSpillRingFile, Log, TEXT("Spill ring criado: %s (%.2f MB, LZ4: %s)."), *FilePath, CapacityBytes / (1024.0 * 1024.0), bCompressLZ4 ? TEXT("sim") : TEXT("não"));
+    return true;
+}
+
+void FIVR_SpillRingFile::Close()
+{
+    if (!FileHandle.IsValid())
+    {
+        return;
+    }
+    if (NumRecords > 0)
+    {
+        UE_LOG(LogIVRSpillRingFile, Warning, TEXT("Fechando spill ring '%s' com %d frames não lidos. Eles serão descartados."), *FilePath, NumRecords);
+    }
+    FileHandle.Reset(); // Fecha o handle antes de apagar o arquivo
+    FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*FilePath);
+
+    Records.Empty();
+    NumRecords = 0;
+    UsedBytes = 0;
+    WrapWasteBytes = 0;
+    bWrapped = false;
+    CompressionScratch.Empty();
+    UE_LOG(LogIVRSpillRingFile, Log, TEXT("Spill ring fechado e removido: %s"), *FilePath);
+}
+
+int64 FIVR_SpillRingFile::ReserveSpan(int64 SpanBytes) const
+{
+    if (SpanBytes > CapacityBytes)
+    {
+        return INDEX_NONE;
+    }
+    if (NumRecords == 0)
+    {
+        return 0; // Anel vazio: recomeça do início para manter as escritas sequenciais
+    }
+    if (!bWrapped)
+    {
+        // Espaço livre em [WriteOffset, Capacity) e depois em [0, ReadOffset)
+        if (WriteOffset + SpanBytes <= CapacityBytes)
+        {
+            return WriteOffset;
+        }
+        if (SpanBytes <= ReadOffset)
+        {
+            return 0;
+        }
+        return INDEX_NONE;
+    }
+    // Já deu a volta: espaço livre apenas em [WriteOffset, ReadOffset)
+    return (WriteOffset + SpanBytes <= ReadOffset) ? WriteOffset : INDEX_NONE;
+}
+
+bool FIVR_SpillRingFile::Push(const FIVR_VideoFrame& Frame)
+{
+    if (!FileHandle.IsValid() || !Frame.RawDataPtr.IsValid() || Frame.RawDataPtr->Num() == 0)
+    {
+        return false;
+    }
+
+    const int32 RawBytes = Frame.RawDataPtr->Num();
+    const uint8* Payload = Frame.RawDataPtr->GetData();
+    int32 PayloadBytes = RawBytes;
+    bool bCompressed = false;
+
+    if (bCompressLZ4)
+    {
+        int32 CompressedBytes = FCompression::CompressMemoryBound(NAME_LZ4, RawBytes);
+        CompressionScratch.SetNumUninitialized(CompressedBytes, EAllowShrinking::No);
+        if (FCompression::CompressMemory(NAME_LZ4, CompressionScratch.GetData(), CompressedBytes, Payload, RawBytes) && CompressedBytes < RawBytes)
+        {
+            Payload = CompressionScratch.GetData();
+            PayloadBytes = CompressedBytes;
+            bCompressed = true;
+        }
+    }
+
+    const int64 SpanBytes = Align((int64)PayloadBytes, SpillBlockAlignment);
+    const int64 Offset = ReserveSpan(SpanBytes);
+    if (Offset == INDEX_NONE)
+    {
+        return false; // Anel cheio
+    }
+
+    if (!FileHandle->Seek(Offset) || !FileHandle->Write(Payload, PayloadBytes))
+    {
+        UE_LOG(LogIVRSpillRingFile, Error, TEXT("Falha ao escrever %d bytes no spill ring '%s' (offset %lld)."), PayloadBytes, *FilePath, Offset);
+        return false;
+    }
+    const int64 PaddingBytes = SpanBytes - PayloadBytes;
+    if (PaddingBytes > 0 && !FileHandle->Write(ZeroPadding.GetData(), PaddingBytes))
+    {
+        UE_LOG(LogIVRSpillRingFile, Error, TEXT("Falha ao completar o alinhamento no spill ring '%s'."), *FilePath);
+        return false;
+    }
+
+    if (NumRecords == 0)
+    {
+        ReadOffset = Offset;
+        WrapWasteBytes = 0;
+        bWrapped = false;
+    }
+    else if (!bWrapped && Offset < WriteOffset)
+    {
+        // Deu a volta: o trecho final não usado fica ocupado até a cabeça também voltar ao início.
+        WrapWasteBytes = CapacityBytes - WriteOffset;
+        UsedBytes += WrapWasteBytes;
+        bWrapped = true;
+    }
+
+    FSpillRecord Record;
+    Record.Offset = Offset;
+    Record.SpanBytes = SpanBytes;
+    Record.PayloadBytes = PayloadBytes;
+    Record.RawBytes = RawBytes;
+    Record.Width = Frame.Width;
+    Record.Height = Frame.Height;
+    Record.TimestampNs = Frame.TimestampNs;
+    Record.bCompressed = bCompressed;
+    Records.Enqueue(Record);
+    ++NumRecords;
+
+    WriteOffset = Offset + SpanBytes;
+    UsedBytes += SpanBytes;
+    return true;
+}
+
+bool FIVR_SpillRingFile::Pop(FIVR_VideoFrame& OutFrame, UIVRFramePool* FramePool)
+{
+    FSpillRecord Record;
+    if (!FileHandle.IsValid() || !FramePool || !Records.Dequeue(Record))
+    {
+        return false;
+    }
+    --NumRecords;
+    UsedBytes -= Record.SpanBytes;
+
+    // Avança a cabeça; se ela voltou ao início, o trecho pulado no final do arquivo é liberado.
+    if (NumRecords == 0)
+    {
+        ReadOffset = 0;
+        WriteOffset = 0;
+        UsedBytes = 0;
+        WrapWasteBytes = 0;
+        bWrapped = false;
+    }
+    else
+    {
+        const FSpillRecord* Next = Records.Peek();
+        if (Next && Next->Offset < Record.Offset)
+        {
+            UsedBytes -= WrapWasteBytes;
+            WrapWasteBytes = 0;
+            bWrapped = false;
+        }
+        ReadOffset = Next ? Next->Offset : 0;
+    }
+
+    TSharedPtr<TArray<uint8>> FrameBuffer = FramePool->AcquireFrame();
+    if (!FrameBuffer.IsValid())
+    {
+        UE_LOG(LogIVRSpillRingFile, Error, TEXT("Falha ao adquirir buffer do pool para ler frame do spill ring. Frame descartado."));
+        return false;
+    }
+    FrameBuffer->SetNumUninitialized(Record.RawBytes, EAllowShrinking::No);
+
+    bool bReadOk = FileHandle->Seek(Record.Offset);
+    if (bReadOk && Record.bCompressed)
+    {
+        CompressionScratch.SetNumUninitialized(Record.PayloadBytes, EAllowShrinking::No);
+        bReadOk = FileHandle->Read(CompressionScratch.GetData(), Record.PayloadBytes)
+            && FCompression::UncompressMemory(NAME_LZ4, FrameBuffer->GetData(), Record.RawBytes, CompressionScratch.GetData(), Record.PayloadBytes);
+    }
+    else if (bReadOk)
+    {
+        bReadOk = FileHandle->Read(FrameBuffer->GetData(), Record.PayloadBytes);
+    }
+    if (!bReadOk)
+    {
+        UE_LOG(LogIVRSpillRingFile, Error, TEXT("Falha ao ler frame do spill ring '%s' (offset %lld). Frame descartado."), *FilePath, Record.Offset);
+        FramePool->ReleaseFrame(FrameBuffer);
+        return false;
+    }
+
+    OutFrame = FIVR_VideoFrame(Record.Width, Record.Height, Record.TimestampNs);
+    OutFrame.RawDataPtr = FrameBuffer;
+    return true;
+}
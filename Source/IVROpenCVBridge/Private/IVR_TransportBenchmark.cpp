@@ -0,0 +1,316 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#include "IVR_TransportBenchmark.h"
+#include "IVR_FrameTransport.h"
+#include "IVR_PipeWrapper.h"
+#include "Async/Async.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Guid.h"
+#if PLATFORM_LINUX || PLATFORM_MAC
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#endif
+
+DEFINE_LOG_CATEGORY(LogIVRTransportBenchmark);
+
+namespace IVRTransportBenchmark
+{
+#if PLATFORM_WINDOWS
+    typedef HANDLE FReaderHandle;
+    static const FReaderHandle InvalidReader = INVALID_HANDLE_VALUE;
+#else
+    typedef int FReaderHandle;
+    static const FReaderHandle InvalidReader = -1;
+#endif
+
+    static const TCHAR* TransportName(EIVRFrameTransport Transport)
+    {
+        switch (Transport)
+        {
+        case EIVRFrameTransport::StdinPipe:  return TEXT("StdinPipe");
+        case EIVRFrameTransport::UnixSocket: return TEXT("UnixSocket");
+        default:                             return TEXT("NamedPipe");
+        }
+    }
+
+    /** Abre o lado do leitor como o FFmpeg faria. bOwned indica se o handle deve ser fechado pelo benchmark. */
+    static FReaderHandle OpenReader(const IIVR_FrameTransport& Transport, bool& bOwned)
+    {
+        bOwned = true;
+        const FString Url = Transport.GetFFmpegInputUrl();
+        switch (Transport.GetTransportKind())
+        {
+        case EIVRFrameTransport::StdinPipe:
+            bOwned = false; // Pertence ao transporte (seria herdado pelo FFmpeg)
+#if PLATFORM_WINDOWS
+            return (HANDLE)Transport.GetChildStdinPipe();
+#elif PLATFORM_LINUX
+            return static_cast<FPipeHandle*>(Transport.GetChildStdinPipe())->GetHandle();
+#else
+            return InvalidReader;
+#endif
+        case EIVRFrameTransport::UnixSocket:
+        {
+#if PLATFORM_LINUX || PLATFORM_MAC
+            struct sockaddr_un Address = {};
+            Address.sun_family = AF_UNIX;
+            FCStringAnsi::Strncpy(Address.sun_path, TCHAR_TO_UTF8(*Url.RightChop(5)), sizeof(Address.sun_path)); // Remove "unix:"
+            const int Socket = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (Socket != -1 && connect(Socket, (struct sockaddr*)&Address, sizeof(Address)) == 0)
+            {
+                return Socket;
+            }
+            if (Socket != -1)
+            {
+                close(Socket);
+            }
+#endif
+            return InvalidReader;
+        }
+        default:
+#if PLATFORM_WINDOWS
+            return CreateFile(*Url, GENERIC_READ, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+#else
+            return open(TCHAR_TO_UTF8(*Url), O_RDONLY); // Bloqueia até o escritor abrir o FIFO, como o FFmpeg
+#endif
+        }
+    }
+
+    /**
+     * Lê exatamente NumBytes. Retorna false em EOF, erro ou quando bStop é sinalizado.
+     * Só chama read() com dados disponíveis, para que o escritor possa parar o leitor (bStop) antes de fechar o canal.
+     */
+    static bool ReadExactly(FReaderHandle Reader, uint8* Data, int64 NumBytes, const FThreadSafeBool& bStop)
+    {
+        int64 Received = 0;
+        while (Received < NumBytes)
+        {
+            if (bStop)
+            {
+                return false;
+            }
+#if PLATFORM_WINDOWS
+            DWORD BytesAvailable = 0;
+            if (!PeekNamedPipe(Reader, nullptr, 0, nullptr, &BytesAvailable, nullptr))
+            {
+                return false;
+            }
+            if (BytesAvailable == 0)
+            {
+                FPlatformProcess::YieldThread();
+                continue;
+            }
+            DWORD BytesRead = 0;
+            if (!ReadFile(Reader, Data + Received, (DWORD)FMath::Min<int64>(NumBytes - Received, MAX_int32), &BytesRead, nullptr) || BytesRead == 0)
+            {
+                return false;
+            }
+#else
+            struct pollfd WaitFd = { Reader, POLLIN, 0 };
+            const int Ready = poll(&WaitFd, 1, 100);
+            if (Ready == 0 || (Ready == -1 && errno == EINTR))
+            {
+                continue;
+            }
+            if (Ready == -1)
+            {
+                return false;
+            }
+            const ssize_t BytesRead = read(Reader, Data + Received, (size_t)(NumBytes - Received));
+            if (BytesRead == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            if (BytesRead <= 0)
+            {
+                return false;
+            }
+#endif
+            Received += BytesRead;
+        }
+        return true;
+    }
+
+    static void CloseReader(FReaderHandle Reader)
+    {
+#if PLATFORM_WINDOWS
+        CloseHandle(Reader);
+#else
+        close(Reader);
+#endif
+    }
+}
+
+FIVR_TransportBenchmarkResult FIVR_TransportBenchmark::RunSingle(EIVRFrameTransport Transport, int32 Width, int32 Height, int32 NumFrames, bool bZeroCopy)
+{
+    using namespace IVRTransportBenchmark;
+
+    FIVR_TransportBenchmarkResult Result;
+    Result.Width = Width;
+    Result.Height = Height;
+    Result.NumFrames = NumFrames;
+    const int32 FrameBytes = Width * Height * 4;
+    if (FrameBytes <= 0 || NumFrames <= 0)
+    {
+        return Result;
+    }
+
+    TUniquePtr<IIVR_FrameTransport> Channel = IIVR_FrameTransport::MakeTransport(Transport);
+    Result.Transport = Channel->GetTransportKind();
+    FIVR_PipeSettings Settings;
+    Settings.BasePipeName = FString::Printf(TEXT("IVRBench%s"), *FGuid::NewGuid().ToString(EGuidFormats::Digits).Mid(0, 5));
+    Settings.bUseZeroCopySplice = bZeroCopy;
+    Settings.ConnectTimeoutSeconds = 5.0f;
+    if (!Channel->Create(Settings, TEXT(""), Width, Height))
+    {
+        return Result;
+    }
+
+    // Leitor em outra thread: conecta, lê cada frame inteiro e mede a latência pelo carimbo nos 8 primeiros bytes.
+    TArray<double> LatenciesMs;
+    LatenciesMs.Reserve(NumFrames);
+    FThreadSafeBool bReaderFailed;
+    FThreadSafeBool bStopReader;
+    TFuture<double> ReaderFuture = Async(EAsyncExecution::Thread, [&Channel, &LatenciesMs, &bReaderFailed, &bStopReader, FrameBytes, NumFrames]() -> double
+    {
+        bool bOwned = true;
+        const FReaderHandle Reader = OpenReader(*Channel, bOwned);
+        if (Reader == InvalidReader)
+        {
+            bReaderFailed.AtomicSet(true);
+            return 0.0;
+        }
+        TArray<uint8> Frame;
+        Frame.SetNumUninitialized(FrameBytes);
+        for (int32 i = 0; i < NumFrames; ++i)
+        {
+            if (!ReadExactly(Reader, Frame.GetData(), FrameBytes, bStopReader))
+            {
+                bReaderFailed.AtomicSet(true);
+                // Libera o escritor se ele estiver esperando espaço no buffer que este leitor não vai mais consumir.
+                Channel->AbortConnect();
+                break;
+            }
+            uint64 SentCycles = 0;
+            FMemory::Memcpy(&SentCycles, Frame.GetData(), sizeof(SentCycles));
+            LatenciesMs.Add(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - SentCycles));
+        }
+        const double FinishedSeconds = FPlatformTime::Seconds();
+        if (bOwned)
+        {
+            CloseReader(Reader);
+        }
+        return FinishedSeconds;
+    });
+
+    if (!Channel->Connect())
+    {
+        Channel->AbortConnect();
+        Channel->Close();
+        ReaderFuture.Wait();
+        return Result;
+    }
+
+    // Anel de buffers: no modo zero-copy um buffer só é reescrito depois que o leitor consumiu seus bytes.
+    const int32 RingSize = 4;
+    TArray<TArray<uint8>> Ring;
+    TArray<int64> RingEndOffsets;
+    Ring.SetNum(RingSize);
+    RingEndOffsets.SetNumZeroed(RingSize);
+    for (TArray<uint8>& Buffer : Ring)
+    {
+        Buffer.SetNumUninitialized(FrameBytes);
+        FMemory::Memset(Buffer.GetData(), 0x80, FrameBytes);
+    }
+    const bool bSplice = Channel->IsZeroCopyEnabled();
+    const double StartSeconds = FPlatformTime::Seconds();
+    bool bWriteFailed = false;
+    for (int32 i = 0; i < NumFrames && !bWriteFailed && !bReaderFailed; ++i)
+    {
+        const int32 Slot = i % RingSize;
+        while (bSplice && Channel->GetBytesConsumedByReader() < RingEndOffsets[Slot] && !bReaderFailed)
+        {
+            FPlatformProcess::YieldThread();
+        }
+        TArray<uint8>& Buffer = Ring[Slot];
+        const uint64 SentCycles = FPlatformTime::Cycles64();
+        FMemory::Memcpy(Buffer.GetData(), &SentCycles, sizeof(SentCycles));
+        const int32 Written = bSplice ? Channel->WriteZeroCopy(Buffer.GetData(), FrameBytes) : Channel->Write(Buffer.GetData(), FrameBytes);
+        bWriteFailed = (Written != FrameBytes);
+        RingEndOffsets[Slot] = Channel->GetTotalBytesWritten();
+    }
+    const FIVR_PipeWriteStats WriteStats = Channel->GetWriteStats();
+    Result.KernelBufferBytes = Channel->GetPipeCapacity();
+    if (bWriteFailed)
+    {
+        // O leitor ainda espera frames que não virão: é parado e aguardado antes do Close, que pode fechar o handle dele.
+        bStopReader.AtomicSet(true);
+    }
+    const double FinishedSeconds = ReaderFuture.Get();
+    Channel->Close();
+
+    Result.bZeroCopy = bSplice;
+    Result.bSucceeded = !bWriteFailed && !bReaderFailed && LatenciesMs.Num() == NumFrames;
+    if (Result.bSucceeded && FinishedSeconds > StartSeconds)
+    {
+        const double ElapsedSeconds = FinishedSeconds - StartSeconds;
+        Result.MegabytesPerSecond = ((double)FrameBytes * NumFrames) / (1024.0 * 1024.0) / ElapsedSeconds;
+        Result.FramesPerSecond = NumFrames / ElapsedSeconds;
+        Result.StallRatio = WriteStats.StallSeconds / ElapsedSeconds;
+        double LatencySum = 0.0;
+        for (double Latency : LatenciesMs)
+        {
+            LatencySum += Latency;
+        }
+        Result.AvgLatencyMs = LatencySum / LatenciesMs.Num();
+        LatenciesMs.Sort();
+        Result.P99LatencyMs = LatenciesMs[FMath::Min(LatenciesMs.Num() - 1, (int32)(LatenciesMs.Num() * 0.99))];
+    }
+    return Result;
+}
+
+TArray<FIVR_TransportBenchmarkResult> FIVR_TransportBenchmark::RunAll(int32 NumFrames)
+{
+    const FIntPoint Resolutions[] = { FIntPoint(1920, 1080), FIntPoint(3840, 2160) };
+    TArray<EIVRFrameTransport> Transports = { EIVRFrameTransport::NamedPipe };
+#if PLATFORM_WINDOWS || PLATFORM_LINUX
+    Transports.Add(EIVRFrameTransport::StdinPipe);
+#endif
+#if PLATFORM_LINUX || PLATFORM_MAC
+    Transports.Add(EIVRFrameTransport::UnixSocket);
+#endif
+
+    TArray<FIVR_TransportBenchmarkResult> Results;
+    UE_LOG(LogIVRTransportBenchmark, Log, TEXT("Frame transport benchmark: %d BGRA frames per run."), NumFrames);
+    for (const FIntPoint& Resolution : Resolutions)
+    {
+        for (EIVRFrameTransport Transport : Transports)
+        {
+            Results.Add(RunSingle(Transport, Resolution.X, Resolution.Y, NumFrames, false));
+            UE_LOG(LogIVRTransportBenchmark, Log, TEXT("  %s"), *Describe(Results.Last()));
+#if PLATFORM_LINUX
+            // Pipes no Linux também rodam com vmsplice
+            if (Transport != EIVRFrameTransport::UnixSocket)
+            {
+                Results.Add(RunSingle(Transport, Resolution.X, Resolution.Y, NumFrames, true));
+                UE_LOG(LogIVRTransportBenchmark, Log, TEXT("  %s"), *Describe(Results.Last()));
+            }
+#endif
+        }
+    }
+    return Results;
+}
+
+FString FIVR_TransportBenchmark::Describe(const FIVR_TransportBenchmarkResult& Result)
+{
+    const FString Name = FString::Printf(TEXT("%s%s %dx%d"), IVRTransportBenchmark::TransportName(Result.Transport), Result.bZeroCopy ? TEXT("+vmsplice") : TEXT(""), Result.Width, Result.Height);
+    if (!Result.bSucceeded)
+    {
+        return FString::Printf(TEXT("%-28s FAILED"), *Name);
+    }
+    return FString::Printf(TEXT("%-28s %8.1f MB/s %7.1f fps | latency avg %6.2f ms p99 %6.2f ms | stall %3.0f%% | buffer %d KB"),
+        *Name, Result.MegabytesPerSecond, Result.FramesPerSecond, Result.AvgLatencyMs, Result.P99LatencyMs, Result.StallRatio * 100.0, Result.KernelBufferBytes / 1024);
+}
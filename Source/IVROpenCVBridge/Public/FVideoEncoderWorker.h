@@ -7,12 +7,14 @@
 #include "HAL/Runnable.h"
 #include "HAL/RunnableThread.h"
 #include "HAL/ThreadSafeBool.h" // Para o mecanismo de "locked rendering"
+#include "HAL/ThreadSafeCounter.h" // Para o contador de frames pendentes
 #include "HAL/PlatformProcess.h"
 #include "Containers/Queue.h"
 
 #include "IVRTypes.h" // Para FIVR_VideoFrame
 #include "IVRFramePool.h" // Para UIVRFramePool
-#include "IVR_PipeWrapper.h" // Para FIVR_PipeWrapper
+#include "IVR_FrameTransport.h" // Para IIVR_FrameTransport
+#include "IVR_MatroskaPipeMuxer.h" // Para FIVR_MatroskaPipeMuxer (timestamps por frame)
 
 #include "IVROpenCVBridge.h"
 
@@ -28,7 +30,7 @@ class UIVRVideoEncoder;
 class IVROPENCVBRIDGE_API FVideoEncoderWorker : public FRunnable
 {
 public:
-    FVideoEncoderWorker(UIVRVideoEncoder* InEncoder, TQueue<FIVR_VideoFrame, EQueueMode::Mpsc>& InFrameQueue, FIVR_PipeWrapper& InVideoInputPipe, FThreadSafeBool& InStopFlag, FThreadSafeBool& InNoMoreFramesFlag, FEvent* InNewFrameEvent, UIVRFramePool* InFramePool);
+    FVideoEncoderWorker(UIVRVideoEncoder* InEncoder, TQueue<FIVR_VideoFrame, EQueueMode::Mpsc>& InFrameQueue, IIVR_FrameTransport& InVideoInputPipe, FThreadSafeBool& InStopFlag, FThreadSafeBool& InNoMoreFramesFlag, FEvent* InNewFrameEvent, UIVRFramePool* InFramePool, FThreadSafeCounter& InPendingFrameCount, FIVR_MatroskaPipeMuxer* InStreamMuxer = nullptr);
     virtual ~FVideoEncoderWorker();
 
     // Implementação da interface FRunnable
@@ -36,12 +38,52 @@ public:
     virtual uint32 Run() override;
     virtual void Stop() override;
     virtual void Exit() override;
+
+    /**
+     * Verdadeiro quando nenhum frame está sendo escrito e nenhum buffer emprestado ao pipe (vmsplice)
+     * aguarda o FFmpeg. Só então é seguro fechar o pipe.
+     */
+    bool IsDrained() const { return !bIsWritingFrame && DeferredBufferCount.GetValue() == 0; }
 private:
+    // Buffer entregue ao pipe por vmsplice: só volta ao pool quando o leitor consumir até EndOffset.
+    struct FDeferredBuffer
+    {
+        TSharedPtr<TArray<uint8>> Buffer;
+        int64 EndOffset = 0;
+    };
+
+    /** Devolve ao pool os buffers cujos bytes o FFmpeg já leu. */
+    void ReclaimConsumedBuffers();
+    /** Devolve o buffer ao pool (se houver pool). */
+    void ReleaseFrameBuffer(TSharedPtr<TArray<uint8>>& Buffer);
+    /**
+     * Retira da fila o próximo lote: um frame e, se o writer estiver atrasado, os já enfileirados (até MaxBatchFrames).
+     * Frames inválidos são descartados aqui. Retorna false se a fila estava vazia.
+     */
+    bool DequeueBatch();
+    /** Escreve o lote atual (cabeçalhos Matroska + payloads) com uma única chamada writev/vmsplice quando possível. */
+    bool WriteBatch();
+
+    static constexpr int32 MaxBatchFrames = 8;
+
     UIVRVideoEncoder* Encoder; // Ponteiro raw para o UObject pai (para acesso a logs e configurações)
     TQueue<FIVR_VideoFrame, EQueueMode::Mpsc>& FrameQueue; // Referência à fila de frames
-    FIVR_PipeWrapper& VideoInputPipe; // Referência ao wrapper do pipe de vídeo
+    IIVR_FrameTransport& VideoInputPipe; // Referência ao transporte de vídeo (Named Pipe/FIFO, stdin ou socket)
     FThreadSafeBool& bShouldStop; // Referência para a flag de parada da thread
     FThreadSafeBool& bNoMoreFramesToEncode; // Referência para a flag de "sem mais frames"
     FEvent* NewFrameEvent; // Referência ao evento de sinalização
     UIVRFramePool* FramePool; // Referência ao pool de frames para liberar buffers 
+    FThreadSafeCounter& PendingFrameCount; // Frames ainda não escritos no pipe (decrementado a cada frame consumido)
+    FIVR_MatroskaPipeMuxer* StreamMuxer; // Se não nulo, cada frame é encapsulado em Matroska com seu timestamp (CFR/VFR)
+
+    TArray<FDeferredBuffer> DeferredBuffers; // Buffers ainda referenciados pelo pipe (somente a worker thread acessa)
+    FThreadSafeCounter DeferredBufferCount;   // Espelho de DeferredBuffers.Num() para consulta de outras threads
+    FThreadSafeBool bIsWritingFrame;          // Um frame foi retirado da fila e ainda está sendo escrito
+
+    bool bZeroCopy = false;                   // Payloads via vmsplice (decidido após o Connect)
+    TArray<FIVR_VideoFrame> Batch;            // Frames do lote atual
+    TArray<FIVR_PipeWriteSpan> BatchSpans;    // Segmentos do lote atual
+    uint8 BatchHeaders[MaxBatchFrames][FIVR_MatroskaPipeMuxer::FrameHeaderBytes]; // Cabeçalhos Matroska do lote
+    int64 NumBatches = 0;                     // Estatística: lotes escritos
+    int64 NumFramesWritten = 0;               // Estatística: frames escritos
 };
\ No newline at end of file
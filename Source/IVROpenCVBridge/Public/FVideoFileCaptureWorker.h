@@ -11,6 +11,7 @@
 #include "Containers/Queue.h"   // Para TQueue
 #include "IVRTypes.h" // Para FIVR_VideoFrame
 #include "IVRFramePool.h" // Para UIVRFramePool
+#include "IVRFrameMailbox.h" // Para TIVR_LatestValueMailbox
 #include <atomic> // Necessário para std::atomic
 #include <string> // Inclusão explícita para std::string
 
@@ -40,8 +41,9 @@ public:
      * @param InVideoFilePath Caminho para o arquivo de vídeo.
      * @param InDesiredFPS Taxa de quadros desejada para leitura (pode não ser respeitada pela webcam).
      * @param InLoopPlayback Se o vídeo deve ser reproduzido em loop.
+     * @param InLatestFrameMailbox NOVO: Se não for nulo, os frames vão para esta caixa "o mais recente vence" em vez da fila.
      */
-    FVideoFileCaptureWorker(UIVRFramePool* InFramePool, TQueue<FIVR_VideoFrame, EQueueMode::Mpsc>& InQueue, FThreadSafeBool& InStopFlag, FEvent* InNewFrameEvent, const FString& InVideoFilePath, float InDesiredFPS, bool InLoopPlayback);
+    FVideoFileCaptureWorker(UIVRFramePool* InFramePool, TQueue<FIVR_VideoFrame, EQueueMode::Mpsc>& InQueue, FThreadSafeBool& InStopFlag, FEvent* InNewFrameEvent, const FString& InVideoFilePath, float InDesiredFPS, bool InLoopPlayback, TIVR_LatestValueMailbox<FIVR_VideoFrame>* InLatestFrameMailbox = nullptr);
     
     /**
      * @brief Destrutor do worker, libera o VideoCapture.
@@ -82,6 +84,7 @@ private:
     FString VideoFilePath;
     float DesiredFPS;
     bool bLoopPlayback; // <-- ESTE MEMBRO AGORA ESTÁ DECLARADO ANTES
+    TIVR_LatestValueMailbox<FIVR_VideoFrame>* LatestFrameMailbox; // NOVO: Entrega coalescida (nulo = fila)
     
 #if WITH_OPENCV // <--- Adicione este ifdef
     cv::VideoCapture* OpenCVVideoCapture; // Objeto de captura de vídeo do OpenCV, agora ponteiro
@@ -11,6 +11,7 @@
 #include "Containers/Queue.h"   // Para TQueue
 #include "IVRTypes.h" // Para FIVR_VideoFrame
 #include "IVRFramePool.h" // Para UIVRFramePool
+#include "IVRFrameMailbox.h" // Para TIVR_LatestValueMailbox
 #include <atomic> // Necessário para std::atomic
 #include <string> // Inclusão explícita para std::string
 
@@ -45,9 +46,10 @@ public:
      * @param InHeight Altura desejada para a captura.
      * @param InFPS FPS desejado para a captura.
      * @param InApiPreference Preferência de API para OpenCV (e.g., cv::CAP_DSHOW como int).
+     * @param InLatestFrameMailbox NOVO: Se não for nulo, os frames vão para esta caixa "o mais recente vence" em vez da fila.
      */
     FWebcamCaptureWorker(UIVRFramePool* InFramePool, TQueue<FIVR_VideoFrame, EQueueMode::Mpsc>& InQueue, FThreadSafeBool& InStopFlag, FEvent* InNewFrameEvent, int32 InDeviceIndex, int32 InWidth, int32 InHeight, float InFPS,
-        VideoCaptureAPIs InApiPreference
+        VideoCaptureAPIs InApiPreference, TIVR_LatestValueMailbox<FIVR_VideoFrame>* InLatestFrameMailbox = nullptr
     );
     
     /**
@@ -96,4 +98,5 @@ private:
     cv::VideoCapture* OpenCVWebcamCapture; // Objeto de captura de vídeo do OpenCV, agora ponteiro
     int ApiPreference; // Preferência de API para OpenCV (int)
     // --- FIM DA ALTERAÇÃO ---
+    TIVR_LatestValueMailbox<FIVR_VideoFrame>* LatestFrameMailbox; // NOVO: Entrega coalescida (nulo = fila)
 };
\ No newline at end of file
@@ -7,9 +7,49 @@
 // É CRÍTICO que a macro IVROPENCVBRIDGE_API esteja definida antes de ser usada.
 // Ela é definida em IVROpenCVBridge.h (que é o header principal do módulo).
 #include "IVROpenCVBridge.h" // Garante que IVROPENCVBRIDGE_API seja definida.
+#include "HAL/CriticalSection.h"
 // --- FIM DA CORREÇÃO ---
 
 
+// NOVO: Etapas selecionáveis da extração de features (máscara de bits). Só as etapas pedidas rodam.
+// Os bits de Corners, Quads e Histograms coincidem com EIVRFeatureStage (IVRCore).
+enum class EOCV_FeatureStage : uint32
+{
+    None            = 0,
+    Corners         = 1 << 0, // goodFeaturesToTrack sobre o Mat em tons de cinza
+    Quads           = 1 << 1, // Limiar adaptativo + contornos + classificação quadrado/retângulo
+    Histograms      = 1 << 2, // Histogramas B/G/R normalizados (0-1)
+    DebugOverlay    = 1 << 3, // Primitivas de desenho do resultado das etapas (FOCV_NativeJustRTFeatures::Overlay); os pixels não são alterados
+    All             = Corners | Quads | Histograms | DebugOverlay
+};
+ENUM_CLASS_FLAGS(EOCV_FeatureStage)
+
+// NOVO: Parâmetros das etapas de extração
+struct IVROPENCVBRIDGE_API FOCV_FeatureStageParams
+{
+    int32 MaxCorners = 100;
+    float QualityLevel = 0.01f;
+    float MinDistance = 10.0f;
+    int32 HistogramSubsample = 1; // Passo de amostragem em linhas e colunas da etapa Histograms (1 = todos os pixels)
+    // NOVO: Pirâmide de detecção. Corners e Quads rodam sobre o cinza reduzido em 2^Nível (média por área);
+    // as coordenadas voltam para a resolução do frame.
+    int32 PyramidLevel = 0;                 // 0 = resolução cheia
+    int32 MaxDetectionWidth = 0;            // > 0: sobe o nível até a largura de detecção caber neste limite
+    bool bRefineCornersAtFullResolution = false; // cornerSubPix dos cantos no cinza em resolução cheia
+    // NOVO: Regiões de interesse, em pixels do frame. Vazio = frame inteiro. As etapas rodam sobre vistas
+    // (cv::Mat sem cópia) de cada região; regiões sobrepostas são fundidas para nada ser processado duas vezes.
+    TArray<FIntRect> Regions;
+};
+
+// NOVO: Parâmetros do rastreamento temporal (FOCV_FeatureTracker)
+struct IVROPENCVBRIDGE_API FOCV_TrackerSettings
+{
+    int32 KeyframeInterval = 15;    // Redetecta a cada N frames, mesmo que o rastreamento esteja bom
+    float MinSurvivalRatio = 0.5f;  // Redetecta quando sobra menos que esta fração das trilhas do último keyframe
+    int32 WindowSize = 21;          // Janela do Lucas-Kanade, em pixels da imagem de detecção
+    int32 MaxPyramidLevel = 3;      // Níveis da pirâmide do Lucas-Kanade
+};
+
 // Corresponde a FIVR_JustRTPoint
 struct IVROPENCVBRIDGE_API FOCV_NativeJustRTPoint
 {
@@ -19,6 +59,7 @@ struct IVROPENCVBRIDGE_API FOCV_NativeJustRTPoint
     FVector2D Size2D;
     float Angle;
     bool IsQuad;
+    int32 TrackId; // NOVO: Identidade estável entre frames (FOCV_FeatureTracker); INDEX_NONE sem rastreamento
 
     // --- INÍCIO DA CORREÇÃO: Construtor deve ser declarado no corpo da struct, não como lista de inicializadores ---
     // Isso é mais robusto para a interpretação de alguns compiladores e evitar C2365 / C2550
@@ -29,12 +70,36 @@ struct IVROPENCVBRIDGE_API FOCV_NativeJustRTPoint
         , Size2D(FVector2D::ZeroVector)
         , Angle(0.0f)
         , IsQuad(false)
+        , TrackId(INDEX_NONE)
     {
     }
     // --- FIM DA CORREÇÃO ---
 };
 
 
+// NOVO: Primitiva do overlay de debug, em pixels do frame. Composta só onde for exibida (textura de preview).
+enum class EOCV_OverlayShape : uint8
+{
+    Polygon,    // Points[0..3], contorno fechado
+    Circle      // Points[0] = centro, preenchido
+};
+
+struct IVROPENCVBRIDGE_API FOCV_OverlayPrimitive
+{
+    EOCV_OverlayShape Shape = EOCV_OverlayShape::Polygon;
+    FVector2f Points[4] = { FVector2f::ZeroVector, FVector2f::ZeroVector, FVector2f::ZeroVector, FVector2f::ZeroVector };
+    float Radius = 0.0f;    // Circle
+    int32 Thickness = 1;    // Polygon
+    FColor Color = FColor::Green;
+};
+
+// NOVO: Tempo de uma etapa do FOCV_CVStageGraph em um frame
+struct IVROPENCVBRIDGE_API FOCV_StageTiming
+{
+    FName Stage;
+    float Milliseconds = 0.0f; // Soma das regiões de interesse
+};
+
 // Corresponde a FIVR_JustRTFeatures
 struct IVROPENCVBRIDGE_API FOCV_NativeJustRTFeatures
 {
@@ -46,8 +111,31 @@ struct IVROPENCVBRIDGE_API FOCV_NativeJustRTFeatures
     TArray<float> HistogramRed;
     TArray<float> HistogramGreen;
     TArray<float> HistogramBlue;
+    TArray<FVector2D> Corners; // NOVO: Saída da etapa Corners
+    TArray<int32> CornerIds;   // NOVO: Identidade estável de cada canto (só com FOCV_FeatureTracker)
+    bool bIsKeyframe = true;   // NOVO: Falso quando os pontos vieram do rastreamento, sem nova detecção
+    TArray<FOCV_StageTiming> StageTimings; // NOVO: Tempo de cada etapa que rodou (vazio quando o resultado veio do cache)
+    TArray<FOCV_OverlayPrimitive> Overlay;  // NOVO: Saída da etapa DebugOverlay (ver DrawOverlay)
 
     FOCV_NativeJustRTFeatures() {}
+
+    // NOVO: Volta ao estado inicial mantendo a memória dos arrays (scratch reaproveitado entre frames)
+    void Reset()
+    {
+        JustRTInterestPoints.Reset();
+        BiggestPointIndex = INDEX_NONE;
+        SmallerPointIndex = INDEX_NONE;
+        NumOfQuads = 0;
+        NumOfRectangles = 0;
+        HistogramRed.Reset();
+        HistogramGreen.Reset();
+        HistogramBlue.Reset();
+        Corners.Reset();
+        CornerIds.Reset();
+        bIsKeyframe = true;
+        StageTimings.Reset();
+        Overlay.Reset();
+    }
 };
 
 // Corresponde a FIVR_JustRTFrame
@@ -76,7 +164,30 @@ struct IVROPENCVBRIDGE_API FOCV_NativeJustRTFrame
 namespace IVROpenCVBridge
 {
     
-    // Declaração da função ProcessFrameAndExtractFeatures com os novos tipos
+    /**
+     * NOVO: Extração sob demanda. Roda apenas as etapas de Stages; etapas que dependem do mesmo intermediário
+     * (o Mat em tons de cinza de Corners e Quads) o compartilham. Os pixels nunca são escritos: DebugOverlay só
+     * gera primitivas em OutFeatures.Overlay, e o buffer pode continuar compartilhado entre consumidores.
+     * Usa o grafo embutido de FOCV_CVStageGraph::GetBuiltIn(Stages); etapas próprias entram por um grafo próprio.
+     */
+    IVROPENCVBRIDGE_API void ExtractFeatureStages(
+        uint8* PixelData,
+        int32 Width,
+        int32 Height,
+        EOCV_FeatureStage Stages,
+        const FOCV_FeatureStageParams& Params,
+        FOCV_NativeJustRTFeatures& OutFeatures
+    );
+
+    /**
+     * NOVO: Compõe as primitivas do overlay em um buffer BGRA (Width * 4 bytes por linha). Chamado sobre a cópia
+     * que vai para a exibição, nunca sobre o frame compartilhado.
+     */
+    IVROPENCVBRIDGE_API void DrawOverlay(uint8* PixelData, int32 Width, int32 Height, const TArray<FOCV_OverlayPrimitive>& Overlay);
+
+    // Declaração da função ProcessFrameAndExtractFeatures com os novos tipos.
+    // Mantida por compatibilidade: equivale a ExtractFeatureStages com Quads | Histograms (+ Corners e DebugOverlay com bDebugDrawFeatures).
+    // Como antes, com bDebugDrawFeatures o overlay é composto nos próprios PixelData (DrawOverlay).
     IVROPENCVBRIDGE_API void ProcessFrameAndExtractFeatures(
         uint8* PixelData,
         int32 Width,
@@ -90,6 +201,41 @@ namespace IVROpenCVBridge
         FOCV_NativeJustRTFeatures& OutFeatures
     );
 
+    /**
+     * NOVO: Rastreamento temporal de cantos e quads. Detecta em keyframes (ExtractFeatureStages) e, nos frames
+     * seguintes, acompanha os pontos com Lucas-Kanade piramidal em vez de redetectar. Cada ponto recebe um
+     * TrackId que se mantém entre frames; em um novo keyframe, detecções próximas de trilhas vivas herdam o ID.
+     * Os frames devem chegar em ordem de captura. Thread-safe (um frame por vez).
+     */
+    class IVROPENCVBRIDGE_API FOCV_FeatureTracker
+    {
+    public:
+        FOCV_FeatureTracker();
+        ~FOCV_FeatureTracker();
+
+        /** Descarta as trilhas; o próximo frame é um keyframe. */
+        void Reset();
+
+        /** Mesmo contrato de ExtractFeatureStages, com Corners e Quads rastreados entre keyframes. */
+        void ProcessFrame(
+            uint8* PixelData,
+            int32 Width,
+            int32 Height,
+            EOCV_FeatureStage Stages,
+            const FOCV_FeatureStageParams& Params,
+            const FOCV_TrackerSettings& Settings,
+            FOCV_NativeJustRTFeatures& OutFeatures
+        );
+
+        FOCV_FeatureTracker(const FOCV_FeatureTracker&) = delete;
+        FOCV_FeatureTracker& operator=(const FOCV_FeatureTracker&) = delete;
+
+    private:
+        struct FState; // Tipos do OpenCV ficam fora do header
+        TUniquePtr<FState> State;
+        FCriticalSection Mutex;
+    };
+
     // Funções para migrar a lógica de LoadImageFromFile (redimensionamento OpenCV)
     IVROPENCVBRIDGE_API bool LoadAndResizeImage(const FString& FilePath, int32 TargetWidth, int32 TargetHeight, TArray<uint8>& OutRawData);
 
@@ -0,0 +1,184 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IVROpenCVBridge.h"
+#include "IVROpenCVGlobals.h"
+#include "HAL/CriticalSection.h"
+
+namespace cv { class Mat; }
+
+namespace IVROpenCVBridge
+{
+    /** Nomes dos intermediários publicados pelas etapas embutidas. */
+    struct IVROPENCVBRIDGE_API FOCV_CVStageKeys
+    {
+        static const FName Gray;            // Cinza em resolução cheia (CV_8UC1)
+        static const FName DetectionGray;   // Cinza reduzido pelo fator de detecção (CV_8UC1)
+        static const FName Blur;            // DetectionGray com filtro gaussiano 5x5
+        static const FName Threshold;       // Limiar adaptativo da etapa Quads (binário CV_8UC1)
+        static const FName QuadShapes;      // Retângulos rotacionados dos quads: N x 5 CV_32F (cx, cy, w, h, ângulo)
+        static const FName CornerPoints;    // Cantos: N x 2 CV_32F (x, y)
+    };
+
+    /** Em que escopo a etapa roda. */
+    enum class EOCV_CVStageScope : uint8
+    {
+        PerRegion,  // Uma vez por região de interesse, sobre a vista da região (coordenadas da região)
+        PerFrame    // Uma vez por frame, depois de todas as regiões, com as features já juntadas
+    };
+
+    /**
+     * Estado visto por uma etapa durante a execução. Os intermediários (Mats) vivem no contexto da região;
+     * cada chave é escrita por uma única etapa, e só depois que ela termina as etapas que a declararam como
+     * entrada rodam. Os Mats podem compartilhar memória entre etapas: quem precisar alterar um deve cloná-lo.
+     */
+    class IVROPENCVBRIDGE_API FOCV_CVStageContext
+    {
+    public:
+#if WITH_OPENCV
+        /** Pixels BGRA da região (ou do frame inteiro em PerFrame). Só etapas com WritesFrame() podem alterá-los. */
+        cv::Mat& GetFrame() const;
+
+        /** Intermediário declarado em GetInputs() (ou vazio, se o produtor não rodou). */
+        const cv::Mat& GetMat(FName Key) const;
+
+        /** Publica um intermediário declarado em GetOutputs(). */
+        void SetMat(FName Key, const cv::Mat& Mat);
+#endif
+        /** Verdadeiro se algum produtor já publicou Key (entradas opcionais). */
+        bool HasMat(FName Key) const;
+
+        /** Canto superior esquerdo da região no frame. */
+        FIntPoint GetOrigin() const;
+
+        /** Regiões resolvidas (recortadas e fundidas), em pixels do frame. */
+        const TArray<FIntRect>& GetRegions() const;
+
+        /** Fator de redução das imagens de detecção desta região (FOCV_FeatureStageParams::PyramidLevel). */
+        int32 GetDetectionFactor() const;
+
+        const FOCV_FeatureStageParams& GetParams() const;
+
+        /** Features de todas as regiões, já em coordenadas do frame. Só em etapas PerFrame. */
+        const FOCV_NativeJustRTFeatures& GetMergedFeatures() const;
+
+    private:
+        friend class FOCV_CVStageGraph;
+        struct FImpl;
+        explicit FOCV_CVStageContext(FImpl& InImpl) : Impl(InImpl) {}
+        FImpl& Impl;
+    };
+
+    /**
+     * Uma etapa do grafo. Declara as chaves que lê e publica; o grafo ordena as etapas por essas dependências e
+     * roda em paralelo as que não dependem umas das outras. Execute() pode ser chamado ao mesmo tempo por
+     * frames diferentes: a etapa não deve guardar estado por frame.
+     */
+    class IVROPENCVBRIDGE_API FOCV_CVStage
+    {
+    public:
+        virtual ~FOCV_CVStage() {}
+
+        /** Nome único no grafo; também identifica a etapa nos tempos medidos. */
+        virtual FName GetName() const = 0;
+
+        /** Chaves obrigatórias: a etapa é descartada (com aviso) se nenhuma etapa do grafo as publicar. */
+        virtual TArray<FName> GetInputs() const { return TArray<FName>(); }
+
+        /** Chaves lidas se existirem: a etapa espera o produtor quando ele roda, mas não o obriga a rodar. */
+        virtual TArray<FName> GetOptionalInputs() const { return TArray<FName>(); }
+
+        virtual TArray<FName> GetOutputs() const { return TArray<FName>(); }
+
+        virtual EOCV_CVStageScope GetScope() const { return EOCV_CVStageScope::PerRegion; }
+
+        /** Etapas que escrevem nos pixels rodam sozinhas, depois de todas as outras do mesmo escopo. */
+        virtual bool WritesFrame() const { return false; }
+
+        /**
+         * Etapas terminais contribuem para o resultado (features ou pixels) e sempre rodam; as demais só rodam
+         * quando alguma etapa que vai rodar lê o que elas publicam.
+         */
+        virtual bool IsTerminal() const { return GetOutputs().Num() == 0; }
+
+        /** Roda a etapa. OutFeatures é um resultado parcial exclusivo desta etapa, em coordenadas da região. */
+        virtual void Execute(FOCV_CVStageContext& Context, FOCV_NativeJustRTFeatures& OutFeatures) = 0;
+    };
+
+    /** Tempos acumulados de uma etapa. */
+    struct IVROPENCVBRIDGE_API FOCV_StageTimingStats
+    {
+        FName Stage;
+        double LastMilliseconds = 0.0;      // Último frame (soma das regiões)
+        double AverageMilliseconds = 0.0;   // Média móvel exponencial
+        double MaxMilliseconds = 0.0;
+        int64 NumRuns = 0;
+    };
+
+    /**
+     * Grafo de etapas de visão computacional. Só as etapas adicionadas rodam: detectores próprios entram com
+     * AddStage() sem custo das etapas embutidas, e intermediários que ninguém lê não são calculados.
+     * Cada etapa tem seu tempo medido por frame (FOCV_NativeJustRTFeatures::StageTimings) e acumulado no grafo.
+     * Thread-safe: vários frames podem ser executados ao mesmo tempo.
+     */
+    class IVROPENCVBRIDGE_API FOCV_CVStageGraph
+    {
+    public:
+        using FStageRef = TSharedRef<FOCV_CVStage, ESPMode::ThreadSafe>;
+
+        FOCV_CVStageGraph();
+        ~FOCV_CVStageGraph();
+
+        /** Adiciona uma etapa; uma etapa com o mesmo nome é substituída. */
+        void AddStage(FStageRef Stage);
+
+        /** @return Falso se não havia etapa com esse nome. */
+        bool RemoveStage(FName Name);
+
+        TArray<FName> GetStageNames() const;
+
+        /**
+         * Adiciona as etapas embutidas equivalentes a Stages (ExtractFeatureStages) e os produtores de
+         * intermediários (Gray, DetectionGray, Blur, Threshold), que só rodam se alguma etapa os ler.
+         */
+        void AddBuiltInStages(EOCV_FeatureStage Stages);
+
+        /**
+         * Adiciona só a etapa embutida Name, se AddBuiltInStages(Stages) a adicionaria (ex.: para voltar ao lugar
+         * de uma etapa própria removida). As demais etapas e os tempos acumulados não mudam.
+         * @return Falso se Name não é uma etapa embutida de Stages.
+         */
+        bool AddBuiltInStage(FName Name, EOCV_FeatureStage Stages);
+
+        /** Nome da etapa embutida de um único bit de EOCV_FeatureStage (NAME_None para None ou combinações). */
+        static FName GetBuiltInStageName(EOCV_FeatureStage Stage);
+
+        /** Grafo compartilhado com as etapas embutidas de Stages, usado por ExtractFeatureStages. */
+        static FOCV_CVStageGraph& GetBuiltIn(EOCV_FeatureStage Stages);
+
+        /** Roda as etapas sobre um frame BGRA; mesmo contrato de ExtractFeatureStages. */
+        void Execute(uint8* PixelData, int32 Width, int32 Height, const FOCV_FeatureStageParams& Params, FOCV_NativeJustRTFeatures& OutFeatures);
+
+        TArray<FOCV_StageTimingStats> GetTimingStats() const;
+        void ResetTimingStats();
+
+        FOCV_CVStageGraph(const FOCV_CVStageGraph&) = delete;
+        FOCV_CVStageGraph& operator=(const FOCV_CVStageGraph&) = delete;
+
+    private:
+        struct FPlan;
+        TSharedPtr<const FPlan, ESPMode::ThreadSafe> GetPlan();
+        void RecordTimings(const FPlan& Plan, const TArray<double>& Milliseconds, FOCV_NativeJustRTFeatures& OutFeatures);
+
+        TArray<FStageRef> Stages;
+        TSharedPtr<const FPlan, ESPMode::ThreadSafe> CachedPlan; // Refeito quando as etapas mudam
+        TSet<FName> WarnedStages;                                // Etapas descartadas já avisadas no log
+        mutable FCriticalSection StagesMutex;
+
+        TMap<FName, FOCV_StageTimingStats> Timings;
+        mutable FCriticalSection TimingMutex;
+    };
+} // namespace IVROpenCVBridge
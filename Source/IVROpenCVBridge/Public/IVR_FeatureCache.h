@@ -0,0 +1,64 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IVROpenCVBridge.h"
+#include "IVROpenCVGlobals.h"
+#include "HAL/CriticalSection.h"
+
+/**
+ * Hash de 64 bits do conteúdo de um frame (algoritmo XXH64). Quatro acumuladores independentes consomem
+ * 32 bytes por iteração, então o laço roda na largura de banda da memória e o compilador o vetoriza.
+ */
+struct IVROPENCVBRIDGE_API FIVR_FrameHash
+{
+    static uint64 Hash64(const void* Data, SIZE_T NumBytes, uint64 Seed = 0);
+};
+
+/** Contadores do FIVR_FeatureCache desde a criação. */
+struct IVROPENCVBRIDGE_API FIVR_FeatureCacheStats
+{
+    int64 Hits = 0;
+    int64 Misses = 0;
+    int64 Evictions = 0;
+    int32 NumEntries = 0;
+};
+
+/**
+ * Cache LRU limitado de FOCV_NativeJustRTFeatures, indexado pelo hash dos pixels combinado com as etapas e
+ * os parâmetros da extração. Loops de pastas e cenas estáticas entregam os mesmos frames repetidamente:
+ * um acerto pula a extração inteira. Thread-safe.
+ */
+class IVROPENCVBRIDGE_API FIVR_FeatureCache
+{
+public:
+    explicit FIVR_FeatureCache(int32 InCapacity);
+
+    /** Chave de um frame BGRA (Width * 4 bytes por linha) extraído com Stages e Params. */
+    static uint64 MakeKey(const uint8* PixelData, int32 Width, int32 Height, EOCV_FeatureStage Stages, const FOCV_FeatureStageParams& Params);
+
+    /** @return Verdadeiro (e copia o resultado) se a chave estiver no cache; o item passa a ser o mais recente. */
+    bool Find(uint64 Key, FOCV_NativeJustRTFeatures& OutFeatures);
+
+    /** Guarda o resultado, descartando o item usado há mais tempo se o cache estiver cheio. */
+    void Add(uint64 Key, const FOCV_NativeJustRTFeatures& Features);
+
+    void Empty();
+    int32 GetCapacity() const { return Capacity; }
+    FIVR_FeatureCacheStats GetStats() const;
+
+private:
+    struct FEntry
+    {
+        FOCV_NativeJustRTFeatures Features;
+        uint64 LastUsed = 0;
+    };
+
+    const int32 Capacity;
+    TMap<uint64, FEntry> Entries;
+    uint64 UseCounter = 0;
+    FIVR_FeatureCacheStats Stats;
+    mutable FCriticalSection Mutex;
+};
@@ -0,0 +1,93 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/UniquePtr.h"
+#include "IVRTypes.h" // Para FIVR_PipeSettings e EIVRFrameTransport
+
+/** Um segmento contíguo de uma escrita em lote (writev/vmsplice). */
+struct FIVR_PipeWriteSpan
+{
+    const uint8* Data = nullptr;
+    int32 NumBytes = 0;
+};
+
+/** Estatísticas de escrita no pipe, acumuladas desde o Connect. */
+struct FIVR_PipeWriteStats
+{
+    int64 BytesWritten = 0;        // Bytes entregues ao leitor
+    int64 WriteCalls = 0;          // Chamadas de sistema de escrita (write/writev/vmsplice/WriteFile)
+    int64 GatherWrites = 0;        // Entregas com mais de um segmento
+    int64 PartialWrites = 0;       // Chamadas que aceitaram menos bytes que o pedido
+    double StallSeconds = 0.0;     // Tempo esperando o leitor liberar espaço no pipe
+    double ConnectedSeconds = 0.0; // Tempo desde o Connect
+
+    double GetBytesPerSecond() const { return ConnectedSeconds > 0.0 ? (double)BytesWritten / ConnectedSeconds : 0.0; }
+    double GetStallRatio() const { return ConnectedSeconds > 0.0 ? StallSeconds / ConnectedSeconds : 0.0; }
+};
+
+/**
+ * Canal pelo qual os frames chegam ao FFmpeg (UE escreve, FFmpeg lê).
+ * Implementações: FIVR_PipeWrapper (Named Pipe/FIFO), FIVR_StdinPipeTransport (pipe anônimo como stdin)
+ * e FIVR_UnixSocketTransport (socket Unix). Todas garantem entrega completa em Write/WriteGather.
+ *
+ * Ciclo de vida: Create() -> GetFFmpegInputUrl()/GetChildStdinPipe() para lançar o FFmpeg ->
+ * OnReaderLaunched() -> Connect() (na worker thread) -> Write...() -> Close().
+ */
+class IVROPENCVBRIDGE_API IIVR_FrameTransport
+{
+public:
+    virtual ~IIVR_FrameTransport() {}
+
+    /**
+     * Cria o transporte do tipo pedido. Tipos não suportados na plataforma caem para o Named Pipe/FIFO (com aviso).
+     */
+    static TUniquePtr<IIVR_FrameTransport> MakeTransport(EIVRFrameTransport Kind);
+
+    /** Tipo efetivo do transporte (após o fallback de plataforma). */
+    virtual EIVRFrameTransport GetTransportKind() const = 0;
+
+    /** Cria o canal. InWidth/InHeight dimensionam os buffers do kernel para um frame BGRA. */
+    virtual bool Create(const FIVR_PipeSettings& Settings, const FString& SessionID, int32 InWidth = 0, int32 InHeight = 0) = 0;
+    /**
+     * Aguarda o leitor (FFmpeg) se conectar. Desiste após FIVR_PipeSettings::ConnectTimeoutSeconds
+     * ou quando AbortConnect() é chamado de outra thread.
+     */
+    virtual bool Connect() = 0;
+    /** Faz um Connect() ou uma espera por espaço no buffer em andamento (em outra thread) retornar com falha. */
+    virtual void AbortConnect() = 0;
+
+    /** Entrada a ser passada ao FFmpeg em "-i" (caminho do FIFO, "pipe:0" ou "unix:<caminho>"). */
+    virtual FString GetFFmpegInputUrl() const = 0;
+    /** Extremidade de leitura a ser herdada como stdin do FFmpeg (FPlatformProcess::CreateProc), ou nullptr. */
+    virtual void* GetChildStdinPipe() const { return nullptr; }
+    /** Chamado depois que o FFmpeg foi lançado: libera o que o processo filho herdou. */
+    virtual void OnReaderLaunched() {}
+
+    /** Entrega todos os bytes. @return NumBytes, ou -1 em caso de erro. */
+    virtual int32 Write(const uint8* Data, int32 NumBytes) = 0;
+    /** Entrega vários segmentos em ordem, em uma única chamada de sistema quando possível. */
+    virtual bool WriteGather(const FIVR_PipeWriteSpan* Spans, int32 NumSpans) = 0;
+    /** Escrita sem cópia (vmsplice) quando IsZeroCopyEnabled(); caso contrário equivale a Write. */
+    virtual int32 WriteZeroCopy(const uint8* Data, int32 NumBytes) = 0;
+    /** Versão em lote de WriteZeroCopy. */
+    virtual bool WriteZeroCopyGather(const FIVR_PipeWriteSpan* Spans, int32 NumSpans) = 0;
+    /** Verdadeiro se WriteZeroCopy empresta as páginas ao kernel (buffers só podem ser reutilizados após o consumo). */
+    virtual bool IsZeroCopyEnabled() const = 0;
+
+    /** Total de bytes entregues desde o Connect. */
+    virtual int64 GetTotalBytesWritten() const = 0;
+    /** Bytes já lidos pelo leitor (quando o transporte não sabe informar, igual a GetTotalBytesWritten()). */
+    virtual int64 GetBytesConsumedByReader() const = 0;
+    /** Capacidade do buffer do kernel em bytes, quando conhecida (0 caso contrário). */
+    virtual int32 GetPipeCapacity() const = 0;
+    /** Bytes/s, chamadas e tempo de espera pelo leitor desde o Connect. Snapshot consistente; pode ser chamado de qualquer thread. */
+    virtual FIVR_PipeWriteStats GetWriteStats() const = 0;
+
+    /** Fecha o canal (EOF para o FFmpeg) e remove qualquer arquivo criado no sistema de arquivos. */
+    virtual void Close() = 0;
+    /** Verdadeiro enquanto o canal está conectado e aceitando escrita. */
+    virtual bool IsValid() const = 0;
+};
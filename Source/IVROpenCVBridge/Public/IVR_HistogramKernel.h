@@ -0,0 +1,50 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IVROpenCVBridge.h"
+
+/**
+ * Histogramas B/G/R de um frame BGRA intercalado em uma única leitura, sem separar os planos.
+ * O frame é dividido em faixas de linhas processadas em paralelo; cada faixa conta em NumLanes
+ * sub-histogramas alternados (pixels vizinhos de mesma cor não incrementam o mesmo contador em
+ * sequência, evitando a dependência store-to-load) e todos são somados no final.
+ */
+struct IVROPENCVBRIDGE_API FIVR_HistogramKernel
+{
+    static constexpr int32 NumBins = 256;
+    static constexpr int32 NumLanes = 4;
+
+    /** Contagens brutas por canal (B, G, R). */
+    struct FCounts
+    {
+        uint32 Blue[NumBins];
+        uint32 Green[NumBins];
+        uint32 Red[NumBins];
+    };
+
+    /**
+     * Conta os pixels do frame.
+     * @param PixelData Pixels BGRA.
+     * @param Subsample Passo de amostragem em linhas e colunas (1 = todos os pixels, 2 = um a cada 2x2, ...).
+     * @param OutCounts Recebe as contagens (zeradas antes).
+     * @param RowPitch Bytes entre o início de duas linhas; 0 = Width * 4. Permite contar uma região de um frame maior.
+     * @return Número de pixels amostrados.
+     */
+    static int64 Count(const uint8* PixelData, int32 Width, int32 Height, int32 Subsample, FCounts& OutCounts, SIZE_T RowPitch = 0);
+
+    /** Soma as contagens de Other em InOutCounts (várias regiões do mesmo frame). */
+    static void Accumulate(FCounts& InOutCounts, const FCounts& Other);
+
+    /** Normaliza cada canal para 0-1 (min-max, como cv::normalize NORM_MINMAX). */
+    static void Normalize(const FCounts& Counts, TArray<float>& OutBlue, TArray<float>& OutGreen, TArray<float>& OutRed);
+
+    /**
+     * Conta e normaliza cada canal para 0-1.
+     * @return Falso se o frame for inválido (as saídas ficam vazias).
+     */
+    static bool ComputeNormalized(const uint8* PixelData, int32 Width, int32 Height, int32 Subsample,
+                                  TArray<float>& OutBlue, TArray<float>& OutGreen, TArray<float>& OutRed, SIZE_T RowPitch = 0);
+};
@@ -0,0 +1,60 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IVROpenCVBridge.h"
+
+/**
+ * Muxer Matroska mínimo para o stream de vídeo bruto enviado ao FFmpeg pelo pipe.
+ * Ao contrário de "-f rawvideo -r FPS", cada frame leva o seu próprio timestamp (SimpleBlock dentro de um Cluster),
+ * permitindo ao FFmpeg gerar saída VFR fiel ou CFR com duplicação/descartes contra o relógio nominal.
+ * Produz apenas os bytes de cabeçalho; o payload do frame é escrito pelo chamador logo em seguida (sem cópia).
+ */
+struct IVROPENCVBRIDGE_API FIVR_MatroskaPipeMuxer
+{
+public:
+    /** Escala de tempo do segmento: 1 ms por tick (padrão do Matroska). */
+    static constexpr int64 TimestampTicksPerSecond = 1000;
+
+    /** Bytes escritos antes do payload de cada frame por BuildFrameHeader. */
+    static constexpr int32 FrameHeaderBytes = 35;
+
+    /**
+     * Configura o stream.
+     * @param InWidth Largura dos frames.
+     * @param InHeight Altura dos frames.
+     * @param InPixelFormat Pixel format no vocabulário do FFmpeg ("bgra", "rgba"...), gravado como FourCC no ColourSpace.
+     * @return false se o pixel format não tem FourCC reconhecido pelo demuxer Matroska do FFmpeg (o stream não é configurado).
+     */
+    bool Configure(int32 InWidth, int32 InHeight, const FString& InPixelFormat);
+
+    /** Reinicia a linha do tempo: o próximo frame passa a ser o instante zero. */
+    void ResetTimeline();
+
+    /** Cabeçalho EBML + Segment (tamanho desconhecido) + Info + Tracks. Deve ser escrito uma vez, antes do primeiro frame. */
+    const TArray<uint8>& GetStreamHeader() const { return StreamHeader; }
+
+    /**
+     * Converte o timestamp do frame (nanossegundos do FIVR_CaptureClock) em ticks relativos ao primeiro frame,
+     * garantindo que sejam estritamente crescentes.
+     */
+    int64 ComputeFrameTicks(int64 FrameTimestampNs);
+
+    /**
+     * Preenche OutHeader com o Cluster e o SimpleBlock que precedem o payload de um frame.
+     * @return O número de bytes escritos (sempre FrameHeaderBytes).
+     */
+    int32 BuildFrameHeader(int64 FrameTicks, int32 PayloadBytes, uint8 (&OutHeader)[FrameHeaderBytes]) const;
+
+    /** Número de frames cujo timestamp não avançou e foi ajustado para manter a monotonicidade. */
+    int32 GetNonMonotonicFrames() const { return NonMonotonicFrames; }
+
+private:
+    TArray<uint8> StreamHeader;
+    bool bHasFirstTimestamp = false;
+    int64 FirstTimestampNs = 0;
+    int64 LastFrameTicks = -1;
+    int32 NonMonotonicFrames = 0;
+};
@@ -6,6 +6,9 @@
 #include "CoreMinimal.h"
 #include "IVROpenCVBridge.h" // Inclua o log principal do IVR, se LogIVRPipeWrapper usar LogIVR
 #include "IVRTypes.h" // Inclui a USTRUCT FIVR_PipeSettings
+#include "IVR_FrameTransport.h" // Interface IIVR_FrameTransport
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/CriticalSection.h"
 #if PLATFORM_WINDOWS
 #include "Windows/AllowWindowsPlatformTypes.h"
 #include <windows.h>
@@ -15,6 +18,7 @@
 #include <sys/stat.h>   // Para mkfifo
 #include <fcntl.h>      // Para open, O_RDWR, O_CREAT
 #include <unistd.h>     // Para close, write
+#include <sys/uio.h>    // Para struct iovec (vmsplice)
 #endif
 
 //#include "IVR_PipeWrapper.generated.h"
@@ -33,17 +37,19 @@ typedef int IVR_NativePipeHandle; // file descriptor é int
 // Definição de LogCategory para FIVR_PipeWrapper (se usar LogIVR)
 DECLARE_LOG_CATEGORY_EXTERN(LogIVRPipeWrapper, Log, All);
 
-
-
 /**
  * Encapsula um Named Pipe multiplataforma (HANDLE no Windows, file descriptor no Linux).
+ * Também serve de base para os demais transportes baseados em handle/descritor, que reaproveitam
+ * a lógica de escrita (entrega completa, writev/vmsplice, estatísticas).
  */
-struct IVROPENCVBRIDGE_API FIVR_PipeWrapper
+struct IVROPENCVBRIDGE_API FIVR_PipeWrapper : public IIVR_FrameTransport
 {
 public:
 
      FIVR_PipeWrapper();
-    ~FIVR_PipeWrapper();
+    virtual ~FIVR_PipeWrapper();
+
+    virtual EIVRFrameTransport GetTransportKind() const override { return EIVRFrameTransport::NamedPipe; }
     /**
     * Cria e abre o Named Pipe (Windows) ou FIFO (POSIX).
     * @param Settings As configurações para criar o pipe.
@@ -52,40 +58,80 @@ public:
     * @param InHeight Altura do vídeo (usada para calcular o tamanho do buffer do pipe).
     * @return true se o pipe foi criado e aberto com sucesso, false caso contrário.
     */
-    bool Create(const FIVR_PipeSettings& Settings, const FString& SessionID, int32 InWidth = 0, int32 InHeight = 0); // <--- ALTERAÇÃO: Adicionados parâmetros InWidth e InHeight
+    virtual bool Create(const FIVR_PipeSettings& Settings, const FString& SessionID, int32 InWidth = 0, int32 InHeight = 0) override; // <--- ALTERAÇÃO: Adicionados parâmetros InWidth e InHeight
     /**
      * Tenta conectar-se ao Named Pipe. Este método bloqueará até que um cliente
-     * (e.g., FFmpeg) se conecte ao pipe.
+     * (e.g., FFmpeg) se conecte ao pipe, até o timeout de FIVR_PipeSettings ou até AbortConnect().
      * Deve ser chamado DEPOIS que o pipe é criado (com Create()) e DEPOIS que o cliente
      * que vai ler/escrever no pipe é lançado.
      * @return true se a conexão foi bem-sucedida, false caso contrário.
      */
-    bool Connect(); // <-- NOVO MÉTODO
+    virtual bool Connect() override; // <-- NOVO MÉTODO
+    virtual void AbortConnect() override;
+    virtual FString GetFFmpegInputUrl() const override { return GetFullPipeName(); }
     /**
-     * Escreve dados no pipe.
+     * Escreve dados no pipe. Escritas parciais, EINTR e EAGAIN são tratados internamente (espera com poll):
+     * a chamada só retorna depois de entregar todos os bytes ou em caso de erro.
      * @param Data Ponteiro para os dados a serem escritos.
      * @param Size O número de bytes a serem escritos.
-     * @return O número de bytes realmente escritos, ou -1 em caso de erro.
+     * @return NumBytes se todos os bytes foram escritos, ou -1 em caso de erro.
+     */
+    virtual int32 Write(const uint8* Data, int32 NumBytes) override;
+
+    /**
+     * Escreve vários segmentos em ordem, com uma única chamada writev quando possível (POSIX).
+     * Mesma garantia de entrega completa de Write().
+     * @return true se todos os segmentos foram entregues.
+     */
+    virtual bool WriteGather(const FIVR_PipeWriteSpan* Spans, int32 NumSpans) override;
+
+    /**
+     * Escrita zero-copy (Linux): as páginas do buffer são mapeadas no pipe com vmsplice, sem doação (SPLICE_F_GIFT):
+     * os buffers do pool são TArrays comuns, reaproveitados depois do consumo. Bloqueia até entregar todos os bytes.
+     * O buffer NÃO pode ser alterado nem reaproveitado até que GetBytesConsumedByReader() ultrapasse o seu fim
+     * (GetTotalBytesWritten() logo após esta chamada).
+     * @return NumBytes se todos os bytes foram entregues, ou -1 em caso de erro.
      */
-    int32 Write(const uint8* Data, int32 NumBytes);
+    virtual int32 WriteZeroCopy(const uint8* Data, int32 NumBytes) override;
+
+    /** Versão em lote de WriteZeroCopy (um vmsplice com vários iovecs). Nas demais plataformas equivale a WriteGather. */
+    virtual bool WriteZeroCopyGather(const FIVR_PipeWriteSpan* Spans, int32 NumSpans) override;
+
+    /** Verdadeiro se WriteZeroCopy está disponível e habilitado (Linux com bUseZeroCopySplice). */
+    virtual bool IsZeroCopyEnabled() const override;
+
+    /** Total de bytes entregues ao pipe desde o Connect (Write e WriteZeroCopy). */
+    virtual int64 GetTotalBytesWritten() const override { return TotalBytesWritten; }
+
+    /**
+     * Bytes já lidos pelo leitor (total escrito menos o que ainda está no buffer do pipe).
+     * Em plataformas sem suporte retorna GetTotalBytesWritten().
+     */
+    virtual int64 GetBytesConsumedByReader() const override;
+
+    /** Capacidade do buffer do pipe em bytes, quando conhecida (0 caso contrário). */
+    virtual int32 GetPipeCapacity() const override { return PipeCapacityBytes; }
+
+    /** Bytes/s, chamadas e tempo de espera pelo leitor desde o Connect. */
+    virtual FIVR_PipeWriteStats GetWriteStats() const override;
 
     /**
      * Fecha o pipe e libera seus recursos.
      * Para FIFOs POSIX, isso também remove o arquivo do sistema de arquivos.
      */
-    void Close();
+    virtual void Close() override;
 
     /**
      * Verifica se o pipe está aberto e válido.
      */
-    bool IsValid() const;
+    virtual bool IsValid() const override;
 
     /**
      * Retorna o caminho completo do pipe (e.g., "\.\pipe\MyPipe" ou "/tmp/MyPipe").
      */
     FString GetFullPipeName() const;
 
-private:
+protected:
 
 #if PLATFORM_WINDOWS
     HANDLE PipeHandle; // HANDLE para Windows Named Pipe
@@ -97,8 +143,93 @@ private:
 
     FString FullPipePath; // Caminho completo para o pipe
     bool bIsCreatedAndConnected; // Indica se o pipe foi criado e está pronto para uso
+    FThreadSafeBool bConnectAborted; // AbortConnect() foi chamado
+#if PLATFORM_LINUX || PLATFORM_MAC
+    bool bFifoLinked = false;    // O FIFO ainda existe no sistema de arquivos (removido após o Connect)
+    bool bStreamSocket = false;  // O descritor é um socket (escreve com sendmsg/MSG_NOSIGNAL no Linux)
+#endif
+
+    int32 FrameBytesHint = 0;     // Tamanho de um frame (Create), usado para dimensionar o buffer do pipe
+    int32 PipeCapacityBytes = 0;  // Capacidade efetiva do buffer do pipe
+    int64 TotalBytesWritten = 0;  // Bytes entregues ao pipe desde o Connect
+
+    // Estatísticas acumuladas pela thread que escreve e lidas por outras (GetWriteStats): protegidas por WriteStatsLock.
+    mutable FCriticalSection WriteStatsLock;
+    FIVR_PipeWriteStats WriteStats;
+    uint64 ConnectCycles = 0;       // FPlatformTime::Cycles64() no Connect
+
+    /** Zera contadores e marca o início das estatísticas (chamado ao concluir o Connect). */
+    void ResetWriteStats();
+    /** Soma às estatísticas o que uma entrega acumulou localmente (um lock por entrega, não por chamada de sistema). */
+    void MergeWriteStats(const FIVR_PipeWriteStats& Delta);
+    /** Entrega todos os segmentos, repetindo em escritas parciais. bSplice usa vmsplice (Linux). */
+    bool DeliverSpans(const FIVR_PipeWriteSpan* Spans, int32 NumSpans, bool bSplice);
+#if PLATFORM_LINUX || PLATFORM_MAC
+    /** Espera (poll) até o pipe aceitar escrita. Retorna false se o leitor desapareceu. */
+    bool WaitUntilWritable();
+#endif
+
+#if PLATFORM_LINUX
+    /** Aumenta o buffer do FIFO (F_SETPIPE_SZ) para até um frame, respeitando /proc/sys/fs/pipe-max-size. */
+    void GrowPipeBuffer();
+#endif
+#if PLATFORM_LINUX || PLATFORM_MAC
+    /** Verdadeiro quando Connect() deve desistir (abortado ou após o prazo), registrando o motivo. */
+    bool ShouldGiveUpConnecting(double DeadlineSeconds) const;
+#endif
 
     // Desabilitar cópia e atribuição
     FIVR_PipeWrapper(const FIVR_PipeWrapper&) = delete;
     FIVR_PipeWrapper& operator=(const FIVR_PipeWrapper&) = delete;
-};
\ No newline at end of file
+};
+
+#if PLATFORM_WINDOWS || PLATFORM_LINUX
+/**
+ * Pipe anônimo cuja extremidade de leitura vira o stdin do FFmpeg ("-i pipe:0").
+ * Não cria nada no sistema de arquivos e não depende do FFmpeg abrir um caminho: Connect() não bloqueia.
+ * No Linux aceita F_SETPIPE_SZ e vmsplice como o FIFO.
+ */
+struct IVROPENCVBRIDGE_API FIVR_StdinPipeTransport : public FIVR_PipeWrapper
+{
+public:
+    virtual ~FIVR_StdinPipeTransport();
+
+    virtual EIVRFrameTransport GetTransportKind() const override { return EIVRFrameTransport::StdinPipe; }
+    virtual bool Create(const FIVR_PipeSettings& Settings, const FString& SessionID, int32 InWidth = 0, int32 InHeight = 0) override;
+    virtual bool Connect() override;
+    /** Sem FFmpeg lançado ninguém lerá o pipe: libera a extremidade do filho para que escritas paradas falhem. */
+    virtual void AbortConnect() override;
+    virtual FString GetFFmpegInputUrl() const override { return TEXT("pipe:0"); }
+    virtual void* GetChildStdinPipe() const override { return ChildReadPipe; }
+    virtual void OnReaderLaunched() override;
+    virtual void Close() override;
+
+protected:
+    void* ChildReadPipe = nullptr;  // Herdado pelo FFmpeg como stdin (FPlatformProcess::CreatePipe)
+    void* LocalWritePipe = nullptr; // Extremidade de escrita, não herdável
+};
+#endif
+
+#if PLATFORM_LINUX || PLATFORM_MAC
+/**
+ * Socket Unix (SOCK_STREAM) em que o FFmpeg se conecta como cliente ("-i unix:<caminho>").
+ * O SO_SNDBUF é ajustado para comportar ao menos um frame. Sem vmsplice (exclusivo de pipes).
+ */
+struct IVROPENCVBRIDGE_API FIVR_UnixSocketTransport : public FIVR_PipeWrapper
+{
+public:
+    virtual ~FIVR_UnixSocketTransport();
+
+    virtual EIVRFrameTransport GetTransportKind() const override { return EIVRFrameTransport::UnixSocket; }
+    virtual bool Create(const FIVR_PipeSettings& Settings, const FString& SessionID, int32 InWidth = 0, int32 InHeight = 0) override;
+    virtual bool Connect() override;
+    virtual FString GetFFmpegInputUrl() const override { return FString(TEXT("unix:")) + SocketPath; }
+    virtual bool IsZeroCopyEnabled() const override { return false; }
+    virtual int64 GetBytesConsumedByReader() const override { return TotalBytesWritten; }
+    virtual void Close() override;
+
+protected:
+    int ListenSocket = -1; // Socket de escuta (fechado após o accept)
+    FString SocketPath;    // Caminho do socket no sistema de arquivos (removido após o accept)
+};
+#endif
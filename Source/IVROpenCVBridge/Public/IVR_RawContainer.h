@@ -0,0 +1,136 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GenericPlatform/GenericPlatformFile.h" // Para IFileHandle
+#include "Async/MappedFileHandle.h"              // Para IMappedFileHandle / IMappedFileRegion
+#include "IVROpenCVBridge.h"
+#include "IVRTypes.h" // Para FIVR_VideoFrame
+
+DECLARE_LOG_CATEGORY_EXTERN(LogIVRRawContainer, Log, All);
+
+// Layout do container .ivrraw (little-endian):
+//   [Cabeçalho de 64 bytes][padding até IVR_RAW_BLOCK_ALIGNMENT]
+//   [Frame 0 (alinhado)][Frame 1 (alinhado)]...[Frame N-1 (alinhado)]
+//   [Índice: FrameCount entradas de FIVR_RawIndexEntry]
+// O cabeçalho é reescrito no Finalize com o offset do índice e o número de frames.
+#define IVR_RAW_BLOCK_ALIGNMENT 4096
+#define IVR_RAW_VERSION 1
+#define IVR_RAW_FLAG_LZ4 0x1
+
+/** Cabeçalho fixo do container .ivrraw. */
+struct FIVR_RawContainerHeader
+{
+    ANSICHAR Magic[8];     // "IVRRAW\0\0"
+    uint32 Version;
+    uint32 HeaderBytes;    // sizeof(FIVR_RawContainerHeader)
+    int32 Width;
+    int32 Height;
+    float NominalFPS;
+    uint32 PixelFormat;    // FourCC, sempre 'BGRA' nesta versão
+    uint32 Flags;          // IVR_RAW_FLAG_*
+    uint32 Reserved0;
+    int64 IndexOffset;     // Offset do índice (0 enquanto o container não foi finalizado)
+    int64 FrameCount;
+    int64 Reserved1;
+};
+static_assert(sizeof(FIVR_RawContainerHeader) == 64, "FIVR_RawContainerHeader deve ter 64 bytes.");
+
+/** Entrada do índice: localização, tamanho e timestamp de um frame. */
+struct FIVR_RawIndexEntry
+{
+    int64 Offset;
+    int32 StoredBytes;     // Bytes gravados (comprimidos ou não)
+    int32 RawBytes;        // Tamanho do frame BGRA descomprimido
+    int64 TimestampNs;     // Timestamp original do frame (FIVR_CaptureClock, nanossegundos)
+    uint32 Flags;          // IVR_RAW_FLAG_LZ4 se este frame foi comprimido
+    uint32 Reserved;
+};
+static_assert(sizeof(FIVR_RawIndexEntry) == 32, "FIVR_RawIndexEntry deve ter 32 bytes.");
+
+/**
+ * Grava frames BGRA, sem codificação, em um container .ivrraw indexado.
+ * As escritas são sequenciais e alinhadas; o índice é mantido em memória e gravado no Finalize.
+ * NÃO é thread-safe: deve ser usado por uma única thread (o IVRecThread).
+ */
+class IVROPENCVBRIDGE_API FIVR_RawContainerWriter
+{
+public:
+    FIVR_RawContainerWriter();
+    ~FIVR_RawContainerWriter();
+
+    /**
+     * Cria o container e grava um cabeçalho provisório.
+     * @param InFilePath Caminho completo do arquivo .ivrraw.
+     * @param InWidth Largura dos frames.
+     * @param InHeight Altura dos frames.
+     * @param InNominalFPS Taxa nominal da captura (metadado para o encode posterior).
+     * @param bInCompressLZ4 Se verdadeiro, cada frame é comprimido com LZ4.
+     */
+    bool Open(const FString& InFilePath, int32 InWidth, int32 InHeight, float InNominalFPS, bool bInCompressLZ4);
+
+    /** Acrescenta um frame ao container. Não libera o buffer do frame. */
+    bool Append(const FIVR_VideoFrame& Frame);
+
+    /** Grava o índice e o cabeçalho definitivo e fecha o arquivo. */
+    bool Finalize();
+
+    /** Fecha e apaga o arquivo sem finalizar. */
+    void Abort();
+
+    bool IsOpen() const { return FileHandle.IsValid(); }
+    int32 Num() const { return Index.Num(); }
+    const FString& GetFilePath() const { return FilePath; }
+
+    FIVR_RawContainerWriter(const FIVR_RawContainerWriter&) = delete;
+    FIVR_RawContainerWriter& operator=(const FIVR_RawContainerWriter&) = delete;
+
+private:
+    TUniquePtr<IFileHandle> FileHandle;
+    FString FilePath;
+    FIVR_RawContainerHeader Header;
+    TArray<FIVR_RawIndexEntry> Index;
+    int64 WriteOffset = 0;
+    TArray<uint8> CompressionScratch;
+    TArray<uint8> ZeroPadding;
+};
+
+/**
+ * Lê um container .ivrraw finalizado através de um mapeamento de memória do arquivo inteiro.
+ */
+class IVROPENCVBRIDGE_API FIVR_RawContainerReader
+{
+public:
+    FIVR_RawContainerReader();
+    ~FIVR_RawContainerReader();
+
+    /** Mapeia o arquivo e valida cabeçalho e índice. */
+    bool Open(const FString& InFilePath);
+    void Close();
+
+    bool IsOpen() const { return MappedRegion.IsValid(); }
+    int32 Num() const { return FrameCount; }
+    const FIVR_RawContainerHeader& GetHeader() const { return Header; }
+
+    /** Retorna a entrada de índice do frame (válida após Open). */
+    const FIVR_RawIndexEntry& GetEntry(int32 FrameIndex) const { return IndexEntries[FrameIndex]; }
+
+    /**
+     * Copia (ou descomprime) o frame para Dest, que deve ter pelo menos GetEntry(FrameIndex).RawBytes bytes.
+     */
+    bool ReadFrame(int32 FrameIndex, uint8* Dest, int32 DestBytes) const;
+
+    FIVR_RawContainerReader(const FIVR_RawContainerReader&) = delete;
+    FIVR_RawContainerReader& operator=(const FIVR_RawContainerReader&) = delete;
+
+private:
+    TUniquePtr<IMappedFileHandle> MappedHandle;
+    TUniquePtr<IMappedFileRegion> MappedRegion;
+    const uint8* MappedData = nullptr;
+    int64 MappedSize = 0;
+    FIVR_RawContainerHeader Header;
+    const FIVR_RawIndexEntry* IndexEntries = nullptr;
+    int32 FrameCount = 0;
+};
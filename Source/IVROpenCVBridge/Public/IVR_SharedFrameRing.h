@@ -0,0 +1,71 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IVROpenCVBridge.h"
+#include "IVRTypes.h" // Para FIVR_VideoFrame
+#include "IVR_SharedFrameRingABI.h" // Layout compartilhado com os leitores externos
+
+DECLARE_LOG_CATEGORY_EXTERN(LogIVRSharedFrameRing, Log, All);
+
+/**
+ * Publica frames BGRA em um anel de memória compartilhada nomeado (POSIX shm no Linux/macOS,
+ * file mapping no Windows), para que processos locais consumam a captura sem cópia.
+ * O layout é definido em IVR_SharedFrameRingABI.h. O escritor nunca espera pelos leitores:
+ * cada Publish copia o frame para o próximo slot e segue, e leitores lentos apenas perdem frames.
+ * NÃO é thread-safe: Open/Publish/Close devem ser chamados pela mesma thread (a Game Thread).
+ */
+class IVROPENCVBRIDGE_API FIVR_SharedFrameRingWriter
+{
+public:
+    FIVR_SharedFrameRingWriter();
+    ~FIVR_SharedFrameRingWriter();
+
+    /**
+     * Cria (ou recria) o anel e mapeia todos os slots.
+     * @param InRingName Nome lógico do anel. O nome do sistema é "/IVR_<nome>" (POSIX) ou "Local\IVR_<nome>" (Windows).
+     * @param InWidth Largura nominal dos frames (define a capacidade dos slots).
+     * @param InHeight Altura nominal dos frames.
+     * @param InSlotCount Número de slots (mínimo 2).
+     * @return true se o anel foi criado e está pronto para publicar.
+     */
+    bool Open(const FString& InRingName, int32 InWidth, int32 InHeight, int32 InSlotCount);
+
+    /** Marca o anel como fechado para os leitores, desmapeia e remove o nome do sistema. */
+    void Close();
+
+    bool IsOpen() const { return Header != nullptr; }
+
+    /**
+     * Copia o frame para o próximo slot e avisa os leitores. Não libera o buffer do frame.
+     * @return false se o anel não estiver aberto ou o frame não couber no slot.
+     */
+    bool Publish(const FIVR_VideoFrame& Frame);
+
+    /** Nome do mapeamento no sistema operacional, usado pelos leitores para anexar. */
+    const FString& GetSystemName() const { return SystemName; }
+
+    uint64 GetFramesPublished() const { return FramesPublished; }
+    uint64 GetFramesRejected() const { return FramesRejected; }
+
+    // Não copiável (possui o mapeamento)
+    FIVR_SharedFrameRingWriter(const FIVR_SharedFrameRingWriter&) = delete;
+    FIVR_SharedFrameRingWriter& operator=(const FIVR_SharedFrameRingWriter&) = delete;
+
+private:
+    /** Sinaliza os leitores bloqueados de que Doorbell mudou. */
+    void RingDoorbell(uint32 NewDoorbell);
+
+    IVR_ShmRingHeader* Header = nullptr;
+    uint64 MappedBytes = 0;
+    FString SystemName;
+    uint64 FramesPublished = 0;
+    uint64 FramesRejected = 0;
+
+#if PLATFORM_WINDOWS
+    void* MappingHandle = nullptr;
+    void* DoorbellEvents[2] = { nullptr, nullptr }; // Par/ímpar, ver IVR_SharedFrameRingABI.h
+#endif
+};
@@ -0,0 +1,201 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#pragma once
+
+/*
+ * ABI do anel de frames em memória compartilhada publicado pelo IVR (FIVR_SharedFrameRingWriter).
+ * Header C puro, sem dependências da Unreal: processos externos (Python/ctypes, C, C++) incluem
+ * apenas este arquivo para ler os frames diretamente do mapeamento, sem cópia.
+ *
+ * Como anexar (NOME = IVR_SharedRingName das FIVR_VideoSettings):
+ *  - Linux/macOS: fd = shm_open("/IVR_NOME", O_RDONLY, 0); fstat(fd); mmap(PROT_READ, MAP_SHARED).
+ *  - Windows:     OpenFileMappingA(FILE_MAP_READ, FALSE, "Local\\IVR_NOME"); MapViewOfFile(FILE_MAP_READ).
+ *
+ * Layout: IVR_ShmRingHeader no início e SlotCount slots de SlotStride bytes a partir de HeaderBytes.
+ * Cada slot começa com um IVR_ShmSlotHeader (64 bytes) e o payload BGRA vem logo depois, sempre
+ * alinhado a IVR_SHM_PAYLOAD_ALIGNMENT.
+ *
+ * O frame de índice N (0, 1, 2, ...) vai para o slot N % SlotCount. O Sequence do slot funciona como
+ * seqlock: vale 2N+1 enquanto o escritor copia o frame e 2N+2 depois de publicado. O escritor NUNCA
+ * espera pelos leitores: um leitor lento simplesmente perde frames (IVR_ShmRing_NextFrame pula para o
+ * mais antigo ainda válido) e IVR_ShmRing_EndRead avisa se o slot foi sobrescrito durante a leitura.
+ *
+ * Espera por novos frames:
+ *  - Linux:   futex FUTEX_WAIT em Doorbell (incrementado a cada publicação), ver IVR_ShmRing_WaitLinux.
+ *  - Windows: eventos de reset manual "Local\\IVR_NOME_Even" / "Local\\IVR_NOME_Odd". O escritor sinaliza
+ *             o evento da paridade do novo Doorbell e reseta o da outra. Espere com timeout curto e
+ *             confira WriteSequence de novo.
+ *  - macOS:   não há doorbell; faça polling de WriteSequence.
+ * Em C estrito (-std=c99) defina _GNU_SOURCE antes de incluir este header (syscall/timespec no Linux).
+ *
+ * Quando o escritor fecha o anel, WriterState passa a 0. Leitores devem desmapear e anexar de novo.
+ * No Linux/macOS uma nova sessão cria um objeto novo com o mesmo nome; no Windows o mapeamento ainda
+ * aberto por um leitor é reaproveitado e WriteSequence recomeça do zero (IVR_ShmRing_NextFrame trata isso).
+ */
+
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IVR_SHM_RING_MAGIC        0x52525649u /* "IVRR" em little-endian */
+#define IVR_SHM_RING_VERSION      1u
+#define IVR_SHM_PAYLOAD_ALIGNMENT 4096u
+#define IVR_SHM_FOURCC_BGRA       0x41524742u /* "BGRA" em little-endian */
+
+/* Sequence de um slot que contém o frame FrameIndex já publicado. */
+#define IVR_SHM_PUBLISHED_SEQUENCE(FrameIndex) (((uint64_t)(FrameIndex) + 1u) * 2u)
+
+typedef struct IVR_ShmRingHeader
+{
+    /* Linha de cache 0: imutável depois da criação */
+    uint32_t Magic;            /* IVR_SHM_RING_MAGIC */
+    uint32_t Version;          /* IVR_SHM_RING_VERSION */
+    uint32_t HeaderBytes;      /* Offset do slot 0 a partir do início do mapeamento */
+    uint32_t SlotCount;
+    uint64_t SlotStride;       /* Distância em bytes entre slots consecutivos */
+    uint64_t SlotPayloadBytes; /* Capacidade do payload de cada slot */
+    uint32_t Width;            /* Resolução nominal do anel (cada slot traz a do seu frame) */
+    uint32_t Height;
+    uint32_t PixelFormat;      /* IVR_SHM_FOURCC_BGRA */
+    uint32_t WriterPid;
+    uint64_t TotalBytes;       /* Tamanho total do mapeamento */
+    uint8_t  Reserved0[8];
+
+    /* Linha de cache 1: atualizada a cada frame */
+    volatile uint64_t WriteSequence; /* Frames publicados; o mais recente é WriteSequence - 1 */
+    volatile uint32_t Doorbell;      /* Palavra do futex (Linux); incrementada a cada publicação */
+    volatile uint32_t WriterState;   /* 1 = escritor ativo, 0 = anel fechado */
+    uint8_t  Reserved1[48];
+} IVR_ShmRingHeader;
+
+typedef struct IVR_ShmSlotHeader
+{
+    volatile uint64_t Sequence; /* Seqlock: 2N+1 escrevendo, 2N+2 frame N publicado */
+    uint64_t FrameIndex;        /* N */
+    int64_t  TimestampNs;       /* Instante da captura no relógio de captura do IVR */
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t Stride;            /* Bytes por linha do payload */
+    uint32_t PayloadBytes;
+    uint8_t  Reserved[24];
+} IVR_ShmSlotHeader;
+
+#if defined(__cplusplus) && __cplusplus >= 201103L
+static_assert(sizeof(IVR_ShmRingHeader) == 128, "IVR_ShmRingHeader deve ter 128 bytes");
+static_assert(sizeof(IVR_ShmSlotHeader) == 64, "IVR_ShmSlotHeader deve ter 64 bytes");
+#endif
+
+static inline uint64_t IVR_ShmLoadAcquire64(const volatile uint64_t* Address)
+{
+#if defined(_MSC_VER)
+    const uint64_t Value = *Address;
+#if defined(_M_ARM64)
+    __dmb(_ARM64_BARRIER_ISH);
+#else
+    _ReadWriteBarrier(); /* x86/x64: loads já têm semântica de acquire */
+#endif
+    return Value;
+#else
+    return __atomic_load_n(Address, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void IVR_ShmReadFence(void)
+{
+#if defined(_MSC_VER)
+#if defined(_M_ARM64)
+    __dmb(_ARM64_BARRIER_ISH);
+#else
+    _ReadWriteBarrier();
+#endif
+#else
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+#endif
+}
+
+/* Confere magic, versão e tamanho. Retorna 1 se o mapeamento é um anel IVR utilizável. */
+static inline int IVR_ShmRing_Validate(const void* MappedBase, uint64_t MappedBytes)
+{
+    const IVR_ShmRingHeader* Ring = (const IVR_ShmRingHeader*)MappedBase;
+    if (!MappedBase || MappedBytes < sizeof(IVR_ShmRingHeader)) return 0;
+    if (Ring->Magic != IVR_SHM_RING_MAGIC || Ring->Version != IVR_SHM_RING_VERSION) return 0;
+    if (Ring->SlotCount == 0 || Ring->TotalBytes > MappedBytes) return 0;
+    return (uint64_t)Ring->HeaderBytes + (uint64_t)Ring->SlotCount * Ring->SlotStride <= MappedBytes;
+}
+
+static inline const IVR_ShmSlotHeader* IVR_ShmRing_Slot(const IVR_ShmRingHeader* Ring, uint64_t FrameIndex)
+{
+    return (const IVR_ShmSlotHeader*)((const uint8_t*)Ring + Ring->HeaderBytes + (FrameIndex % Ring->SlotCount) * Ring->SlotStride);
+}
+
+static inline const uint8_t* IVR_ShmRing_SlotPayload(const IVR_ShmRingHeader* Ring, const IVR_ShmSlotHeader* Slot)
+{
+    (void)Ring;
+    return (const uint8_t*)Slot + sizeof(IVR_ShmSlotHeader);
+}
+
+/*
+ * Avança o cursor do leitor. Retorna 0 se não há frame novo. Se o leitor ficou para trás, o cursor
+ * pula para o frame mais antigo ainda seguro (um slot de folga para o que está sendo escrito) e
+ * OutSkipped (opcional) recebe quantos frames foram perdidos.
+ */
+static inline int IVR_ShmRing_NextFrame(const IVR_ShmRingHeader* Ring, uint64_t* InOutCursor, uint64_t* OutSkipped)
+{
+    const uint64_t Written = IVR_ShmLoadAcquire64(&Ring->WriteSequence);
+    const uint64_t SafeSlots = Ring->SlotCount > 1 ? Ring->SlotCount - 1 : 1;
+    const uint64_t Oldest = Written > SafeSlots ? Written - SafeSlots : 0;
+    if (OutSkipped) *OutSkipped = 0;
+    if (*InOutCursor > Written) *InOutCursor = Oldest; /* Escritor reiniciou o anel (nova sessão) */
+    if (*InOutCursor >= Written) return 0;
+    if (*InOutCursor < Oldest)
+    {
+        if (OutSkipped) *OutSkipped = Oldest - *InOutCursor;
+        *InOutCursor = Oldest;
+    }
+    return 1;
+}
+
+/* Começa a ler o frame FrameIndex. Retorna 0 se o slot já não contém esse frame (leitor foi ultrapassado). */
+static inline int IVR_ShmRing_BeginRead(const IVR_ShmRingHeader* Ring, uint64_t FrameIndex, const IVR_ShmSlotHeader** OutSlot, uint64_t* OutSequence)
+{
+    const IVR_ShmSlotHeader* Slot = IVR_ShmRing_Slot(Ring, FrameIndex);
+    const uint64_t Sequence = IVR_ShmLoadAcquire64(&Slot->Sequence);
+    if (Sequence != IVR_SHM_PUBLISHED_SEQUENCE(FrameIndex)) return 0;
+    *OutSlot = Slot;
+    *OutSequence = Sequence;
+    return 1;
+}
+
+/* Termina a leitura. Retorna 1 se o payload lido continua válido; 0 se foi sobrescrito no meio (descarte o resultado). */
+static inline int IVR_ShmRing_EndRead(const IVR_ShmSlotHeader* Slot, uint64_t Sequence)
+{
+    IVR_ShmReadFence();
+    return IVR_ShmLoadAcquire64(&Slot->Sequence) == Sequence;
+}
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Bloqueia até o Doorbell mudar em relação a ObservedDoorbell ou até TimeoutMs expirar. */
+static inline void IVR_ShmRing_WaitLinux(const IVR_ShmRingHeader* Ring, uint32_t ObservedDoorbell, int TimeoutMs)
+{
+    struct timespec Timeout;
+    Timeout.tv_sec = TimeoutMs / 1000;
+    Timeout.tv_nsec = (long)(TimeoutMs % 1000) * 1000000L;
+    syscall(SYS_futex, (const volatile uint32_t*)&Ring->Doorbell, FUTEX_WAIT, ObservedDoorbell, &Timeout, NULL, 0);
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,100 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "GenericPlatform/GenericPlatformFile.h" // Para IFileHandle
+#include "IVROpenCVBridge.h"
+#include "IVRTypes.h" // Para FIVR_VideoFrame
+#include "IVRFramePool.h" // Para UIVRFramePool
+
+DECLARE_LOG_CATEGORY_EXTERN(LogIVRSpillRingFile, Log, All);
+
+/**
+ * Arquivo em anel pré-alocado usado como camada de "spill" da sessão de gravação.
+ * Quando o encoder não acompanha a captura, os frames excedentes são escritos aqui (opcionalmente
+ * comprimidos com LZ4) e lidos de volta, na mesma ordem, quando o encoder volta a ter folga.
+ * Cada registro ocupa um múltiplo de SpillBlockAlignment bytes, de modo que todas as escritas são
+ * grandes, sequenciais e alinhadas. O índice dos registros fica apenas em memória.
+ * NÃO é thread-safe: Push/Pop devem ser chamados sempre pela mesma thread (o IVRecThread).
+ */
+struct IVROPENCVBRIDGE_API FIVR_SpillRingFile
+{
+public:
+    /** Alinhamento (em bytes) de cada registro no arquivo. */
+    static constexpr int64 SpillBlockAlignment = 4096;
+
+    FIVR_SpillRingFile();
+    ~FIVR_SpillRingFile();
+
+    /**
+     * Cria (ou recria) o arquivo em anel e reserva sua extensão completa.
+     * @param InFilePath Caminho completo do arquivo de spill.
+     * @param InCapacityBytes Capacidade total do anel em bytes (arredondada para o alinhamento).
+     * @param bInCompressLZ4 Se verdadeiro, comprime cada frame com LZ4 antes de escrever.
+     * @return true se o arquivo foi criado com sucesso.
+     */
+    bool Open(const FString& InFilePath, int64 InCapacityBytes, bool bInCompressLZ4);
+
+    /** Fecha o arquivo, descarta os registros pendentes e remove o arquivo do disco. */
+    void Close();
+
+    bool IsOpen() const { return FileHandle.IsValid(); }
+
+    /**
+     * Escreve o frame no final do anel. Não libera o buffer do frame (responsabilidade de quem chama).
+     * @return false se não houver espaço contíguo suficiente ou em caso de erro de E/S.
+     */
+    bool Push(const FIVR_VideoFrame& Frame);
+
+    /**
+     * Lê o registro mais antigo do anel para um buffer adquirido do FramePool.
+     * @return false se o anel estiver vazio ou em caso de erro de leitura (o registro é descartado).
+     */
+    bool Pop(FIVR_VideoFrame& OutFrame, UIVRFramePool* FramePool);
+
+    /** Número de frames armazenados no anel. */
+    int32 Num() const { return NumRecords; }
+
+    int64 GetUsedBytes() const { return UsedBytes; }
+    int64 GetCapacityBytes() const { return CapacityBytes; }
+
+    // Não copiável (possui o handle do arquivo)
+    FIVR_SpillRingFile(const FIVR_SpillRingFile&) = delete;
+    FIVR_SpillRingFile& operator=(const FIVR_SpillRingFile&) = delete;
+
+private:
+    /** Entrada do índice em memória de um registro gravado no anel. */
+    struct FSpillRecord
+    {
+        int64 Offset = 0;        // Início do registro no arquivo (sempre alinhado)
+        int64 SpanBytes = 0;     // Espaço ocupado no anel (payload + padding)
+        int32 PayloadBytes = 0;  // Bytes úteis gravados
+        int32 RawBytes = 0;      // Tamanho original do frame (BGRA)
+        int32 Width = 0;
+        int32 Height = 0;
+        int64 TimestampNs = 0;
+        bool bCompressed = false;
+    };
+
+    /** Reserva espaço contíguo para SpanBytes. Retorna o offset ou INDEX_NONE se o anel estiver cheio. */
+    int64 ReserveSpan(int64 SpanBytes) const;
+
+    TUniquePtr<IFileHandle> FileHandle;
+    FString FilePath;
+    int64 CapacityBytes = 0;
+    int64 WriteOffset = 0;   // Próxima posição de escrita (cauda)
+    int64 ReadOffset = 0;    // Registro mais antigo (cabeça)
+    int64 UsedBytes = 0;     // Bytes ocupados, incluindo o trecho perdido no final ao dar a volta
+    int64 WrapWasteBytes = 0; // Trecho no final do arquivo pulado na última volta
+    bool bWrapped = false;    // Cauda já voltou ao início, mas a cabeça ainda não
+    bool bCompressLZ4 = false;
+
+    TQueue<FSpillRecord, EQueueMode::Spsc> Records;
+    int32 NumRecords = 0;
+
+    TArray<uint8> CompressionScratch; // Buffer reutilizado para compressão/descompressão
+    TArray<uint8> ZeroPadding;        // Bloco de zeros para completar o alinhamento
+};
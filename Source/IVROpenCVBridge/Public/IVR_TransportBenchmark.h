@@ -0,0 +1,45 @@
+﻿// Copyright 2025 William Wolff. All Rights Reserved.
+// This code is property of Williäm Wolff and protected by copyright law.
+// Proibited copy or distribution without expressed authorization of the Author.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "IVRTypes.h" // Para EIVRFrameTransport
+
+DECLARE_LOG_CATEGORY_EXTERN(LogIVRTransportBenchmark, Log, All);
+
+/** Resultado de uma rodada do microbenchmark de transporte. */
+struct FIVR_TransportBenchmarkResult
+{
+    EIVRFrameTransport Transport = EIVRFrameTransport::NamedPipe; // Tipo efetivo (após fallback de plataforma)
+    bool bZeroCopy = false;         // Payloads enviados com vmsplice
+    int32 Width = 0;
+    int32 Height = 0;
+    int32 NumFrames = 0;
+    bool bSucceeded = false;
+    double MegabytesPerSecond = 0.0;
+    double FramesPerSecond = 0.0;
+    double AvgLatencyMs = 0.0;      // Do início da escrita até o frame inteiro ser lido, sob carga máxima
+    double P99LatencyMs = 0.0;
+    double StallRatio = 0.0;        // Fração do tempo em que o escritor esperou o leitor
+    int32 KernelBufferBytes = 0;    // Capacidade do pipe / SO_SNDBUF efetiva
+};
+
+/**
+ * Microbenchmark dos transportes UE -> FFmpeg (IIVR_FrameTransport).
+ * Um leitor em processo (thread) substitui o FFmpeg, de modo que só o custo do canal é medido.
+ */
+struct IVROPENCVBRIDGE_API FIVR_TransportBenchmark
+{
+    /**
+     * Envia NumFrames frames BGRA de Width x Height pelo transporte e mede vazão e latência.
+     * @param bZeroCopy Usa vmsplice quando o transporte suporta (Linux, pipes).
+     */
+    static FIVR_TransportBenchmarkResult RunSingle(EIVRFrameTransport Transport, int32 Width, int32 Height, int32 NumFrames, bool bZeroCopy);
+
+    /** Roda todos os transportes disponíveis na plataforma em 1080p e 4K e registra uma tabela no log. */
+    static TArray<FIVR_TransportBenchmarkResult> RunAll(int32 NumFrames = 120);
+
+    /** Linha de relatório legível para um resultado. */
+    static FString Describe(const FIVR_TransportBenchmarkResult& Result);
+};